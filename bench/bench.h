@@ -0,0 +1,192 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace bench
+{
+    // Prevent the optimizer from discarding a computed value
+    template <class T>
+    inline void do_not_optimize(T const &value)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        static volatile const void *sink;
+        sink = &value;
+#endif
+    }
+
+    inline void clobber_memory()
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : : "memory");
+#endif
+    }
+
+    struct result
+    {
+        std::string name;
+        std::string params;
+        int samples;
+        std::int64_t iterations; // per sample
+        double min_ns;
+        double median_ns;
+        double mean_ns;
+        double stddev_ns;
+        double mad_ns; // median absolute deviation
+    };
+
+    struct options
+    {
+        std::string filter;
+        std::string csv_path;
+        std::string json_path;
+        std::string compare_path;
+        int samples = 15;
+        double min_sample_ms = 5.0;
+        bool list_only = false;
+    };
+
+    class runner
+    {
+    public:
+        explicit runner(options opts)
+            : opts(std::move(opts))
+        { }
+
+        // Time `body` and record one result line. The body is run in
+        // batches sized so that one sample lasts at least `min_sample_ms`,
+        // which keeps the timer resolution out of the statistics.
+        template <class F>
+        void run(std::string_view name, std::string_view params, F &&body)
+        {
+            std::string full_name = std::string(name);
+            if (!params.empty())
+                full_name += "/" + std::string(params);
+
+            if (!opts.filter.empty()
+                && full_name.find(opts.filter) == std::string::npos)
+                return;
+
+            if (opts.list_only)
+            {
+                listed.push_back(full_name);
+                return;
+            }
+
+            std::int64_t iterations = calibrate(body);
+
+            // One untimed warmup sample to settle caches and clocks
+            time_batch(body, iterations);
+
+            std::vector<double> per_iter(opts.samples);
+            for (auto &sample : per_iter)
+                sample = time_batch(body, iterations)
+                    / static_cast<double>(iterations);
+
+            results.push_back(summarize(std::string(name), std::string(params),
+                                        iterations, per_iter));
+            print_line(results.back());
+        }
+
+        const std::vector<result> &get_results() const
+        {
+            return results;
+        }
+
+        const std::vector<std::string> &get_listed() const
+        {
+            return listed;
+        }
+
+        const options &get_options() const
+        {
+            return opts;
+        }
+
+    private:
+        template <class F>
+        static double time_batch(F &body, std::int64_t iterations)
+        {
+            auto start = std::chrono::steady_clock::now();
+            for (std::int64_t i = 0; i < iterations; i++)
+                body();
+            clobber_memory();
+            auto end = std::chrono::steady_clock::now();
+            return std::chrono::duration<double, std::nano>(end - start)
+                .count();
+        }
+
+        template <class F>
+        std::int64_t calibrate(F &body)
+        {
+            const double target_ns = opts.min_sample_ms * 1e6;
+            std::int64_t iterations = 1;
+            while (true)
+            {
+                double elapsed = time_batch(body, iterations);
+                if (elapsed >= target_ns || iterations >= (1LL << 30))
+                    return iterations;
+
+                double scale = elapsed > 0.0 ? target_ns / elapsed : 10.0;
+                scale = std::clamp(scale * 1.2, 2.0, 10.0);
+                iterations = static_cast<std::int64_t>(
+                    std::ceil(static_cast<double>(iterations) * scale));
+            }
+        }
+
+        static result summarize(std::string name, std::string params,
+                                std::int64_t iterations,
+                                std::vector<double> &samples);
+        static void print_line(const result &res);
+
+        options opts;
+        std::vector<result> results;
+        std::vector<std::string> listed;
+    };
+
+    using bench_fn = void (*)(runner &);
+
+    struct registry_entry
+    {
+        const char *group;
+        bench_fn fn;
+    };
+
+    std::vector<registry_entry> &registry();
+
+    struct registrar
+    {
+        registrar(const char *group, bench_fn fn)
+        {
+            registry().push_back({ group, fn });
+        }
+    };
+
+    void write_csv(const std::vector<result> &results, const std::string &path);
+    void write_json(const std::vector<result> &results,
+                    const std::string &path);
+    void print_comparison(const std::vector<result> &results,
+                          const std::string &baseline_csv);
+
+} // namespace bench
+
+#define BENCH_CONCAT_IMPL(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_IMPL(a, b)
+
+// Declare a group of benchmarks. The body receives `bench::runner &runner`
+// and calls runner.run(name, params, lambda) for every case.
+#define BENCHMARK_GROUP(group)                                                 \
+    static void BENCH_CONCAT(bench_group_, __LINE__)(bench::runner &);         \
+    static bench::registrar BENCH_CONCAT(bench_registrar_, __LINE__)(          \
+        group, &BENCH_CONCAT(bench_group_, __LINE__));                         \
+    static void BENCH_CONCAT(bench_group_, __LINE__)(                          \
+        [[maybe_unused]] bench::runner & runner)
@@ -0,0 +1,53 @@
+#include <array>
+
+#include "../fastmathart/utils/pixelUtils.h"
+#include "bench.h"
+
+BENCHMARK_GROUP("color")
+{
+    // A fixed spread of inputs so the results do not depend on one value
+    std::array<color_t<RGB_8>, 16> rgb8{
+        color_t<RGB_8>(0, 0, 0),       color_t<RGB_8>(255, 255, 255),
+        color_t<RGB_8>(255, 0, 0),     color_t<RGB_8>(0, 255, 0),
+        color_t<RGB_8>(0, 0, 255),     color_t<RGB_8>(12, 34, 56),
+        color_t<RGB_8>(200, 100, 50),  color_t<RGB_8>(77, 88, 99),
+        color_t<RGB_8>(128, 128, 128), color_t<RGB_8>(1, 2, 3),
+        color_t<RGB_8>(250, 20, 140),  color_t<RGB_8>(60, 200, 180),
+        color_t<RGB_8>(90, 10, 220),   color_t<RGB_8>(33, 66, 99),
+        color_t<RGB_8>(240, 230, 10),  color_t<RGB_8>(5, 150, 75)
+    };
+
+    std::size_t i = 0;
+    auto next = [&]() -> color_t<RGB_8> & { return rgb8[i++ & 15]; };
+
+    runner.run("RGB_8::toOklab", "", [&] {
+        bench::do_not_optimize(next().toOklab());
+    });
+    runner.run("RGB_8::toRGB_f32", "", [&] {
+        bench::do_not_optimize(next().toRGB_f32());
+    });
+    runner.run("RGB_8::toLinearRGB_8", "", [&] {
+        bench::do_not_optimize(next().toLinearRGB_8());
+    });
+    runner.run("RGB_f32::toRGB_8", "", [&] {
+        auto c = next().toRGB_f32();
+        bench::do_not_optimize(c.toRGB_8());
+    });
+    runner.run("RGB_f32::toLinearRGB_f32", "", [&] {
+        auto c = next().toRGB_f32();
+        bench::do_not_optimize(c.toLinearRGB_f32());
+    });
+    runner.run("LinearRGB_f32::toRGB_8", "", [&] {
+        auto c = next().toRGB_f32().toLinearRGB_f32();
+        bench::do_not_optimize(c.toRGB_8());
+    });
+    runner.run("blend<RGB_8>", "", [&] {
+        bench::do_not_optimize(blend(next(), next(), 0.3f));
+    });
+
+    PyAPI::Color py_color{ 0.3f, 0.6f, 0.8f };
+    runner.run("cast_to_color_t_RGB_8", "", [&] {
+        bench::do_not_optimize(py_color);
+        bench::do_not_optimize(cast_to_color_t_RGB_8(py_color));
+    });
+}
@@ -0,0 +1,161 @@
+#include <cmath>
+#include <numbers>
+
+#include "../fastmathart/math/bezier.h"
+#include "../fastmathart/math/expression.h"
+#include "../fastmathart/math/projection.h"
+#include "../fastmathart/math/simplify.h"
+#include "../fastmathart/utils/arena.h"
+#include "bench.h"
+
+// Deterministic closed path with `count` curves around the unit circle
+static math::BezierPath make_path(int count, float wobble)
+{
+    std::vector<math::CubicBezier> curves;
+    curves.reserve(count);
+
+    auto point_at = [&](int i) {
+        float angle = 2.0f * std::numbers::pi_v<float> * float(i) / count;
+        float radius = 0.5f + wobble * std::sin(7.0f * angle);
+        return math::fvec3(radius * std::cos(angle), radius * std::sin(angle),
+                           0.0f);
+    };
+
+    for (int i = 0; i < count; i++)
+    {
+        auto a = point_at(i);
+        auto b = point_at(i + 1);
+        curves.push_back(math::CubicBezier(a, math::lerp(a, b, 0.33f),
+                                           math::lerp(a, b, 0.66f), b));
+    }
+    return math::BezierPath(std::move(curves));
+}
+
+BENCHMARK_GROUP("geometry")
+{
+    const math::CubicBezier curve{ { 0.0f, 0.0f, 0.0f },
+                                   { 1.0f, 1.0f, 0.0f },
+                                   { 2.0f, 1.0f, 0.0f },
+                                   { 3.0f, 0.0f, 0.0f } };
+
+    float t = 0.37f;
+    runner.run("CubicBezier::valueAt", "", [&] {
+        bench::do_not_optimize(t);
+        bench::do_not_optimize(curve.valueAt(t));
+    });
+
+    runner.run("CubicBezier::split", "", [&] {
+        bench::do_not_optimize(t);
+        bench::do_not_optimize(curve.split(t));
+    });
+
+    for (int precision : { 15, 100 })
+    {
+        runner.run("CubicBezier::length",
+                   fmt::format("precision={}", precision), [&] {
+                       bench::do_not_optimize(precision);
+                       bench::do_not_optimize(curve.length(precision));
+                   });
+    }
+
+    for (auto [small, large] : { std::pair{ 4, 16 }, std::pair{ 16, 256 },
+                                 std::pair{ 32, 1024 } })
+    {
+        const auto src = make_path(small, 0.0f);
+        const auto dest = make_path(large, 0.1f);
+
+        runner.run("alignPaths", fmt::format("{}->{}", small, large), [&] {
+            auto a = src;
+            auto b = dest;
+            math::alignPaths(a, b);
+            bench::do_not_optimize(a);
+        });
+    }
+
+    for (int size : { 4, 64, 1024, 16384 })
+    {
+        const auto src = make_path(size, 0.0f);
+        const auto dest = make_path(size, 0.1f);
+
+        runner.run("interpolatePaths", fmt::format("curves={}", size), [&] {
+            bench::do_not_optimize(t);
+            auto path = math::interpolatePaths(src, dest, t);
+            bench::do_not_optimize(path);
+        });
+
+        utils::frame_arena arena;
+        math::BezierPath morphed(&arena);
+        runner.run("interpolatePaths/in_place", fmt::format("curves={}", size),
+                   [&] {
+                       bench::do_not_optimize(t);
+                       math::interpolatePaths(src, dest, t, morphed);
+                       bench::do_not_optimize(morphed);
+                   });
+    }
+
+    for (int size : { 1000, 100000 })
+    {
+        std::vector<math::fvec3> plot;
+        plot.reserve(size);
+        for (int i = 0; i < size; i++)
+        {
+            float x = -1.0f + 2.0f * i / float(size - 1);
+            plot.emplace_back(x, 0.5f * std::sin(40.0f * x), 0.0f);
+        }
+
+        // Half a pixel at 1080p
+        const float tolerance = 1.0f / 1080.0f;
+        std::vector<math::fvec3> kept;
+        runner.run("simplify_polyline", fmt::format("points={}", size), [&] {
+            kept.clear();
+            math::simplify_polyline(plot.data(), plot.size(), tolerance,
+                                    kept);
+            bench::do_not_optimize(kept);
+        });
+    }
+
+    // y = 0.5 sin(40 x), the kind of plot Parametric replaces
+    const math::instruction code[] = { { math::opcode::constant, 0.5f },
+                                       { math::opcode::constant, 40.0f },
+                                       { math::opcode::variable, 0 },
+                                       { math::opcode::mul, 0 },
+                                       { math::opcode::sin, 0 },
+                                       { math::opcode::mul, 0 } };
+    const math::expression wave(code, std::size(code), 0);
+    const math::instruction identity_code[] = { { math::opcode::variable, 0 } };
+    const math::expression identity(identity_code, 1, 0);
+
+    std::vector<float> xs(4096), ys(xs.size());
+    for (std::size_t i = 0; i < xs.size(); i++)
+        xs[i] = -1.0f + 2.0f * i / float(xs.size());
+    runner.run("expression::evaluate", "points=4096", [&] {
+        wave.evaluate(xs.data(), xs.size(), nullptr, ys.data());
+        bench::do_not_optimize(ys);
+    });
+
+    std::vector<math::fvec3> sampled;
+    runner.run("sample_parametric", "tolerance=0.5px@1080p", [&] {
+        sampled.clear();
+        math::sample_parametric(identity, wave, nullptr, -1.0f, 1.0f,
+                                1.0f / 1080.0f, sampled);
+        bench::do_not_optimize(sampled);
+    });
+
+    // Control points of a 250 x 200 surface wireframe
+    std::vector<math::fvec3> surface, projected;
+    for (int i = 0; i < 250; i++)
+        for (int k = 0; k < 200; k++)
+        {
+            const float x = i / 125.0f - 1.0f, z = k / 100.0f - 1.0f;
+            surface.emplace_back(x, 0.3f * std::sin(3 * x) * std::cos(3 * z),
+                                 z);
+        }
+    projected.resize(surface.size());
+    const auto camera = math::mat4::perspective(1.0f, 0.1f, 100.0f)
+        * math::mat4::look_at({ 1.0f, 1.2f, 2.5f }, { 0, 0, 0 }, { 0, 1, 0 });
+    runner.run("project_points", "points=50000", [&] {
+        math::project_points(camera, surface.data(), surface.size(),
+                             projected.data());
+        bench::do_not_optimize(projected);
+    });
+}
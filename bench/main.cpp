@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <cstdlib>
+#include <fmt/core.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+#include "bench.h"
+
+namespace bench
+{
+    std::vector<registry_entry> &registry()
+    {
+        static std::vector<registry_entry> entries;
+        return entries;
+    }
+
+    result runner::summarize(std::string name, std::string params,
+                             std::int64_t iterations,
+                             std::vector<double> &samples)
+    {
+        std::sort(samples.begin(), samples.end());
+        const std::size_t n = samples.size();
+
+        auto median_of = [](const std::vector<double> &sorted) {
+            const std::size_t n = sorted.size();
+            return n % 2 ? sorted[n / 2]
+                         : 0.5 * (sorted[n / 2 - 1] + sorted[n / 2]);
+        };
+
+        double mean = 0.0;
+        for (double s : samples)
+            mean += s;
+        mean /= static_cast<double>(n);
+
+        double variance = 0.0;
+        for (double s : samples)
+            variance += (s - mean) * (s - mean);
+        variance /= n > 1 ? static_cast<double>(n - 1) : 1.0;
+
+        const double median = median_of(samples);
+        std::vector<double> deviations(n);
+        for (std::size_t i = 0; i < n; i++)
+            deviations[i] = std::abs(samples[i] - median);
+        std::sort(deviations.begin(), deviations.end());
+
+        return result{ std::move(name),
+                       std::move(params),
+                       static_cast<int>(n),
+                       iterations,
+                       samples.front(),
+                       median,
+                       mean,
+                       std::sqrt(variance),
+                       median_of(deviations) };
+    }
+
+    static std::string human_time(double ns)
+    {
+        if (ns < 1e3)
+            return fmt::format("{:.2f} ns", ns);
+        if (ns < 1e6)
+            return fmt::format("{:.2f} us", ns / 1e3);
+        if (ns < 1e9)
+            return fmt::format("{:.2f} ms", ns / 1e6);
+        return fmt::format("{:.2f} s", ns / 1e9);
+    }
+
+    void runner::print_line(const result &res)
+    {
+        std::string full_name =
+            res.params.empty() ? res.name : res.name + "/" + res.params;
+        fmt::print("{:<48} {:>12} {:>12} {:>8.2f}% {:>10}\n", full_name,
+                   human_time(res.median_ns), human_time(res.min_ns),
+                   res.median_ns > 0 ? 100.0 * res.mad_ns / res.median_ns
+                                     : 0.0,
+                   res.iterations);
+    }
+
+    void write_csv(const std::vector<result> &results, const std::string &path)
+    {
+        std::ofstream out(path);
+        out << "name,params,samples,iterations,min_ns,median_ns,mean_ns,"
+               "stddev_ns,mad_ns\n";
+        for (auto &res : results)
+        {
+            out << fmt::format("{},{},{},{},{:.3f},{:.3f},{:.3f},{:.3f},{:.3f}\n",
+                               res.name, res.params, res.samples,
+                               res.iterations, res.min_ns, res.median_ns,
+                               res.mean_ns, res.stddev_ns, res.mad_ns);
+        }
+    }
+
+    void write_json(const std::vector<result> &results, const std::string &path)
+    {
+        std::ofstream out(path);
+        out << "{\n  \"benchmarks\": [\n";
+        for (std::size_t i = 0; i < results.size(); i++)
+        {
+            auto &res = results[i];
+            out << fmt::format(
+                "    {{\"name\": \"{}\", \"params\": \"{}\", \"samples\": {}, "
+                "\"iterations\": {}, \"min_ns\": {:.3f}, \"median_ns\": "
+                "{:.3f}, \"mean_ns\": {:.3f}, \"stddev_ns\": {:.3f}, "
+                "\"mad_ns\": {:.3f}}}{}\n",
+                res.name, res.params, res.samples, res.iterations, res.min_ns,
+                res.median_ns, res.mean_ns, res.stddev_ns, res.mad_ns,
+                i + 1 < results.size() ? "," : "");
+        }
+        out << "  ]\n}\n";
+    }
+
+    void print_comparison(const std::vector<result> &results,
+                          const std::string &baseline_csv)
+    {
+        std::ifstream in(baseline_csv);
+        if (!in)
+        {
+            fmt::print(stderr, "Cannot open baseline {}\n", baseline_csv);
+            return;
+        }
+
+        std::unordered_map<std::string, double> baseline;
+        std::string line;
+        std::getline(in, line); // header
+        while (std::getline(in, line))
+        {
+            std::stringstream fields(line);
+            std::string name, params, samples, iterations, min_ns, median_ns;
+            std::getline(fields, name, ',');
+            std::getline(fields, params, ',');
+            std::getline(fields, samples, ',');
+            std::getline(fields, iterations, ',');
+            std::getline(fields, min_ns, ',');
+            std::getline(fields, median_ns, ',');
+            baseline[name + "/" + params] = std::atof(median_ns.c_str());
+        }
+
+        fmt::print("\n{:<48} {:>12} {:>12} {:>9}\n", "comparison", "baseline",
+                   "current", "speedup");
+        for (auto &res : results)
+        {
+            auto it = baseline.find(res.name + "/" + res.params);
+            if (it == baseline.end() || res.median_ns <= 0.0)
+                continue;
+
+            std::string full_name =
+                res.params.empty() ? res.name : res.name + "/" + res.params;
+            fmt::print("{:<48} {:>12} {:>12} {:>8.3f}x\n", full_name,
+                       human_time(it->second), human_time(res.median_ns),
+                       it->second / res.median_ns);
+        }
+    }
+
+} // namespace bench
+
+static void usage()
+{
+    fmt::print("Usage: fma_bench [--filter <substring>] [--samples <n>]\n"
+               "                 [--min-time <ms>] [--csv <file>]\n"
+               "                 [--json <file>] [--compare <baseline.csv>]\n"
+               "                 [--list]\n");
+}
+
+int main(int argc, char **argv)
+{
+    bench::options opts;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc)
+            {
+                usage();
+                std::exit(1);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--filter")
+            opts.filter = next();
+        else if (arg == "--samples")
+            opts.samples = std::max(1, std::atoi(next().c_str()));
+        else if (arg == "--min-time")
+            opts.min_sample_ms = std::atof(next().c_str());
+        else if (arg == "--csv")
+            opts.csv_path = next();
+        else if (arg == "--json")
+            opts.json_path = next();
+        else if (arg == "--compare")
+            opts.compare_path = next();
+        else if (arg == "--list")
+            opts.list_only = true;
+        else
+        {
+            usage();
+            return arg == "--help" || arg == "-h" ? 0 : 1;
+        }
+    }
+
+    // Run groups in a stable order, independent of static init order
+    auto entries = bench::registry();
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const auto &a, const auto &b) {
+                         return std::string_view(a.group)
+                             < std::string_view(b.group);
+                     });
+
+    bench::runner runner(opts);
+
+    if (!opts.list_only)
+        fmt::print("{:<48} {:>12} {:>12} {:>9} {:>10}\n", "benchmark",
+                   "median", "min", "mad%", "iters");
+
+    for (auto &entry : entries)
+        entry.fn(runner);
+
+    if (opts.list_only)
+    {
+        for (auto &name : runner.get_listed())
+            fmt::print("{}\n", name);
+        return 0;
+    }
+
+    if (!opts.csv_path.empty())
+        bench::write_csv(runner.get_results(), opts.csv_path);
+    if (!opts.json_path.empty())
+        bench::write_json(runner.get_results(), opts.json_path);
+    if (!opts.compare_path.empty())
+        bench::print_comparison(runner.get_results(), opts.compare_path);
+
+    return 0;
+}
@@ -0,0 +1,47 @@
+#include "../fastmathart/math/random.h"
+#include "../fastmathart/particles.h"
+#include "bench.h"
+
+BENCHMARK_GROUP("particles")
+{
+    std::uint32_t counter = 0;
+    runner.run("philox4x32", "", [&] {
+        bench::do_not_optimize(math::random_uniform4(42, counter++, 0));
+    });
+
+    PyAPI::Color color{ 1.0f, 0.6f, 0.2f };
+    PyAPI::Color fade{ 0.6f, 0.1f, 0.4f };
+    PyAPI::Properties props{ 0.0f, -0.5f, 0.0f, &color, 0.0f, nullptr, 0.8f };
+
+    PyAPI::Particles emitter{};
+    emitter.count = 1'000'000;
+    emitter.seconds = 10.0f;
+    emitter.seed = 42;
+    emitter.lifetime = 2.0f;
+    emitter.radius = 0.05f;
+    emitter.direction = 1.5708f;
+    emitter.spread = 0.6f;
+    emitter.speed_min = 0.5f;
+    emitter.speed_max = 1.5f;
+    emitter.gravity_y = -0.8f;
+    emitter.drag = 0.2f;
+    emitter.end_color = &fade;
+    emitter.properties = &props;
+
+    particle_system particles(emitter, 60);
+    // Past the first lifetime, every particle is alive
+    for (int i = 0; i < 130; i++)
+        particles.step();
+
+    runner.run("particle_system::step", "particles=1000000", [&] {
+        particles.step();
+        bench::do_not_optimize(particles.x.data());
+    });
+
+    pixel_buffer_t frame(1920, 1080);
+    frame.clear();
+    runner.run("particle_system::render", "particles=1000000@1080p", [&] {
+        particles.render(frame);
+        bench::do_not_optimize(frame.buffer);
+    });
+}
@@ -0,0 +1,181 @@
+#include <cmath>
+#include <type_traits>
+#include <vector>
+
+#include "../fastmathart/render.h"
+#include "bench.h"
+
+BENCHMARK_GROUP("raster")
+{
+    pixel_buffer_t frame(1920, 1080);
+    frame.clear();
+
+    PyAPI::Color white{ 1.0f, 1.0f, 1.0f };
+
+    for (int radius : { 1, 2, 5, 10, 20 })
+    {
+        runner.run("render_disk", fmt::format("radius={}", radius), [&] {
+            render_disk({ 960, 540, 0 }, radius, frame,
+                        color_t<RGB_8>(255, 255, 255));
+            bench::do_not_optimize(frame.buffer);
+        });
+    }
+
+    // Thickness in NDC, 0.001 is 1px at 1080p
+    for (float thickness : { 0.001f, 0.005f, 0.01f, 0.02f })
+    {
+        PyAPI::Properties props{ 0.0f, 0.0f,      0.0f, &white,
+                                 thickness, nullptr, 1.0f };
+
+        runner.run("render_line/short", fmt::format("thickness={}", thickness),
+                   [&] {
+                       render_line({ -0.1f, -0.05f, 0.0f },
+                                   { 0.1f, 0.05f, 0.0f }, frame, props);
+                       bench::do_not_optimize(frame.buffer);
+                   });
+
+        runner.run("render_line/long", fmt::format("thickness={}", thickness),
+                   [&] {
+                       render_line({ -1.5f, -0.9f, 0.0f },
+                                   { 1.5f, 0.9f, 0.0f }, frame, props);
+                       bench::do_not_optimize(frame.buffer);
+                   });
+    }
+
+    PyAPI::Properties props{ 0.0f, 0.0f, 0.0f, &white, 0.005f, nullptr, 1.0f };
+    math::CubicBezier curve{ { -0.5f, 0.0f, 0.0f },
+                             { -0.25f, 0.5f, 0.0f },
+                             { 0.25f, -0.5f, 0.0f },
+                             { 0.5f, 0.0f, 0.0f } };
+
+    runner.run("render_cubic_bezier", "thickness=0.005", [&] {
+        render_cubic_bezier(curve, frame, props);
+        bench::do_not_optimize(frame.buffer);
+    });
+
+    // Span primitives: solid and blended rectangles, coverage runs
+    const pixel_writer<frame_format, blend_mode::replace> solid(
+        color_t<RGB_8>(255, 255, 255));
+    const pixel_writer<frame_format, blend_mode::over> translucent(
+        color_t<RGB_8>(255, 128, 0), 0.5f);
+    std::vector<std::uint8_t> coverage(512 * 512);
+    for (std::size_t i = 0; i < coverage.size(); i++)
+        coverage[i] = static_cast<std::uint8_t>(i * 7);
+
+    runner.run("render_rect", "512x512/replace", [&] {
+        render_rect(700, 300, 1211, 811, frame, solid);
+        bench::do_not_optimize(frame.buffer);
+    });
+
+    runner.run("render_rect", "512x512/over", [&] {
+        render_rect(700, 300, 1211, 811, frame, translucent);
+        bench::do_not_optimize(frame.buffer);
+    });
+
+    runner.run("render_coverage", "512x512", [&] {
+        render_coverage(coverage.data(), 512, 512, 700, 300, frame,
+                        translucent);
+        bench::do_not_optimize(frame.buffer);
+    });
+
+    // Surface wireframe of 50k segments seen through a perspective camera
+    std::vector<math::fvec3> grid;
+    for (int i = 0; i < 250; i++)
+        for (int k = 0; k <= 200; k++)
+        {
+            const float x = i / 125.0f - 1.0f, z = k / 100.0f - 1.0f;
+            grid.emplace_back(x, 0.3f * std::sin(3 * x) * std::cos(3 * z), z);
+        }
+    const auto camera = math::mat4::perspective(1.0f, 0.1f, 100.0f)
+        * math::mat4::look_at({ 1.0f, 1.2f, 2.5f }, { 0, 0, 0 }, { 0, 1, 0 });
+    const pixel_writer<frame_format, blend_mode::replace> wire_writer(
+        color_t<RGB_8>(255, 255, 255));
+
+    runner.run("render_polyline/projected", "segments=50000", [&] {
+        for (std::size_t i = 0; i < grid.size(); i += 201)
+            render_polyline(&grid[i], 201, math::affine2::identity(), camera,
+                            2, frame, wire_writer);
+        bench::do_not_optimize(frame.buffer);
+    });
+
+    // Same line into every destination format and blend mode
+    basic_pixel_buffer<LinearRGB_f32> linear(1920, 1080);
+    basic_pixel_buffer<RGBA_8> rgba(1920, 1080);
+    linear.clear();
+    rgba.clear();
+
+    auto kernel_case = [&](const char *params, auto &target, auto mode) {
+        runner.run("render_line/kernel", params, [&] {
+            render_line<decltype(mode)::value>({ -0.5f, -0.3f, 0.0f },
+                                               { 0.5f, 0.3f, 0.0f }, target,
+                                               props);
+            bench::do_not_optimize(target.buffer);
+        });
+    };
+
+    using replace = std::integral_constant<blend_mode, blend_mode::replace>;
+    using over = std::integral_constant<blend_mode, blend_mode::over>;
+    using add = std::integral_constant<blend_mode, blend_mode::add>;
+
+    kernel_case("RGB_8/replace", frame, replace{});
+    kernel_case("RGB_8/over", frame, over{});
+    kernel_case("RGB_8/add", frame, add{});
+    kernel_case("LinearRGB_f32/replace", linear, replace{});
+    kernel_case("LinearRGB_f32/over", linear, over{});
+    kernel_case("LinearRGB_f32/add", linear, add{});
+    kernel_case("RGBA_8/replace", rgba, replace{});
+    kernel_case("RGBA_8/over", rgba, over{});
+    kernel_case("RGBA_8/add", rgba, add{});
+}
+
+BENCHMARK_GROUP("buffer")
+{
+    for (auto [width, height] : { std::pair{ 1280, 720 }, std::pair{ 1920, 1080 },
+                                  std::pair{ 3840, 2160 } })
+    {
+        pixel_buffer_t frame(width, height);
+        pixel_buffer_t other(width, height);
+        other.clear({ 12, 34, 56 });
+
+        auto params = fmt::format("{}x{}", width, height);
+
+        runner.run("pixel_buffer_t::clear", params, [&] {
+            frame.clear({ 1, 2, 3 });
+            bench::do_not_optimize(frame.buffer);
+        });
+
+        runner.run("pixel_buffer_t::copy_from", params, [&] {
+            frame.copy_from(other);
+            bench::do_not_optimize(frame.buffer);
+        });
+
+        basic_pixel_buffer<LinearRGB_f32> linear(width, height);
+        linear.clear({ 0.5f, 0.25f, 0.125f });
+
+        runner.run("convert_pixels/LinearRGB_f32", params, [&] {
+            convert_pixels(linear, frame);
+            bench::do_not_optimize(frame.buffer);
+        });
+
+        // Padded 32 bits layout, and its conversion for the encoder
+        basic_pixel_buffer<RGBX_8> rgbx(width, height);
+        basic_pixel_buffer<RGBX_8> other_rgbx(width, height);
+        other_rgbx.clear({ 12, 34, 56 });
+        basic_pixel_buffer<RGB_8> packed(width, height);
+
+        runner.run("RGBX_8::clear", params, [&] {
+            rgbx.clear({ 1, 2, 3 });
+            bench::do_not_optimize(rgbx.buffer);
+        });
+
+        runner.run("RGBX_8::copy_from", params, [&] {
+            rgbx.copy_from(other_rgbx);
+            bench::do_not_optimize(rgbx.buffer);
+        });
+
+        runner.run("convert_pixels/RGBX_8", params, [&] {
+            convert_pixels(rgbx, packed);
+            bench::do_not_optimize(packed.buffer);
+        });
+    }
+}
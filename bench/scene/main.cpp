@@ -0,0 +1,371 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fmt/core.h>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_WIN32) || defined(_WIN64)
+#    include <windows.h>
+#    include <psapi.h>
+#    pragma comment(lib, "psapi")
+#else
+#    include <sys/resource.h>
+#endif
+
+#include "../../fastmathart/render.h"
+#include "synthetic.h"
+
+/*
+======================================
+fma_scene_bench: full renders of synthetic scenes, end to end
+
+Linked against the fma library and driven through its C API, so it
+measures the library as shipped (and as trained, see cmake/pgo.cmake).
+======================================
+*/
+
+extern "C" void render(PyAPI::Scene *scene, PyAPI::Config *config,
+                       const char *filename);
+extern "C" void render_statistics(render_stats *stats);
+
+struct resolution
+{
+    const char *name;
+    int width;
+    int height;
+};
+
+static const resolution resolutions[] = { { "720p", 1280, 720 },
+                                          { "1080p", 1920, 1080 },
+                                          { "4k", 3840, 2160 } };
+
+struct scene_case
+{
+    const char *name;
+    std::string params;
+    std::function<void(bench::synthetic_scene &, float)> build;
+};
+
+static std::vector<scene_case> scene_cases()
+{
+    using namespace bench;
+    return {
+        { "draw", "objects=200",
+          [](synthetic_scene &s, float d) { build_draw_scene(s, 200, d); } },
+        { "wait", "objects=200",
+          [](synthetic_scene &s, float d) {
+              build_wait_scene(s, 200, 4.0f * d);
+          } },
+        { "dense", "lines=8;points=100000",
+          [](synthetic_scene &s, float d) {
+              build_dense_scene(s, 8, 100000, d);
+          } },
+        { "morph", "chain=6",
+          [](synthetic_scene &s, float d) {
+              build_morph_scene(s, 6, 3.0f * d);
+          } },
+        { "simultaneous", "children=12",
+          [](synthetic_scene &s, float d) {
+              build_simultaneous_scene(s, 12, d);
+          } },
+    };
+}
+
+struct scene_result
+{
+    std::string name; // case/params@resolution
+    int frames;
+    double wall_seconds;
+    double fps;
+    render_stats stats;
+    double peak_rss_mb;
+};
+
+/* ===== Peak memory ===== */
+
+// Restart the peak RSS count, only Linux can. Elsewhere the peak is the
+// process' so far.
+static void reset_peak_rss()
+{
+#ifdef __linux__
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5";
+#endif
+}
+
+static double peak_rss_mb()
+{
+#if defined(_WIN32) || defined(_WIN64)
+    PROCESS_MEMORY_COUNTERS counters{};
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return double(counters.PeakWorkingSetSize) / (1024.0 * 1024.0);
+#else
+#    ifdef __linux__
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+        if (line.rfind("VmHWM:", 0) == 0)
+            return std::atof(line.c_str() + 6) / 1024.0; // kB
+#    endif
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#    ifdef __APPLE__
+    return double(usage.ru_maxrss) / (1024.0 * 1024.0); // bytes
+#    else
+    return double(usage.ru_maxrss) / 1024.0; // kB
+#    endif
+#endif
+}
+
+static void set_env(const char *name, const char *value)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    _putenv_s(name, value);
+#else
+    setenv(name, value, 1);
+#endif
+}
+
+/* ===== Reports ===== */
+
+static void print_header()
+{
+    fmt::print("{:<44} {:>7} {:>8} {:>8} {:>8} {:>8} {:>8} {:>8} {:>9} "
+               "{:>9}\n",
+               "scene", "frames", "wall s", "fps", "render", "encode",
+               "wait", "cache", "peak MB", "piped MB");
+}
+
+static void print_line(const scene_result &res)
+{
+    fmt::print("{:<44} {:>7} {:>8.2f} {:>8.2f} {:>8.2f} {:>8.2f} {:>8.2f} "
+               "{:>8.2f} {:>9.1f} {:>9.1f}\n",
+               res.name, res.frames, res.wall_seconds, res.fps,
+               res.stats.render_seconds, res.stats.encode_seconds,
+               res.stats.encode_wait_seconds, res.stats.cache_seconds,
+               res.peak_rss_mb,
+               double(res.stats.bytes_piped) / (1024.0 * 1024.0));
+}
+
+static void write_csv(const std::vector<scene_result> &results,
+                      const std::string &path)
+{
+    std::ofstream out(path);
+    out << "name,frames,wall_s,fps,render_s,encode_s,cache_s,concat_s,"
+           "peak_rss_mb,bytes_piped,encode_wait_s\n";
+    for (auto &res : results)
+    {
+        out << fmt::format("{},{},{:.4f},{:.3f},{:.4f},{:.4f},{:.4f},{:.4f},"
+                           "{:.1f},{},{:.4f}\n",
+                           res.name, res.frames, res.wall_seconds, res.fps,
+                           res.stats.render_seconds, res.stats.encode_seconds,
+                           res.stats.cache_seconds, res.stats.concat_seconds,
+                           res.peak_rss_mb, res.stats.bytes_piped,
+                           res.stats.encode_wait_seconds);
+    }
+}
+
+static void print_comparison(const std::vector<scene_result> &results,
+                             const std::string &baseline_csv)
+{
+    std::ifstream in(baseline_csv);
+    if (!in)
+    {
+        fmt::print(stderr, "Cannot open baseline {}\n", baseline_csv);
+        return;
+    }
+
+    // name -> (fps, peak RSS)
+    std::unordered_map<std::string, std::pair<double, double>> baseline;
+    std::string line;
+    std::getline(in, line); // header
+    while (std::getline(in, line))
+    {
+        std::stringstream fields(line);
+        std::vector<std::string> cells;
+        std::string cell;
+        while (std::getline(fields, cell, ','))
+            cells.push_back(cell);
+        if (cells.size() < 9)
+            continue;
+        baseline[cells[0]] = { std::atof(cells[3].c_str()),
+                               std::atof(cells[8].c_str()) };
+    }
+
+    fmt::print("\n{:<44} {:>10} {:>10} {:>9} {:>10} {:>10} {:>9}\n",
+               "comparison", "base fps", "fps", "speedup", "base MB", "MB",
+               "memory");
+    for (auto &res : results)
+    {
+        auto it = baseline.find(res.name);
+        if (it == baseline.end() || it->second.first <= 0.0
+            || it->second.second <= 0.0)
+            continue;
+
+        auto [fps, rss] = it->second;
+        fmt::print("{:<44} {:>10.2f} {:>10.2f} {:>8.3f}x {:>10.1f} {:>10.1f} "
+                   "{:>8.3f}x\n",
+                   res.name, fps, res.fps, res.fps / fps, rss,
+                   res.peak_rss_mb, res.peak_rss_mb / rss);
+    }
+}
+
+static void usage()
+{
+    fmt::print(
+        "Usage: fma_scene_bench [--filter <substring>] [--resolution <720p|1080p|4k>]\n"
+        "                       [--duration <scale>] [--fps <n>] [--repeat <n>]\n"
+        "                       [--null-encoder] [--cache] [--csv <file>]\n"
+        "                       [--compare <baseline.csv>] [--verbose] [--list]\n");
+}
+
+int main(int argc, char **argv)
+{
+    std::string filter, csv_path, compare_path;
+    std::vector<resolution> selected;
+    float duration = 1.0f;
+    int fps = 30;
+    int repeat = 1;
+    bool null_encoder = false, use_cache = false, verbose = false,
+         list_only = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc)
+            {
+                usage();
+                std::exit(1);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--filter")
+            filter = next();
+        else if (arg == "--resolution")
+        {
+            std::string name = next();
+            auto it = std::find_if(
+                std::begin(resolutions), std::end(resolutions),
+                [&](const resolution &r) { return name == r.name; });
+            if (it == std::end(resolutions))
+            {
+                usage();
+                return 1;
+            }
+            selected.push_back(*it);
+        }
+        else if (arg == "--duration")
+            duration = std::max(0.01f, float(std::atof(next().c_str())));
+        else if (arg == "--fps")
+            fps = std::max(1, std::atoi(next().c_str()));
+        else if (arg == "--repeat")
+            repeat = std::max(1, std::atoi(next().c_str()));
+        else if (arg == "--null-encoder")
+            null_encoder = true;
+        else if (arg == "--cache")
+            use_cache = true;
+        else if (arg == "--csv")
+            csv_path = next();
+        else if (arg == "--compare")
+            compare_path = next();
+        else if (arg == "--verbose")
+            verbose = true;
+        else if (arg == "--list")
+            list_only = true;
+        else
+        {
+            usage();
+            return arg == "--help" || arg == "-h" ? 0 : 1;
+        }
+    }
+
+    if (selected.empty())
+        selected.assign(std::begin(resolutions), std::end(resolutions));
+
+    // A warm cache would skip the rendering we want to measure. --cache
+    // keeps it in $FMA_CACHE_DIR, or fma_cache/.
+    const char *cache_dir = std::getenv("FMA_CACHE_DIR");
+    if (!use_cache)
+        set_env("FMA_NO_CACHE", "1");
+    else if (cache_dir == nullptr || *cache_dir == '\0')
+        set_env("FMA_CACHE_DIR", "fma_cache");
+    if (null_encoder)
+        set_env("FMA_ENCODER", "null");
+
+    std::vector<scene_result> results;
+    if (!list_only)
+        print_header();
+
+    for (auto &res : selected)
+    {
+        for (auto &c : scene_cases())
+        {
+            std::string name =
+                fmt::format("{}/{}@{}", c.name, c.params, res.name);
+            if (!filter.empty() && name.find(filter) == std::string::npos)
+                continue;
+            if (list_only)
+            {
+                fmt::print("{}\n", name);
+                continue;
+            }
+
+            bench::synthetic_scene scene;
+            c.build(scene, duration);
+            PyAPI::Config config{ res.width, res.height, fps, nullptr };
+
+            // The fastest of the repeats, the others only add noise. The
+            // peak memory is the largest of them.
+            scene_result result{};
+            result.name = name;
+            for (int r = 0; r < repeat; r++)
+            {
+                // The renderer reports its progress on std::cout
+                auto *out = std::cout.rdbuf();
+                if (!verbose)
+                    std::cout.rdbuf(nullptr);
+
+                reset_peak_rss();
+                auto start = std::chrono::steady_clock::now();
+                render(&scene.scene(), &config, "fma_scene_bench.mp4");
+                auto end = std::chrono::steady_clock::now();
+
+                std::cout.rdbuf(out);
+                std::cout.clear();
+
+                const double wall =
+                    std::chrono::duration<double>(end - start).count();
+                result.peak_rss_mb = std::max(result.peak_rss_mb,
+                                              peak_rss_mb());
+                if (r > 0 && wall >= result.wall_seconds)
+                    continue;
+
+                render_statistics(&result.stats);
+                result.frames = result.stats.frames;
+                result.wall_seconds = wall;
+                result.fps = wall > 0.0 ? result.frames / wall : 0.0;
+            }
+
+            results.push_back(result);
+            print_line(result);
+        }
+    }
+
+    if (list_only)
+        return 0;
+
+    if (!csv_path.empty())
+        write_csv(results, csv_path);
+    if (!compare_path.empty())
+        print_comparison(results, compare_path);
+
+    return 0;
+}
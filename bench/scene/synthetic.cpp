@@ -0,0 +1,214 @@
+#include "synthetic.h"
+
+#include <cmath>
+#include <numbers>
+
+namespace bench
+{
+    static const PyAPI::Color palette[] = {
+        { 0.3f, 0.6f, 0.8f }, { 0.8f, 0.6f, 0.8f }, { 0.1f, 0.8f, 0.6f },
+        { 0.8f, 0.1f, 0.6f }, { 0.9f, 0.7f, 0.2f }, { 0.4f, 0.9f, 0.3f },
+        { 0.9f, 0.3f, 0.2f }, { 0.6f, 0.5f, 1.0f }
+    };
+
+    PyAPI::Properties *synthetic_scene::properties(float x, float y,
+                                                   int color_index)
+    {
+        auto *color = keep(palette[color_index % std::size(palette)]);
+        return keep(PyAPI::Properties{ x, y, 0.0f, color, 0.01f, nullptr,
+                                       1.0f });
+    }
+
+    shape synthetic_scene::circle(float x, float y, float radius,
+                                  int color_index)
+    {
+        auto *circle = keep(
+            PyAPI::Circle{ radius, properties(x, y, color_index) });
+        return { circle, PyAPI::CIRCLE };
+    }
+
+    shape synthetic_scene::polyline(std::vector<float> x, std::vector<float> y,
+                                    int color_index)
+    {
+        auto *line = keep(PyAPI::Polyline{
+            keep_array(x), keep_array(y), static_cast<int>(x.size()),
+            properties(0.0f, 0.0f, color_index), nullptr });
+        return { line, PyAPI::POLYLINES };
+    }
+
+    shape synthetic_scene::star(float x, float y, float radius, int points,
+                                int color_index)
+    {
+        std::vector<float> xs, ys;
+        for (int i = 0; i <= 2 * points; i++)
+        {
+            float angle = std::numbers::pi_v<float> * float(i) / float(points);
+            float r = i % 2 ? 0.5f * radius : radius;
+            xs.push_back(x + r * std::cos(angle));
+            ys.push_back(y + r * std::sin(angle));
+        }
+        return polyline(std::move(xs), std::move(ys), color_index);
+    }
+
+    PyAPI::SceneElement synthetic_scene::wait(float seconds)
+    {
+        return { PyAPI::WAIT, keep(PyAPI::Wait{ seconds }) };
+    }
+
+    PyAPI::SceneElement synthetic_scene::place(const std::vector<shape> &shapes)
+    {
+        std::vector<void *> objects;
+        std::vector<PyAPI::ShapeType> types;
+        for (auto &s : shapes)
+        {
+            objects.push_back(s.ptr);
+            types.push_back(s.type);
+        }
+        return { PyAPI::PLACE,
+                 keep(PyAPI::Place{ keep_array(objects), keep_array(types),
+                                    static_cast<int>(shapes.size()) }) };
+    }
+
+    PyAPI::SceneElement synthetic_scene::draw(const std::vector<shape> &shapes,
+                                              float seconds)
+    {
+        std::vector<void *> objects;
+        std::vector<PyAPI::ShapeType> types;
+        for (auto &s : shapes)
+        {
+            objects.push_back(s.ptr);
+            types.push_back(s.type);
+        }
+        return { PyAPI::DRAW,
+                 keep(PyAPI::Draw{ keep_array(objects), keep_array(types),
+                                   static_cast<int>(shapes.size()),
+                                   seconds }) };
+    }
+
+    PyAPI::SceneElement synthetic_scene::morph(shape src, shape dest,
+                                               float seconds)
+    {
+        return { PyAPI::MORPH, keep(PyAPI::Morph{ src.ptr, dest.ptr, src.type,
+                                                  dest.type, seconds }) };
+    }
+
+    PyAPI::SceneElement synthetic_scene::simultaneous(
+        const std::vector<PyAPI::SceneElement> &children)
+    {
+        std::vector<void *> objects;
+        std::vector<PyAPI::ElementType> types;
+        for (auto &child : children)
+        {
+            objects.push_back(child.elem);
+            types.push_back(child.type);
+        }
+        return { PyAPI::SIMULTANEOUS,
+                 keep(PyAPI::Simultaneous{ keep_array(objects),
+                                           keep_array(types),
+                                           static_cast<int>(
+                                               children.size()) }) };
+    }
+
+    void synthetic_scene::add(PyAPI::SceneElement elem)
+    {
+        elements.push_back(elem);
+    }
+
+    PyAPI::Scene &synthetic_scene::scene()
+    {
+        built = { elements.data(), static_cast<int>(elements.size()) };
+        return built;
+    }
+
+    /* ===== Scenes ===== */
+
+    // Small circles on a square grid covering most of the frame
+    static std::vector<shape> circle_grid(synthetic_scene &scene, int count)
+    {
+        int side = static_cast<int>(std::ceil(std::sqrt(float(count))));
+        float step = 1.8f / float(side);
+
+        std::vector<shape> shapes;
+        for (int i = 0; i < count; i++)
+        {
+            float x = -0.9f + step * (float(i % side) + 0.5f);
+            float y = -0.9f + step * (float(i / side) + 0.5f);
+            shapes.push_back(scene.circle(x, y, 0.4f * step, i));
+        }
+        return shapes;
+    }
+
+    void build_draw_scene(synthetic_scene &scene, int objects, float duration)
+    {
+        scene.add(scene.draw(circle_grid(scene, objects), duration));
+    }
+
+    void build_wait_scene(synthetic_scene &scene, int objects, float duration)
+    {
+        scene.add(scene.place(circle_grid(scene, objects)));
+        scene.add(scene.wait(duration));
+    }
+
+    void build_dense_scene(synthetic_scene &scene, int lines, int points,
+                           float duration)
+    {
+        std::vector<shape> plots;
+        for (int l = 0; l < lines; l++)
+        {
+            std::vector<float> x(points), y(points);
+            float offset = -0.8f + 1.6f * (float(l) + 0.5f) / float(lines);
+            for (int i = 0; i < points; i++)
+            {
+                x[i] = -0.95f + 1.9f * float(i) / float(points - 1);
+                y[i] = offset
+                    + 0.1f * std::sin(40.0f * x[i] + float(l))
+                          * std::cos(3.0f * x[i]);
+            }
+            plots.push_back(scene.polyline(std::move(x), std::move(y), l));
+        }
+        scene.add(scene.draw(plots, duration));
+    }
+
+    void build_morph_scene(synthetic_scene &scene, int morphs, float duration)
+    {
+        // circle -> star -> circle -> ..., each morph starts from the last
+        shape current = scene.circle(0.0f, 0.0f, 0.5f, 0);
+        scene.add(scene.place({ current }));
+        for (int i = 0; i < morphs; i++)
+        {
+            shape next = i % 2 == 0
+                ? scene.star(0.0f, 0.0f, 0.7f, 5 + 3 * i, i + 1)
+                : scene.circle(0.0f, 0.0f, 0.3f + 0.05f * float(i), i + 1);
+            scene.add(scene.morph(current, next, duration / float(morphs)));
+            current = next;
+        }
+    }
+
+    void build_simultaneous_scene(synthetic_scene &scene, int children,
+                                  float duration)
+    {
+        // Alternating draws and morphs on a grid, so the layers overlap
+        // the scene but not each other
+        auto anchors = circle_grid(scene, children);
+        scene.add(scene.place(anchors));
+
+        std::vector<PyAPI::SceneElement> group;
+        for (int i = 0; i < children; i++)
+        {
+            auto *anchor = static_cast<PyAPI::Circle *>(anchors[i].ptr);
+            float x = anchor->properties->x;
+            float y = anchor->properties->y;
+            if (i % 2 == 0)
+                group.push_back(scene.morph(
+                    anchors[i],
+                    scene.star(x, y, 1.5f * anchor->radius, 6, i + 1),
+                    duration));
+            else
+                group.push_back(scene.draw(
+                    { scene.star(x, y, 0.8f * anchor->radius, 4, i + 2) },
+                    duration));
+        }
+        scene.add(scene.simultaneous(group));
+    }
+
+} // namespace bench
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "../../fastmathart/api_bindings.h"
+
+/*
+======================================
+Synthetic scenes, built natively for the scene benchmark
+======================================
+*/
+
+namespace bench
+{
+    struct shape
+    {
+        void *ptr;
+        PyAPI::ShapeType type;
+    };
+
+    // A PyAPI::Scene and everything it points to. The element builders
+    // return elements that are only part of the scene once added, so they
+    // can be grouped in a Simultaneous instead.
+    class synthetic_scene
+    {
+    public:
+        synthetic_scene() = default;
+        synthetic_scene(const synthetic_scene &) = delete;
+        synthetic_scene &operator=(const synthetic_scene &) = delete;
+
+        shape circle(float x, float y, float radius, int color_index);
+        shape polyline(std::vector<float> x, std::vector<float> y,
+                       int color_index);
+        // Closed star with `points` tips, for morphs
+        shape star(float x, float y, float radius, int points, int color_index);
+
+        PyAPI::SceneElement wait(float seconds);
+        PyAPI::SceneElement place(const std::vector<shape> &shapes);
+        PyAPI::SceneElement draw(const std::vector<shape> &shapes,
+                                 float seconds);
+        PyAPI::SceneElement morph(shape src, shape dest, float seconds);
+        PyAPI::SceneElement simultaneous(
+            const std::vector<PyAPI::SceneElement> &children);
+
+        void add(PyAPI::SceneElement elem);
+
+        PyAPI::Scene &scene();
+
+    private:
+        template <class T>
+        T *keep(T value)
+        {
+            auto ptr = std::make_shared<T>(std::move(value));
+            owned.push_back(ptr);
+            return ptr.get();
+        }
+
+        template <class T>
+        T *keep_array(const std::vector<T> &values)
+        {
+            return keep(values)->data();
+        }
+
+        PyAPI::Properties *properties(float x, float y, int color_index);
+
+        std::vector<std::shared_ptr<void>> owned;
+        std::vector<PyAPI::SceneElement> elements;
+        PyAPI::Scene built{};
+    };
+
+    // The benchmarked scenes. `duration` scales every element's length.
+    void build_draw_scene(synthetic_scene &scene, int objects, float duration);
+    void build_wait_scene(synthetic_scene &scene, int objects, float duration);
+    void build_dense_scene(synthetic_scene &scene, int lines, int points,
+                           float duration);
+    void build_morph_scene(synthetic_scene &scene, int morphs,
+                           float duration);
+    void build_simultaneous_scene(synthetic_scene &scene, int children,
+                                  float duration);
+
+} // namespace bench
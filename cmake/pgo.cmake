@@ -0,0 +1,97 @@
+# Profile guided build of fma, from the source directory:
+#
+#   cmake -P cmake/pgo.cmake
+#
+# Builds fma instrumented, trains it on the synthetic scenes of
+# fma_scene_bench, rebuilds it with the profile and reports the speedup over
+# a build without PGO. Set before -P, with -D:
+#   PGO_BINARY_DIR      where to build (build-pgo), the trained library ends
+#                       up in <PGO_BINARY_DIR>/pgo
+#   PGO_CONFIGURE_ARGS  extra configure arguments, e.g. the Conan toolchain
+#   PGO_TRAIN_ARGS      fma_scene_bench arguments of the training run
+#   PGO_BENCH_ARGS      fma_scene_bench arguments of the report
+#   PGO_REPORT          OFF to skip the build without PGO and the report
+
+cmake_minimum_required(VERSION 3.12)
+
+get_filename_component(SOURCE_DIR "${CMAKE_CURRENT_LIST_DIR}/.." ABSOLUTE)
+
+if(NOT PGO_BINARY_DIR)
+  set(PGO_BINARY_DIR "${SOURCE_DIR}/build-pgo")
+endif()
+get_filename_component(PGO_BINARY_DIR "${PGO_BINARY_DIR}" ABSOLUTE)
+if(NOT DEFINED PGO_TRAIN_ARGS)
+  set(PGO_TRAIN_ARGS --null-encoder --resolution 720p --resolution 1080p
+                     --duration 0.5)
+endif()
+if(NOT DEFINED PGO_BENCH_ARGS)
+  set(PGO_BENCH_ARGS --null-encoder --resolution 720p --resolution 1080p
+                     --repeat 3)
+endif()
+if(NOT DEFINED PGO_REPORT)
+  set(PGO_REPORT ON)
+endif()
+
+set(BASELINE_DIR "${PGO_BINARY_DIR}/baseline")
+set(PGO_DIR "${PGO_BINARY_DIR}/pgo")
+set(PROFILE_DIR "${PGO_DIR}/profile")
+
+function(run step)
+  message(STATUS "pgo: ${step}")
+  execute_process(COMMAND ${ARGN} RESULT_VARIABLE result)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "pgo: ${step} failed (${result})")
+  endif()
+endfunction()
+
+function(configure_and_build dir mode)
+  run("configure ${mode}"
+      ${CMAKE_COMMAND} -S "${SOURCE_DIR}" -B "${dir}"
+      -DCMAKE_BUILD_TYPE=Release -DBUILD_TESTING=OFF -DBUILD_BENCHMARKS=ON
+      -DPGO=${mode} -DPGO_PROFILE_DIR=${PROFILE_DIR} ${PGO_CONFIGURE_ARGS})
+  foreach(target fma fma_scene_bench)
+    run("build ${target} (${mode})"
+        ${CMAKE_COMMAND} --build "${dir}" --config Release --target ${target})
+  endforeach()
+endfunction()
+
+# Scenes are rendered in a scratch directory, they write video files
+function(run_bench step dir)
+  file(MAKE_DIRECTORY "${dir}/scenes")
+  run("${step}" ${CMAKE_COMMAND} -E chdir "${dir}/scenes"
+      "${dir}/fma_scene_bench" ${ARGN})
+endfunction()
+
+if(PGO_REPORT)
+  configure_and_build("${BASELINE_DIR}" OFF)
+  run_bench("baseline" "${BASELINE_DIR}" ${PGO_BENCH_ARGS}
+            --csv "${PGO_BINARY_DIR}/baseline.csv")
+endif()
+
+# A stale profile would be merged into the new one
+file(REMOVE_RECURSE "${PROFILE_DIR}")
+configure_and_build("${PGO_DIR}" GENERATE)
+run_bench("training" "${PGO_DIR}" ${PGO_TRAIN_ARGS})
+
+# Clang writes raw profiles that have to be merged, GCC's are used as is
+file(GLOB RAW_PROFILES "${PROFILE_DIR}/*.profraw")
+if(RAW_PROFILES)
+  find_program(LLVM_PROFDATA NAMES llvm-profdata llvm-profdata-18
+                                   llvm-profdata-17 llvm-profdata-16
+                                   llvm-profdata-15 llvm-profdata-14)
+  if(NOT LLVM_PROFDATA)
+    message(FATAL_ERROR "pgo: llvm-profdata is needed to merge the profile")
+  endif()
+  run("merge profile" "${LLVM_PROFDATA}" merge
+      -output=${PROFILE_DIR}/fma.profdata ${RAW_PROFILES})
+endif()
+
+configure_and_build("${PGO_DIR}" USE)
+
+if(PGO_REPORT)
+  run_bench("report" "${PGO_DIR}" ${PGO_BENCH_ARGS}
+            --csv "${PGO_BINARY_DIR}/pgo.csv"
+            --compare "${PGO_BINARY_DIR}/baseline.csv")
+endif()
+
+message(STATUS "pgo: trained library in ${PGO_DIR}")
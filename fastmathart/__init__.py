@@ -1,8 +1,10 @@
-from fastmathart.render import render
+from fastmathart.render import render, render_frame, save_scene, memory_usage
 from fastmathart.scene import SceneBuilder
+from fastmathart.native_scene import NativeScene
 from fastmathart.config import config, presets
 from fastmathart.const import *
 from fastmathart.shapes import *
-from fastmathart.basic_animation import Place, Wait, Draw, Morph
+from fastmathart.basic_animation import Place, Wait, Draw, Morph, CameraMove, Particles
+from fastmathart.camera import Camera, look_at, perspective, orbit
 from fastmathart.properties import Properties
 from fastmathart.color import *
\ No newline at end of file
@@ -3,6 +3,9 @@
 #include <iostream>
 
 #include "render.h"
+#include "utils/memory.h"
+#include "utils/sceneBuilder.h"
+#include "utils/sceneFile.h"
 
 #if defined(_WIN32) || defined(_WIN64)
 #define EXPORT __declspec(dllexport)
@@ -19,4 +22,194 @@ extern "C" EXPORT void render(PyAPI::Scene *scene, PyAPI::Config *config,
         return;
     }
     render_scene(*scene, *config, filename);
-}
\ No newline at end of file
+}
+
+// Writes the scene and its config to a binary scene file, which fma_render
+// renders without Python. Returns 0 on success.
+extern "C" EXPORT int save_scene(PyAPI::Scene *scene, PyAPI::Config *config,
+                                 const char *path)
+{
+    if (scene == nullptr || config == nullptr || path == nullptr)
+    {
+        std::cout << "No scene, config or path specified" << std::endl;
+        return 1;
+    }
+    return scene_file::save(*scene, *config, path) ? 0 : 1;
+}
+
+// Renders a scene file to `filename`. The width, height and fps of the file
+// are replaced by the ones given, unless 0. Returns 0 on success.
+extern "C" EXPORT int render_scene_file(const char *path,
+                                        const char *filename, int width,
+                                        int height, int fps)
+{
+    if (path == nullptr || filename == nullptr)
+    {
+        std::cout << "No scene file or output specified" << std::endl;
+        return 1;
+    }
+
+    scene_file::mapped file;
+    if (!file.open(path))
+        return 1;
+
+    PyAPI::Config config = file.config();
+    config.width = width > 0 ? width : config.width;
+    config.height = height > 0 ? height : config.height;
+    config.fps = fps > 0 ? fps : config.fps;
+    render_scene(file.scene(), config, filename);
+    return 0;
+}
+
+// Renders frame `frame_index` of the scene, as packed 24 bits RGB rows of
+// `stride` bytes, into `out`: height * stride bytes owned by the caller.
+// Returns 0 on success.
+extern "C" EXPORT int render_frame(PyAPI::Scene *scene, PyAPI::Config *config,
+                                   int frame_index, std::uint8_t *out,
+                                   std::size_t stride)
+{
+    if (scene == nullptr || config == nullptr)
+    {
+        std::cout << "No scene or config specified" << std::endl;
+        return 1;
+    }
+    return render_scene_frame(*scene, *config, frame_index, out, stride) ? 0
+                                                                         : 1;
+}
+
+// Frames, bytes piped and time per stage of the last render
+extern "C" EXPORT void render_statistics(render_stats *stats)
+{
+    if (stats != nullptr)
+        *stats = last_render_stats();
+}
+
+// Current and peak bytes of one subsystem, see memory::tag for the values.
+// The peaks restart at every render.
+extern "C" EXPORT void memory_usage(int tag, std::size_t *current,
+                                    std::size_t *peak)
+{
+    if (tag < 0 || tag >= memory::TAG_COUNT || current == nullptr
+        || peak == nullptr)
+    {
+        std::cout << "Invalid memory tag " << tag << std::endl;
+        return;
+    }
+    auto usage = memory::query(static_cast<memory::tag>(tag));
+    *current = usage.current;
+    *peak = usage.peak;
+}
+
+// Scenes built by handles, see utils/sceneBuilder.h. The scene_add_*
+// functions return the handle of what they add, -1 if it was invalid. The
+// buffers they borrow must outlive the builder, released by scene_release.
+extern "C" EXPORT scene_builder *scene_create()
+{
+    return new scene_builder();
+}
+
+extern "C" EXPORT void scene_release(scene_builder *builder)
+{
+    delete builder;
+}
+
+extern "C" EXPORT int scene_add_circle(scene_builder *builder, float radius,
+                                       const PyAPI::Properties *properties)
+{
+    return builder->add_circle(radius, properties);
+}
+
+extern "C" EXPORT int scene_add_polyline(scene_builder *builder, float *x,
+                                         float *y, float *z, int count,
+                                         const PyAPI::Properties *properties)
+{
+    return builder->add_polyline(x, y, z, count, properties);
+}
+
+extern "C" EXPORT int scene_add_polylines(scene_builder *builder, float *x,
+                                          float *y, float *z,
+                                          const int *starts, int count,
+                                          const PyAPI::Properties *properties)
+{
+    return builder->add_polylines(x, y, z, starts, count, properties);
+}
+
+extern "C" EXPORT int
+scene_add_instanced(scene_builder *builder, int shape, float *transforms,
+                    PyAPI::Color *colors, float *opacities, int count,
+                    const PyAPI::Properties *properties)
+{
+    return builder->add_instanced(shape, transforms, colors, opacities, count,
+                                  properties);
+}
+
+extern "C" EXPORT int
+scene_add_parametric(scene_builder *builder, const PyAPI::Instruction *x_code,
+                     int x_length, const PyAPI::Instruction *y_code,
+                     int y_length, const float *params, int param_count,
+                     float t_min, float t_max,
+                     const PyAPI::Properties *properties)
+{
+    return builder->add_parametric(x_code, x_length, y_code, y_length, params,
+                                   param_count, t_min, t_max, properties);
+}
+
+extern "C" EXPORT int scene_add_text(scene_builder *builder,
+                                     const char *font_path, const char *text,
+                                     float size,
+                                     const PyAPI::Properties *properties)
+{
+    return builder->add_text(font_path, text, size, properties);
+}
+
+extern "C" EXPORT int scene_add_wait(scene_builder *builder, float seconds)
+{
+    return builder->add_wait(seconds);
+}
+
+extern "C" EXPORT int scene_add_place(scene_builder *builder,
+                                      const int *shapes, int count)
+{
+    return builder->add_place(shapes, count);
+}
+
+extern "C" EXPORT int scene_add_draw(scene_builder *builder,
+                                     const int *shapes, int count,
+                                     float seconds)
+{
+    return builder->add_draw(shapes, count, seconds);
+}
+
+extern "C" EXPORT int scene_add_morph(scene_builder *builder, int src,
+                                      int dest, float seconds)
+{
+    return builder->add_morph(src, dest, seconds);
+}
+
+extern "C" EXPORT int scene_add_camera_move(scene_builder *builder,
+                                            float *views, int view_count,
+                                            float seconds)
+{
+    return builder->add_camera_move(views, view_count, seconds);
+}
+
+extern "C" EXPORT int scene_add_particles(scene_builder *builder,
+                                          const PyAPI::Particles *particles)
+{
+    if (particles == nullptr)
+        return -1;
+    return builder->add_particles(*particles);
+}
+
+extern "C" EXPORT int scene_add_simultaneous(scene_builder *builder,
+                                             const int *elements, int count)
+{
+    return builder->add_simultaneous(elements, count);
+}
+
+// The scene to pass to render, render_frame or save_scene, valid until the
+// builder changes
+extern "C" EXPORT PyAPI::Scene *scene_get(scene_builder *builder)
+{
+    return &builder->scene();
+}
@@ -5,11 +5,20 @@
 
 namespace PyAPI
 {
+    // 4x4 row-major matrices, see math::mat4. The projection maps the
+    // smaller side of the frame to [-1, 1], it has no aspect ratio.
+    struct Camera
+    {
+        float view[16];
+        float projection[16];
+    };
+
     struct Config
     {
         int width;
         int height;
         int fps;
+        Camera *camera; // null for 2D scenes
     };
 
     enum ElementType
@@ -19,14 +28,19 @@ namespace PyAPI
         PLACE = 2,
         DRAW = 3,
         MORPH = 4,
-        SIMULTANEOUS = 5
+        SIMULTANEOUS = 5,
+        CAMERA_MOVE = 6,
+        PARTICLES = 7
     };
 
     enum ShapeType
     {
         NO_TYPE = 0,
         CIRCLE = 1,
-        POLYLINES = 2
+        POLYLINES = 2,
+        INSTANCED = 3,
+        PARAMETRIC = 4,
+        TEXT = 5
     };
 
     struct SceneElement
@@ -77,6 +91,42 @@ namespace PyAPI
         int obj_count;
     };
 
+    // Moves the camera through `view_count` view matrices (16 floats each),
+    // evenly spaced over the duration, and redraws the scene at every frame
+    struct CameraMove
+    {
+        float *views;
+        int view_count;
+        float seconds;
+    };
+
+    struct Color;
+    struct Properties;
+
+    // Emitter of `count` particles. Particle i is born i / count of a
+    // lifetime after the start at the properties' position (within
+    // `radius`), heading `direction` +- `spread` radians at a speed in
+    // [speed_min, speed_max], and is reborn when it gets `lifetime` old.
+    // It fades from the properties' color to end_color (if not null) and
+    // to transparent. The thickness is the particle size.
+    struct Particles
+    {
+        int count;
+        float seconds;
+        unsigned int seed;
+        float lifetime;
+        float radius;
+        float direction;
+        float spread;
+        float speed_min;
+        float speed_max;
+        float gravity_x;
+        float gravity_y;
+        float drag;
+        Color *end_color;
+        Properties *properties;
+    };
+
     template <class F>
     inline constexpr void element_visitor(F &&lambda, void* elem, ElementType type)
     {
@@ -87,6 +137,8 @@ namespace PyAPI
         case DRAW: return lambda(static_cast<Draw *>(elem));
         case MORPH: return lambda(static_cast<Morph *>(elem));
         case SIMULTANEOUS: return lambda(static_cast<Simultaneous *>(elem));
+        case CAMERA_MOVE: return lambda(static_cast<CameraMove *>(elem));
+        case PARTICLES: return lambda(static_cast<Particles *>(elem));
         default: std::cout << "Unknown element type\n";
         }
     }
@@ -121,6 +173,56 @@ namespace PyAPI
         float *y;
         int point_count;
         Properties *properties;
+        float *z; // may be null, only seen through a Camera
+    };
+
+    // One shape drawn instance_count times, its geometry is flattened once.
+    // transforms holds 6 floats per instance, the rows of a 2x3 affine
+    // matrix (see math::affine2), applied before the properties' position.
+    // colors and opacities may be null, the properties are used instead.
+    struct Instanced
+    {
+        void *shape;
+        ShapeType shape_type;
+        float *transforms;
+        Color *colors;
+        float *opacities;
+        int instance_count;
+        Properties *properties;
+    };
+
+    // One step of an expression, see math::opcode for the op values
+    struct Instruction
+    {
+        int op;
+        float operand;
+    };
+
+    // Curve (x(t), y(t)) for t in [t_min, t_max], both given as postfix
+    // bytecode and sampled natively at the output resolution
+    struct Parametric
+    {
+        Instruction *x_code;
+        int x_length;
+        Instruction *y_code;
+        int y_length;
+        float *params;
+        int param_count;
+        float t_min;
+        float t_max;
+        Properties *properties;
+    };
+
+    // UTF-8 text in a TrueType font, centered on the properties' position.
+    // `size` is the em size in NDC and '\n' starts a new line. The glyphs
+    // are filled with the properties' fill color when there is one, and
+    // outlined with the stroke.
+    struct Text
+    {
+        const char *font_path;
+        const char *text;
+        float size;
+        Properties *properties;
     };
 
     template <class F>
@@ -130,6 +232,9 @@ namespace PyAPI
         {
         case CIRCLE: return lambda(static_cast<Circle *>(shape));
         case POLYLINES: return lambda(static_cast<Polyline *>(shape));
+        case INSTANCED: return lambda(static_cast<Instanced *>(shape));
+        case PARAMETRIC: return lambda(static_cast<Parametric *>(shape));
+        case TEXT: return lambda(static_cast<Text *>(shape));
         default: std::cout << "Unknown shape type\n";
         }
     }
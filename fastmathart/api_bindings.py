@@ -1,7 +1,11 @@
-from ctypes import POINTER, c_char_p, cdll
+from ctypes import POINTER, c_char_p, c_float, c_int, c_size_t, c_uint8, c_void_p, cdll
 import platform
 from fastmathart.scene import Scene
 from fastmathart.config import ConfigBinding
+from fastmathart.properties import Properties
+from fastmathart.color import Color
+from fastmathart.shapes import Instruction
+from fastmathart.basic_animation import Particles
 from glob import glob
 
 files = []
@@ -21,4 +25,48 @@ else:
 lib = cdll.LoadLibrary(files[0])
 
 lib.render.argtypes = [POINTER(Scene), POINTER(ConfigBinding), c_char_p]
-lib.render.restype = None
\ No newline at end of file
+lib.render.restype = None
+
+lib.save_scene.argtypes = [POINTER(Scene), POINTER(ConfigBinding), c_char_p]
+lib.save_scene.restype = c_int
+
+lib.render_frame.argtypes = [POINTER(Scene), POINTER(ConfigBinding), c_int,
+                             POINTER(c_uint8), c_size_t]
+lib.render_frame.restype = c_int
+
+lib.memory_usage.argtypes = [c_int, POINTER(c_size_t), POINTER(c_size_t)]
+lib.memory_usage.restype = None
+
+# Scenes built by handles, see fastmathart.native_scene
+lib.scene_create.argtypes = []
+lib.scene_create.restype = c_void_p
+lib.scene_release.argtypes = [c_void_p]
+lib.scene_release.restype = None
+lib.scene_get.argtypes = [c_void_p]
+lib.scene_get.restype = POINTER(Scene)
+
+_floats = POINTER(c_float)
+_ints = POINTER(c_int)
+_properties = POINTER(Properties)
+for name, args in (
+    ("scene_add_circle", [c_float, _properties]),
+    ("scene_add_polyline", [_floats, _floats, _floats, c_int, _properties]),
+    ("scene_add_polylines",
+     [_floats, _floats, _floats, _ints, c_int, _properties]),
+    ("scene_add_instanced",
+     [c_int, _floats, POINTER(Color), _floats, c_int, _properties]),
+    ("scene_add_parametric",
+     [POINTER(Instruction), c_int, POINTER(Instruction), c_int, _floats,
+      c_int, c_float, c_float, _properties]),
+    ("scene_add_text", [c_char_p, c_char_p, c_float, _properties]),
+    ("scene_add_wait", [c_float]),
+    ("scene_add_place", [_ints, c_int]),
+    ("scene_add_draw", [_ints, c_int, c_float]),
+    ("scene_add_morph", [c_int, c_int, c_float]),
+    ("scene_add_camera_move", [_floats, c_int, c_float]),
+    ("scene_add_particles", [POINTER(Particles.ParticlesBuilder)]),
+    ("scene_add_simultaneous", [_ints, c_int]),
+):
+    function = getattr(lib, name)
+    function.argtypes = [c_void_p] + args
+    function.restype = c_int
@@ -1,10 +1,14 @@
-from ctypes import c_float, Structure, cast, c_void_p, POINTER, c_int, pointer
+from ctypes import c_float, Structure, cast, c_void_p, POINTER, c_int, c_uint, pointer
+from fastmathart.color import Color
+from fastmathart.properties import Properties
 
 WAIT_ID = 1
 PLACE_ID = 2
 DRAW_ID = 3
 MORPH_ID = 4
 SIMULTANEOUS_ID = 5
+CAMERA_MOVE_ID = 6
+PARTICLES_ID = 7
 
 _basic_fields = [
     ("obj_list", POINTER(POINTER(c_void_p))),
@@ -163,3 +167,106 @@ class Morph(AnimationBase):
 
         self._morph_obj.seconds = self.seconds
         return self._morph_obj
+
+
+class CameraMove(AnimationBase):
+    """
+    Moves the camera through a list of view matrices, evenly spaced over
+    the duration, and redraws the scene from every viewpoint. The config
+    needs a Camera, see fastmathart.camera.orbit for a turn around the scene.
+    """
+    anim_id = CAMERA_MOVE_ID
+
+    class CameraMoveBuilder(Structure):
+        _fields_ = [
+            ("views", POINTER(c_float)),
+            ("view_count", c_int),
+            ("seconds", c_float)
+        ]
+
+    def __init__(self, views: list, seconds: float = 1.0):
+        self._camera_obj = CameraMove.CameraMoveBuilder()
+        self.views = views
+        self.seconds = seconds
+
+    def build(self):
+        values = [value for view in self.views for value in view]
+        self._camera_obj.views = (c_float * len(values))(*values)
+        self._camera_obj.view_count = len(self.views)
+        self._camera_obj.seconds = self.seconds
+        return self._camera_obj
+
+
+class Particles(AnimationBase):
+    """
+    Emits count particles from the position of the properties, simulated
+    natively. Each particle lives lifetime seconds then is reborn, heading
+    direction +- spread radians at a random speed between speed_min and
+    speed_max. It fades from the properties' color to end_color and to
+    transparent. The same seed always gives the same animation.
+    """
+    anim_id = PARTICLES_ID
+
+    class ParticlesBuilder(Structure):
+        _fields_ = [
+            ("count", c_int),
+            ("seconds", c_float),
+            ("seed", c_uint),
+            ("lifetime", c_float),
+            ("radius", c_float),
+            ("direction", c_float),
+            ("spread", c_float),
+            ("speed_min", c_float),
+            ("speed_max", c_float),
+            ("gravity_x", c_float),
+            ("gravity_y", c_float),
+            ("drag", c_float),
+            ("end_color", POINTER(Color)),
+            ("properties", POINTER(Properties))
+        ]
+
+    def __init__(
+        self,
+        count: int = 10000,
+        seconds: float = 1.0,
+        lifetime: float = 1.0,
+        radius: float = 0.0,
+        direction: float = 1.5707963267948966,
+        spread: float = 3.141592653589793,
+        speed: tuple = (0.2, 0.8),
+        gravity: tuple = (0.0, 0.0),
+        drag: float = 0.0,
+        end_color: Color = None,
+        seed: int = 0,
+        properties: Properties = None
+    ):
+        self._particles_obj = Particles.ParticlesBuilder()
+        self.count = count
+        self.seconds = seconds
+        self.lifetime = lifetime
+        self.radius = radius
+        self.direction = direction
+        self.spread = spread
+        self.speed = speed
+        self.gravity = gravity
+        self.drag = drag
+        self.end_color = end_color
+        self.seed = seed
+        self.properties = properties if properties is not None else Properties(thickness=0.0)
+
+    def build(self):
+        obj = self._particles_obj
+        obj.count = self.count
+        obj.seconds = self.seconds
+        obj.seed = self.seed
+        obj.lifetime = self.lifetime
+        obj.radius = self.radius
+        obj.direction = self.direction
+        obj.spread = self.spread
+        obj.speed_min, obj.speed_max = self.speed
+        obj.gravity_x, obj.gravity_y = self.gravity
+        obj.drag = self.drag
+        if self.end_color is not None:
+            obj.end_color = pointer(self.end_color)
+        obj.properties = pointer(self.properties)
+        return obj
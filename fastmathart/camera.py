@@ -0,0 +1,69 @@
+from ctypes import Structure, c_float
+import math
+
+
+def _normalize(v):
+    length = math.sqrt(sum(c * c for c in v))
+    return [c / length for c in v]
+
+
+def _cross(u, v):
+    return [u[1] * v[2] - u[2] * v[1],
+            u[2] * v[0] - u[0] * v[2],
+            u[0] * v[1] - u[1] * v[0]]
+
+
+def _dot(u, v):
+    return sum(a * b for a, b in zip(u, v))
+
+
+def look_at(eye: tuple, target: tuple = (0.0, 0.0, 0.0),
+            up: tuple = (0.0, 1.0, 0.0)) -> list:
+    """View matrix of a camera at eye looking at target, 16 floats row-major"""
+    forward = _normalize([t - e for t, e in zip(target, eye)])
+    side = _normalize(_cross(forward, up))
+    top = _cross(side, forward)
+    return side + [-_dot(side, eye)] \
+        + top + [-_dot(top, eye)] \
+        + [-f for f in forward] + [_dot(forward, eye)] \
+        + [0.0, 0.0, 0.0, 1.0]
+
+
+def perspective(fov: float = math.pi / 3, near: float = 0.1,
+                far: float = 100.0) -> list:
+    """
+    Projection matrix, fov in radians across the smaller side of the frame.
+    There is no aspect ratio, the renderer already accounts for it.
+    """
+    f = 1.0 / math.tan(fov / 2)
+    depth = near - far
+    return [f, 0.0, 0.0, 0.0,
+            0.0, f, 0.0, 0.0,
+            0.0, 0.0, (far + near) / depth, 2 * far * near / depth,
+            0.0, 0.0, -1.0, 0.0]
+
+
+def orbit(center: tuple = (0.0, 0.0, 0.0), distance: float = 3.0,
+          elevation: float = 0.4, start: float = 0.0, turns: float = 1.0,
+          keys: int = 64) -> list:
+    """View matrices of a camera circling around center, for CameraMove"""
+    views = []
+    for i in range(keys):
+        angle = start + 2 * math.pi * turns * i / (keys - 1)
+        eye = (center[0] + distance * math.cos(elevation) * math.sin(angle),
+               center[1] + distance * math.sin(elevation),
+               center[2] + distance * math.cos(elevation) * math.cos(angle))
+        views.append(look_at(eye, center))
+    return views
+
+
+class Camera(Structure):
+    """Makes the scene 3D, z coordinates are seen through the camera"""
+    _fields_ = [
+        ("view", c_float * 16),
+        ("projection", c_float * 16),
+    ]
+
+    def __init__(self, view: list = None, projection: list = None):
+        self.view = (c_float * 16)(*(view or look_at((0.0, 0.0, 3.0))))
+        self.projection = (c_float * 16)(*(projection or perspective()))
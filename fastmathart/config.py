@@ -1,21 +1,26 @@
-from ctypes import Structure, c_int
+from ctypes import Structure, c_int, POINTER, pointer
+from fastmathart.camera import Camera
 class ConfigBinding(Structure):
     _fields_ = [
         ('width', c_int),
         ('height', c_int),
         ('frames_per_second', c_int),
+        ('camera', POINTER(Camera)),
     ]
 
     def __init__(self):
         self.width = config.width
         self.height = config.height
         self.frames_per_second = config.frames_per_second
+        if config.camera is not None:
+            self.camera = pointer(config.camera)
 
 
 class config:
     width = 1920
     height = 1080
     frames_per_second = 60
+    camera = None  # a Camera makes the scene 3D
 
     def load_preset(preset):
         config.width = preset.width
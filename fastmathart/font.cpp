@@ -0,0 +1,655 @@
+#include "font.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <system_error>
+
+
+/*
+======================================
+Loading
+======================================
+*/
+
+std::shared_ptr<font> font::load(const std::string &path)
+{
+    struct entry
+    {
+        std::filesystem::file_time_type modified;
+        std::shared_ptr<font> loaded;
+    };
+    static std::mutex fonts_mutex;
+    static std::map<std::string, entry> fonts;
+
+    std::error_code error;
+    const auto modified = std::filesystem::last_write_time(path, error);
+    if (error)
+    {
+        std::cout << "Could not open font " << path << "\n";
+        return nullptr;
+    }
+
+    std::lock_guard lock(fonts_mutex);
+    auto found = fonts.find(path);
+    if (found != fonts.end() && found->second.modified == modified)
+        return found->second.loaded;
+
+    std::ifstream file(path, std::ios::binary);
+    std::vector<std::uint8_t> data((std::istreambuf_iterator<char>(file)),
+                                   std::istreambuf_iterator<char>());
+
+    auto loaded = std::make_shared<font>(std::move(data));
+    if (!loaded->valid())
+    {
+        std::cout << "Could not read font " << path << "\n";
+        loaded = nullptr;
+    }
+    fonts[path] = { modified, loaded };
+    return loaded;
+}
+
+font::font(std::vector<std::uint8_t> data)
+    : data(std::move(data))
+    , cached_bytes(memory::caches, this->data.capacity())
+{
+    if (!parse())
+        units_per_em = 0;
+}
+
+// Big endian reads, out of range ones give 0
+std::uint16_t font::u16(std::size_t offset) const
+{
+    if (offset + 2 > data.size())
+        return 0;
+    return static_cast<std::uint16_t>(data[offset] << 8 | data[offset + 1]);
+}
+
+std::int16_t font::i16(std::size_t offset) const
+{
+    return static_cast<std::int16_t>(u16(offset));
+}
+
+std::uint32_t font::u32(std::size_t offset) const
+{
+    return std::uint32_t{ u16(offset) } << 16 | u16(offset + 2);
+}
+
+font::table font::find_table(std::string_view tag) const
+{
+    const int table_count = u16(font_offset + 4);
+    for (int i = 0; i < table_count; i++)
+    {
+        const std::size_t record = font_offset + 12 + 16 * std::size_t(i);
+        if (record + 16 > data.size())
+            break;
+        if (std::equal(tag.begin(), tag.end(), &data[record]))
+        {
+            const table found{ u32(record + 8), u32(record + 12) };
+            if (std::size_t{ found.offset } + found.length > data.size())
+                return {};
+            return found;
+        }
+    }
+    return {};
+}
+
+bool font::parse()
+{
+    if (data.size() < 12)
+        return false;
+
+    // Font collections: the first font
+    if (u32(0) == 0x74746366) // 'ttcf'
+        font_offset = u32(12);
+
+    const std::uint32_t version = u32(font_offset);
+    if (version == 0x4F54544F) // 'OTTO'
+    {
+        std::cout << "CFF outlines are not supported, use a TrueType font\n";
+        return false;
+    }
+    if (version != 0x00010000 && version != 0x74727565) // 'true'
+        return false;
+
+    const table head = find_table("head");
+    const table maxp = find_table("maxp");
+    const table hhea = find_table("hhea");
+    const table cmap = find_table("cmap");
+    loca = find_table("loca");
+    glyf = find_table("glyf");
+    hmtx = find_table("hmtx");
+    if (head.length < 54 || maxp.length < 6 || hhea.length < 36
+        || cmap.length < 4 || loca.length == 0 || glyf.length == 0)
+        return false;
+
+    units_per_em = u16(head.offset + 18);
+    index_to_loc_format = i16(head.offset + 50);
+    num_glyphs = u16(maxp.offset + 4);
+    ascent = i16(hhea.offset + 4);
+    descent = i16(hhea.offset + 6);
+    line_gap = i16(hhea.offset + 8);
+    number_of_hmetrics = u16(hhea.offset + 34);
+
+    // Unicode subtables, the full repertoire ones first
+    int best = 0;
+    const int subtable_count = u16(cmap.offset + 2);
+    for (int i = 0; i < subtable_count; i++)
+    {
+        const std::size_t record = cmap.offset + 4 + 8 * std::size_t(i);
+        const int platform = u16(record);
+        const int encoding = u16(record + 2);
+        const std::size_t subtable = cmap.offset + u32(record + 4);
+        const int format = u16(subtable);
+
+        const bool unicode = platform == 0 || (platform == 3 && encoding == 1)
+            || (platform == 3 && encoding == 10);
+        const int rank = !unicode ? 0 : format == 12 ? 2 : format == 4 ? 1 : 0;
+        if (rank > best)
+        {
+            best = rank;
+            cmap_subtable = subtable;
+            cmap_format = format;
+        }
+    }
+
+    return units_per_em > 0 && num_glyphs > 0 && best > 0;
+}
+
+std::uint32_t font::glyph_index(std::uint32_t codepoint) const
+{
+    const std::size_t t = cmap_subtable;
+    if (cmap_format == 4)
+    {
+        if (codepoint > 0xFFFF)
+            return 0;
+        const std::size_t segments = u16(t + 6) / 2;
+        const std::size_t ends = t + 14;
+        const std::size_t starts = ends + 2 * segments + 2;
+        const std::size_t deltas = starts + 2 * segments;
+        const std::size_t ranges = deltas + 2 * segments;
+
+        // First segment ending at or after the codepoint
+        std::size_t lo = 0, hi = segments;
+        while (lo < hi)
+        {
+            const std::size_t mid = (lo + hi) / 2;
+            if (u16(ends + 2 * mid) < codepoint)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        if (lo == segments || u16(starts + 2 * lo) > codepoint)
+            return 0;
+
+        const std::uint16_t delta = u16(deltas + 2 * lo);
+        const std::uint16_t range = u16(ranges + 2 * lo);
+        if (range == 0)
+            return (codepoint + delta) & 0xFFFF;
+
+        const std::size_t address = ranges + 2 * lo + range
+            + 2 * (codepoint - u16(starts + 2 * lo));
+        const std::uint16_t glyph = u16(address);
+        return glyph == 0 ? 0 : (glyph + delta) & 0xFFFF;
+    }
+
+    if (cmap_format == 12)
+    {
+        std::size_t lo = 0, hi = u32(t + 12);
+        while (lo < hi)
+        {
+            const std::size_t mid = (lo + hi) / 2;
+            const std::size_t group = t + 16 + 12 * mid;
+            if (codepoint < u32(group))
+                hi = mid;
+            else if (codepoint > u32(group + 4))
+                lo = mid + 1;
+            else
+                return u32(group + 8) + (codepoint - u32(group));
+        }
+    }
+    return 0;
+}
+
+float font::advance(std::uint32_t glyph) const
+{
+    if (number_of_hmetrics == 0)
+        return 0.0f;
+    const std::uint32_t metric =
+        std::min<std::uint32_t>(glyph, std::uint32_t(number_of_hmetrics) - 1);
+    return float(u16(hmtx.offset + 4 * std::size_t{ metric }))
+        / float(units_per_em);
+}
+
+float font::ascender() const
+{
+    return float(ascent) / float(units_per_em);
+}
+
+float font::descender() const
+{
+    return float(descent) / float(units_per_em);
+}
+
+float font::line_height() const
+{
+    return float(ascent - descent + line_gap) / float(units_per_em);
+}
+
+/*
+======================================
+Outlines
+======================================
+*/
+
+// Appends the glyph contours, in em units, mapped by (a b; c d) + (dx, dy).
+// Composite glyphs recurse into their components.
+bool font::parse_glyph(std::uint32_t glyph, float a, float b, float c,
+                       float d, float dx, float dy, int depth,
+                       glyph_outline &out) const
+{
+    if (glyph >= num_glyphs || depth > 8)
+        return false;
+
+    const std::size_t loc = index_to_loc_format == 0
+        ? std::size_t{ u16(loca.offset + 2 * std::size_t{ glyph }) } * 2
+        : u32(loca.offset + 4 * std::size_t{ glyph });
+    const std::size_t loc_end = index_to_loc_format == 0
+        ? std::size_t{ u16(loca.offset + 2 * std::size_t{ glyph } + 2) } * 2
+        : u32(loca.offset + 4 * std::size_t{ glyph } + 4);
+    if (loc_end <= loc)
+        return true; // no outline, as for the space
+    if (loc_end > glyf.length)
+        return false;
+
+    const std::size_t begin = glyf.offset + loc;
+    const std::size_t end = glyf.offset + loc_end;
+    const int contour_count = i16(begin);
+
+    if (contour_count < 0)
+    {
+        std::size_t at = begin + 10;
+        std::uint16_t flags;
+        do
+        {
+            flags = u16(at);
+            const std::uint16_t component = u16(at + 2);
+            at += 4;
+
+            float ox, oy;
+            if (flags & 0x0001) // ARG_1_AND_2_ARE_WORDS
+            {
+                ox = i16(at);
+                oy = i16(at + 2);
+                at += 4;
+            }
+            else
+            {
+                ox = static_cast<std::int8_t>(at < end ? data[at] : 0);
+                oy = static_cast<std::int8_t>(at + 1 < end ? data[at + 1] : 0);
+                at += 2;
+            }
+            // Matched points are not supported, the component stays put
+            if (!(flags & 0x0002)) // ARGS_ARE_XY_VALUES
+                ox = oy = 0.0f;
+
+            auto f2dot14 = [&](std::size_t offset) {
+                return float(i16(offset)) / 16384.0f;
+            };
+            float ca = 1.0f, cb = 0.0f, cc = 0.0f, cd = 1.0f;
+            if (flags & 0x0008) // WE_HAVE_A_SCALE
+            {
+                ca = cd = f2dot14(at);
+                at += 2;
+            }
+            else if (flags & 0x0040) // WE_HAVE_AN_X_AND_Y_SCALE
+            {
+                ca = f2dot14(at);
+                cd = f2dot14(at + 2);
+                at += 4;
+            }
+            else if (flags & 0x0080) // WE_HAVE_A_TWO_BY_TWO
+            {
+                ca = f2dot14(at);
+                cb = f2dot14(at + 2);
+                cc = f2dot14(at + 4);
+                cd = f2dot14(at + 6);
+                at += 8;
+            }
+            if (at > end)
+                return false;
+
+            // x' = ca x + cc y + ox, y' = cb x + cd y + oy, then ours
+            const float em = 1.0f / float(units_per_em);
+            if (!parse_glyph(component, a * ca + b * cb, a * cc + b * cd,
+                             c * ca + d * cb, c * cc + d * cd,
+                             dx + (a * ox + b * oy) * em,
+                             dy + (c * ox + d * oy) * em, depth + 1, out))
+                return false;
+        } while (flags & 0x0020); // MORE_COMPONENTS
+        return true;
+    }
+
+    // Simple glyph: contour ends, instructions, flags, then x and y deltas
+    const std::size_t ends_at = begin + 10;
+    const std::size_t point_count =
+        contour_count == 0 ? 0 : std::size_t{ u16(ends_at + 2 * std::size_t(contour_count - 1)) } + 1;
+    std::size_t at = ends_at + 2 * std::size_t(contour_count);
+    at += 2 + u16(at);
+
+    std::vector<std::uint8_t> flags;
+    flags.reserve(point_count);
+    while (flags.size() < point_count)
+    {
+        if (at >= end)
+            return false;
+        const std::uint8_t flag = data[at++];
+        std::size_t repeat = 1;
+        if (flag & 0x08)
+        {
+            if (at >= end)
+                return false;
+            repeat += data[at++];
+        }
+        for (std::size_t k = 0; k < repeat && flags.size() < point_count; k++)
+            flags.push_back(flag);
+    }
+
+    std::vector<math::fvec3> points(point_count);
+    auto read_axis = [&](std::uint8_t short_bit, std::uint8_t same_bit,
+                         float math::fvec3::*axis) {
+        int value = 0;
+        for (std::size_t k = 0; k < point_count; k++)
+        {
+            const std::uint8_t flag = flags[k];
+            if (flag & short_bit)
+            {
+                if (at >= end)
+                    return false;
+                const int delta = data[at++];
+                value += (flag & same_bit) ? delta : -delta;
+            }
+            else if (!(flag & same_bit))
+            {
+                if (at + 2 > end)
+                    return false;
+                value += i16(at);
+                at += 2;
+            }
+            points[k].*axis = float(value);
+        }
+        return true;
+    };
+    if (!read_axis(0x02, 0x10, &math::fvec3::x)
+        || !read_axis(0x04, 0x20, &math::fvec3::y))
+        return false;
+
+    const float em = 1.0f / float(units_per_em);
+    for (auto &p : points)
+        p = math::fvec3((a * p.x + b * p.y) * em + dx,
+                        (c * p.x + d * p.y) * em + dy, 0.0f);
+
+    auto on_curve = [&](std::size_t k) { return (flags[k] & 0x01) != 0; };
+    auto add_line = [&](math::fvec3 p0, math::fvec3 p1) {
+        out.curves.addCurve(math::CubicBezier::straightLine(p0, p1));
+    };
+    // Quadratics are exact as cubics with the control point 2/3 of the way
+    auto add_quadratic = [&](math::fvec3 p0, math::fvec3 control,
+                             math::fvec3 p1) {
+        out.curves.addCurve(math::CubicBezier(
+            p0, p0 + (control - p0) * (2.0f / 3.0f),
+            p1 + (control - p1) * (2.0f / 3.0f), p1));
+    };
+
+    std::size_t first = 0;
+    for (int contour = 0; contour < contour_count; contour++)
+    {
+        const std::size_t last = u16(ends_at + 2 * std::size_t(contour));
+        if (last < first || last >= point_count)
+            return false;
+
+        // Start on a point on the curve, or between two off curve ones
+        math::fvec3 start;
+        std::size_t from = first, to = last;
+        if (on_curve(first))
+        {
+            start = points[first];
+            from = first + 1;
+        }
+        else if (on_curve(last))
+        {
+            start = points[last];
+            to = last - 1;
+        }
+        else
+        {
+            start = (points[first] + points[last]) * 0.5f;
+        }
+
+        math::fvec3 previous = start, control;
+        bool has_control = false;
+        for (std::size_t k = from; k <= to && k <= last; k++)
+        {
+            if (on_curve(k))
+            {
+                if (has_control)
+                    add_quadratic(previous, control, points[k]);
+                else
+                    add_line(previous, points[k]);
+                previous = points[k];
+                has_control = false;
+            }
+            else
+            {
+                if (has_control)
+                {
+                    const math::fvec3 middle = (control + points[k]) * 0.5f;
+                    add_quadratic(previous, control, middle);
+                    previous = middle;
+                }
+                control = points[k];
+                has_control = true;
+            }
+        }
+        if (has_control)
+            add_quadratic(previous, control, start);
+        else if (!(previous == start))
+            add_line(previous, start);
+
+        out.contour_ends.push_back(out.curves.size());
+        first = last + 1;
+    }
+    return true;
+}
+
+const glyph_outline &font::outline(std::uint32_t glyph)
+{
+    std::lock_guard lock(cache_mutex);
+    auto found = outlines.find(glyph);
+    if (found != outlines.end())
+        return found->second;
+
+    glyph_outline parsed;
+    if (!parse_glyph(glyph, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0, parsed))
+    {
+        std::cout << "Invalid outline for glyph " << glyph << "\n";
+        parsed = {};
+    }
+    return outlines.emplace(glyph, std::move(parsed)).first->second;
+}
+
+const glyph_polyline &font::flattened(std::uint32_t glyph, int pixels_per_em)
+{
+    const auto &contours = outline(glyph);
+
+    std::lock_guard lock(cache_mutex);
+    auto &cached = polylines[{ glyph, pixels_per_em }];
+    // A quarter of a pixel
+    if (cached.empty() && contours.curves.size() > 0)
+    {
+        flatten_outline(contours, 0.25f / float(std::max(pixels_per_em, 1)),
+                        cached);
+        cached_bytes.add(cached.capacity() * sizeof(math::fvec3));
+    }
+    return cached;
+}
+
+const coverage_mask &font::mask(std::uint32_t glyph, int pixels_per_em)
+{
+    const auto &contours = flattened(glyph, pixels_per_em);
+
+    std::lock_guard lock(cache_mutex);
+    auto found = masks.find({ glyph, pixels_per_em });
+    if (found != masks.end())
+        return found->second;
+
+    std::vector<math::fvec3> pixels(contours.size());
+    const float scale = float(pixels_per_em);
+    std::transform(contours.begin(), contours.end(), pixels.begin(),
+                   [&](math::fvec3 p) {
+                       return math::fvec3(p.x * scale, -p.y * scale, 0.0f);
+                   });
+    auto &mask = masks.emplace(std::pair{ glyph, pixels_per_em },
+                               rasterize_coverage(pixels))
+                     .first->second;
+    cached_bytes.add(mask.coverage.capacity());
+    return mask;
+}
+
+/*
+======================================
+Flattening and coverage
+======================================
+*/
+
+void flatten_outline(const glyph_outline &outline, float tolerance,
+                     std::vector<math::fvec3> &out)
+{
+    const math::fvec3 separator(std::numeric_limits<float>::quiet_NaN());
+
+    std::size_t first = 0;
+    for (const std::size_t end : outline.contour_ends)
+    {
+        if (end > first)
+            out.push_back(outline.curves[first].p1);
+        for (std::size_t i = first; i < end; i++)
+        {
+            // Flat curves, the lines of the outline, are one segment
+            const auto &curve = outline.curves[i];
+            const int steps = math::flatten_steps(curve, tolerance, 64);
+            for (int k = 1; k <= steps; k++)
+                out.push_back(curve.valueAt(float(k) / float(steps)));
+        }
+        out.push_back(separator);
+        first = end;
+    }
+}
+
+coverage_mask rasterize_coverage(const std::vector<math::fvec3> &contours)
+{
+    struct edge
+    {
+        float x0, y0, x1, y1;
+        int winding;
+    };
+
+    std::vector<edge> edges;
+    float min_x = std::numeric_limits<float>::infinity(), min_y = min_x;
+    float max_x = -min_x, max_y = -min_x;
+
+    // Contours are closed: the last point of each one meets the first
+    std::size_t first = 0;
+    for (std::size_t i = 0; i <= contours.size(); i++)
+    {
+        if (i < contours.size() && std::isfinite(contours[i].x))
+        {
+            const math::fvec3 p = contours[i];
+            min_x = std::min(min_x, p.x);
+            max_x = std::max(max_x, p.x);
+            min_y = std::min(min_y, p.y);
+            max_y = std::max(max_y, p.y);
+            continue;
+        }
+        for (std::size_t k = first; k < i; k++)
+        {
+            const math::fvec3 p0 = contours[k];
+            const math::fvec3 p1 = contours[k + 1 < i ? k + 1 : first];
+            if (p0.y != p1.y)
+                edges.push_back(p0.y < p1.y
+                                    ? edge{ p0.x, p0.y, p1.x, p1.y, 1 }
+                                    : edge{ p1.x, p1.y, p0.x, p0.y, -1 });
+        }
+        first = i + 1;
+    }
+
+    coverage_mask mask;
+    if (edges.empty())
+        return mask;
+
+    mask.left = static_cast<int>(std::floor(min_x));
+    mask.top = static_cast<int>(std::floor(min_y));
+    mask.width = static_cast<int>(std::ceil(max_x)) - mask.left + 1;
+    mask.height = static_cast<int>(std::ceil(max_y)) - mask.top + 1;
+
+    constexpr int sub_rows = 4;
+    constexpr float weight = 1.0f / sub_rows;
+
+    std::vector<float> row(static_cast<std::size_t>(mask.width) + 1);
+    std::vector<std::pair<float, int>> crossings;
+    mask.coverage.resize(static_cast<std::size_t>(mask.width) * mask.height);
+
+    auto add_span = [&](float x0, float x1) {
+        x0 = std::clamp(x0 - float(mask.left), 0.0f, float(mask.width));
+        x1 = std::clamp(x1 - float(mask.left), 0.0f, float(mask.width));
+        const int i0 = static_cast<int>(x0), i1 = static_cast<int>(x1);
+        if (i0 == i1)
+        {
+            row[i0] += (x1 - x0) * weight;
+            return;
+        }
+        row[i0] += (float(i0 + 1) - x0) * weight;
+        for (int i = i0 + 1; i < i1; i++)
+            row[i] += weight;
+        row[i1] += (x1 - float(i1)) * weight;
+    };
+
+    for (int y = 0; y < mask.height; y++)
+    {
+        std::fill(row.begin(), row.end(), 0.0f);
+        for (int s = 0; s < sub_rows; s++)
+        {
+            const float sample_y =
+                float(mask.top + y) + (float(s) + 0.5f) * weight;
+
+            crossings.clear();
+            for (auto &e : edges)
+            {
+                if (sample_y < e.y0 || sample_y >= e.y1)
+                    continue;
+                const float u = (sample_y - e.y0) / (e.y1 - e.y0);
+                crossings.emplace_back(e.x0 + (e.x1 - e.x0) * u, e.winding);
+            }
+            std::sort(crossings.begin(), crossings.end());
+
+            // Nonzero winding between consecutive crossings
+            int winding = 0;
+            for (std::size_t k = 0; k + 1 < crossings.size(); k++)
+            {
+                winding += crossings[k].second;
+                if (winding != 0)
+                    add_span(crossings[k].first, crossings[k + 1].first);
+            }
+        }
+
+        std::uint8_t *out =
+            &mask.coverage[static_cast<std::size_t>(y) * mask.width];
+        for (int x = 0; x < mask.width; x++)
+            out[x] = static_cast<std::uint8_t>(
+                std::min(row[x], 1.0f) * 255.0f + 0.5f);
+    }
+    return mask;
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "math/bezier.h"
+#include "math/vec.h"
+#include "utils/memory.h"
+
+/*
+======================================
+TrueType fonts
+
+Reads the glyf outlines of .ttf/.ttc files (and of OpenType files with
+TrueType outlines), no external dependency. Every derived product is
+cached, so a label drawn over hundreds of frames is parsed and flattened
+once:
+    - the outline of a glyph, as a math::BezierPath in em units
+    - its flattened contours, per pixel size
+    - its coverage mask, per pixel size
+Fonts themselves are shared through font::load, keyed by path.
+======================================
+*/
+
+// Contours of one glyph. Each contour is closed and runs over
+// [contour_ends[i - 1], contour_ends[i]) of the curves.
+struct glyph_outline
+{
+    math::BezierPath curves;
+    std::vector<std::size_t> contour_ends;
+};
+
+// 8 bits coverage of a glyph rasterized at one size. (left, top) is the
+// offset of the first pixel from the glyph origin, y going down.
+struct coverage_mask
+{
+    int left = 0;
+    int top = 0;
+    int width = 0;
+    int height = 0;
+    std::vector<std::uint8_t> coverage;
+};
+
+// Flattened contours in em units, NaN points separate the contours
+using glyph_polyline = std::vector<math::fvec3>;
+
+class font
+{
+public:
+    // Shared instance for the path, null if the file is not a usable font
+    static std::shared_ptr<font> load(const std::string &path);
+
+    // Parses a font file already in memory
+    explicit font(std::vector<std::uint8_t> data);
+
+    bool valid() const
+    {
+        return units_per_em > 0;
+    }
+
+    // 0, the missing glyph, for characters the font does not have
+    std::uint32_t glyph_index(std::uint32_t codepoint) const;
+
+    // In em units
+    float advance(std::uint32_t glyph) const;
+    float ascender() const;
+    float descender() const;
+    float line_height() const;
+
+    std::uint32_t glyph_count() const
+    {
+        return num_glyphs;
+    }
+
+    // The cached products, references stay valid as long as the font
+    const glyph_outline &outline(std::uint32_t glyph);
+    const glyph_polyline &flattened(std::uint32_t glyph, int pixels_per_em);
+    const coverage_mask &mask(std::uint32_t glyph, int pixels_per_em);
+
+private:
+    struct table
+    {
+        std::uint32_t offset = 0;
+        std::uint32_t length = 0;
+    };
+
+    bool parse();
+    table find_table(std::string_view tag) const;
+    bool parse_glyph(std::uint32_t glyph, float a, float b, float c, float d,
+                     float dx, float dy, int depth, glyph_outline &out) const;
+
+    std::uint16_t u16(std::size_t offset) const;
+    std::int16_t i16(std::size_t offset) const;
+    std::uint32_t u32(std::size_t offset) const;
+
+    std::vector<std::uint8_t> data;
+    std::size_t font_offset = 0;
+
+    int units_per_em = 0;
+    int index_to_loc_format = 0;
+    std::uint32_t num_glyphs = 0;
+    int number_of_hmetrics = 0;
+    int ascent = 0, descent = 0, line_gap = 0;
+    table loca, glyf, hmtx;
+    std::size_t cmap_subtable = 0;
+    int cmap_format = 0;
+
+    std::mutex cache_mutex;
+    std::map<std::uint32_t, glyph_outline> outlines;
+    std::map<std::pair<std::uint32_t, int>, glyph_polyline> polylines;
+    std::map<std::pair<std::uint32_t, int>, coverage_mask> masks;
+
+    // The file, the flattened contours and the masks, counted as caches
+    memory::charge cached_bytes;
+};
+
+// Cubic beziers of the contours flattened to within `tolerance`, appended to
+// `out` with a NaN point after each contour
+void flatten_outline(const glyph_outline &outline, float tolerance,
+                     std::vector<math::fvec3> &out);
+
+// Nonzero winding coverage of the closed contours, given in pixels with y
+// going down. 4 sub-scanlines per pixel, exact coverage along them.
+coverage_mask rasterize_coverage(const std::vector<math::fvec3> &contours);
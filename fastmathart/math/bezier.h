@@ -1,8 +1,13 @@
 #pragma once
 #include <algorithm>
+#include <cmath>
+#include <memory_resource>
 #include <ranges>
+#include <stdexcept>
 #include <vector>
 
+#include "../utils/memory.h"
+#include "simplify.h"
 #include "vec.h"
 
 namespace math
@@ -70,28 +75,43 @@ namespace math
         }
     };
 
+    // The curves can live in any std::pmr resource, e.g. a frame arena.
+    // Otherwise, and for every copy, they go to the heap, counted as
+    // geometry.
     class BezierPath
     {
     private:
-        std::vector<CubicBezier> curves;
+        std::pmr::vector<CubicBezier> curves;
+
+        static std::pmr::memory_resource *heap()
+        {
+            return memory::resource(memory::geometry);
+        }
 
     public:
-        BezierPath(std::vector<CubicBezier> &curves)
-            : curves(curves)
+        BezierPath(const std::vector<CubicBezier> &curves)
+            : curves(curves.begin(), curves.end(), heap())
         { }
 
         BezierPath(std::initializer_list<CubicBezier> curves)
-            : curves(curves)
+            : curves(curves, heap())
         { }
 
-        BezierPath(std::vector<CubicBezier> &&curves)
-            : curves(std::move(curves))
+        explicit BezierPath(std::pmr::memory_resource *resource)
+            : curves(resource)
         { }
 
         BezierPath()
-        {
-            curves = {};
-        }
+            : curves(heap())
+        { }
+
+        BezierPath(const BezierPath &other)
+            : curves(other.curves, heap())
+        { }
+
+        BezierPath(BezierPath &&other) = default;
+        BezierPath &operator=(const BezierPath &other) = default;
+        BezierPath &operator=(BezierPath &&other) = default;
 
         math::fvec3 valueAt(float t) const
         {
@@ -115,6 +135,16 @@ namespace math
             curves.push_back(curve);
         }
 
+        void reserve(std::size_t count)
+        {
+            curves.reserve(count);
+        }
+
+        void resize(std::size_t count)
+        {
+            curves.resize(count);
+        }
+
         std::size_t size() const
         {
             return curves.size();
@@ -182,6 +212,26 @@ namespace math
         }
     }
 
+    // Uniform steps that flatten the curve to within `tolerance`, at most
+    // `max_steps`. Flat curves are one step, otherwise n steps are within
+    // 3/4 M / n^2 of the curve, M being the largest second difference of
+    // the control points.
+    inline int flatten_steps(const CubicBezier &curve, float tolerance,
+                             int max_steps)
+    {
+        const float tolerance2 = tolerance * tolerance;
+        if (segment_distance2(curve.p2, curve.p1, curve.p4) <= tolerance2
+            && segment_distance2(curve.p3, curve.p1, curve.p4) <= tolerance2)
+            return 1;
+
+        auto p1 = curve.p1, p2 = curve.p2, p3 = curve.p3, p4 = curve.p4;
+        const float m = std::max((p1 - p2 * 2.0f + p3).length(),
+                                 (p2 - p3 * 2.0f + p4).length());
+        const float steps = std::ceil(std::sqrt(0.75f * m / tolerance));
+        return std::clamp(static_cast<int>(std::min(steps, float(max_steps))),
+                          1, max_steps);
+    }
+
     inline CubicBezier interpolate(const CubicBezier path1,
                                    const CubicBezier path2, float t)
     {
@@ -191,19 +241,27 @@ namespace math
                             lerp(path1.p4, path2.p4, t) };
     }
 
-    inline BezierPath interpolatePaths(const BezierPath &path1,
-                                       const BezierPath &path2, float t)
+    // Writes into `result`, reusing its storage from one frame to the next
+    inline void interpolatePaths(const BezierPath &path1,
+                                 const BezierPath &path2, float t,
+                                 BezierPath &result)
     {
         if (path1.size() != path2.size())
             throw std::runtime_error(
                 "Paths must have the same number of curves");
 
-        std::vector<CubicBezier> result;
-        result.reserve(path1.size());
+        result.resize(path1.size());
         for (std::size_t i = 0; i < path1.size(); i++)
         {
-            result.push_back(interpolate(path1[i], path2[i], t));
+            result[i] = interpolate(path1[i], path2[i], t);
         }
+    }
+
+    inline BezierPath interpolatePaths(const BezierPath &path1,
+                                       const BezierPath &path2, float t)
+    {
+        BezierPath result;
+        interpolatePaths(path1, path2, t, result);
         return result;
     }
 
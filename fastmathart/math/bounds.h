@@ -0,0 +1,64 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include "projection.h"
+#include "vec.h"
+
+namespace math
+{
+    // Axis aligned box around points, empty until one is added. Points that
+    // are not finite, the pen lifts between contours, are left out.
+    struct box3
+    {
+        fvec3 lo = fvec3(std::numeric_limits<float>::infinity());
+        fvec3 hi = fvec3(-std::numeric_limits<float>::infinity());
+
+        void add(fvec3 p)
+        {
+            if (!is_projected(p))
+                return;
+            lo = fvec3(std::min(lo.x, p.x), std::min(lo.y, p.y),
+                       std::min(lo.z, p.z));
+            hi = fvec3(std::max(hi.x, p.x), std::max(hi.y, p.y),
+                       std::max(hi.z, p.z));
+        }
+
+        bool empty() const
+        {
+            return lo.x > hi.x;
+        }
+
+        // One of the 8 corners, bit 0 of `i` picks x, bit 1 y and bit 2 z
+        fvec3 corner(int i) const
+        {
+            return fvec3((i & 1) ? hi.x : lo.x, (i & 2) ? hi.y : lo.y,
+                         (i & 4) ? hi.z : lo.z);
+        }
+
+        static box3 around(const fvec3 *points, std::size_t count)
+        {
+            box3 box;
+            for (std::size_t i = 0; i < count; i++)
+                box.add(points[i]);
+            return box;
+        }
+    };
+
+    // Boxes of the chunks of a path: chunk k holds points k * size to
+    // (k + 1) * size included, the segment joining it to the next chunk
+    // being part of both
+    inline std::vector<box3> chunk_bounds(const fvec3 *points,
+                                          std::size_t count, std::size_t size)
+    {
+        std::vector<box3> chunks;
+        for (std::size_t begin = 0; begin + 1 < count; begin += size)
+            chunks.push_back(
+                box3::around(points + begin, std::min(size + 1, count - begin)));
+        return chunks;
+    }
+
+} // namespace math
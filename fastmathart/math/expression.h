@@ -0,0 +1,377 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "simplify.h"
+#include "vec.h"
+
+/*
+======================================
+Expression bytecode
+
+A stack program in postfix order, e.g. a * sin(t) is
+    parameter 0, variable, sin, mul
+It is evaluated for a whole batch of t values at once: every instruction
+runs as one loop over the batch instead of once per sample.
+======================================
+*/
+
+namespace math
+{
+    enum class opcode : int
+    {
+        constant = 0, // push the operand
+        variable,     // push t
+        parameter,    // push params[operand]
+        add,
+        sub,
+        mul,
+        div,
+        pow,
+        neg,
+        sin,
+        cos,
+        tan,
+        exp,
+        log,
+        sqrt,
+        abs
+    };
+
+    struct instruction
+    {
+        opcode op;
+        float operand;
+    };
+
+    class expression
+    {
+    public:
+        static constexpr std::size_t batch_size = 256;
+
+        expression() = default;
+
+        // Validates the program, an invalid one evaluates to NaN
+        expression(const instruction *code, std::size_t length,
+                   int param_count)
+            : code(code, code + length)
+        {
+            int depth = 0;
+            for (auto &ins : this->code)
+            {
+                // A parameter index is a whole number in range, NaN fails
+                // both comparisons
+                const bool bad_parameter = ins.op == opcode::parameter
+                    && !(ins.operand >= 0.0f && ins.operand < float(param_count)
+                         && std::trunc(ins.operand) == ins.operand);
+                const int arity = arity_of(ins.op);
+                if (arity < 0 || depth < arity || bad_parameter)
+                {
+                    std::cout << "Invalid expression bytecode\n";
+                    this->code.clear();
+                    return;
+                }
+                depth += arity == 0 ? 1 : 1 - arity;
+                max_depth = std::max(max_depth, depth);
+            }
+
+            if (depth != 1)
+            {
+                std::cout << "Expression must leave one value on the stack\n";
+                this->code.clear();
+            }
+        }
+
+        bool valid() const
+        {
+            return !code.empty();
+        }
+
+        // out[i] = f(t[i])
+        void evaluate(const float *t, std::size_t count, const float *params,
+                      float *out) const
+        {
+            if (!valid())
+            {
+                std::fill_n(out, count, NAN);
+                return;
+            }
+
+            thread_local std::vector<float> stack;
+            stack.resize(static_cast<std::size_t>(max_depth) * batch_size);
+
+            for (std::size_t begin = 0; begin < count; begin += batch_size)
+            {
+                const std::size_t n = std::min(batch_size, count - begin);
+                evaluate_batch(t + begin, n, params, stack.data());
+                std::copy_n(stack.data(), n, out + begin);
+            }
+        }
+
+        float evaluate(float t, const float *params) const
+        {
+            float out;
+            evaluate(&t, 1, params, &out);
+            return out;
+        }
+
+    private:
+        static int arity_of(opcode op)
+        {
+            switch (op)
+            {
+            case opcode::constant:
+            case opcode::variable:
+            case opcode::parameter: return 0;
+            case opcode::add:
+            case opcode::sub:
+            case opcode::mul:
+            case opcode::div:
+            case opcode::pow: return 2;
+            case opcode::neg:
+            case opcode::sin:
+            case opcode::cos:
+            case opcode::tan:
+            case opcode::exp:
+            case opcode::log:
+            case opcode::sqrt:
+            case opcode::abs: return 1;
+            default: return -1;
+            }
+        }
+
+        template <class F>
+        static void unary(float *a, std::size_t n, F f)
+        {
+            for (std::size_t i = 0; i < n; i++)
+                a[i] = f(a[i]);
+        }
+
+        template <class F>
+        static void binary(float *a, const float *b, std::size_t n, F f)
+        {
+            for (std::size_t i = 0; i < n; i++)
+                a[i] = f(a[i], b[i]);
+        }
+
+        // Slot k of the stack holds batch_size values
+        void evaluate_batch(const float *t, std::size_t n, const float *params,
+                            float *stack) const
+        {
+            int top = 0;
+            auto slot = [&](int k) {
+                return stack + static_cast<std::size_t>(k) * batch_size;
+            };
+
+            for (auto &ins : code)
+            {
+                const int arity = arity_of(ins.op);
+                float *a = arity == 2 ? slot(top - 2)
+                    : arity == 1      ? slot(top - 1)
+                                      : nullptr;
+                const float *b = arity == 2 ? slot(top - 1) : nullptr;
+
+                switch (ins.op)
+                {
+                case opcode::constant:
+                    std::fill_n(slot(top++), n, ins.operand);
+                    break;
+                case opcode::variable:
+                    std::copy_n(t, n, slot(top++));
+                    break;
+                case opcode::parameter:
+                    std::fill_n(slot(top++), n,
+                                params[static_cast<int>(ins.operand)]);
+                    break;
+                case opcode::add:
+                    binary(a, b, n, [](float x, float y) { return x + y; });
+                    break;
+                case opcode::sub:
+                    binary(a, b, n, [](float x, float y) { return x - y; });
+                    break;
+                case opcode::mul:
+                    binary(a, b, n, [](float x, float y) { return x * y; });
+                    break;
+                case opcode::div:
+                    binary(a, b, n, [](float x, float y) { return x / y; });
+                    break;
+                case opcode::pow:
+                    binary(a, b, n,
+                           [](float x, float y) { return std::pow(x, y); });
+                    break;
+                case opcode::neg:
+                    unary(a, n, [](float x) { return -x; });
+                    break;
+                case opcode::sin:
+                    unary(a, n, [](float x) { return std::sin(x); });
+                    break;
+                case opcode::cos:
+                    unary(a, n, [](float x) { return std::cos(x); });
+                    break;
+                case opcode::tan:
+                    unary(a, n, [](float x) { return std::tan(x); });
+                    break;
+                case opcode::exp:
+                    unary(a, n, [](float x) { return std::exp(x); });
+                    break;
+                case opcode::log:
+                    unary(a, n, [](float x) { return std::log(x); });
+                    break;
+                case opcode::sqrt:
+                    unary(a, n, [](float x) { return std::sqrt(x); });
+                    break;
+                case opcode::abs:
+                    unary(a, n, [](float x) { return std::abs(x); });
+                    break;
+                }
+
+                if (arity == 2)
+                    top--;
+            }
+        }
+
+        std::vector<instruction> code;
+        int max_depth = 0;
+    };
+
+    /*
+    Samples the curve (x(t), y(t)) over [t_min, t_max], appending the points
+    to `out`. Starts from a uniform grid, then splits every interval whose
+    midpoint is further than `tolerance` from its chord, one batch of
+    midpoints per level. Where the curve is not finite, and across jumps
+    such as the poles of tan(t) or 1 / t, the pen is lifted: one NaN point
+    separates the pieces. A jump is an interval still not flat after the
+    last level whose chord does not shrink when it is halved, as it does
+    along a continuous curve.
+    */
+    template <class Vector>
+    void sample_parametric(const expression &x, const expression &y,
+                           const float *params, float t_min, float t_max,
+                           float tolerance, Vector &out,
+                           int initial_segments = 64, int max_depth = 12)
+    {
+        // Scratch space reused across calls, curves are resampled per frame
+        thread_local std::vector<float> ts, xs, ys, mid_t, mid_x, mid_y,
+            next_t, next_x, next_y;
+        thread_local std::vector<char> active, next_active;
+
+        const auto segments = static_cast<std::size_t>(initial_segments);
+        ts.resize(segments + 1);
+        for (int i = 0; i <= initial_segments; i++)
+            ts[static_cast<std::size_t>(i)] =
+                t_min + (t_max - t_min) * float(i) / float(initial_segments);
+
+        xs.resize(ts.size());
+        ys.resize(ts.size());
+        x.evaluate(ts.data(), ts.size(), params, xs.data());
+        y.evaluate(ts.data(), ts.size(), params, ys.data());
+
+        // Interval i is [ts[i], ts[i + 1]], refined while it is active.
+        // The last level only tests them for a jump.
+        constexpr char done = 0, refine = 1, jump = 2;
+        active.assign(segments, refine);
+
+        const float tolerance2 = tolerance * tolerance;
+
+        for (int depth = 0; depth <= max_depth; depth++)
+        {
+            mid_t.clear();
+            for (std::size_t i = 0; i < active.size(); i++)
+            {
+                if (active[i] == refine)
+                    mid_t.push_back(0.5f * (ts[i] + ts[i + 1]));
+            }
+            if (mid_t.empty())
+                break;
+
+            mid_x.resize(mid_t.size());
+            mid_y.resize(mid_t.size());
+            x.evaluate(mid_t.data(), mid_t.size(), params, mid_x.data());
+            y.evaluate(mid_t.data(), mid_t.size(), params, mid_y.data());
+
+            next_t.clear();
+            next_x.clear();
+            next_y.clear();
+            next_active.clear();
+
+            std::size_t m = 0;
+            for (std::size_t i = 0; i < active.size(); i++)
+            {
+                next_t.push_back(ts[i]);
+                next_x.push_back(xs[i]);
+                next_y.push_back(ys[i]);
+
+                if (active[i] != refine)
+                {
+                    next_active.push_back(active[i]);
+                    continue;
+                }
+
+                const fvec3 a(xs[i], ys[i], 0.0f);
+                const fvec3 b(xs[i + 1], ys[i + 1], 0.0f);
+                const fvec3 mid(mid_x[m], mid_y[m], 0.0f);
+
+                // NaN compares false, so the edges of undefined parts get
+                // refined, their inside does not
+                auto finite = [](fvec3 p) {
+                    return std::isfinite(p.x) && std::isfinite(p.y);
+                };
+                const bool undefined = !finite(a) && !finite(b) && !finite(mid);
+                const bool flat =
+                    undefined || segment_distance2(mid, a, b) <= tolerance2;
+                if (flat)
+                {
+                    next_active.push_back(done);
+                }
+                else if (depth == max_depth)
+                {
+                    // Each half of a continuous piece is about half the
+                    // chord, across a jump one of them is the whole gap
+                    const float half2 = std::max(dot(mid - a, mid - a),
+                                                 dot(b - mid, b - mid));
+                    next_active.push_back(
+                        half2 > 0.5625f * dot(b - a, b - a) ? jump : done);
+                }
+                else
+                {
+                    next_t.push_back(mid_t[m]);
+                    next_x.push_back(mid_x[m]);
+                    next_y.push_back(mid_y[m]);
+                    next_active.push_back(refine);
+                    next_active.push_back(refine);
+                }
+                m++;
+            }
+            next_t.push_back(ts.back());
+            next_x.push_back(xs.back());
+            next_y.push_back(ys.back());
+
+            std::swap(ts, next_t);
+            std::swap(xs, next_x);
+            std::swap(ys, next_y);
+            std::swap(active, next_active);
+        }
+
+        // Separators only go between two pieces
+        bool drawn = false, lifted = false;
+        for (std::size_t i = 0; i < ts.size(); i++)
+        {
+            if (!std::isfinite(xs[i]) || !std::isfinite(ys[i]))
+            {
+                lifted = true;
+                continue;
+            }
+            if (drawn && lifted)
+                out.emplace_back(std::numeric_limits<float>::quiet_NaN());
+            out.emplace_back(xs[i], ys[i], 0.0f);
+            drawn = true;
+            lifted = i < active.size() && active[i] == jump;
+        }
+    }
+
+} // namespace math
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include "transform.h"
+#include "vec.h"
+
+/*
+======================================
+3D projection
+
+4x4 matrices in row-major order, acting on column vectors (x, y, z, 1).
+Cameras follow the OpenGL conventions: the view looks down -z and the
+projection maps the visible depth range to z in [-1, 1]. The projection
+has no aspect ratio, NDC already spans [-1, 1] on the smaller side of the
+frame (see ndc_to_raster_position).
+======================================
+*/
+
+namespace math
+{
+    struct mat4
+    {
+        float m[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+
+        static constexpr mat4 identity()
+        {
+            return {};
+        }
+
+        static mat4 from_array(const float *values)
+        {
+            mat4 result;
+            std::copy_n(values, 16, result.m);
+            return result;
+        }
+
+        // The 2D transform in the xy plane, z is left untouched
+        static constexpr mat4 from_affine(const affine2 &t)
+        {
+            return { { t.a, t.b, 0, t.tx, t.c, t.d, 0, t.ty, 0, 0, 1, 0, 0, 0,
+                       0, 1 } };
+        }
+
+        static constexpr mat4 translation(float x, float y, float z)
+        {
+            return { { 1, 0, 0, x, 0, 1, 0, y, 0, 0, 1, z, 0, 0, 0, 1 } };
+        }
+
+        // Rotation of `angle` radians around the unit vector `axis`
+        static mat4 rotation(fvec3 axis, float angle)
+        {
+            const float c = std::cos(angle), s = std::sin(angle);
+            const float k = 1.0f - c;
+            const float x = axis.x, y = axis.y, z = axis.z;
+            return { { c + x * x * k, x * y * k - z * s, x * z * k + y * s, 0,
+                       y * x * k + z * s, c + y * y * k, y * z * k - x * s, 0,
+                       z * x * k - y * s, z * y * k + x * s, c + z * z * k, 0,
+                       0, 0, 0, 1 } };
+        }
+
+        // Camera at `eye` looking at `target`
+        static mat4 look_at(fvec3 eye, fvec3 target, fvec3 up)
+        {
+            fvec3 forward = (target - eye).normalize();
+            fvec3 side = cross(forward, up).normalize();
+            const fvec3 top = cross(side, forward);
+            return { { side.x, side.y, side.z, -dot(side, eye), top.x, top.y,
+                       top.z, -dot(top, eye), -forward.x, -forward.y,
+                       -forward.z, dot(forward, eye), 0, 0, 0, 1 } };
+        }
+
+        // fov_y in radians, across the smaller side of the frame
+        static mat4 perspective(float fov_y, float near, float far)
+        {
+            const float f = 1.0f / std::tan(0.5f * fov_y);
+            const float depth = near - far;
+            return { { f, 0, 0, 0, 0, f, 0, 0, 0, 0, (far + near) / depth,
+                       2.0f * far * near / depth, 0, 0, -1, 0 } };
+        }
+
+        constexpr float operator()(int row, int column) const
+        {
+            return m[4 * row + column];
+        }
+
+        // (*this) after `inner`
+        constexpr mat4 operator*(const mat4 &inner) const
+        {
+            mat4 result;
+            for (int i = 0; i < 4; i++)
+            {
+                for (int j = 0; j < 4; j++)
+                {
+                    float sum = 0.0f;
+                    for (int k = 0; k < 4; k++)
+                        sum += (*this)(i, k) * inner(k, j);
+                    result.m[4 * i + j] = sum;
+                }
+            }
+            return result;
+        }
+    };
+
+    // Smallest w a projected point may have, the ones behind the camera are
+    // not drawn
+    inline constexpr float min_projected_w = 1e-5f;
+
+    inline bool is_projected(fvec3 p)
+    {
+        return std::isfinite(p.x) && std::isfinite(p.y);
+    }
+
+    /*
+    out[i] = m * in[i] followed by the perspective divide, so x and y are in
+    NDC and z is the depth, larger is further. Points outside the depth
+    range of the projection, behind the camera included, come out as NaN.
+    Works on batches of structure of arrays: every row of the matrix is one
+    loop over the batch, which the compiler turns into SIMD code.
+    `in` and `out` may be the same array.
+    */
+    inline void project_points(const mat4 &m, const fvec3 *in,
+                               std::size_t count, fvec3 *out)
+    {
+        constexpr std::size_t batch_size = 256;
+        thread_local std::vector<float> scratch(7 * batch_size);
+        float *xs = scratch.data();
+        float *ys = xs + batch_size;
+        float *zs = ys + batch_size;
+        float *px = zs + batch_size;
+        float *py = px + batch_size;
+        float *pz = py + batch_size;
+        float *pw = pz + batch_size;
+
+        for (std::size_t begin = 0; begin < count; begin += batch_size)
+        {
+            const std::size_t n = std::min(batch_size, count - begin);
+            const fvec3 *src = in + begin;
+
+            for (std::size_t i = 0; i < n; i++)
+            {
+                xs[i] = src[i].x;
+                ys[i] = src[i].y;
+                zs[i] = src[i].z;
+            }
+
+            auto row = [&](int r, float *dst) {
+                const float a = m(r, 0), b = m(r, 1), c = m(r, 2),
+                            d = m(r, 3);
+                for (std::size_t i = 0; i < n; i++)
+                    dst[i] = a * xs[i] + b * ys[i] + c * zs[i] + d;
+            };
+            row(0, px);
+            row(1, py);
+            row(2, pz);
+            row(3, pw);
+
+            for (std::size_t i = 0; i < n; i++)
+            {
+                const float w = pw[i] > min_projected_w ? pw[i] : 0.0f;
+                const float depth = pz[i] / w;
+                const float inv = depth >= -1.0f && depth <= 1.0f
+                    ? 1.0f / w
+                    : std::numeric_limits<float>::quiet_NaN();
+                px[i] *= inv;
+                py[i] *= inv;
+                pz[i] *= inv;
+            }
+
+            fvec3 *dst = out + begin;
+            for (std::size_t i = 0; i < n; i++)
+                dst[i] = fvec3(px[i], py[i], pz[i]);
+        }
+    }
+
+    inline fvec3 project_point(const mat4 &m, fvec3 p)
+    {
+        project_points(m, &p, 1, &p);
+        return p;
+    }
+
+} // namespace math
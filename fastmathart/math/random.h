@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+/*
+======================================
+Counter-based random numbers
+
+Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as
+1, 2, 3"). The output is a pure function of a 128 bits counter and a
+64 bits key: there is no state to share between threads, and the same
+(seed, particle, frame) gives the same numbers on any thread, in any order.
+======================================
+*/
+
+namespace math
+{
+    using philox_counter = std::array<std::uint32_t, 4>;
+    using philox_key = std::array<std::uint32_t, 2>;
+
+    inline philox_counter philox4x32(philox_counter counter, philox_key key)
+    {
+        constexpr std::uint32_t multiplier0 = 0xD2511F53;
+        constexpr std::uint32_t multiplier1 = 0xCD9E8D57;
+        constexpr std::uint32_t weyl0 = 0x9E3779B9;
+        constexpr std::uint32_t weyl1 = 0xBB67AE85;
+
+        for (int round = 0; round < 10; round++)
+        {
+            const std::uint64_t product0 =
+                std::uint64_t{ multiplier0 } * counter[0];
+            const std::uint64_t product1 =
+                std::uint64_t{ multiplier1 } * counter[2];
+            const auto hi0 = static_cast<std::uint32_t>(product0 >> 32);
+            const auto lo0 = static_cast<std::uint32_t>(product0);
+            const auto hi1 = static_cast<std::uint32_t>(product1 >> 32);
+            const auto lo1 = static_cast<std::uint32_t>(product1);
+
+            counter = { hi1 ^ counter[1] ^ key[0], lo1,
+                        hi0 ^ counter[3] ^ key[1], lo0 };
+            key[0] += weyl0;
+            key[1] += weyl1;
+        }
+        return counter;
+    }
+
+    // Uniform in [0, 1), from the 24 high bits
+    inline float uniform_float(std::uint32_t bits)
+    {
+        return static_cast<float>(bits >> 8) * (1.0f / 16777216.0f);
+    }
+
+    // Four uniform floats in [0, 1) for the given seed and indices
+    inline std::array<float, 4> random_uniform4(std::uint64_t seed,
+                                                std::uint32_t a,
+                                                std::uint32_t b,
+                                                std::uint32_t c = 0)
+    {
+        const auto bits = philox4x32(
+            { a, b, c, 0 }, { static_cast<std::uint32_t>(seed),
+                              static_cast<std::uint32_t>(seed >> 32) });
+        return { uniform_float(bits[0]), uniform_float(bits[1]),
+                 uniform_float(bits[2]), uniform_float(bits[3]) };
+    }
+
+} // namespace math
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "vec.h"
+
+namespace math
+{
+    // Squared distance from p to the segment [a, b], in the xy plane
+    inline float segment_distance2(fvec3 p, fvec3 a, fvec3 b)
+    {
+        const float dx = b.x - a.x;
+        const float dy = b.y - a.y;
+        const float len2 = dx * dx + dy * dy;
+
+        float t = 0.0f;
+        if (len2 > 0.0f)
+            t = std::clamp(((p.x - a.x) * dx + (p.y - a.y) * dy) / len2, 0.0f,
+                           1.0f);
+
+        const float ex = a.x + t * dx - p.x;
+        const float ey = a.y + t * dy - p.y;
+        return ex * ex + ey * ey;
+    }
+
+    // Douglas-Peucker simplification of a run of finite points
+    template <class Vector>
+    void simplify_run(const fvec3 *points, std::size_t count, float tolerance,
+                      Vector &out)
+    {
+        if (count < 3 || tolerance <= 0.0f)
+        {
+            out.insert(out.end(), points, points + count);
+            return;
+        }
+
+        const float tolerance2 = tolerance * tolerance;
+
+        // Scratch space of the thread, curves resampled at every frame
+        // don't allocate once it has grown
+        static thread_local std::vector<char> keep;
+        keep.assign(count, 0);
+        keep[0] = keep[count - 1] = 1;
+
+        // Explicit stack, plots can have far too many points to recurse
+        static thread_local std::vector<std::pair<std::size_t, std::size_t>>
+            ranges;
+        ranges.clear();
+        ranges.emplace_back(0, count - 1);
+
+        while (!ranges.empty())
+        {
+            auto [first, last] = ranges.back();
+            ranges.pop_back();
+
+            float max_distance2 = 0.0f;
+            std::size_t farthest = first;
+            for (std::size_t i = first + 1; i < last; i++)
+            {
+                const float d2 =
+                    segment_distance2(points[i], points[first], points[last]);
+                if (d2 > max_distance2)
+                {
+                    max_distance2 = d2;
+                    farthest = i;
+                }
+            }
+
+            if (max_distance2 > tolerance2)
+            {
+                keep[farthest] = 1;
+                if (farthest - first > 1)
+                    ranges.emplace_back(first, farthest);
+                if (last - farthest > 1)
+                    ranges.emplace_back(farthest, last);
+            }
+        }
+
+        for (std::size_t i = 0; i < count; i++)
+        {
+            if (keep[i])
+                out.push_back(points[i]);
+        }
+    }
+
+    // Douglas-Peucker simplification: the kept points are appended to `out`,
+    // every dropped point is within `tolerance` of the simplified polyline.
+    // The end points are always kept, a tolerance <= 0 keeps everything.
+    // Non finite points lift the pen: the runs between them are simplified
+    // on their own and each gap is kept as one of its points.
+    template <class Vector>
+    void simplify_polyline(const fvec3 *points, std::size_t count,
+                           float tolerance, Vector &out)
+    {
+        auto finite = [](fvec3 p) {
+            return std::isfinite(p.x) && std::isfinite(p.y)
+                && std::isfinite(p.z);
+        };
+
+        std::size_t i = 0;
+        while (i < count)
+        {
+            if (!finite(points[i]))
+            {
+                out.push_back(points[i]);
+                while (i < count && !finite(points[i]))
+                    i++;
+                continue;
+            }
+
+            std::size_t end = i;
+            while (end < count && finite(points[end]))
+                end++;
+            simplify_run(points + i, end - i, tolerance, out);
+            i = end;
+        }
+    }
+
+} // namespace math
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#include "vec.h"
+
+namespace math
+{
+    // 2D affine transform in NDC, the z coordinate is left untouched
+    //
+    //   | a  b  tx |
+    //   | c  d  ty |
+    //
+    // Laid out like the 6 floats per instance of PyAPI::Instanced.
+    struct affine2
+    {
+        float a = 1.0f, b = 0.0f, tx = 0.0f;
+        float c = 0.0f, d = 1.0f, ty = 0.0f;
+
+        static constexpr affine2 identity()
+        {
+            return {};
+        }
+
+        static constexpr affine2 translation(float x, float y)
+        {
+            return { 1.0f, 0.0f, x, 0.0f, 1.0f, y };
+        }
+
+        static constexpr affine2 from_array(const float *m)
+        {
+            return { m[0], m[1], m[2], m[3], m[4], m[5] };
+        }
+
+        constexpr fvec3 apply(fvec3 p) const
+        {
+            return fvec3(a * p.x + b * p.y + tx, c * p.x + d * p.y + ty, p.z);
+        }
+
+        // (*this) after `inner`
+        constexpr affine2 operator*(const affine2 &inner) const
+        {
+            return { a * inner.a + b * inner.c,
+                     a * inner.b + b * inner.d,
+                     a * inner.tx + b * inner.ty + tx,
+                     c * inner.a + d * inner.c,
+                     c * inner.b + d * inner.d,
+                     c * inner.tx + d * inner.ty + ty };
+        }
+
+        // Largest factor a length can be stretched by
+        float max_scale() const
+        {
+            const float e = a * a + b * b + c * c + d * d;
+            const float det = a * d - b * c;
+            return std::sqrt(
+                0.5f * (e + std::sqrt(std::max(e * e - 4 * det * det, 0.0f))));
+        }
+
+        constexpr bool is_identity() const
+        {
+            return a == 1.0f && b == 0.0f && tx == 0.0f && c == 0.0f
+                && d == 1.0f && ty == 0.0f;
+        }
+    };
+
+    inline constexpr affine2 lerp(const affine2 &m1, const affine2 &m2,
+                                  float t)
+    {
+        auto mix = [t](float x, float y) { return x + (y - x) * t; };
+        return { mix(m1.a, m2.a), mix(m1.b, m2.b), mix(m1.tx, m2.tx),
+                 mix(m1.c, m2.c), mix(m1.d, m2.d), mix(m1.ty, m2.ty) };
+    }
+
+} // namespace math
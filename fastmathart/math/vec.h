@@ -5,15 +5,25 @@
 #include <iostream>
 #include <memory>
 #include <numbers>
-#include <random>
+
+#include "random.h"
 
 namespace math
 {
+    // Every thread draws from its own Philox stream, the same sequence on
+    // every run. Code that must not depend on the calling thread keys
+    // random_uniform4 explicitly instead.
     inline float random_float()
     {
-        static std::uniform_real_distribution<float> distribution(0.0, 1.0);
-        static std::mt19937 generator;
-        return distribution(generator);
+        thread_local std::uint64_t index = 0;
+        thread_local std::array<float, 4> batch;
+
+        const auto lane = index % 4;
+        if (lane == 0)
+            batch = random_uniform4(0, static_cast<std::uint32_t>(index / 4),
+                                    static_cast<std::uint32_t>(index >> 34));
+        index++;
+        return batch[lane];
     }
 
     inline float random_float(float min, float max)
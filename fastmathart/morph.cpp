@@ -0,0 +1,67 @@
+#include "morph.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "raster.h"
+#include "utils/kernels.h"
+#include "utils/trace.h"
+
+morph_outline flatten_aligned(const math::BezierPath &src,
+                              const math::BezierPath &dest, float tolerance,
+                              std::pmr::memory_resource *resource)
+{
+    FMA_TRACE_SCOPE("flatten", stage);
+
+    const math::fvec3 separator(std::numeric_limits<float>::quiet_NaN());
+    morph_outline outline{ std::pmr::vector<math::fvec3>(resource),
+                           std::pmr::vector<math::fvec3>(resource) };
+    const auto &kernel = kernels::active();
+    std::pmr::vector<float> ts(resource);
+
+    for (std::size_t k = 0; k < src.size(); k++)
+    {
+        const auto &a = src[k];
+        const auto &b = dest[k];
+
+        // Dense enough for the more detailed of the two curves. Without a
+        // tolerance (through a camera) as many steps as a placed bezier.
+        const int steps = tolerance > 0.0f
+            ? std::max(math::flatten_steps(a, tolerance, 256),
+                       math::flatten_steps(b, tolerance, 256))
+            : bezier_sample_count();
+
+        if (k == 0 || a.p1 != src[k - 1].p4 || b.p1 != dest[k - 1].p4)
+        {
+            if (k > 0)
+            {
+                outline.src.push_back(separator);
+                outline.dest.push_back(separator);
+            }
+            outline.src.push_back(a.p1);
+            outline.dest.push_back(b.p1);
+        }
+
+        ts.resize(static_cast<std::size_t>(steps));
+        for (int i = 1; i <= steps; i++)
+            ts[static_cast<std::size_t>(i - 1)] = float(i) / float(steps);
+
+        const std::size_t first = outline.src.size();
+        outline.src.resize(first + ts.size());
+        outline.dest.resize(first + ts.size());
+        kernel.eval_cubic(a, ts.data(), outline.src.data() + first,
+                          ts.size());
+        kernel.eval_cubic(b, ts.data(), outline.dest.data() + first,
+                          ts.size());
+    }
+    return outline;
+}
+
+void interpolate_outline(const morph_outline &outline, float t,
+                         std::pmr::vector<math::fvec3> &points)
+{
+    FMA_TRACE_SCOPE("interpolate", stage);
+    points.resize(outline.src.size());
+    kernels::active().lerp_points(outline.src.data(), outline.dest.data(), t,
+                                  points.data(), points.size());
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <memory_resource>
+#include <vector>
+
+#include "math/bezier.h"
+#include "math/vec.h"
+
+/*
+======================================
+Morph outlines
+
+The source and destination of a Morph are aligned and flattened once, at
+the same curve parameters, so that a frame is a lerp between the two
+point arrays. Curves that don't join in both paths are separated by a NaN
+point, which lifts the pen. All the storage comes from one memory
+resource, the frame arena of the element while rendering.
+======================================
+*/
+
+struct morph_outline
+{
+    std::pmr::vector<math::fvec3> src;
+    std::pmr::vector<math::fvec3> dest;
+};
+
+// Every curve is cut into segments within `tolerance` (in NDC) of both
+// curves, a tolerance of 0 samples them like a placed bezier
+morph_outline flatten_aligned(const math::BezierPath &src,
+                              const math::BezierPath &dest, float tolerance,
+                              std::pmr::memory_resource *resource);
+
+// The outline `t` of the way, into `points` whose storage is kept from a
+// frame to the next
+void interpolate_outline(const morph_outline &outline, float t,
+                         std::pmr::vector<math::fvec3> &points);
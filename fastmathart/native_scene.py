@@ -0,0 +1,160 @@
+from ctypes import POINTER, byref, c_float, c_int, cast, pointer
+from fastmathart.api_bindings import lib
+from fastmathart.color import Color
+from fastmathart.properties import Properties
+
+
+class NativeScene:
+    """
+    A scene built natively, one call per shape and per element instead of
+    nested ctypes structs. Every method returns the handle of what it adds,
+    shapes are given to elements by their handles.
+
+    Coordinates, transforms, instance colors and camera views are numpy
+    arrays borrowed without copies when they are contiguous float32, they
+    are kept alive as long as the scene and must not change. Elements
+    are played in the order they are added, those grouped by simultaneous()
+    play inside the group. Use it like a SceneBuilder:
+    ```
+    scene = NativeScene()
+    first = scene.polylines(x, y, starts, Properties(thickness=0.002))
+    scene.draw(*range(first, first + len(starts) - 1), seconds=2.0)
+    render(scene, "plot.mp4")
+    ```
+    """
+
+    def __init__(self):
+        self._handle = lib.scene_create()
+        self._borrowed = []
+
+    def __del__(self):
+        if self._handle:
+            lib.scene_release(self._handle)
+            self._handle = None
+
+    def _floats(self, values, columns=None):
+        import numpy
+        array = numpy.ascontiguousarray(values, dtype=numpy.float32)
+        if columns is not None and array.size % columns != 0:
+            raise ValueError(f"Expected rows of {columns} values")
+        self._borrowed.append(array)
+        return array.ctypes.data_as(POINTER(c_float)), array.size
+
+    @staticmethod
+    def _checked(handle):
+        if handle < 0:
+            raise ValueError("Invalid shape or element, see the output")
+        return handle
+
+    @staticmethod
+    def _handles(handles):
+        return (c_int * len(handles))(*handles), len(handles)
+
+    def circle(self, radius: float, properties: Properties = None):
+        return self._checked(lib.scene_add_circle(
+            self._handle, radius, byref(properties or Properties())))
+
+    def polyline(self, x, y, properties: Properties = None, z=None):
+        x, count = self._floats(x)
+        y, y_count = self._floats(y)
+        if y_count != count:
+            raise ValueError("x and y must have the same length")
+        if z is not None:
+            z, z_count = self._floats(z)
+            if z_count != count:
+                raise ValueError("x, y and z must have the same length")
+        return self._checked(lib.scene_add_polyline(
+            self._handle, x, y, z, count, byref(properties or Properties())))
+
+    def polylines(self, x, y, starts, properties: Properties = None, z=None):
+        """
+        len(starts) - 1 polylines with the same properties in the same
+        arrays, polyline i going through points starts[i] to starts[i + 1].
+        Returns the range of their handles.
+        """
+        import numpy
+        starts = numpy.ascontiguousarray(starts, dtype=numpy.int32)
+        x, count = self._floats(x)
+        y, y_count = self._floats(y)
+        if y_count != count or starts[-1] > count:
+            raise ValueError("The polylines go past the points")
+        if z is not None:
+            z, z_count = self._floats(z)
+            if z_count != count:
+                raise ValueError("x, y and z must have the same length")
+        first = self._checked(lib.scene_add_polylines(
+            self._handle, x, y, z, starts.ctypes.data_as(POINTER(c_int)),
+            len(starts) - 1, byref(properties or Properties())))
+        return range(first, first + len(starts) - 1)
+
+    def instanced(self, shape: int, transforms, colors=None, opacities=None,
+                  properties: Properties = None):
+        """
+        Copies of a shape, see Instanced. transforms holds 6 coefficients
+        (a, b, tx, c, d, ty) per instance, colors 3 floats.
+        """
+        transforms, size = self._floats(transforms, 6)
+        count = size // 6
+        if colors is not None:
+            colors, color_size = self._floats(colors, 3)
+            if color_size != 3 * count:
+                raise ValueError("one color per instance is needed")
+            colors = cast(colors, POINTER(Color))
+        if opacities is not None:
+            opacities, opacity_count = self._floats(opacities)
+            if opacity_count != count:
+                raise ValueError("one opacity per instance is needed")
+        return self._checked(lib.scene_add_instanced(
+            self._handle, shape, transforms, colors, opacities, count,
+            byref(properties) if properties is not None else None))
+
+    def parametric(self, curve):
+        """Adds a copy of a Parametric or FunctionPlot"""
+        return self._checked(lib.scene_add_parametric(
+            self._handle, curve.x_code, curve.x_length, curve.y_code,
+            curve.y_length, curve.params, curve.param_count, curve.t_min,
+            curve.t_max, curve.properties or pointer(Properties())))
+
+    def text(self, text: str, font: str, size: float = 0.2,
+             properties: Properties = None):
+        return self._checked(lib.scene_add_text(
+            self._handle, str(font).encode(), text.encode("utf-8"), size,
+            byref(properties or Properties())))
+
+    def wait(self, seconds: float = 1.0):
+        return self._checked(lib.scene_add_wait(self._handle, seconds))
+
+    def place(self, *shapes: int):
+        return self._checked(lib.scene_add_place(
+            self._handle, *self._handles(shapes)))
+
+    def draw(self, *shapes: int, seconds: float = 1.0):
+        return self._checked(lib.scene_add_draw(
+            self._handle, *self._handles(shapes), seconds))
+
+    def morph(self, source: int, target: int, seconds: float = 1.0):
+        return self._checked(lib.scene_add_morph(
+            self._handle, source, target, seconds))
+
+    def camera_move(self, views, seconds: float = 1.0):
+        """views is a list of 4x4 view matrices, or an (n, 16) array"""
+        views, size = self._floats(views, 16)
+        return self._checked(lib.scene_add_camera_move(
+            self._handle, views, size // 16, seconds))
+
+    def particles(self, particles):
+        """Adds a copy of a Particles emitter"""
+        return self._checked(lib.scene_add_particles(
+            self._handle, pointer(particles.build())))
+
+    def simultaneous(self, *elements: int):
+        """
+        Plays elements already added at the same time. They leave the
+        sequence of the scene, the group comes after everything added
+        before it.
+        """
+        return self._checked(lib.scene_add_simultaneous(
+            self._handle, *self._handles(elements)))
+
+    def build(self):
+        return lib.scene_get(self._handle)
@@ -0,0 +1,110 @@
+#include "particles.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+#include "math/random.h"
+#include "raster.h"
+
+particle_system::particle_system(const PyAPI::Particles &emitter, int fps)
+    : emitter(emitter)
+    , dt(1.0f / float(fps))
+    , start_color(stroke_color(*emitter.properties))
+    , end_color(emitter.end_color ? cast_to_color_t_RGB_f32(*emitter.end_color)
+                                  : start_color)
+{
+    const auto count = static_cast<std::size_t>(std::max(emitter.count, 0));
+    for (auto *attribute : { &x, &y, &vx, &vy, &age, &r, &g, &b, &opacity })
+        attribute->resize(count);
+
+    // Births are spread over the first lifetime, a steady flow after that
+    for (std::size_t i = 0; i < count; i++)
+    {
+        age[i] = -emitter.lifetime * float(i) / float(count);
+        spawn(i);
+    }
+    update_colors();
+}
+
+void particle_system::spawn(std::size_t i)
+{
+    const auto u = math::random_uniform4(
+        emitter.seed, static_cast<std::uint32_t>(i), frame_index);
+
+    const float heading = emitter.direction + emitter.spread * (2.0f * u[0] - 1.0f);
+    const float speed =
+        emitter.speed_min + (emitter.speed_max - emitter.speed_min) * u[1];
+    vx[i] = speed * std::cos(heading);
+    vy[i] = speed * std::sin(heading);
+
+    // Uniform over the disk around the emitter
+    const float distance = emitter.radius * std::sqrt(u[2]);
+    const float angle = 2.0f * std::numbers::pi_v<float> * u[3];
+    x[i] = emitter.properties->x + distance * std::cos(angle);
+    y[i] = emitter.properties->y + distance * std::sin(angle);
+}
+
+void particle_system::step()
+{
+    frame_index++;
+
+    // Semi-implicit Euler, particles not born yet stay where they spawn.
+    // Plain pointers and locals again, for vectorization.
+    const std::size_t count = size();
+    const float gravity_x = emitter.gravity_x, gravity_y = emitter.gravity_y;
+    const float drag = emitter.drag;
+    const float step = dt;
+    float *px = x.data(), *py = y.data(), *pvx = vx.data(), *pvy = vy.data(),
+          *page = age.data();
+    for (std::size_t i = 0; i < count; i++)
+    {
+        const float h = page[i] >= 0.0f ? step : 0.0f;
+        pvx[i] += (gravity_x - drag * pvx[i]) * h;
+        pvy[i] += (gravity_y - drag * pvy[i]) * h;
+        px[i] += pvx[i] * h;
+        py[i] += pvy[i] * h;
+        page[i] += step;
+    }
+
+    const float lifetime = emitter.lifetime;
+    for (std::size_t i = 0; i < count; i++)
+    {
+        if (age[i] >= lifetime)
+        {
+            age[i] = std::fmod(age[i], lifetime);
+            spawn(i);
+        }
+    }
+
+    update_colors();
+}
+
+void particle_system::update_colors()
+{
+    // Locals, so the stores below can't alias them and the loop vectorizes
+    const std::size_t count = size();
+    const float inverse_lifetime = 1.0f / emitter.lifetime;
+    const float alpha = emitter.properties->opacity;
+    const float r0 = start_color.r, dr = end_color.r - r0;
+    const float g0 = start_color.g, dg = end_color.g - g0;
+    const float b0 = start_color.b, db = end_color.b - b0;
+    const float *page = age.data();
+    float *pr = r.data(), *pg = g.data(), *pb = b.data(),
+          *popacity = opacity.data();
+    for (std::size_t i = 0; i < count; i++)
+    {
+        const float t = std::clamp(page[i] * inverse_lifetime, 0.0f, 1.0f);
+        pr[i] = r0 + dr * t;
+        pg[i] = g0 + dg * t;
+        pb[i] = b0 + db * t;
+        popacity[i] = page[i] >= 0.0f ? alpha * (1.0f - t) : 0.0f;
+    }
+}
+
+void particle_system::render(pixel_buffer_t &frame) const
+{
+    render_points<blend_mode::over>(
+        x.data(), y.data(), r.data(), g.data(), b.data(), opacity.data(),
+        size(), stroke_radius(emitter.properties->thickness, frame), frame);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "api_bindings.h"
+#include "utils/pixelUtils.h"
+
+/*
+======================================
+Particle system
+
+The state is a structure of arrays, one array per attribute, so the
+integrator and the color update are plain loops over floats that the
+compiler vectorizes. Randomness is drawn from Philox keyed by
+(seed, particle, frame): a run is reproducible whatever the order or
+the thread particles are processed in.
+======================================
+*/
+
+class particle_system
+{
+public:
+    particle_system(const PyAPI::Particles &emitter, int fps);
+
+    // Advance every particle by one frame, the dead ones are reborn
+    void step();
+
+    void render(pixel_buffer_t &frame) const;
+
+    std::size_t size() const
+    {
+        return age.size();
+    }
+
+    // Frames simulated so far
+    std::uint32_t frame() const
+    {
+        return frame_index;
+    }
+
+    // One entry per particle. A negative age is a particle not born yet.
+    std::vector<float> x, y;
+    std::vector<float> vx, vy;
+    std::vector<float> age;
+    std::vector<float> r, g, b, opacity;
+
+private:
+    void spawn(std::size_t i);
+    void update_colors();
+
+    PyAPI::Particles emitter;
+    float dt;
+    std::uint32_t frame_index = 0;
+    color_t<RGB_f32> start_color;
+    color_t<RGB_f32> end_color;
+};
@@ -0,0 +1,788 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "api_bindings.h"
+#include "math/bezier.h"
+#include "math/projection.h"
+#include "math/transform.h"
+#include "math/vec.h"
+#include "utils/kernels.h"
+#include "utils/pixelUtils.h"
+#include "utils/trace.h"
+
+/*
+======================================
+Rasterization kernels
+
+Every kernel is a template on the destination pixel_format and the
+blend_mode. Each combination gets its own inner loop, so there is no
+per pixel branching on either. Shapes are clipped once and then written
+row by row as horizontal spans.
+======================================
+*/
+
+enum class blend_mode
+{
+    replace = 0, // overwrite the destination, ignores opacity
+    over,        // alpha compositing with the opacity as alpha
+    add          // additive, clamped for 8 bits formats
+};
+
+// Before the conversion to whole pixels, which truncates
+inline math::fvec3 ndc_to_raster_position(math::fvec3 point, const int width,
+                                          const int height)
+{
+    int bigger_dimension = std::max(width, height);
+    int smaller_dimension = std::min(width, height);
+
+    const float screen_ratio =
+        float(bigger_dimension) / float(smaller_dimension);
+
+    const float half = float(smaller_dimension) / 2.0f;
+    return math::fvec3((point.x + screen_ratio) * half,
+                       (-point.y + 1.0f) * half, 0.0f);
+}
+
+inline int ndc_to_raster_space(float quantity, int width, int height)
+{
+    return static_cast<int>(quantity * float(std::min(height, width)));
+}
+
+// Source color converted to the destination format
+template <pixel_format F>
+typename pixel_traits<F>::color_type encode_color(color_t<RGB_f32> color)
+{
+    if constexpr (F == LinearRGB_f32)
+        return color.toLinearRGB_f32();
+    else
+        return color.toRGB_8();
+}
+
+template <pixel_format F>
+typename pixel_traits<F>::color_type encode_color(color_t<RGB_8> color)
+{
+    if constexpr (F == LinearRGB_f32)
+        return color.toRGB_f32().toLinearRGB_f32();
+    else
+        return color;
+}
+
+// Writes one source color into runs of destination pixels
+template <pixel_format F, blend_mode B>
+struct pixel_writer
+{
+    using traits = pixel_traits<F>;
+    using channel_type = typename traits::channel_type;
+    static constexpr int channels = traits::channels;
+    static constexpr int color_channels = traits::color_channels;
+
+    channel_type src[channels];
+    float alpha;
+    int alpha8;
+
+    template <class Color>
+    pixel_writer(Color color, float opacity = 1.0f)
+        : alpha(std::clamp(opacity, 0.0f, 1.0f))
+        , alpha8(static_cast<int>(alpha * 255.0f + 0.5f))
+    {
+        traits::store(src, encode_color<F>(color));
+        for (int i = 0; i < pattern_pixels * channels; i++)
+        {
+            pattern[i] = src[i % channels];
+            if constexpr (sizeof(channel_type) == 1)
+                weighted[i] =
+                    static_cast<std::uint16_t>(pattern[i] * alpha8 + 127);
+        }
+    }
+
+    void write(channel_type *dst) const
+    {
+        write(dst, alpha, alpha8);
+    }
+
+    // Run of `count` pixels. 8 bits formats without alpha go through blocks
+    // of 16 pixels, over which the source channels repeat, so the run is one
+    // flat loop on bytes, blended by the kernels of the CPU. RGBX padding
+    // bytes blend as a fourth channel and stay 0.
+    void fill(channel_type *dst, int count) const
+    {
+        constexpr bool bytes = sizeof(channel_type) == 1 && !traits::has_alpha;
+        constexpr int block = pattern_pixels * channels;
+
+        if constexpr (B == blend_mode::replace && bytes)
+        {
+            int i = 0;
+            for (; i + pattern_pixels <= count; i += pattern_pixels)
+                std::memcpy(dst + i * channels, pattern, block);
+            for (; i < count; i++)
+                std::memcpy(dst + i * channels, src, channels);
+        }
+        else if constexpr (B != blend_mode::replace && bytes)
+        {
+            const auto &k = kernels::active();
+            const auto n = static_cast<std::size_t>(count * channels);
+            if constexpr (B == blend_mode::over)
+                k.blend_over(dst, n, weighted, block, alpha8);
+            else
+                k.blend_add(dst, n, weighted, block, alpha8);
+        }
+        else
+        {
+            for (int i = 0; i < count; i++, dst += channels)
+                write(dst);
+        }
+    }
+
+    // Run of `count` pixels, the opacity of each scaled by its 8 bits
+    // coverage. A zero coverage leaves the pixel as it is.
+    void blend(channel_type *dst, const std::uint8_t *coverage,
+               int count) const
+    {
+        static_assert(B != blend_mode::replace,
+                      "coverage needs a blending mode");
+
+        if constexpr (sizeof(channel_type) == 1 && !traits::has_alpha)
+        {
+            for (int i = 0; i < count; i++, dst += channels)
+            {
+                const std::uint16_t a8 = div255(
+                    static_cast<std::uint16_t>(alpha8 * coverage[i] + 127));
+                for (int c = 0; c < channels; c++)
+                    dst[c] = blend_byte(
+                        dst[c],
+                        static_cast<std::uint16_t>(src[c] * a8 + 127), a8);
+            }
+        }
+        else
+        {
+            for (int i = 0; i < count; i++, dst += channels)
+                write(dst, alpha * float(coverage[i]) / 255.0f,
+                      (alpha8 * coverage[i] + 127) / 255);
+        }
+    }
+
+private:
+    // src repeated over 16 pixels, a whole number of 16 bytes vectors, and
+    // the same premultiplied by alpha8 and rounded
+    static constexpr int pattern_pixels = 16;
+    channel_type pattern[pattern_pixels * channels];
+    std::uint16_t weighted[pattern_pixels * channels];
+
+    // x / 255 for x <= 255 * 256, exact, in 16 bits lanes
+    static std::uint16_t div255(std::uint16_t x)
+    {
+        return static_cast<std::uint16_t>((x + (x >> 8) + 1) >> 8);
+    }
+
+    // One 8 bits channel, `weighted` being src * a8 + 127
+    static channel_type blend_byte(channel_type d, std::uint16_t weighted,
+                                   int a8)
+    {
+        if constexpr (B == blend_mode::over)
+            return static_cast<channel_type>(div255(static_cast<std::uint16_t>(
+                d * static_cast<std::uint16_t>(255 - a8) + weighted)));
+        else
+            return static_cast<channel_type>(
+                std::min(255, d + div255(weighted)));
+    }
+
+    void write(channel_type *dst, float a, int a8) const
+    {
+        if constexpr (B == blend_mode::replace)
+        {
+            for (int c = 0; c < channels; c++)
+                dst[c] = src[c];
+        }
+        else if constexpr (std::is_floating_point_v<channel_type>)
+        {
+            for (int c = 0; c < color_channels; c++)
+            {
+                if constexpr (B == blend_mode::over)
+                    dst[c] += (src[c] - dst[c]) * a;
+                else
+                    dst[c] += src[c] * a;
+            }
+        }
+        else
+        {
+            for (int c = 0; c < color_channels; c++)
+            {
+                if constexpr (B == blend_mode::over)
+                    dst[c] = static_cast<channel_type>(
+                        (dst[c] * (255 - a8) + src[c] * a8 + 127) / 255);
+                else
+                    dst[c] = static_cast<channel_type>(
+                        std::min(255, dst[c] + (src[c] * a8 + 127) / 255));
+            }
+
+            if constexpr (traits::has_alpha)
+            {
+                auto &alpha_channel = dst[channels - 1];
+                if constexpr (B == blend_mode::over)
+                    alpha_channel = static_cast<channel_type>(
+                        alpha_channel
+                        + ((255 - alpha_channel) * a8 + 127) / 255);
+                else
+                    alpha_channel = static_cast<channel_type>(
+                        std::min(255, alpha_channel + a8));
+            }
+        }
+    }
+};
+
+/*
+Span primitives. Each clips once, then hands the whole run to the writer.
+Rasterizers emit rows of these rather than single pixels.
+*/
+
+// Fill the clipped run [x0, x1] of row y
+template <pixel_format F, blend_mode B>
+inline void render_span(int y, int x0, int x1, basic_pixel_buffer<F> &frame,
+                        const pixel_writer<F, B> &writer)
+{
+    x0 = std::max(x0, 0);
+    x1 = std::min(x1, frame.width - 1);
+    if (x0 > x1)
+        return;
+
+    writer.fill(frame.row(y) + x0 * pixel_traits<F>::channels, x1 - x0 + 1);
+    FMA_TRACE_COUNT(pixels_written, x1 - x0 + 1);
+}
+
+// Blend the run of `count` pixels of row y starting at x0, with the
+// writer's opacity scaled by the coverage of each pixel
+template <pixel_format F, blend_mode B>
+inline void render_span(int y, int x0, const std::uint8_t *coverage,
+                        int count, basic_pixel_buffer<F> &frame,
+                        const pixel_writer<F, B> &writer)
+{
+    if (y < 0 || y >= frame.height)
+        return;
+
+    const int begin = std::max(0, -x0);
+    const int end = std::min(count, frame.width - x0);
+    if (begin >= end)
+        return;
+
+    writer.blend(frame.row(y) + (x0 + begin) * pixel_traits<F>::channels,
+                 coverage + begin, end - begin);
+    FMA_TRACE_COUNT(pixels_written, end - begin);
+}
+
+// Fill the clipped rectangle [x0, x1] x [y0, y1]
+template <pixel_format F, blend_mode B>
+void render_rect(int x0, int y0, int x1, int y1,
+                 basic_pixel_buffer<F> &frame,
+                 const pixel_writer<F, B> &writer)
+{
+    x0 = std::max(x0, 0);
+    x1 = std::min(x1, frame.width - 1);
+    y0 = std::max(y0, 0);
+    y1 = std::min(y1, frame.height - 1);
+    if (x0 > x1)
+        return;
+
+    for (int y = y0; y <= y1; y++)
+        writer.fill(frame.row(y) + x0 * pixel_traits<F>::channels,
+                    x1 - x0 + 1);
+    FMA_TRACE_COUNT(pixels_written,
+                    std::max(0, y1 - y0 + 1) * (x1 - x0 + 1));
+}
+
+// 8 bits coverage mask whose top left pixel lands on (x, y), blended over
+// the frame with the writer's opacity scaled by the coverage
+template <pixel_format F, blend_mode B>
+void render_coverage(const std::uint8_t *coverage, int width, int height,
+                     int x, int y, basic_pixel_buffer<F> &frame,
+                     const pixel_writer<F, B> &writer)
+{
+    const int y_begin = std::max(0, -y);
+    const int y_end = std::min(height, frame.height - y);
+
+    for (int row = y_begin; row < y_end; row++)
+        render_span(y + row, x, coverage + row * width, width, frame, writer);
+}
+
+// Largest x such that x * x <= n
+inline int isqrt(int n)
+{
+    int x = static_cast<int>(std::sqrt(static_cast<double>(n)));
+    while (x * x > n)
+        x--;
+    while ((x + 1) * (x + 1) <= n)
+        x++;
+    return x;
+}
+
+// Pixels strictly closer than `radius` to the center
+template <pixel_format F, blend_mode B>
+void render_disk(math::vec3<int> center, int radius,
+                 basic_pixel_buffer<F> &frame, const pixel_writer<F, B> &writer)
+{
+    const int r2 = radius * radius;
+    const int y_begin = std::max(-radius + 1, -center.y);
+    const int y_end = std::min(radius - 1, frame.height - 1 - center.y);
+
+    for (int y = y_begin; y <= y_end; y++)
+    {
+        const int half = isqrt(r2 - y * y - 1);
+        render_span(center.y + y, center.x - half, center.x + half, frame,
+                    writer);
+    }
+}
+
+template <blend_mode B = blend_mode::replace, pixel_format F>
+void render_disk(math::vec3<int> center, int radius,
+                 basic_pixel_buffer<F> &frame, color_t<RGB_8> color,
+                 float opacity = 1.0f)
+{
+    render_disk(center, radius, frame, pixel_writer<F, B>(color, opacity));
+}
+
+// Points given as a structure of arrays in NDC, each with its own color and
+// opacity. Coordinates are converted a batch at a time, then points with a
+// radius of 1 or less are single pixels and larger ones disks.
+template <blend_mode B, pixel_format F>
+void render_points(const float *x, const float *y, const float *r,
+                   const float *g, const float *b, const float *opacity,
+                   std::size_t count, int radius, basic_pixel_buffer<F> &frame)
+{
+    constexpr std::size_t batch_size = 256;
+    float fx[batch_size], fy[batch_size];
+
+    // Same mapping as ndc_to_raster_position
+    const float smaller = float(std::min(frame.width, frame.height));
+    const float ratio = float(std::max(frame.width, frame.height)) / smaller;
+    const float half = smaller / 2.0f;
+
+    for (std::size_t begin = 0; begin < count; begin += batch_size)
+    {
+        const std::size_t n = std::min(batch_size, count - begin);
+        for (std::size_t i = 0; i < n; i++)
+        {
+            fx[i] = (x[begin + i] + ratio) * half;
+            fy[i] = (-y[begin + i] + 1.0f) * half;
+        }
+
+        for (std::size_t i = 0; i < n; i++)
+        {
+            const std::size_t k = begin + i;
+            const float margin = radius > 1 ? float(radius) : 0.0f;
+            if (!(fx[i] > -1.0f - margin && fx[i] < frame.width + margin
+                  && fy[i] > -1.0f - margin && fy[i] < frame.height + margin)
+                || opacity[k] <= 0.0f)
+                continue;
+
+            const pixel_writer<F, B> writer(color_t<RGB_f32>(r[k], g[k], b[k]),
+                                            opacity[k]);
+            const math::vec3<int> center(static_cast<int>(fx[i]),
+                                         static_cast<int>(fy[i]), 0);
+            if (radius > 1)
+            {
+                render_disk(center, radius, frame, writer);
+            }
+            else
+            {
+                writer.write(frame.row(center.y)
+                             + center.x * pixel_traits<F>::channels);
+                FMA_TRACE_COUNT(pixels_written, 1);
+            }
+        }
+    }
+}
+
+// Union of the disks stamped at every step of the Bresenham line from p1 to
+// p2. Consecutive disks overlap, so the union is a single run per row:
+// gather the run bounds first, then write each pixel once.
+template <pixel_format F, blend_mode B>
+void render_segment(math::vec3<int> p1, math::vec3<int> p2, int radius,
+                    basic_pixel_buffer<F> &frame,
+                    const pixel_writer<F, B> &writer)
+{
+    FMA_TRACE_COUNT(segments_rasterized, 1);
+
+    if (radius <= 0)
+        return;
+
+    const int y_begin = std::max(std::min(p1.y, p2.y) - radius + 1, 0);
+    const int y_end =
+        std::min(std::max(p1.y, p2.y) + radius - 1, frame.height - 1);
+    if (y_begin > y_end)
+        return;
+
+    // Scratch space reused across calls, no allocation once warmed up
+    thread_local std::vector<int> half_width;
+    thread_local std::vector<int> row_lo;
+    thread_local std::vector<int> row_hi;
+    thread_local int cached_radius = -1;
+
+    if (cached_radius != radius)
+    {
+        half_width.resize(static_cast<std::size_t>(radius));
+        for (int d = 0; d < radius; d++)
+            half_width[static_cast<std::size_t>(d)] =
+                isqrt(radius * radius - d * d - 1);
+        cached_radius = radius;
+    }
+
+    const auto rows = static_cast<std::size_t>(y_end - y_begin + 1);
+    if (row_lo.size() < rows)
+    {
+        row_lo.resize(rows);
+        row_hi.resize(rows);
+    }
+    std::fill_n(row_lo.begin(), rows, std::numeric_limits<int>::max());
+    std::fill_n(row_hi.begin(), rows, std::numeric_limits<int>::min());
+
+    const int dx = std::abs(p2.x - p1.x);
+    const int dy = std::abs(p2.y - p1.y);
+    const int sx = (p1.x < p2.x) ? 1 : -1;
+    const int sy = (p1.y < p2.y) ? 1 : -1;
+
+    // Only the steps whose disk reaches the frame are walked. The line
+    // advances on its major axis at every step, the minor one is within
+    // half a pixel of the ideal line: both bound the steps, then the walk
+    // starts from the first of them as if it had gone through the others.
+    const bool x_major = dx >= dy;
+    const std::int64_t steps = std::max(dx, dy);
+    const std::int64_t minor = std::min(dx, dy);
+    std::int64_t k_begin = 0, k_end = steps;
+
+    // Steps where the coordinate c0 + s * (steps moved along it) can be in
+    // [lo, hi]
+    auto clip_axis = [&](int c0, int s, std::int64_t delta, int lo, int hi) {
+        std::int64_t first = s > 0 ? lo - c0 : c0 - hi; // moves needed
+        std::int64_t last = s > 0 ? hi - c0 : c0 - lo;
+        if (delta == steps)
+        {
+            k_begin = std::max(k_begin, first);
+            k_end = std::min(k_end, last);
+        }
+        else if (delta == 0)
+        {
+            if (first > 0 || last < 0)
+                k_end = -1;
+        }
+        else
+        {
+            k_begin = std::max(k_begin, (first - 1) * steps / delta);
+            k_end = std::min(k_end, (last + 1) * steps / delta + 1);
+        }
+    };
+    clip_axis(p1.x, sx, dx, -radius + 1, frame.width + radius - 2);
+    clip_axis(p1.y, sy, dy, y_begin - radius + 1, y_end + radius - 1);
+
+    // Moves along the minor axis after k steps, the error term staying in
+    // a window as wide as the major delta
+    auto minor_moves = [&](std::int64_t k) {
+        const std::int64_t num = 2 * k * minor - steps;
+        const std::int64_t den = 2 * steps;
+        return num >= 0 ? (num + den - 1) / den : -((-num) / den);
+    };
+
+    int err = dx - dy;
+    if (k_begin > 0 && k_begin <= k_end)
+    {
+        const std::int64_t moves = minor_moves(k_begin);
+        if (x_major)
+        {
+            err = static_cast<int>(dx - dy - k_begin * dy + moves * dx);
+            p1.x += static_cast<int>(sx * k_begin);
+            p1.y += static_cast<int>(sy * moves);
+        }
+        else
+        {
+            err = static_cast<int>(dx - dy + k_begin * dx - moves * dy);
+            p1.y += static_cast<int>(sy * k_begin);
+            p1.x += static_cast<int>(sx * moves);
+        }
+    }
+
+    for (std::int64_t k = k_begin; k <= k_end; k++)
+    {
+        const int d_begin = std::max(-radius + 1, y_begin - p1.y);
+        const int d_end = std::min(radius - 1, y_end - p1.y);
+        for (int d = d_begin; d <= d_end; d++)
+        {
+            // Both within the scratch space, d is clipped to the rows
+            const auto row = static_cast<std::size_t>(p1.y + d - y_begin);
+            const int half = half_width[static_cast<std::size_t>(std::abs(d))];
+            row_lo[row] = std::min(row_lo[row], p1.x - half);
+            row_hi[row] = std::max(row_hi[row], p1.x + half);
+        }
+
+        int e2 = 2 * err;
+        if (e2 > -dy)
+        {
+            err -= dy;
+            p1.x += sx;
+        }
+        if (e2 < dx)
+        {
+            err += dx;
+            p1.y += sy;
+        }
+    }
+
+    for (std::size_t row = 0; row < rows; row++)
+    {
+        if (row_lo[row] <= row_hi[row])
+            render_span(y_begin + static_cast<int>(row), row_lo[row],
+                        row_hi[row], frame, writer);
+    }
+}
+
+// One placement of a shape: where it goes and how it is colored
+struct shape_instance
+{
+    math::affine2 transform;
+    color_t<RGB_f32> color;
+    float opacity;
+};
+
+inline color_t<RGB_f32> stroke_color(const PyAPI::Properties &properties)
+{
+    return (properties.color != nullptr)
+        ? cast_to_color_t_RGB_f32(*properties.color)
+        : color_t<RGB_f32>(1.0f, 1.0f, 1.0f);
+}
+
+// Position of the object, applied at rasterization time
+inline math::affine2 object_transform(const PyAPI::Properties &properties)
+{
+    return math::affine2::translation(properties.x, properties.y);
+}
+
+inline shape_instance object_instance(const PyAPI::Properties &properties)
+{
+    return { object_transform(properties), stroke_color(properties),
+             properties.opacity };
+}
+
+// Pixels kept around the frame, beyond the stroke radius, when segments are
+// clipped before their conversion to whole pixels. Zooming in or far off
+// screen points would otherwise overflow an int. Segments inside the band
+// are left as they are, it is wide enough for that to be all of them in
+// practice.
+inline constexpr float guard_band = 65536.0f;
+
+// Clips the segment from a to b, in raster space, to the box of corners lo
+// and hi (Liang-Barsky). False when nothing of it is left, or when it does
+// not have finite ends.
+inline bool clip_segment(math::fvec3 &a, math::fvec3 &b, math::fvec3 lo,
+                         math::fvec3 hi)
+{
+    auto inside = [&](math::fvec3 p) {
+        return p.x >= lo.x && p.x <= hi.x && p.y >= lo.y && p.y <= hi.y;
+    };
+    if (inside(a) && inside(b))
+        return true;
+
+    const float dx = b.x - a.x;
+    const float dy = b.y - a.y;
+    if (!std::isfinite(dx) || !std::isfinite(dy))
+        return false;
+
+    // Entering and leaving parameters along the segment, for each side
+    const float p[] = { -dx, dx, -dy, dy };
+    const float q[] = { a.x - lo.x, hi.x - a.x, a.y - lo.y, hi.y - a.y };
+    float t0 = 0.0f, t1 = 1.0f;
+    for (int i = 0; i < 4; i++)
+    {
+        if (p[i] == 0.0f)
+        {
+            if (q[i] < 0.0f)
+                return false;
+            continue;
+        }
+        const float t = q[i] / p[i];
+        if (p[i] < 0.0f)
+            t0 = std::max(t0, t);
+        else
+            t1 = std::min(t1, t);
+    }
+    if (t0 > t1)
+        return false;
+
+    const math::fvec3 start = a;
+    a = math::fvec3(start.x + t0 * dx, start.y + t0 * dy, 0.0f);
+    b = math::fvec3(start.x + t1 * dx, start.y + t1 * dy, 0.0f);
+    return true;
+}
+
+// Segment between two positions in raster space, before truncation: it is
+// clipped to the guard band first, then drawn between whole pixels
+template <pixel_format F, blend_mode B>
+void render_clipped_segment(math::fvec3 p1, math::fvec3 p2, int radius,
+                            basic_pixel_buffer<F> &frame,
+                            const pixel_writer<F, B> &writer)
+{
+    const float band = guard_band + float(radius);
+    if (!clip_segment(p1, p2, math::fvec3(-band, -band, 0.0f),
+                      math::fvec3(float(frame.width) + band,
+                                  float(frame.height) + band, 0.0f)))
+        return;
+
+    render_segment(
+        math::vec3<int>(static_cast<int>(p1.x), static_cast<int>(p1.y), 0),
+        math::vec3<int>(static_cast<int>(p2.x), static_cast<int>(p2.y), 0),
+        radius, frame, writer);
+}
+
+template <pixel_format F>
+int stroke_radius(float thickness, const basic_pixel_buffer<F> &frame)
+{
+    return ndc_to_raster_space(thickness, frame.width, frame.height) / 2;
+}
+
+// Connected segments through `count` points given in object space
+template <pixel_format F, blend_mode B>
+void render_polyline(const math::fvec3 *points, std::size_t count,
+                     const math::affine2 &transform, int radius,
+                     basic_pixel_buffer<F> &frame,
+                     const pixel_writer<F, B> &writer)
+{
+    if (count < 2)
+        return;
+
+    auto to_raster = [&](math::fvec3 p) {
+        return ndc_to_raster_position(transform.apply(p), frame.width,
+                                      frame.height);
+    };
+
+    // Non finite points lift the pen, e.g. between the contours of a glyph
+    math::fvec3 point1;
+    bool pen_down = false;
+    for (std::size_t i = 0; i < count; i++)
+    {
+        if (!math::is_projected(points[i]))
+        {
+            pen_down = false;
+            continue;
+        }
+        const math::fvec3 point2 = to_raster(points[i]);
+        if (pen_down)
+            render_clipped_segment(point1, point2, radius, frame, writer);
+        point1 = point2;
+        pen_down = true;
+    }
+}
+
+// Connected segments through points in 3D object space: the transform and
+// then the camera projection are applied to all of them in one batch. The
+// polyline is broken where a point falls behind the camera.
+template <pixel_format F, blend_mode B>
+void render_polyline(const math::fvec3 *points, std::size_t count,
+                     const math::affine2 &transform, const math::mat4 &camera,
+                     int radius, basic_pixel_buffer<F> &frame,
+                     const pixel_writer<F, B> &writer)
+{
+    if (count < 2)
+        return;
+
+    thread_local std::vector<math::fvec3> projected;
+    projected.resize(count);
+    math::project_points(camera * math::mat4::from_affine(transform), points,
+                         count, projected.data());
+
+    std::size_t begin = 0;
+    while (begin < count)
+    {
+        while (begin < count && !math::is_projected(projected[begin]))
+            begin++;
+        std::size_t end = begin;
+        while (end < count && math::is_projected(projected[end]))
+            end++;
+        render_polyline(&projected[begin], end - begin,
+                        math::affine2::identity(), radius, frame, writer);
+        begin = end;
+    }
+}
+
+template <blend_mode B = blend_mode::replace, pixel_format F>
+void render_polyline(const math::fvec3 *points, std::size_t count,
+                     int radius, basic_pixel_buffer<F> &frame,
+                     const shape_instance &instance)
+{
+    render_polyline(points, count, instance.transform, radius, frame,
+                    pixel_writer<F, B>(instance.color, instance.opacity));
+}
+
+template <blend_mode B = blend_mode::replace, pixel_format F>
+void render_line(math::fvec3 point1, math::fvec3 point2,
+                 basic_pixel_buffer<F> &frame_cache,
+                 const PyAPI::Properties &properties)
+{
+    const math::fvec3 points[] = { point1, point2 };
+    render_polyline<B>(points, 2,
+                       stroke_radius(properties.thickness, frame_cache),
+                       frame_cache, object_instance(properties));
+}
+
+// Number of points render_cubic_bezier goes through, the same for every curve
+inline int bezier_sample_count()
+{
+    static const int count = [] {
+        int n = 1;
+        for (float t = 0.01; t < 1.0; t += 0.01)
+            n++;
+        return n;
+    }();
+    return count;
+}
+
+// Writes the bezier_sample_count() points of the curve to `out`
+inline math::fvec3 *sample_cubic_bezier(const math::CubicBezier &bezier,
+                                        math::fvec3 *out)
+{
+    // The same parameters as the stepping loop of render_cubic_bezier
+    static const std::vector<float> ts = [] {
+        std::vector<float> t_values{ 0.0f };
+        for (float t = 0.01; t < 1.0; t += 0.01)
+            t_values.push_back(t);
+        return t_values;
+    }();
+    kernels::active().eval_cubic(bezier, ts.data(), out, ts.size());
+    return out + ts.size();
+}
+
+template <pixel_format F, blend_mode B>
+void render_cubic_bezier(const math::CubicBezier &bezier,
+                         const math::affine2 &transform, int radius,
+                         basic_pixel_buffer<F> &frame,
+                         const pixel_writer<F, B> &writer)
+{
+    auto to_raster = [&](math::fvec3 p) {
+        return ndc_to_raster_position(transform.apply(p), frame.width,
+                                      frame.height);
+    };
+
+    math::fvec3 point1 = to_raster(bezier.valueAt(0));
+
+    for (float t = 0.01; t < 1.0; t += 0.01)
+    {
+        math::fvec3 point2 = to_raster(bezier.valueAt(t));
+
+        render_clipped_segment(point1, point2, radius, frame, writer);
+
+        point1 = point2;
+    }
+}
+
+template <blend_mode B = blend_mode::replace, pixel_format F>
+void render_cubic_bezier(const math::CubicBezier &bezier,
+                         basic_pixel_buffer<F> &frame_cache,
+                         const PyAPI::Properties &props)
+{
+    const pixel_writer<F, B> writer(stroke_color(props), props.opacity);
+    render_cubic_bezier(bezier, object_transform(props),
+                        stroke_radius(props.thickness, frame_cache),
+                        frame_cache, writer);
+}
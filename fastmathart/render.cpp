@@ -1,37 +1,165 @@
 #include "render.h"
 
+#include <atomic>
+#include <chrono>
 #include <cstdio>
+#include <cstdlib>
 #include <fmt/core.h>
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <limits>
 #include <memory>
 #include <numeric>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <unordered_map>
+#include <variant>
 #include <vector>
 #include <optional>
+#include <semaphore>
 
 #include "api_bindings.h"
+#include "font.h"
 #include "math/bezier.h"
+#include "math/bounds.h"
+#include "math/expression.h"
+#include "math/projection.h"
+#include "math/simplify.h"
 #include "math/vec.h"
+#include "morph.h"
+#include "particles.h"
+#include "utils/arena.h"
 #include "utils/cWrapper.h"
+#include "utils/elementCache.h"
+#include "utils/encoder.h"
+#include "utils/hash.h"
+#include "utils/kernels.h"
+#include "utils/memory.h"
 #include "utils/pixelUtils.h"
+#include "utils/trace.h"
+#include "utils/wait.h"
 
-using segment_cache = std::unordered_map<void*, std::pair<std::vector<math::fvec3>, PyAPI::Properties>>;
-static segment_cache scene_cache;
+// Points of an outline between two checks of its bounds, a chunk is only
+// rasterized if it can reach the frame
+constexpr std::size_t bounds_chunk = 64;
+
+// Fills the inside of a shape for one of its placements, drawn before the
+// outline. Only text has one for now.
+using shape_fill = std::function<void(pixel_buffer_t &, const shape_instance &)>;
+
+// What later elements still draw of an object: its flattened outline in
+// object space and every placement of it. Runs of `stride` points are
+// separate polylines.
+struct cached_shape
+{
+    std::vector<math::fvec3> segments;
+    std::vector<shape_instance> instances;
+    float thickness = 0.0f;
+    std::size_t stride = 0;
+    shape_fill fill;
+    math::box3 bounds;               // of the whole outline, in object space
+    std::vector<math::box3> chunks;  // of every bounds_chunk points
+    memory::charge charge; // the vectors, counted as caches
+
+    cached_shape() = default;
+
+    cached_shape(std::vector<math::fvec3> segments,
+                 std::vector<shape_instance> instances, float thickness,
+                 std::size_t stride, shape_fill fill)
+        : segments(std::move(segments))
+        , instances(std::move(instances))
+        , thickness(thickness)
+        , stride(stride)
+        , fill(std::move(fill))
+        , bounds(math::box3::around(this->segments.data(),
+                                    this->segments.size()))
+        , chunks(math::chunk_bounds(this->segments.data(),
+                                    this->segments.size(), bounds_chunk))
+        , charge(memory::caches,
+                 this->segments.capacity() * sizeof(math::fvec3)
+                     + this->instances.capacity() * sizeof(shape_instance)
+                     + this->chunks.capacity() * sizeof(math::box3))
+    { }
+};
+
+// The scene state below is per thread: the children of a Simultaneous are
+// rendered on their own threads, each from a copy of the caller's state.
+using segment_cache = std::unordered_map<void*, cached_shape>;
+static thread_local segment_cache scene_cache;
 static std::ofstream concat_file;
 
-void save_to_video_file(video_buffer_t &video_buffer, std::string_view filename,
-                        int fps, int width, int height, int frames)
+// Camera of 3D scenes, set from the Config and moved by CameraMove
+struct scene_camera
+{
+    math::mat4 view;
+    math::mat4 projection;
+
+    math::mat4 view_projection() const
+    {
+        return projection * view;
+    }
+};
+static thread_local std::optional<scene_camera> camera;
+
+// Pixels per NDC unit of the output, glyphs are flattened and rasterized
+// at this resolution
+static float ndc_pixels = 1.0f;
+
+// Transient geometry of the element being rendered, reset after each element
+static thread_local utils::frame_arena element_arena;
+
+static render_stats stats;
+
+const render_stats &last_render_stats()
+{
+    return stats;
+}
+
+// Adds the time spent in its scope to one of the stats
+class stage_timer
 {
-    static int num_files = 0;
-    std::string actual_filename = fmt::format("{}_{}", num_files, filename);
-    std::cout << "Saving to video file " << filename << "\n";
-    std::cout << "Frame rate: " << fps << "\n";
-    std::cout << "Frame width: " << width << "\n";
-    std::cout << "Frame height: " << height << "\n";
+public:
+    explicit stage_timer(double &total)
+        : total(total), start(std::chrono::steady_clock::now())
+    { }
+
+    ~stage_timer()
+    {
+        total += std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+    }
+
+private:
+    double &total;
+    std::chrono::steady_clock::time_point start;
+};
+
+// FMA_ENCODER=null still converts every frame but writes it to the null
+// device instead of ffmpeg, to measure the renderer alone
+static bool null_encoder = false;
+
+#if defined(_WIN32) || defined(_WIN64)
+static const char *null_device = "NUL";
+#else
+static const char *null_device = "/dev/null";
+#endif
+
+// Pipe to the encoder writing `filename`, or to the null device. Opened on
+// the writer thread.
+async_encoder::output open_video_output(const std::string &filename, int fps,
+                                        int width, int height)
+{
+    if (null_encoder)
+    {
+        async_encoder::output sink{ std::fopen(null_device, "wb"),
+                                    [](std::FILE *file) { return std::fclose(file); } };
+        if (!sink)
+            std::cerr << "Cannot open " << null_device << "\n";
+        return sink;
+    }
 
     std::string command = fmt::format(
         "ffmpeg -hide_banner -loglevel error -y -f rawvideo -s "
@@ -39,25 +167,170 @@ void save_to_video_file(video_buffer_t &video_buffer, std::string_view filename,
         "-x264opts opencl -vcodec h264 -pix_fmt yuv420p -q:v 5 -f mp4 "
         "{filename}",
         fmt::arg("width", width), fmt::arg("height", height),
-        fmt::arg("fps", fps), fmt::arg("filename", actual_filename));
+        fmt::arg("fps", fps), fmt::arg("filename", filename));
+    // pclose() returns the exit status of the encoder
+    return { popen2(command.c_str(), "w").release(),
+             [](std::FILE *pipe) { return pclose(pipe); } };
+}
 
-    auto pipe = popen2(command.c_str(), "w");
+// The frames of the top level element go to the encoder as soon as they are
+// final, while the next ones render. Elements call frames_rendered() on
+// their video, those of the children of a Simultaneous are not encoded.
+struct element_encoding
+{
+    async_encoder *encoder = nullptr;
+    const std::optional<video_buffer_t> *video = nullptr;
+    std::string filename;
+    int fps = 0;
+    bool opened = false;
+    int queued = 0;
+};
+static element_encoding encoding;
+
+// A child of a Simultaneous renders on a thread of its own, through all of
+// its frames once, but its video only stores a chunk of them at a time. At
+// the end of a chunk the child waits in frames_rendered() while its parent
+// composites the chunk and slides the video to the next one. The child
+// keeps its state, nothing is rendered twice.
+struct frame_stream
+{
+    static constexpr int ended = std::numeric_limits<int>::max();
+
+    int chunk = 1; // frames
+    std::counting_semaphore<> *cores = nullptr;
+    std::optional<video_buffer_t> *video = nullptr;
+    std::atomic<int> handed = 0;  // chunks done, `ended` once it returned
+    std::atomic<int> resumed = 0; // chunks composited
+    int reported = -1;
+
+    // Chunk n, after the last frame of the previous one, which Draw builds
+    // on
+    std::vector<int> window(int n, int frames) const
+    {
+        std::vector<int> kept;
+        const int first = n * chunk;
+        if (first > 0)
+            kept.push_back(first - 1);
+        for (int f = first; f < std::min(first + chunk, frames); f++)
+            kept.push_back(f);
+        return kept;
+    }
+
+    void rendered(int last);
+};
+static thread_local frame_stream *active_stream = nullptr;
+
+// Frames rendered by the children of Simultaneous elements
+static std::atomic<int> layer_frames = 0;
 
-    fwrite(video_buffer.buffer.get(), 1, width * height * frames * 3,
-           pipe.get());
+void frame_stream::rendered(int last)
+{
+    const int frames = video->value().frames;
+    layer_frames += std::max(last - reported, 0);
+    reported = std::max(reported, last);
+
+    // The last chunk is over once the child returns
+    for (int n = handed; last >= (n + 1) * chunk - 1 && (n + 1) * chunk < frames;
+         n = handed)
+    {
+        handed = n + 1;
+        handed.notify_all();
+        cores->release();
+        utils::wait_until(resumed, [&](int r) { return r > n; });
+        cores->acquire();
+    }
+}
 
-    concat_file << "file '" << actual_filename << "'\n";
+// Frames up to `last` of `video` won't change anymore
+void frames_rendered(video_buffer_t &video, int last)
+{
+    if (active_stream != nullptr && active_stream->video != nullptr
+        && &active_stream->video->value() == &video)
+    {
+        active_stream->rendered(last);
+        return;
+    }
 
-    num_files++;
+    if (encoding.video == nullptr || !encoding.video->has_value()
+        || &encoding.video->value() != &video)
+        return;
+
+    if (!encoding.opened)
+    {
+        std::cout << "Saving to video file " << encoding.filename << "\n";
+        std::cout << "Frame rate: " << encoding.fps << "\n";
+        std::cout << "Frame width: " << video.width << "\n";
+        std::cout << "Frame height: " << video.height << "\n";
+        encoding.encoder->open(
+            [filename = encoding.filename, fps = encoding.fps,
+             width = video.width, height = video.height] {
+                return open_video_output(filename, fps, width, height);
+            });
+        encoding.opened = true;
+    }
+    for (; encoding.queued <= last && encoding.queued < video.frames;
+         encoding.queued++)
+        encoding.encoder->push(video.get_frame(encoding.queued));
 }
 
+// render_frame() only needs one frame of the element it falls in, and the
+// last frame of every element, which becomes the canvas of the next. The
+// other frames are neither stored nor rasterized. A Simultaneous renders its
+// children a range of frames at a time the same way. The children of a
+// Simultaneous start with it and share its window.
+struct frame_window
+{
+    int first = 0;         // in the whole scene
+    int last = 0;          // included
+    int element_start = 0; // first frame of the current element
+};
+static thread_local const frame_window *active_window = nullptr;
+
+// The video of an element lasting `frames`
+void emplace_video(std::optional<video_buffer_t> &video_buffer,
+                   const PyAPI::Config &config, int frames)
+{
+    // The first video of a streamed child is its own
+    if (active_stream != nullptr && active_stream->video == nullptr
+        && frames > 0)
+    {
+        video_buffer.emplace(config.width, config.height, frames,
+                             active_stream->window(0, frames),
+                             static_cast<std::size_t>(active_stream->chunk)
+                                 + 1);
+        active_stream->video = &video_buffer;
+        return;
+    }
+
+    const int first = active_window == nullptr
+        ? 0
+        : std::max(active_window->first - active_window->element_start, 0);
+    const int last = active_window == nullptr
+        ? frames - 1
+        : std::min(active_window->last - active_window->element_start,
+                   frames - 2);
+    if (first == 0 && last >= frames - 2)
+    {
+        video_buffer.emplace(config.width, config.height, frames);
+        return;
+    }
 
+    std::vector<int> kept;
+    for (int f = first; f <= last; f++)
+        kept.push_back(f);
+    if (frames > 0)
+        kept.push_back(frames - 1);
+    video_buffer.emplace(config.width, config.height, frames, std::move(kept));
+}
 
-math::BezierPath bezier_curve_approx(const PyAPI::Circle &circle)
+math::BezierPath bezier_curve_approx(
+    const PyAPI::Circle &circle,
+    std::pmr::memory_resource *resource = std::pmr::get_default_resource())
 {
     auto p = math::circle_bezier(circle.radius);
 
-    std::vector<math::CubicBezier> path(4);
+    math::BezierPath path(resource);
+    path.resize(4);
 
     path[0] = math::CubicBezier(p[0], p[1], p[2], p[3]);
     path[1] = math::CubicBezier(p[3], p[4], p[5], p[6]);
@@ -68,164 +341,832 @@ math::BezierPath bezier_curve_approx(const PyAPI::Circle &circle)
 }
 
 
-math::BezierPath bezier_curve_approx(PyAPI::Polyline &polyline)
+math::BezierPath bezier_curve_approx(
+    const PyAPI::Polyline &polyline,
+    std::pmr::memory_resource *resource = std::pmr::get_default_resource())
 {
-    std::vector<math::CubicBezier> beziers;
+    math::BezierPath beziers(resource);
+    beziers.reserve(std::max(polyline.point_count - 1, 0));
     for (int i = 0; i < polyline.point_count - 1; i++)
     {
-        auto p1 = math::fvec3(polyline.x[i], polyline.y[i], 0);
-        auto p2 = math::fvec3(polyline.x[i + 1], polyline.y[i + 1], 0);
-        beziers.push_back(math::CubicBezier::straightLine(p1, p2));
+        auto p1 = math::fvec3(polyline.x[i], polyline.y[i],
+                              polyline.z ? polyline.z[i] : 0.0f);
+        auto p2 = math::fvec3(polyline.x[i + 1], polyline.y[i + 1],
+                              polyline.z ? polyline.z[i + 1] : 0.0f);
+        beziers.addCurve(math::CubicBezier::straightLine(p1, p2));
     }
-    return math::BezierPath(beziers);
+    return beziers;
 }
 
-math::vec3<int> ndc_to_raster_space(math::fvec3 point, const int width,
-                                    const int height)
+math::expression compile_expression(const PyAPI::Instruction *code,
+                                    int length, int param_count)
 {
-    int bigger_dimension = std::max(width, height);
-    int smaller_dimension = std::min(width, height);
+    std::vector<math::instruction> program;
+    program.reserve(std::max(length, 0));
+    for (int i = 0; i < length; i++)
+        program.push_back(
+            { static_cast<math::opcode>(code[i].op), code[i].operand });
+    return math::expression(program.data(), program.size(), param_count);
+}
 
-    const float screen_ratio =
-        float(bigger_dimension) / float(smaller_dimension);
+struct curve_program
+{
+    math::expression x;
+    math::expression y;
+};
 
-    return math::vec3<int>((point.x + screen_ratio) * smaller_dimension / 2.0f,
-                           (-point.y + 1.0f) * smaller_dimension / 2.0f, 0);
+curve_program compile_curve(const PyAPI::Parametric &curve)
+{
+    return { compile_expression(curve.x_code, curve.x_length,
+                                curve.param_count),
+             compile_expression(curve.y_code, curve.y_length,
+                                curve.param_count) };
 }
 
-int ndc_to_raster_space(float quantity, int width, int height)
+// Samples the curve for these parameters, within `tolerance` of it
+template <class Vector>
+void parametric_points(const curve_program &program,
+                       const PyAPI::Parametric &curve, const float *params,
+                       float tolerance, Vector &out)
 {
-    return quantity * std::min(height, width);
+    FMA_TRACE_SCOPE("sample", stage);
+    // Without decimation (through a camera, or FMA_POLYLINE_TOLERANCE=0)
+    // curves are still sampled to a quarter of a pixel, exact sampling
+    // would refine every interval to the last level
+    const float min_tolerance = 0.25f / ndc_pixels;
+    math::sample_parametric(program.x, program.y, params, curve.t_min,
+                            curve.t_max, std::max(tolerance, min_tolerance),
+                            out);
 }
 
-void render_disk(math::vec3<int> center, int radius,
-                 pixel_buffer_t &frame_cache, color_t<RGB_8> color)
+template <class Vector>
+void parametric_points(const PyAPI::Parametric &curve, float tolerance,
+                       Vector &out)
 {
-    int r = radius * radius;
-    for (int x = -radius; x <= radius; x++)
+    parametric_points(compile_curve(curve), curve, curve.params, tolerance,
+                      out);
+}
+
+// Same program, only the parameter values may differ
+bool same_program(const PyAPI::Parametric &a, const PyAPI::Parametric &b)
+{
+    auto same_code = [](const PyAPI::Instruction *c1, int n1,
+                        const PyAPI::Instruction *c2, int n2) {
+        return n1 == n2
+            && std::equal(c1, c1 + n1, c2, [](auto &i1, auto &i2) {
+                   return i1.op == i2.op && i1.operand == i2.operand;
+               });
+    };
+    return a.param_count == b.param_count
+        && same_code(a.x_code, a.x_length, b.x_code, b.x_length)
+        && same_code(a.y_code, a.y_length, b.y_code, b.y_length);
+}
+
+math::BezierPath bezier_curve_approx(
+    const PyAPI::Parametric &curve,
+    std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+{
+    // No output resolution here, about half a pixel at 1080p
+    constexpr float tolerance = 1e-3f;
+
+    std::pmr::vector<math::fvec3> points(&element_arena);
+    parametric_points(curve, tolerance, points);
+
+    math::BezierPath beziers(resource);
+    beziers.reserve(points.size());
+    for (std::size_t i = 1; i < points.size(); i++)
+        beziers.addCurve(
+            math::CubicBezier::straightLine(points[i - 1], points[i]));
+    return beziers;
+}
+
+/*
+======================================
+Text
+
+The glyph outlines, flattened contours and coverage masks all come from
+the font caches, a text only costs its layout once they are warm.
+======================================
+*/
+
+// Next codepoint of a UTF-8 string, U+FFFD for malformed sequences
+std::uint32_t next_codepoint(const char *&text)
+{
+    const auto byte = [&] { return static_cast<unsigned char>(*text); };
+    const unsigned char lead = byte();
+    text++;
+
+    const int extra = lead < 0x80 ? 0
+        : (lead & 0xE0) == 0xC0   ? 1
+        : (lead & 0xF0) == 0xE0   ? 2
+        : (lead & 0xF8) == 0xF0   ? 3
+                                  : -1;
+    if (extra < 0)
+        return 0xFFFD;
+
+    std::uint32_t codepoint = extra == 0 ? lead : lead & (0x3F >> extra);
+    for (int i = 0; i < extra; i++)
     {
-        for (int y = -radius; y <= radius; y++)
+        if ((byte() & 0xC0) != 0x80)
+            return 0xFFFD;
+        codepoint = codepoint << 6 | (byte() & 0x3F);
+        text++;
+    }
+    return codepoint;
+}
+
+// A glyph of a text and its origin, in NDC relative to the text position
+struct placed_glyph
+{
+    std::uint32_t glyph;
+    math::fvec3 origin;
+};
+
+struct text_layout
+{
+    std::shared_ptr<font> face;
+    std::vector<placed_glyph> glyphs;
+    float size;
+    int pixels_per_em;
+};
+
+// Lines are centered horizontally, the block of lines vertically
+text_layout layout_text(const PyAPI::Text &text)
+{
+    text_layout layout{ font::load(text.font_path ? text.font_path : ""),
+                        {},
+                        text.size,
+                        std::max(1, static_cast<int>(std::lround(
+                                        text.size * ndc_pixels))) };
+    if (!layout.face || text.text == nullptr)
+        return layout;
+
+    const auto &face = *layout.face;
+    const float line_height = face.line_height();
+
+    int line = 0;
+    std::size_t line_begin = 0;
+    float pen = 0.0f;
+    auto end_line = [&] {
+        for (std::size_t k = line_begin; k < layout.glyphs.size(); k++)
+            layout.glyphs[k].origin.x -= 0.5f * pen;
+        line_begin = layout.glyphs.size();
+        pen = 0.0f;
+    };
+
+    for (const char *c = text.text; *c != '\0';)
+    {
+        const std::uint32_t codepoint = next_codepoint(c);
+        if (codepoint == '\n')
         {
-            int dist = x * x + y * y;
-            if (dist < r)
-            {
-                frame_cache.set_pixel(center.x + x, center.y + y, color);
-            }
-            else if (dist == r)
-            {
-                float alpha = std::sqrt(dist) - radius;
-                auto c =
-                    blend(frame_cache.get_pixel(center.x + x, center.y + y),
-                          color, alpha);
-                frame_cache.set_pixel(center.x + x, center.y + y, c);
-            }
+            end_line();
+            line++;
+            continue;
         }
+        const std::uint32_t glyph = face.glyph_index(codepoint);
+        layout.glyphs.push_back(
+            { glyph, math::fvec3(pen, -float(line) * line_height, 0.0f) });
+        pen += face.advance(glyph);
     }
+    end_line();
+
+    const float top = face.ascender();
+    const float bottom = -float(line) * line_height + face.descender();
+    const float middle = 0.5f * (top + bottom);
+    for (auto &placed : layout.glyphs)
+        placed.origin = math::fvec3(placed.origin.x * text.size,
+                                    (placed.origin.y - middle) * text.size,
+                                    0.0f);
+    return layout;
 }
 
-void render_line(math::fvec3 point1, math::fvec3 point2,
-                 pixel_buffer_t &frame_cache, PyAPI::Properties &properties)
+math::BezierPath bezier_curve_approx(
+    const PyAPI::Text &text,
+    std::pmr::memory_resource *resource = std::pmr::get_default_resource())
 {
-    math::vec3<int> p1 =
-        ndc_to_raster_space(point1, frame_cache.width, frame_cache.height);
-    math::vec3<int> p2 =
-        ndc_to_raster_space(point2, frame_cache.width, frame_cache.height);
+    const auto layout = layout_text(text);
 
-    int dx = std::abs(p2.x - p1.x);
-    int dy = std::abs(p2.y - p1.y);
-    int sx = (p1.x < p2.x) ? 1 : -1;
-    int sy = (p1.y < p2.y) ? 1 : -1;
-    int err = dx - dy;
+    math::BezierPath path(resource);
+    for (auto &[glyph, origin] : layout.glyphs)
+    {
+        const auto &curves = layout.face->outline(glyph).curves;
+        for (std::size_t i = 0; i < curves.size(); i++)
+        {
+            const auto &bezier = curves[i];
+            auto place = [&](math::fvec3 p) { return p * text.size + origin; };
+            path.addCurve(math::CubicBezier(place(bezier.p1), place(bezier.p2),
+                                            place(bezier.p3),
+                                            place(bezier.p4)));
+        }
+    }
+    return path;
+}
 
-    color_t<RGB_8> color = (properties.color != nullptr)
-        ? cast_to_color_t_RGB_8(*properties.color)
-        : color_t<RGB_8>(255, 255, 255);
+// Contours of every glyph, NaN points between them
+template <class Vector>
+void text_points(const PyAPI::Text &text, Vector &out)
+{
+    FMA_TRACE_SCOPE("flatten", stage);
 
-    int thickness = ndc_to_raster_space(properties.thickness, frame_cache.width,
-                                        frame_cache.height);
+    const auto layout = layout_text(text);
+    for (auto &[glyph, origin] : layout.glyphs)
+    {
+        for (auto p : layout.face->flattened(glyph, layout.pixels_per_em))
+            out.push_back(p * text.size + origin);
+    }
+}
 
-    while (true)
+math::BezierPath bezier_curve_approx(
+    const PyAPI::Instanced &instanced,
+    std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+{
+    math::BezierPath path(resource);
+    if (instanced.shape_type == PyAPI::INSTANCED)
     {
-        render_disk(p1, thickness / 2, frame_cache, color);
-        if (p1.x == p2.x && p1.y == p2.y)
-            break;
-        int e2 = 2 * err;
-        if (e2 > -dy)
-        {
-            err -= dy;
-            p1.x += sx;
-        }
-        if (e2 < dx)
+        std::cout << "Nested instanced shapes are not supported\n";
+        return path;
+    }
+
+    PyAPI::shape_visitor(
+        [&](auto *shape) { path = bezier_curve_approx(*shape, resource); },
+        instanced.shape, instanced.shape_type);
+    return path;
+}
+
+shape_fill fill_of(const auto &shape)
+{
+    (void)shape;
+    return {};
+}
+
+// Blits the cached coverage masks of the glyphs. They are rasterized for
+// the output grid, so placements that scale or rotate the text and camera
+// projections only get the outline.
+shape_fill fill_of(const PyAPI::Text &text)
+{
+    if (text.properties->fill == nullptr)
+        return {};
+
+    return [layout = layout_text(text),
+            color = cast_to_color_t_RGB_f32(*text.properties->fill)](
+               pixel_buffer_t &frame, const shape_instance &instance) {
+        const auto &t = instance.transform;
+        if (camera || !layout.face || t.a != 1.0f || t.b != 0.0f
+            || t.c != 0.0f || t.d != 1.0f)
+            return;
+
+        FMA_TRACE_SCOPE("fill", stage);
+        const pixel_writer<frame_format, blend_mode::over> writer(
+            color, instance.opacity);
+
+        // Same mapping as ndc_to_raster_position, rounded
+        const float smaller = float(std::min(frame.width, frame.height));
+        const float ratio =
+            float(std::max(frame.width, frame.height)) / smaller;
+        for (auto &[glyph, origin] : layout.glyphs)
         {
-            err += dx;
-            p1.y += sy;
+            const math::fvec3 p = t.apply(origin);
+            const float fx = (p.x + ratio) * smaller / 2.0f;
+            const float fy = (-p.y + 1.0f) * smaller / 2.0f;
+            // Out of the guard band, the glyph is far off screen
+            if (!(fx > -guard_band && fx < float(frame.width) + guard_band
+                  && fy > -guard_band && fy < float(frame.height) + guard_band))
+                continue;
+
+            const auto &mask = layout.face->mask(glyph, layout.pixels_per_em);
+            const int x = static_cast<int>(std::lround(fx));
+            const int y = static_cast<int>(std::lround(fy));
+            render_coverage(mask.coverage.data(), mask.width, mask.height,
+                            x + mask.left, y + mask.top, frame, writer);
         }
+    };
+}
+
+shape_fill fill_of(const PyAPI::Instanced &instanced)
+{
+    shape_fill fill;
+    if (instanced.shape_type != PyAPI::INSTANCED)
+        PyAPI::shape_visitor([&](auto *shape) { fill = fill_of(*shape); },
+                             instanced.shape, instanced.shape_type);
+    return fill;
+}
+
+std::vector<shape_instance> shape_instances(const auto &shape)
+{
+    return { object_instance(*shape.properties) };
+}
+
+std::vector<shape_instance> shape_instances(const PyAPI::Instanced &instanced)
+{
+    const auto &props = *instanced.properties;
+    const auto placement = object_transform(props);
+    const auto color = stroke_color(props);
+
+    std::vector<shape_instance> instances;
+    instances.reserve(std::max(instanced.instance_count, 0));
+    for (int i = 0; i < instanced.instance_count; i++)
+    {
+        instances.push_back(
+            { instanced.transforms
+                  ? placement
+                      * math::affine2::from_array(&instanced.transforms[6 * i])
+                  : placement,
+              instanced.colors ? cast_to_color_t_RGB_f32(instanced.colors[i])
+                               : color,
+              instanced.opacities ? instanced.opacities[i] : props.opacity });
     }
+    return instances;
+}
+
+// Screen-space error allowed when decimating polylines, in pixels.
+// FMA_POLYLINE_TOLERANCE overrides it, 0 keeps every point.
+static float polyline_tolerance_px()
+{
+    static const float tolerance = [] {
+        const char *env = std::getenv("FMA_POLYLINE_TOLERANCE");
+        return env ? std::max(0.0f, static_cast<float>(std::atof(env))) : 0.5f;
+    }();
+    return tolerance;
+}
+
+// The same tolerance in object space, for a shape drawn by these instances.
+// Through a camera the scale depends on the depth, nothing is dropped.
+float decimation_tolerance(const PyAPI::Config &config,
+                           const std::vector<shape_instance> &instances)
+{
+    if (camera)
+        return 0.0f;
+
+    float scale = 0.0f;
+    for (auto &instance : instances)
+        scale = std::max(scale, instance.transform.max_scale());
+    if (scale <= 0.0f)
+        return 0.0f;
+
+    // One pixel is 2 / min(width, height) in NDC
+    return polyline_tolerance_px() * 2.0f
+        / float(std::min(config.width, config.height)) / scale;
 }
 
-void render_cubic_bezier(math::CubicBezier &bezier, pixel_buffer_t &frame_cache,
-                        PyAPI::Properties props)
+// Points of the polyline, without those the output resolution can't show
+template <class Vector>
+void polyline_points(const PyAPI::Polyline &polyline, float tolerance,
+                     Vector &out)
 {
-    math::fvec3 point1 = bezier.valueAt(0);
+    FMA_TRACE_SCOPE("decimate", stage);
+
+    std::pmr::vector<math::fvec3> points(&element_arena);
+    points.reserve(std::max(polyline.point_count, 0));
+    for (int i = 0; i < polyline.point_count; i++)
+        points.emplace_back(polyline.x[i], polyline.y[i],
+                            polyline.z ? polyline.z[i] : 0.0f);
+
+    math::simplify_polyline(points.data(), points.size(), tolerance, out);
+}
 
-    for (float t = 0.01; t < 1.0; t += 0.01)
+// Polyline traced by Draw, it is also what scene_cache keeps of the object
+std::vector<math::fvec3> flatten_path(math::BezierPath &beziers,
+                                      int steps_per_bezier)
+{
+    FMA_TRACE_SCOPE("flatten", stage);
+
+    const auto steps = static_cast<std::size_t>(steps_per_bezier);
+    std::vector<float> ts(steps);
+    for (std::size_t i = 1; i <= steps; i++)
+        ts[i - 1] = float(i) / float(steps_per_bezier);
+
+    std::vector<math::fvec3> segments(steps * beziers.size() + 1);
+    segments[0] = beziers.valueAt(0);
+
+    const auto &k = kernels::active();
+    math::fvec3 *out = segments.data() + 1;
+    for (auto &bezier : beziers)
     {
-        math::fvec3 point2 = bezier.valueAt(t);
+        k.eval_cubic(bezier, ts.data(), out, steps);
+        out += steps;
+    }
+    return segments;
+}
+
+// Points a shape is rasterized through, in object space. Runs of `stride`
+// points are drawn as separate polylines.
+struct shape_outline
+{
+    std::pmr::vector<math::fvec3> points;
+    std::size_t stride;
+};
+
+shape_outline place_outline(const auto &shape, float tolerance)
+{
+    (void)tolerance;
+    auto beziers = bezier_curve_approx(shape, &element_arena);
+
+    FMA_TRACE_SCOPE("flatten", stage);
+    const std::size_t stride = bezier_sample_count();
+    shape_outline outline{ std::pmr::vector<math::fvec3>(
+                               beziers.size() * stride, &element_arena),
+                           stride };
+    for (std::size_t i = 0; i < beziers.size(); i++)
+        sample_cubic_bezier(beziers[i], &outline.points[i * stride]);
+    return outline;
+}
+
+// Straight lines are drawn as they are, no bezier in between
+shape_outline place_outline(const PyAPI::Polyline &polyline, float tolerance)
+{
+    shape_outline outline{ std::pmr::vector<math::fvec3>(&element_arena), 0 };
+    polyline_points(polyline, tolerance, outline.points);
+    outline.stride = outline.points.size();
+    return outline;
+}
 
-        render_line(point1, point2, frame_cache, props);
+shape_outline place_outline(const PyAPI::Parametric &curve, float tolerance)
+{
+    shape_outline outline{ std::pmr::vector<math::fvec3>(&element_arena), 0 };
+    parametric_points(curve, tolerance, outline.points);
+    outline.stride = outline.points.size();
+    return outline;
+}
+
+shape_outline place_outline(const PyAPI::Text &text, float tolerance)
+{
+    (void)tolerance;
+    shape_outline outline{ std::pmr::vector<math::fvec3>(&element_arena), 0 };
+    text_points(text, outline.points);
+    outline.stride = outline.points.size();
+    return outline;
+}
+
+shape_outline place_outline(const PyAPI::Instanced &instanced,
+                            float tolerance)
+{
+    shape_outline outline{ std::pmr::vector<math::fvec3>(&element_arena), 0 };
+    if (instanced.shape_type == PyAPI::INSTANCED)
+        return outline;
+
+    PyAPI::shape_visitor(
+        [&](auto *shape) { outline = place_outline(*shape, tolerance); },
+        instanced.shape, instanced.shape_type);
+    return outline;
+}
+
+// Path traced by Draw, it is also what scene_cache keeps of the object
+struct traced_outline
+{
+    std::vector<math::fvec3> points;
+    float length;
+};
+
+traced_outline draw_outline(const auto &shape, float tolerance)
+{
+    (void)tolerance;
+    auto beziers = [&] {
+        FMA_TRACE_SCOPE("flatten", stage);
+        return bezier_curve_approx(shape, &element_arena);
+    }();
+    return { flatten_path(beziers, 100), beziers.length(100) };
+}
 
-        point1 = point2;
+traced_outline draw_outline(const PyAPI::Polyline &polyline, float tolerance)
+{
+    traced_outline outline{ {}, 0.0f };
+    polyline_points(polyline, tolerance, outline.points);
+    for (std::size_t k = 1; k < outline.points.size(); k++)
+        outline.length += (outline.points[k] - outline.points[k - 1]).length();
+    return outline;
+}
+
+traced_outline draw_outline(const PyAPI::Parametric &curve, float tolerance)
+{
+    traced_outline outline{ {}, 0.0f };
+    parametric_points(curve, tolerance, outline.points);
+    for (std::size_t k = 1; k < outline.points.size(); k++)
+        outline.length += (outline.points[k] - outline.points[k - 1]).length();
+    return outline;
+}
+
+// The glyphs are traced one contour after the other
+traced_outline draw_outline(const PyAPI::Text &text, float tolerance)
+{
+    (void)tolerance;
+    traced_outline outline{ {}, 0.0f };
+    text_points(text, outline.points);
+    for (std::size_t k = 1; k < outline.points.size(); k++)
+    {
+        const float length = (outline.points[k] - outline.points[k - 1]).length();
+        if (std::isfinite(length))
+            outline.length += length;
     }
+    return outline;
 }
 
-void draw_path(math::BezierPath &beziers, video_buffer_t &video,
-               PyAPI::Properties &props, void* obj)
+traced_outline draw_outline(const PyAPI::Instanced &instanced, float tolerance)
 {
-    std::cout << "Drawing path"
-              << "\n";
+    traced_outline outline{ {}, 0.0f };
+    if (instanced.shape_type == PyAPI::INSTANCED)
+        return outline;
 
-    const int total_frames = video.frames;
-    int current_frame = 0;
+    PyAPI::shape_visitor(
+        [&](auto *shape) { outline = draw_outline(*shape, tolerance); },
+        instanced.shape, instanced.shape_type);
+    return outline;
+}
 
-    const int steps_per_bezier = 100;
-    const float draw_per_frame = 1.0 / (total_frames - 1);
+// Point `t` of the way along segment `index` of a path
+struct path_position
+{
+    std::size_t index;
+    float t;
 
-    float accumulated_length = 0.0f;
-    const float total_length = beziers.length(100);
-    const float length_ratio = 1.0f / total_length;
+    bool operator<(const path_position &other) const
+    {
+        return index < other.index || (index == other.index && t < other.t);
+    }
+};
 
+// One object of a Draw element, revealed a bit more at every frame
+struct draw_job
+{
+    void *obj;
     std::vector<math::fvec3> segments;
-    segments.reserve(100 * beziers.size());
-    segments.push_back(beziers.valueAt(0));
+    std::vector<shape_instance> instances;
+    float thickness;
+    std::vector<path_position> revealed; // end of the path, for every frame
+    float depth;                         // mean over the instances, in 3D
+    shape_fill fill;                     // drawn once the path is complete
+    math::box3 bounds;                   // of the path, in object space
+    std::vector<math::box3> chunks;      // of every bounds_chunk points
+};
+
+draw_job plan_draw(traced_outline outline, int total_frames,
+                   std::vector<shape_instance> instances, float thickness,
+                   void *obj)
+{
+    const float draw_per_frame = 1.0 / (total_frames - 1);
 
-    for (auto &bezier : beziers)
+    float accumulated_length = 0.0f;
+    const float length_ratio = 1.0f / outline.length;
+
+    const auto &points = outline.points;
+    draw_job job{
+        .obj = obj,
+        .segments = {},
+        .instances = std::move(instances),
+        .thickness = thickness,
+        .revealed = {},
+        .depth = 0.0f,
+        .fill = {},
+        .bounds = math::box3::around(points.data(), points.size()),
+        .chunks = math::chunk_bounds(points.data(), points.size(),
+                                     bounds_chunk),
+    };
+    job.segments = std::move(outline.points);
+    auto &segments = job.segments;
+
+    // Frames the path is not done with by the end show all of it
+    const path_position whole = segments.size() < 2
+        ? path_position{ 0, 0.0f }
+        : path_position{ segments.size() - 2, 1.0f };
+    job.revealed.assign(std::max(total_frames, 0), whole);
+
+    int current_frame = 0;
+    for (std::size_t k = 1; k < segments.size() && current_frame < total_frames;
+         k++)
     {
-        math::fvec3 point1 = bezier.valueAt(0);
-        for (int i = 1; i <= steps_per_bezier; i++)
+        const float previous_length = accumulated_length;
+        // Nothing is traced between two contours
+        float length = (segments[k] - segments[k - 1]).length();
+        if (!std::isfinite(length))
+            length = 0.0f;
+        accumulated_length += length * length_ratio;
+
+        // Long segments, as in decimated polylines, are revealed bit by bit
+        while (current_frame < total_frames
+               && accumulated_length
+                       - draw_per_frame * (current_frame + 1.0f)
+                   >= -0.01f)
         {
-            float t = float(i) / float(steps_per_bezier);
-            math::fvec3 point2 = bezier.valueAt(t);
+            const float goal =
+                draw_per_frame * (current_frame + 1.0f) - 0.01f;
+            const float t = accumulated_length > previous_length
+                ? std::clamp((goal - previous_length)
+                                 / (accumulated_length - previous_length),
+                             0.0f, 1.0f)
+                : 1.0f;
+            job.revealed[current_frame++] = { k - 1, t };
+        }
+    }
+    return job;
+}
+
+// Opaque strokes replace the pixels they cover, translucent ones blend
+// over them
+using stroke_writer =
+    std::variant<pixel_writer<frame_format, blend_mode::replace>,
+                 pixel_writer<frame_format, blend_mode::over>>;
+
+stroke_writer make_stroke_writer(color_t<RGB_f32> color, float opacity)
+{
+    if (opacity < 1.0f)
+        return stroke_writer(std::in_place_index<1>, color, opacity);
+    return stroke_writer(std::in_place_index<0>, color);
+}
 
-            segments.push_back(point2);
+// Rasterize points given in object space, through the camera in 3D scenes
+void draw_polyline(const math::fvec3 *points, std::size_t count,
+                   const math::affine2 &transform, int radius,
+                   pixel_buffer_t &frame, const stroke_writer &writer)
+{
+    std::visit(
+        [&](const auto &w) {
+            if (camera)
+                render_polyline(points, count, transform,
+                                camera->view_projection(), radius, frame, w);
+            else
+                render_polyline(points, count, transform, radius, frame, w);
+        },
+        writer);
+}
 
-            const float length = (point2 - point1).length();
-            accumulated_length += length * length_ratio;
+// A single disk, for shapes smaller than a pixel
+void draw_dot(math::vec3<int> center, int radius, pixel_buffer_t &frame,
+              const stroke_writer &writer)
+{
+    std::visit(
+        [&](const auto &w) { render_segment(center, center, radius, frame, w); },
+        writer);
+}
 
-            point1 = point2;
+// Box in raster space, before truncation, around a box of object space.
+// False when part of it is behind the camera.
+bool raster_box(const math::box3 &box, const math::affine2 &transform,
+                const pixel_buffer_t &frame, math::fvec3 &lo, math::fvec3 &hi)
+{
+    math::fvec3 corners[8];
+    int count = 4; // in 2D z plays no part
+    if (camera)
+    {
+        math::fvec3 object[8];
+        for (int i = 0; i < 8; i++)
+            object[i] = box.corner(i);
+        math::project_points(camera->view_projection()
+                                 * math::mat4::from_affine(transform),
+                             object, 8, corners);
+        count = 8;
+    }
+    else
+    {
+        for (int i = 0; i < 4; i++)
+            corners[i] = transform.apply(box.corner(i));
+    }
 
-            if (accumulated_length - draw_per_frame * (current_frame + 1.0f)
-                >= -0.01f)
-            {
-                auto frame = video.get_frame(current_frame);
+    lo = math::fvec3(std::numeric_limits<float>::infinity());
+    hi = math::fvec3(-std::numeric_limits<float>::infinity());
+    for (int i = 0; i < count; i++)
+    {
+        if (!math::is_projected(corners[i]))
+            return false;
+        const math::fvec3 p =
+            ndc_to_raster_position(corners[i], frame.width, frame.height);
+        lo = math::fvec3(std::min(lo.x, p.x), std::min(lo.y, p.y), 0.0f);
+        hi = math::fvec3(std::max(hi.x, p.x), std::max(hi.y, p.y), 0.0f);
+    }
+    return true;
+}
 
-                for (std::size_t j = 0; j < segments.size() - 1; j++)
-                    render_line(segments[j], segments[j + 1], frame, props);
+// Whether strokes of `radius` inside a raster box miss the frame. The
+// margin covers the disks and the truncation to whole pixels.
+bool misses_frame(math::fvec3 lo, math::fvec3 hi, int radius,
+                  const pixel_buffer_t &frame)
+{
+    const float margin = std::max(radius, 0) + 2.0f;
+    return hi.x + margin < 0.0f || lo.x - margin > frame.width
+        || hi.y + margin < 0.0f || lo.y - margin > frame.height;
+}
 
-                current_frame++;
-            }
+// How a placement of a shape shows in the frame: not at all, as a single
+// dot when the whole shape is smaller than a pixel, or as its outline
+struct footprint
+{
+    enum
+    {
+        off_screen,
+        dot,
+        visible
+    } kind;
+    math::vec3<int> center; // of the dot
+};
+
+footprint instance_footprint(const math::box3 &bounds,
+                             const math::affine2 &transform, int radius,
+                             const pixel_buffer_t &frame)
+{
+    if (bounds.empty())
+        return { footprint::off_screen, {} };
+
+    math::fvec3 lo, hi;
+    if (!raster_box(bounds, transform, frame, lo, hi))
+        return { footprint::visible, {} };
+    if (misses_frame(lo, hi, radius, frame))
+        return { footprint::off_screen, {} };
+    if (hi.x - lo.x < 1.0f && hi.y - lo.y < 1.0f)
+    {
+        const math::fvec3 center = (lo + hi) * 0.5f;
+        return { footprint::dot, math::vec3<int>(center.x, center.y, 0) };
+    }
+    return { footprint::visible, {} };
+}
+
+// Rasterize the points `first` to `last` included of a path, skipping the
+// chunks of it that miss the frame. Visible chunks that follow each other
+// are drawn as one polyline.
+void draw_chunks(const math::fvec3 *points,
+                 const std::vector<math::box3> &chunks, std::size_t first,
+                 std::size_t last, const math::affine2 &transform, int radius,
+                 pixel_buffer_t &frame, const stroke_writer &writer)
+{
+    if (last <= first)
+        return;
+
+    std::size_t run = first; // first point of the run not drawn yet
+    auto flush = [&](std::size_t end) {
+        if (end > run)
+            draw_polyline(points + run, end - run + 1, transform, radius,
+                          frame, writer);
+    };
+
+    for (std::size_t k = first / bounds_chunk; k * bounds_chunk < last; k++)
+    {
+        math::fvec3 lo, hi;
+        if (k < chunks.size()
+            && (chunks[k].empty()
+                || (raster_box(chunks[k], transform, frame, lo, hi)
+                    && misses_frame(lo, hi, radius, frame))))
+        {
+            // Segments of this chunk are left out
+            flush(std::max(run, k * bounds_chunk));
+            run = std::max(run, std::min((k + 1) * bounds_chunk, last));
         }
     }
-    scene_cache[obj] = {segments, props};
+    flush(last);
+}
+
+// Depth of the center of a placed shape, larger is further from the camera
+float view_depth(const std::vector<math::fvec3> &points,
+                 const math::affine2 &transform)
+{
+    if (!camera || points.empty())
+        return 0.0f;
+
+    math::fvec3 center(0.0f);
+    std::size_t count = 0;
+    for (auto &point : points)
+    {
+        if (math::is_projected(point))
+        {
+            center += point;
+            count++;
+        }
+    }
+    center /= float(std::max<std::size_t>(count, 1));
+
+    const float depth =
+        math::project_point(camera->view_projection()
+                                * math::mat4::from_affine(transform),
+                            center)
+            .z;
+    return std::isnan(depth) ? std::numeric_limits<float>::infinity() : depth;
+}
+
+// Rasterize the part of a path between two positions
+void render_path_range(const std::vector<math::fvec3> &points,
+                       const std::vector<math::box3> &chunks,
+                       path_position from, path_position to, int radius,
+                       pixel_buffer_t &frame, const shape_instance &instance)
+{
+    auto at = [&](path_position p) {
+        return math::lerp(points[p.index], points[p.index + 1], p.t);
+    };
+
+    const stroke_writer writer =
+        make_stroke_writer(instance.color, instance.opacity);
+    auto draw = [&](const math::fvec3 *run, std::size_t count) {
+        draw_polyline(run, count, instance.transform, radius, frame, writer);
+    };
+
+    if (from.index == to.index)
+    {
+        const math::fvec3 piece[] = { at(from), at(to) };
+        draw(piece, 2);
+        return;
+    }
+
+    const math::fvec3 head[] = { at(from), points[from.index + 1] };
+    const math::fvec3 tail[] = { points[to.index], at(to) };
+    draw(head, 2);
+    draw_chunks(points.data(), chunks, from.index + 1, to.index,
+                instance.transform, radius, frame, writer);
+    draw(tail, 2);
 }
 
 void render_element(PyAPI::Wait *elem, PyAPI::Config &config,
@@ -233,33 +1174,123 @@ void render_element(PyAPI::Wait *elem, PyAPI::Config &config,
 {
     std::cout << "Waiting for " << elem->seconds << " seconds"
               << "\n";
+    FMA_TRACE_SCOPE("Wait", element);
     int frames = elem->seconds * config.fps;
 
     if (!video_buffer.has_value())
-        video_buffer.emplace(config.width, config.height, frames);
+        emplace_video(video_buffer, config, frames);
 
     auto &video = video_buffer.value();
 
-    video.set_all_frames(frame_cache);
+    // Frame by frame, a streamed Wait only stores a chunk of them
+    FMA_TRACE_SCOPE("background", stage);
+    for (int i = 0; i < video.frames; i++)
+    {
+        video.set_frame(frame_cache, i);
+        frames_rendered(video, i);
+    }
 }
 
 
+// Every instance of the shapes, back to front in 3D scenes and in the
+// order given otherwise
+void render_shapes(const std::vector<const cached_shape *> &shapes,
+                   pixel_buffer_t &frame)
+{
+    FMA_TRACE_SCOPE("rasterize", stage);
+
+    struct placement
+    {
+        const cached_shape *shape;
+        const shape_instance *instance;
+        float depth;
+    };
+
+    // Reused by every frame of the thread
+    static thread_local std::vector<placement> order;
+    order.clear();
+    for (auto *shape : shapes)
+    {
+        for (auto &instance : shape->instances)
+            order.push_back({ shape, &instance,
+                              view_depth(shape->segments, instance.transform) });
+    }
+
+    if (camera)
+    {
+        FMA_TRACE_SCOPE("depth_sort", stage);
+        std::stable_sort(order.begin(), order.end(),
+                         [](const placement &a, const placement &b) {
+                             return a.depth > b.depth;
+                         });
+    }
+
+    for (auto &[shape, instance, depth] : order)
+    {
+        if (shape->stride == 0)
+            continue;
+
+        const int radius = stroke_radius(shape->thickness, frame);
+        const footprint shown = instance_footprint(
+            shape->bounds, instance->transform, radius, frame);
+        if (shown.kind == footprint::off_screen)
+        {
+            FMA_TRACE_COUNT(shapes_culled, 1);
+            continue;
+        }
+
+        if (shape->fill)
+            shape->fill(frame, *instance);
+
+        const stroke_writer writer =
+            make_stroke_writer(instance->color, instance->opacity);
+        if (shown.kind == footprint::dot)
+        {
+            FMA_TRACE_COUNT(shapes_culled, 1);
+            draw_dot(shown.center, radius, frame, writer);
+            continue;
+        }
+
+        const auto &points = shape->segments;
+        for (std::size_t i = 0; i < points.size(); i += shape->stride)
+            draw_chunks(points.data(), shape->chunks, i,
+                        std::min(i + shape->stride, points.size()) - 1,
+                        instance->transform, radius, frame, writer);
+    }
+}
+
+// The outline of a placed shape, computed once for all its instances
+cached_shape place_cached(const auto &shape, const PyAPI::Config &config)
+{
+    auto instances = shape_instances(shape);
+    auto outline =
+        place_outline(shape, decimation_tolerance(config, instances));
+    return { std::vector<math::fvec3>(outline.points.begin(),
+                                      outline.points.end()),
+             std::move(instances), shape.properties->thickness,
+             outline.stride, fill_of(shape) };
+}
+
 void render_element(PyAPI::Place *elem, PyAPI::Config &config,
                     pixel_buffer_t &frame_cache, std::optional<video_buffer_t> &video_buffer)
 {
     std::cout << "Placing " << elem->obj_count << " objects"
               << "\n";
+    FMA_TRACE_SCOPE("Place", element);
 
+    // Placed objects stay in the scene, a camera move redraws them
+    std::vector<const cached_shape *> placed;
     for (int j = 0; j < elem->obj_count; j++)
     {
         PyAPI::shape_visitor(
             [&](auto *shape) {
-                auto beziers = bezier_curve_approx(*shape);
-                for (auto &bez : beziers)
-                    render_cubic_bezier(bez, frame_cache, *shape->properties);
+                auto &cached = scene_cache[shape];
+                cached = place_cached(*shape, config);
+                placed.push_back(&cached);
             },
             elem->obj_list[j], elem->obj_types[j]);
     }
+    render_shapes(placed, frame_cache);
 }
 
 
@@ -268,53 +1299,167 @@ void render_element(PyAPI::Draw *elem, PyAPI::Config &config,
 {
     std::cout << "Drawing " << elem->obj_count << " objects"
               << "\n";
+    FMA_TRACE_SCOPE("Draw", element);
 
     int frames = elem->seconds * config.fps;
     std::cout << "Frames: " << frames << "\n";
     std::cout << "Seconds: " << elem->seconds << "\n";
 
-    if (!video_buffer.has_value())
-        video_buffer.emplace(config.width, config.height, frames);
+    // Siblings in a Simultaneous may have drawn into the frames already
+    const bool owns_video = !video_buffer.has_value();
+    if (owns_video)
+        emplace_video(video_buffer, config, frames);
 
     auto &video = video_buffer.value();
     video.set_frame(frame_cache, 0);
 
+    std::vector<draw_job> jobs;
+    jobs.reserve(elem->obj_count);
     for (int j = 0; j < elem->obj_count; j++)
     {
         PyAPI::shape_visitor(
             [&](auto *shape) {
-                auto beziers = bezier_curve_approx(*shape);
-                draw_path(beziers, video, *shape->properties, shape);
+                auto instances = shape_instances(*shape);
+                auto outline = draw_outline(
+                    *shape, decimation_tolerance(config, instances));
+                jobs.push_back(plan_draw(std::move(outline), video.frames,
+                                         std::move(instances),
+                                         shape->properties->thickness, shape));
+                jobs.back().fill = fill_of(*shape);
             },
             elem->obj_list[j], elem->obj_types[j]);
     }
+
+    if (camera)
+    {
+        FMA_TRACE_SCOPE("depth_sort", stage);
+        for (auto &job : jobs)
+        {
+            for (auto &instance : job.instances)
+                job.depth += view_depth(job.segments, instance.transform);
+            job.depth /= float(std::max<std::size_t>(job.instances.size(), 1));
+        }
+        std::stable_sort(jobs.begin(), jobs.end(),
+                         [](const draw_job &a, const draw_job &b) {
+                             return a.depth > b.depth;
+                         });
+    }
+
+    // Where every instance shows, the camera does not move while drawing
+    std::vector<std::vector<footprint>> shown(jobs.size());
+    for (std::size_t j = 0; j < jobs.size(); j++)
+    {
+        const int radius = stroke_radius(jobs[j].thickness, frame_cache);
+        for (auto &instance : jobs[j].instances)
+        {
+            shown[j].push_back(instance_footprint(
+                jobs[j].bounds, instance.transform, radius, frame_cache));
+            if (shown[j].back().kind != footprint::visible)
+                FMA_TRACE_COUNT(shapes_culled, 1);
+        }
+    }
+
+    // Frame-major: every object is rasterized into a frame while it is
+    // still in cache. A frame the element owns starts as a copy of the
+    // previous one, so only the newly revealed segments are drawn, or as
+    // the canvas when the previous one is not stored.
+    for (int f = 0; f < video.frames; f++)
+    {
+        if (!video.contains(f))
+            continue;
+
+        FMA_TRACE_SCOPE_ARG("frame", frame, "index", f);
+        auto frame = video.get_frame(f);
+
+        const bool incremental = owns_video && video.contains(f - 1);
+        if (incremental)
+            frame.copy_from(video.get_frame(f - 1));
+        else if (owns_video && f > 0)
+            frame.copy_from(frame_cache);
+
+        // A frame rebuilt from the canvas goes through the pieces revealed
+        // by every frame before it, in the same order, for the same pixels
+        const int first = owns_video && !incremental ? 0 : f;
+        for (int g = first; g <= f; g++)
+        {
+            for (std::size_t j = 0; j < jobs.size(); j++)
+            {
+                auto &job = jobs[j];
+                path_position begin = owns_video && g > 0
+                    ? job.revealed[g - 1]
+                    : path_position{ 0, 0.0f };
+                const path_position end = job.revealed[g];
+                const int radius = stroke_radius(job.thickness, frame);
+
+                // The fill appears with the last frame, under the whole
+                // outline
+                const bool filled = job.fill && g == video.frames - 1;
+                if (filled)
+                    begin = path_position{ 0, 0.0f };
+                if (!filled && !(begin < end))
+                    continue;
+
+                for (std::size_t i = 0; i < job.instances.size(); i++)
+                {
+                    auto &instance = job.instances[i];
+                    const footprint &at = shown[j][i];
+                    if (at.kind == footprint::off_screen)
+                        continue;
+                    if (filled)
+                        job.fill(frame, instance);
+                    if (!(begin < end))
+                        continue;
+
+                    if (at.kind == footprint::dot)
+                        draw_dot(at.center, radius, frame,
+                                 make_stroke_writer(instance.color,
+                                                    instance.opacity));
+                    else
+                        render_path_range(job.segments, job.chunks, begin,
+                                          end, radius, frame, instance);
+                }
+            }
+        }
+        frames_rendered(video, f);
+    }
+
+    for (auto &job : jobs)
+    {
+        const std::size_t stride = job.segments.size();
+        scene_cache[job.obj] = { std::move(job.segments),
+                                 std::move(job.instances), job.thickness,
+                                 stride, std::move(job.fill) };
+    }
     frame_cache.copy_from(video.get_frame(frames - 1));
 }
 
 void render_cached_scene(segment_cache &segments, pixel_buffer_t &frame_cache)
 {
-    for (auto &[pointer, pair] : segments)
+    // Reused by every frame of the thread, Morph and CameraMove redraw the
+    // scene at each
+    static thread_local std::vector<const cached_shape *> shapes;
+    shapes.clear();
+    shapes.reserve(segments.size());
+    for (auto &[pointer, shape] : segments)
     {
-        auto& segments = pair.first;
-        auto& properties = pair.second;
         std::cout << "Rendering from cache"
                   << "\n";
-        for (std::size_t i = 0; i < segments.size() - 1; i++)
-            render_line(segments[i], segments[i + 1], frame_cache, properties);
+        shapes.push_back(&shape);
     }
+    render_shapes(shapes, frame_cache);
 }
 
 void prepare_cache(segment_cache &segments, auto &elem)
 {
     (void)segments;
     (void)elem;
-    std::puts("Doing nothing");
+    std::cout << "Doing nothing\n";
 }
 
 void prepare_cache(segment_cache &segments, PyAPI::Morph &elem)
 {
     segments.erase(elem.src);
-    std::puts(fmt::format("Deleted {}", elem.src).c_str());
+    std::cout << "Deleted " << elem.src << "\n";
 }
 
 void prepare_cache(segment_cache &segments, PyAPI::Simultaneous &elem)
@@ -334,63 +1479,231 @@ void render_element(PyAPI::Morph *elem, PyAPI::Config &config,
 {
     std::cout << "Morphing " << elem->seconds << " seconds"
               << "\n";
+    FMA_TRACE_SCOPE("Morph", element);
 
     int frames = elem->seconds * config.fps;
 
-    math::BezierPath src_beziers, dest_beziers;
-    PyAPI::Properties *src_props = nullptr, *dest_props = nullptr;
+    math::BezierPath src_beziers(&element_arena), dest_beziers(&element_arena);
+    std::vector<shape_instance> src_instances, dest_instances;
+    float thickness = 0.0f;
     scene_cache.erase(elem->src);
 
     PyAPI::shape_visitor(
         [&](auto *shape) {
-            src_beziers = bezier_curve_approx(*shape);
-            src_props = shape->properties;
+            src_beziers = bezier_curve_approx(*shape, &element_arena);
+            src_instances = shape_instances(*shape);
+            thickness = shape->properties->thickness;
         },
         elem->src, elem->src_type);
 
     PyAPI::shape_visitor(
         [&](auto *shape) {
-            dest_beziers = bezier_curve_approx(*shape);
-            dest_props = shape->properties;
+            dest_beziers = bezier_curve_approx(*shape, &element_arena);
+            dest_instances = shape_instances(*shape);
         },
         elem->dest, elem->dest_type);
 
+    if (src_instances.empty() || dest_instances.empty())
+        return;
+
     if (!video_buffer.has_value())
-        video_buffer.emplace(config.width, config.height, frames);
+        emplace_video(video_buffer, config, frames);
     
     auto &video = video_buffer.value();
 
-    for(int i =0; i < frames; i++)
     {
-        auto fr = video.get_frame(i);
-        render_cached_scene(scene_cache, fr);
+        FMA_TRACE_SCOPE("align", stage);
+        math::alignPaths(src_beziers, dest_beziers);
     }
-    math::alignPaths(src_beziers, dest_beziers);
-
-    auto props = *src_props;
 
-    color_t<RGB_f32> src_color = cast_to_color_t_RGB_f32(*src_props->color);
-    color_t<RGB_f32> dest_color = cast_to_color_t_RGB_f32(*dest_props->color);
+    // Two curves running the same program: animate the parameters and
+    // resample the curve at every frame instead of blending outlines
+    const PyAPI::Parametric *src_curve = nullptr, *dest_curve = nullptr;
+    if (elem->src_type == PyAPI::PARAMETRIC
+        && elem->dest_type == PyAPI::PARAMETRIC)
+    {
+        src_curve = static_cast<PyAPI::Parametric *>(elem->src);
+        dest_curve = static_cast<PyAPI::Parametric *>(elem->dest);
+        if (!same_program(*src_curve, *dest_curve))
+            src_curve = dest_curve = nullptr;
+    }
+    const float tolerance = decimation_tolerance(config, src_instances);
+    const auto program =
+        src_curve ? compile_curve(*src_curve) : curve_program{};
+
+    morph_outline outline{ std::pmr::vector<math::fvec3>(&element_arena),
+                           std::pmr::vector<math::fvec3>(&element_arena) };
+    if (!src_curve)
+        outline = flatten_aligned(
+            src_beziers, dest_beziers,
+            std::min(tolerance, decimation_tolerance(config, dest_instances)),
+            &element_arena);
+
+    // Same storage for every frame
+    std::pmr::vector<float> params(&element_arena);
+    std::pmr::vector<math::fvec3> points(&element_arena);
 
     for (int i = 0; i < frames; i++)
     {
+        if (!video.contains(i))
+            continue;
+
+        FMA_TRACE_SCOPE_ARG("frame", frame, "index", i);
         float t = float(i) / float(frames - 1);
-        auto color = blend(src_color, dest_color, t);
 
-        props.color->r = color.r;
-        props.color->g = color.g;
-        props.color->b = color.b;
+        if (src_curve)
+        {
+            params.resize(src_curve->param_count);
+            for (std::size_t p = 0; p < params.size(); p++)
+                params[p] = src_curve->params[p]
+                    + (dest_curve->params[p] - src_curve->params[p]) * t;
+
+            points.clear();
+            parametric_points(program, *src_curve, params.data(), tolerance,
+                              points);
+        }
+        else
+            interpolate_outline(outline, t, points);
 
-        auto morphed_beziers =
-            math::interpolatePaths(src_beziers, dest_beziers, t);
-        
+        // A streamed Morph only gets the frames of a chunk at a time, the
+        // background is drawn with each
         auto frame = video.get_frame(i);
+        {
+            FMA_TRACE_SCOPE("background", stage);
+            render_cached_scene(scene_cache, frame);
+        }
+        const int radius = stroke_radius(thickness, frame);
+
+        // Instance j of the source goes to instance j of the destination,
+        // the extra source instances to the last one
+        FMA_TRACE_SCOPE("rasterize", stage);
+        for (std::size_t j = 0; j < src_instances.size(); j++)
+        {
+            const auto &src = src_instances[j];
+            const auto &dest =
+                dest_instances[std::min(j, dest_instances.size() - 1)];
+
+            const stroke_writer writer = make_stroke_writer(
+                blend(src.color, dest.color, t),
+                src.opacity + (dest.opacity - src.opacity) * t);
+            const auto transform = math::lerp(src.transform, dest.transform, t);
+
+            draw_polyline(points.data(), points.size(), transform, radius,
+                          frame, writer);
+        }
+        frames_rendered(video, i);
+    }
+
+    // The destination stays on the canvas, and in the scene
+    if (video.frames > 0)
+        frame_cache.copy_from(video.get_frame(video.frames - 1));
+    PyAPI::shape_visitor(
+        [&](auto *shape) { scene_cache[shape] = place_cached(*shape, config); },
+        elem->dest, elem->dest_type);
+}
 
-        for (auto &bezier : morphed_beziers)
-            render_cubic_bezier(bezier, frame, props);
+// View matrix `t` of the way through the move, between the two closest keys
+math::mat4 camera_view(const PyAPI::CameraMove &move, float t)
+{
+    const float position = std::clamp(t, 0.0f, 1.0f) * (move.view_count - 1);
+    const int key = std::min(static_cast<int>(position), move.view_count - 2);
+    if (key < 0)
+        return math::mat4::from_array(move.views);
+
+    const float u = position - key;
+    const float *v1 = &move.views[16 * key];
+    const float *v2 = &move.views[16 * (key + 1)];
+
+    math::mat4 view;
+    for (int k = 0; k < 16; k++)
+        view.m[k] = v1[k] + (v2[k] - v1[k]) * u;
+    return view;
+}
+
+void render_element(PyAPI::CameraMove *elem, PyAPI::Config &config,
+                    pixel_buffer_t &frame_cache, std::optional<video_buffer_t> &video_buffer)
+{
+    std::cout << "Moving the camera for " << elem->seconds << " seconds"
+              << "\n";
+    FMA_TRACE_SCOPE("CameraMove", element);
+
+    if (!camera)
+    {
+        std::cout << "CameraMove needs a camera in the config\n";
+        return;
+    }
+    if (elem->view_count < 1)
+        return;
+
+    int frames = elem->seconds * config.fps;
+    if (!video_buffer.has_value())
+        emplace_video(video_buffer, config, frames);
+
+    auto &video = video_buffer.value();
+
+    // Everything placed or drawn so far is redrawn from the new viewpoint
+    for (int i = 0; i < video.frames; i++)
+    {
+        if (!video.contains(i))
+            continue;
+
+        FMA_TRACE_SCOPE_ARG("frame", frame, "index", i);
+        const float t = video.frames > 1 ? float(i) / float(video.frames - 1)
+                                         : 1.0f;
+        camera->view = camera_view(*elem, t);
+
+        auto frame = video.get_frame(i);
+        render_cached_scene(scene_cache, frame);
+        frames_rendered(video, i);
     }
+
+    camera->view = camera_view(*elem, 1.0f);
+    if (video.frames > 0)
+        frame_cache.copy_from(video.get_frame(video.frames - 1));
 }
+void render_element(PyAPI::Particles *elem, PyAPI::Config &config,
+                    pixel_buffer_t &frame_cache, std::optional<video_buffer_t> &video_buffer)
+{
+    std::cout << "Emitting " << elem->count << " particles for "
+              << elem->seconds << " seconds"
+              << "\n";
+    FMA_TRACE_SCOPE("Particles", element);
 
+    if (elem->properties == nullptr || elem->lifetime <= 0.0f)
+    {
+        std::cout << "Particles need properties and a positive lifetime\n";
+        return;
+    }
+
+    int frames = elem->seconds * config.fps;
+    const bool owns_video = !video_buffer.has_value();
+    if (owns_video)
+        emplace_video(video_buffer, config, frames);
+
+    auto &video = video_buffer.value();
+
+    // Particles are not part of the canvas, later elements don't see them
+    particle_system particles(*elem, config.fps);
+    for (int i = 0; i < video.frames; i++)
+    {
+        FMA_TRACE_SCOPE_ARG("frame", frame, "index", i);
+        auto frame = video.get_frame(i);
+        if (owns_video)
+            frame.copy_from(frame_cache);
+
+        // The simulation runs through every frame, stored or not
+        if (video.contains(i))
+        {
+            FMA_TRACE_SCOPE("rasterize", stage);
+            particles.render(frame);
+        }
+        {
+            FMA_TRACE_SCOPE("simulate", stage);
+            particles.step();
+        }
+        frames_rendered(video, i);
+    }
+}
 
 float get_seconds(auto* element)
 {
@@ -418,67 +1731,539 @@ float get_seconds(PyAPI::Simultaneous *elem)
     return seconds;
 }
 
+// Apply the scene_cache side effects of an element without rendering it,
+// when its output comes from the element cache
+void replay_element(PyAPI::Wait *elem, const PyAPI::Config &config)
+{
+    (void)config;
+    (void)elem;
+}
+
+void replay_element(PyAPI::Place *elem, const PyAPI::Config &config)
+{
+    for (int j = 0; j < elem->obj_count; j++)
+    {
+        PyAPI::shape_visitor(
+            [&](auto *shape) { scene_cache[shape] = place_cached(*shape, config); },
+            elem->obj_list[j], elem->obj_types[j]);
+    }
+}
+
+void replay_element(PyAPI::Draw *elem, const PyAPI::Config &config)
+{
+    for (int j = 0; j < elem->obj_count; j++)
+    {
+        PyAPI::shape_visitor(
+            [&](auto *shape) {
+                auto instances = shape_instances(*shape);
+                auto outline = draw_outline(
+                    *shape, decimation_tolerance(config, instances));
+                const std::size_t stride = outline.points.size();
+                scene_cache[shape] = { std::move(outline.points),
+                                       std::move(instances),
+                                       shape->properties->thickness, stride,
+                                       fill_of(*shape) };
+            },
+            elem->obj_list[j], elem->obj_types[j]);
+    }
+}
+
+void replay_element(PyAPI::Morph *elem, const PyAPI::Config &config)
+{
+    scene_cache.erase(elem->src);
+    PyAPI::shape_visitor(
+        [&](auto *shape) { scene_cache[shape] = place_cached(*shape, config); },
+        elem->dest, elem->dest_type);
+}
+
+void replay_element(PyAPI::Particles *elem, const PyAPI::Config &config)
+{
+    (void)config;
+    (void)elem;
+}
+
+void replay_element(PyAPI::CameraMove *elem, const PyAPI::Config &config)
+{
+    (void)config;
+    if (camera && elem->view_count > 0)
+        camera->view = camera_view(*elem, 1.0f);
+}
+
+void replay_element(PyAPI::Simultaneous *elem, const PyAPI::Config &config)
+{
+    for (int i = 0; i < elem->obj_count; i++)
+    {
+        PyAPI::element_visitor(
+            [&](auto *element) { replay_element(element, config); },
+            elem->obj_list[i], elem->obj_types[i]);
+    }
+}
+
+// What one child of a Simultaneous renders: its frames, if it has any, and
+// the canvas it leaves for the following elements
+struct layer
+{
+    pixel_buffer_t canvas;
+    std::optional<video_buffer_t> video;
+};
+
+// Bytes the layers of a Simultaneous may hold at once, from
+// FMA_LAYER_MEMORY in megabytes
+static std::size_t layer_budget = std::size_t(256) << 20;
+
+// Morphs take their source out of the scene, their siblings must not show it
+bool removes_shapes(void *elem, PyAPI::ElementType type)
+{
+    if (type == PyAPI::MORPH)
+        return true;
+    if (type != PyAPI::SIMULTANEOUS)
+        return false;
+
+    auto *simultaneous = static_cast<PyAPI::Simultaneous *>(elem);
+    for (int i = 0; i < simultaneous->obj_count; i++)
+        if (removes_shapes(simultaneous->obj_list[i],
+                           simultaneous->obj_types[i]))
+            return true;
+    return false;
+}
+
+// Children render from the same canvas and scene, each into its own layer.
+// Each frame is then that canvas with the pixels every layer changed, later
+// children over earlier ones; a child shorter than the others shows its
+// canvas once it is over.
+//
+// Inside a window (render_frame(), or an enclosing Simultaneous rendered
+// for one) the children keep a few frames each, they run once on at most
+// one thread per core. Otherwise they are streamed, at most one running per
+// core: the layers only hold a chunk of frames, composited before the
+// children go on with the next.
 void render_element(PyAPI::Simultaneous *elem, PyAPI::Config &config,
                     pixel_buffer_t &frame_cache, std::optional<video_buffer_t> &video_buffer)
 {
     std::cout << "Simultaneous " << '\n';
+    FMA_TRACE_SCOPE("Simultaneous", element);
 
-    float seconds = get_seconds(elem);
-
-    int frames = seconds * config.fps;
-    if (!video_buffer.has_value())
-        video_buffer.emplace(config.width, config.height, frames);
-    
-    auto &video = video_buffer.value();
+    // Without the shapes being morphed, the canvas is redrawn from the
+    // scene, as a Morph draws its own background
+    pixel_buffer_t base(config.width, config.height);
+    if (removes_shapes(elem, PyAPI::SIMULTANEOUS))
+    {
+        FMA_TRACE_SCOPE("background", stage);
+        base.clear();
+        render_cached_scene(scene_cache, base);
+    }
+    else
+    {
+        base.copy_from(frame_cache);
+    }
 
-    for (int i = 0; i < elem->obj_count; i++)
+    const auto count = static_cast<std::size_t>(std::max(elem->obj_count, 0));
+    std::vector<layer> layers;
+    layers.reserve(count);
+    for (std::size_t i = 0; i < count; i++)
     {
+        layers.push_back({ pixel_buffer_t(config.width, config.height), {} });
+        layers.back().canvas.copy_from(base);
+    }
+
+    const segment_cache &shared_cache = scene_cache;
+    const auto shared_camera = camera;
+    const auto cores = static_cast<std::ptrdiff_t>(std::min<std::size_t>(
+        std::max(std::thread::hardware_concurrency(), 1u),
+        std::max<std::size_t>(count, 1)));
+
+    auto render_child = [&](std::size_t i) {
+        scene_cache = shared_cache;
+        camera = shared_camera;
         PyAPI::element_visitor(
             [&](auto *element) {
-                render_element(element, config, frame_cache, video_buffer);
+                render_element(element, config, layers[i].canvas,
+                               layers[i].video);
             },
             elem->obj_list[i], elem->obj_types[i]);
+    };
+
+    auto output_frames = [&] {
+        int frames = 0;
+        for (auto &child : layers)
+            if (child.video.has_value())
+                frames = std::max(frames, child.video->frames);
+        return frames;
+    };
+
+    // Frames [first, stop) of `video`, the layers hold them
+    auto composite = [&](video_buffer_t &video, int first, int stop,
+                         bool in_place) {
+        FMA_TRACE_SCOPE("composite", stage);
+        for (int f = first; f < stop; f++)
+        {
+            if (!video.contains(f))
+                continue;
+
+            auto frame = video.get_frame(f);
+            if (!in_place)
+                frame.copy_from(base);
+            for (std::size_t i = in_place ? 1 : 0; i < layers.size(); i++)
+            {
+                auto &child = layers[i];
+                if (child.video.has_value() && f < child.video->frames)
+                    overlay_changes(frame, child.video->get_frame(f), base);
+                else
+                    overlay_changes(frame, child.canvas, base);
+            }
+            frames_rendered(video, f);
+        }
+    };
+
+    if (active_window != nullptr)
+    {
+        const frame_window *window = active_window;
+        std::atomic<std::size_t> next = 0;
+        std::vector<std::thread> pool;
+        for (std::ptrdiff_t t = 0; t < cores; t++)
+        {
+            pool.emplace_back([&] {
+                active_window = window;
+                for (std::size_t i = next++; i < count; i = next++)
+                    render_child(i);
+            });
+        }
+        for (auto &worker : pool)
+            worker.join();
+
+        const int frames = output_frames();
+        if (frames > 0)
+        {
+            // When the first layer is the whole element, it is already the
+            // base with its own changes and becomes the output
+            auto &first = layers.front().video;
+            const bool in_place = !video_buffer.has_value()
+                && first.has_value() && first->frames == frames;
+            if (in_place)
+                video_buffer.emplace(std::move(*first));
+            else if (!video_buffer.has_value())
+                emplace_video(video_buffer, config, frames);
+
+            auto &video = video_buffer.value();
+            composite(video, 0, std::min(frames, video.frames), in_place);
+        }
     }
+    else
+    {
+        const std::size_t frame_bytes =
+            base.size() * sizeof(pixel_buffer_t::channel_type);
+        const int chunk = static_cast<int>(
+            std::max<std::size_t>(layer_budget / (count * frame_bytes + 1), 2)
+            - 1);
+
+        std::counting_semaphore<> running(cores);
+        std::vector<frame_stream> streams(count);
+        std::vector<std::thread> children;
+        children.reserve(count);
+        for (std::size_t i = 0; i < count; i++)
+        {
+            streams[i].chunk = chunk;
+            streams[i].cores = &running;
+            children.emplace_back([&, i] {
+                active_stream = &streams[i];
+                running.acquire();
+                render_child(i);
+                running.release();
+                streams[i].handed = frame_stream::ended;
+                streams[i].handed.notify_all();
+            });
+        }
 
-    frame_cache.copy_from(video.get_frame(frames - 1));
+        // Every child is done with chunk n, or over
+        auto wait_for = [&](int n) {
+            for (auto &stream : streams)
+                utils::wait_until(stream.handed, [&](int h) { return h > n; });
+        };
+
+        wait_for(0);
+        const int frames = output_frames();
+        if (frames > 0 && !video_buffer.has_value())
+            emplace_video(video_buffer, config, frames);
+
+        for (int n = 0; frames > 0 && n * chunk < frames; n++)
+        {
+            if (n > 0)
+            {
+                for (std::size_t i = 0; i < count; i++)
+                {
+                    auto &stream = streams[i];
+                    if (stream.handed == frame_stream::ended)
+                        continue;
+                    auto &video = layers[i].video.value();
+                    video.slide(stream.window(n, video.frames));
+                    stream.resumed = n;
+                    stream.resumed.notify_all();
+                }
+                wait_for(n);
+            }
+
+            auto &video = video_buffer.value();
+            composite(video, n * chunk,
+                      std::min({ (n + 1) * chunk, frames, video.frames }),
+                      false);
+        }
+        for (auto &child : children)
+            child.join();
+    }
+
+    // The children's effects on the scene, in declaration order
+    for (int i = 0; i < elem->obj_count; i++)
+    {
+        PyAPI::element_visitor(
+            [&](auto *element) { replay_element(element, config); },
+            elem->obj_list[i], elem->obj_types[i]);
+    }
+
+    frame_cache.copy_from(base);
+    for (auto &child : layers)
+        overlay_changes(frame_cache, child.canvas, base);
 }
 
 void concat_animation_files(std::string_view filename)
 {
+    FMA_TRACE_SCOPE("concat", stage);
     const std::string command = fmt::format("ffmpeg -y -hide_banner -loglevel error "
-                                      "-f concat -i concat.txt -c copy {name}",
+                                      "-f concat -safe 0 -i concat.txt -c copy {name}",
                                       fmt::arg("name", filename));
 
     auto pipe = popen2(command.c_str(), "w");
 }
 
+// Empty scene, camera of the config
+void begin_scene(const PyAPI::Config &config)
+{
+    scene_cache.clear();
+    camera.reset();
+    ndc_pixels = float(std::min(config.width, config.height)) / 2.0f;
+    if (config.camera != nullptr)
+        camera = scene_camera{ math::mat4::from_array(config.camera->view),
+                               math::mat4::from_array(
+                                   config.camera->projection) };
+}
+
 void render_scene(PyAPI::Scene &scene, PyAPI::Config &config,
                   std::string_view filename)
 {
     std::cout << "Rendering scene to " << filename << "\n";
+    // Picks the kernels before the first frame, they are printed once
+    cpu::selected();
+
+    stats = render_stats{};
+    const char *encoder = std::getenv("FMA_ENCODER");
+    null_encoder = encoder != nullptr && std::string_view(encoder) == "null";
+
+    layer_budget = std::size_t(256) << 20;
+    if (const char *size = std::getenv("FMA_LAYER_MEMORY");
+        size != nullptr && *size != '\0')
+    {
+        char *end = nullptr;
+        const long long megabytes = std::strtoll(size, &end, 10);
+        if (*end != '\0' || megabytes < 0)
+            std::cout << "Invalid FMA_LAYER_MEMORY " << size
+                      << ", using 256 megabytes\n";
+        else
+            layer_budget = static_cast<std::size_t>(megabytes) << 20;
+    }
+    layer_frames = 0;
 
+    // Start from a known state, the element cache keys depend on it
+    memory::reset_peaks();
+    begin_scene(config);
     pixel_buffer_t frame_cache(config.width, config.height);
+    frame_cache.clear();
     concat_file = std::ofstream("concat.txt");
 
+    element_cache cache(config);
+    async_encoder video_encoder(async_encoder::default_depth());
+    shape_ids ids;
+    std::uint64_t key = [&] {
+        // Decimation changes the output too
+        utils::hasher h;
+        h.add(cache.seed());
+        h.add(polyline_tolerance_px());
+        return h.digest();
+    }();
+
+    // Canvas of the last reused element, only loaded if a later element
+    // has to be rendered on top of it
+    std::optional<std::uint64_t> pending_canvas;
 
-    for(int i = 0; i < scene.element_count; i++)
     {
-        auto elem = scene.elements[i];
-        PyAPI::element_visitor(
-            [&](auto *element) {
-                auto opt = std::optional<video_buffer_t>();
-                prepare_cache(scene_cache, *element);
-                render_element(element, config, frame_cache, opt);
-                if (opt.has_value())
-                {
-                    auto &video = opt.value();
-                    save_to_video_file(video, "temp.mp4", config.fps, config.width, config.height, video.frames);
-                }
-            },
-            elem.elem, elem.type);
+        FMA_TRACE_SCOPE("render_scene", scene);
+
+        for (int i = 0; i < scene.element_count; i++)
+        {
+            auto elem = scene.elements[i];
+            PyAPI::element_visitor(
+                [&](auto *element) {
+                    key = hash_element(key, *element, ids);
+                    prepare_cache(scene_cache, *element);
+
+                    if (cache.contains(key))
+                    {
+                        std::cout << "Reusing cached element " << i << "\n";
+                        cache.touch(key);
+                        replay_element(element, config);
+                        element_arena.reset();
+                        if (cache.has_video(key))
+                            concat_file << "file '" << cache.video_path(key)
+                                        << "'\n";
+                        pending_canvas = key;
+                        return;
+                    }
+
+                    if (pending_canvas.has_value())
+                    {
+                        stage_timer timer(stats.cache_seconds);
+                        cache.load_canvas(*pending_canvas, frame_cache);
+                        pending_canvas.reset();
+                    }
+
+                    auto opt = std::optional<video_buffer_t>();
+                    encoding = element_encoding{
+                        &video_encoder, &opt,
+                        cache.enabled() ? cache.video_path(key)
+                                        : fmt::format("{}_temp.mp4", i),
+                        config.fps
+                    };
+                    {
+                        stage_timer timer(stats.render_seconds);
+                        render_element(element, config, frame_cache, opt);
+                    }
+                    // Without its video, the entry would be reused with
+                    // the element missing from later renders
+                    const bool has_frames = opt.has_value() && opt->frames > 0;
+                    const bool store = cache.enabled() && !null_encoder;
+                    if (has_frames)
+                    {
+                        // Whatever the element did not hand over yet, then
+                        // the frames have to be written before they go
+                        auto &video = opt.value();
+                        frames_rendered(video, video.frames - 1);
+
+                        // The entry is complete once the encoder is done
+                        // with the video, on the writer thread
+                        std::function<void(bool)> stored;
+                        if (store)
+                        {
+                            auto canvas = std::make_shared<pixel_buffer_t>(
+                                config.width, config.height);
+                            canvas->copy_from(frame_cache);
+                            stored = [&cache, key, canvas](bool ok) {
+                                if (ok)
+                                    cache.store_canvas(key, *canvas, true);
+                                else
+                                    std::cout << "Encoding "
+                                              << cache.video_path(key)
+                                              << " failed, not caching it\n";
+                            };
+                        }
+                        video_encoder.close(std::move(stored));
+                        video_encoder.drain();
+                        concat_file << "file '" << encoding.filename
+                                    << "'\n";
+                        stats.frames += video.frames;
+                    }
+                    else if (store)
+                    {
+                        stage_timer timer(stats.cache_seconds);
+                        cache.store_canvas(key, frame_cache, false);
+                    }
+                    encoding = element_encoding{};
+                    element_arena.reset();
+                },
+                elem.elem, elem.type);
+        }
     }
 
     concat_file.close();
 
-    concat_animation_files(filename);
-}
\ No newline at end of file
+    // Every video is complete before they are concatenated
+    video_encoder.finish();
+    stats.bytes_piped = video_encoder.bytes_written();
+    stats.encode_seconds = video_encoder.write_seconds();
+    stats.encode_wait_seconds = video_encoder.wait_seconds();
+    stats.layer_frames = layer_frames;
+
+    if (!null_encoder)
+    {
+        stage_timer timer(stats.concat_seconds);
+        concat_animation_files(filename);
+    }
+    {
+        stage_timer timer(stats.cache_seconds);
+        cache.trim();
+    }
+
+    // The shapes are not needed after the last element
+    scene_cache.clear();
+    memory::dump(std::cout);
+
+    FMA_TRACE_WRITE();
+}
+
+bool render_scene_frame(PyAPI::Scene &scene, PyAPI::Config &config,
+                        int frame_index, std::uint8_t *out,
+                        std::size_t stride)
+{
+    if (frame_index < 0 || out == nullptr
+        || stride < static_cast<std::size_t>(config.width) * 3)
+    {
+        std::cout << "Invalid frame " << frame_index << " or output buffer\n";
+        return false;
+    }
+
+    // Picks the kernels before the first frame, they are printed once
+    cpu::selected();
+
+    begin_scene(config);
+    pixel_buffer_t frame_cache(config.width, config.height);
+    frame_cache.clear();
+
+    frame_window window{ frame_index, frame_index, 0 };
+    active_window = &window;
+
+    bool found = false;
+    {
+        FMA_TRACE_SCOPE("render_frame", scene);
+
+        for (int i = 0; i < scene.element_count && !found; i++)
+        {
+            auto elem = scene.elements[i];
+            PyAPI::element_visitor(
+                [&](auto *element) {
+                    prepare_cache(scene_cache, *element);
+
+                    auto opt = std::optional<video_buffer_t>();
+                    render_element(element, config, frame_cache, opt);
+                    element_arena.reset();
+                    if (!opt.has_value())
+                        return;
+
+                    auto &video = opt.value();
+                    const int local = frame_index - window.element_start;
+                    if (local < video.frames)
+                    {
+                        basic_pixel_buffer<RGB_8> rgb(out, config.width,
+                                                      config.height, stride);
+                        convert_pixels(video.get_frame(local), rgb);
+                        found = true;
+                    }
+                    window.element_start += video.frames;
+                },
+                elem.elem, elem.type);
+        }
+    }
+
+    active_window = nullptr;
+    scene_cache.clear();
+    if (!found)
+        std::cout << "Frame " << frame_index << " is past the end of the "
+                  << window.element_start << " frames of the scene\n";
+    return found;
+}
@@ -1,8 +1,37 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <string_view>
 
 #include "api_bindings.h"
+#include "raster.h"
 
 void render_scene(PyAPI::Scene &scene, PyAPI::Config &config,
-                  std::string_view filename);
\ No newline at end of file
+                  std::string_view filename);
+
+// Frame `frame_index` of the video render_scene() would write, as packed
+// 24 bits RGB into `out`, `stride` bytes per row. Only the last frame of
+// the elements before it is rasterized, for the canvas they leave, and
+// nothing is cached, encoded or written to disk. False (with a message)
+// past the end of the scene.
+bool render_scene_frame(PyAPI::Scene &scene, PyAPI::Config &config,
+                        int frame_index, std::uint8_t *out,
+                        std::size_t stride);
+
+// Totals of the last render_scene call, always recorded. The stages are
+// coarse, build with tracing for the detail.
+struct render_stats
+{
+    int frames = 0;
+    std::uint64_t bytes_piped = 0;
+    double render_seconds = 0.0; // rasterizing the elements
+    double encode_seconds = 0.0; // converting and piping frames to ffmpeg,
+                                 // on the writer thread, overlapping render
+    double cache_seconds = 0.0;  // loading and storing cached canvases
+    double concat_seconds = 0.0;
+    double encode_wait_seconds = 0.0; // rendering blocked on a full queue
+    int layer_frames = 0; // rendered by the children of Simultaneous elements
+};
+
+const render_stats &last_render_stats();
@@ -1,6 +1,6 @@
 from typing import List, Union
 from fastmathart.api_bindings import lib
-from ctypes import pointer, c_char_p
+from ctypes import byref, pointer, c_char_p, c_size_t, c_uint8, POINTER
 from fastmathart.config import ConfigBinding
 from fastmathart.scene import SceneBuilder
 
@@ -30,4 +30,59 @@ def render(
         scene.build(),
         pointer(ConfigBinding()),
         c_char_p(filename.encode('utf-8'))
-    )
\ No newline at end of file
+    )
+
+
+def save_scene(
+        scene: SceneBuilder,
+        filename: str,
+    ):
+    """Save a scene and the current config to a binary file for fma_render."""
+    if lib.save_scene(
+        scene.build(),
+        pointer(ConfigBinding()),
+        c_char_p(filename.encode('utf-8'))
+    ) != 0:
+        raise IOError(f"Cannot save the scene to {filename}")
+
+
+def render_frame(
+        scene: SceneBuilder,
+        frame: int,
+        out=None,
+    ):
+    """Render one frame of a scene into `out`, a numpy uint8 array of shape
+    (height, width, 3), without rendering the frames before it or writing
+    any file. A new array is returned when `out` is not given."""
+    binding = ConfigBinding()
+    if out is None:
+        import numpy
+        out = numpy.empty((binding.height, binding.width, 3), numpy.uint8)
+
+    if (out.shape != (binding.height, binding.width, 3)
+            or out.dtype.itemsize != 1 or out.strides[1:] != (3, 1)
+            or not out.flags.writeable):
+        raise ValueError("Expected a writable uint8 array of shape "
+                         f"({binding.height}, {binding.width}, 3)")
+
+    if lib.render_frame(
+        scene.build(),
+        pointer(binding),
+        frame,
+        out.ctypes.data_as(POINTER(c_uint8)),
+        out.strides[0]
+    ) != 0:
+        raise IndexError(f"Cannot render frame {frame}")
+    return out
+
+
+MEMORY_TAGS = ("frames", "geometry", "caches", "encoder")
+
+def memory_usage():
+    """Current and peak bytes of each subsystem, peaks since the last render."""
+    usage = {}
+    for tag, name in enumerate(MEMORY_TAGS):
+        current, peak = c_size_t(), c_size_t()
+        lib.memory_usage(tag, byref(current), byref(peak))
+        usage[name] = (current.value, peak.value)
+    return usage
@@ -1,11 +1,16 @@
-from ctypes import c_float, Structure, POINTER, pointer, c_int
+from ctypes import c_float, Structure, POINTER, pointer, c_int, c_void_p, cast, c_char_p
 from fastmathart.const import *
 from fastmathart.properties import Properties
+from fastmathart.color import Color
+import ast
 import math
 
 NO_TYPE = 0
 CIRCLE = 1
 POLYLINES = 2
+INSTANCED = 3
+PARAMETRIC = 4
+TEXT = 5
 
 class Circle(Structure):
     _fields_ = [
@@ -28,14 +33,16 @@ class Polylines(Structure):
         ("x", POINTER(c_float)),
         ("y", POINTER(c_float)),
         ("n", c_int),
-        ("properties", POINTER(Properties))
+        ("properties", POINTER(Properties)),
+        ("z", POINTER(c_float))
     ]
 
     def __init__(
         self,
         x: list,
         y: list,
-        properties: Properties = None
+        properties: Properties = None,
+        z: list = None
     ):
         self.shape_id = POLYLINES
         if len(x) != len(y):
@@ -46,6 +53,202 @@ class Polylines(Structure):
         self.n = len(x)
         if properties is not None:
             self.properties = pointer(properties)
+        if z is not None:
+            if len(z) != len(x):
+                raise ValueError("x, y and z must have the same length")
+            self.z = (c_float * len(z))(*z)
+
+
+class Instanced(Structure):
+    """
+    Draw the same shape many times, its geometry is only computed once.
+
+    Each transform is either a position (x, y) or the 6 coefficients
+    (a, b, tx, c, d, ty) of the affine matrix applied to the shape.
+    colors and opacities are optional, one per instance.
+    """
+    _fields_ = [
+        ("shape", c_void_p),
+        ("shape_type", c_int),
+        ("transforms", POINTER(c_float)),
+        ("colors", POINTER(Color)),
+        ("opacities", POINTER(c_float)),
+        ("n", c_int),
+        ("properties", POINTER(Properties))
+    ]
+
+    def __init__(
+        self,
+        shape,
+        transforms: list,
+        colors: list = None,
+        opacities: list = None,
+        properties: Properties = None
+    ):
+        self.shape_id = INSTANCED
+        self._shape = shape
+        self.shape = cast(pointer(shape), c_void_p)
+        self.shape_type = shape.shape_id
+
+        matrices = []
+        for transform in transforms:
+            if len(transform) == 2:
+                matrices += [1.0, 0.0, transform[0], 0.0, 1.0, transform[1]]
+            elif len(transform) == 6:
+                matrices += list(transform)
+            else:
+                raise ValueError("a transform is a position or 6 coefficients")
+        self.transforms = (c_float * len(matrices))(*matrices)
+        self.n = len(transforms)
+
+        if colors is not None:
+            if len(colors) != self.n:
+                raise ValueError("one color per instance is needed")
+            self.colors = (Color * self.n)(*colors)
+
+        if opacities is not None:
+            if len(opacities) != self.n:
+                raise ValueError("one opacity per instance is needed")
+            self.opacities = (c_float * self.n)(*opacities)
+
+        if properties is None:
+            properties = shape.properties.contents if shape.properties else Properties()
+        self.properties = pointer(properties)
+
+
+# Opcodes of math::opcode in fastmathart/math/expression.h
+_OP_CONSTANT, _OP_VARIABLE, _OP_PARAMETER = 0, 1, 2
+_BINARY_OPS = {ast.Add: 3, ast.Sub: 4, ast.Mult: 5, ast.Div: 6, ast.Pow: 7}
+_OP_NEG = 8
+_FUNCTIONS = {"sin": 9, "cos": 10, "tan": 11, "exp": 12, "log": 13,
+              "sqrt": 14, "abs": 15}
+
+
+class Instruction(Structure):
+    _fields_ = [
+        ("op", c_int),
+        ("operand", c_float)
+    ]
+
+
+def compile_expression(expression: str, variable: str, params: list) -> list:
+    """
+    Compile an expression such as "a * sin(t) + 0.5" into postfix bytecode.
+    Names are the variable or one of the params, functions are sin, cos,
+    tan, exp, log, sqrt and abs.
+    """
+    code = []
+
+    def visit(node):
+        if isinstance(node, ast.Expression):
+            visit(node.body)
+        elif isinstance(node, ast.Constant) and isinstance(node.value, (int, float)):
+            code.append((_OP_CONSTANT, float(node.value)))
+        elif isinstance(node, ast.Name) and node.id == variable:
+            code.append((_OP_VARIABLE, 0.0))
+        elif isinstance(node, ast.Name) and node.id in params:
+            code.append((_OP_PARAMETER, float(params.index(node.id))))
+        elif isinstance(node, ast.Name) and node.id in ("pi", "e"):
+            code.append((_OP_CONSTANT, getattr(math, node.id)))
+        elif isinstance(node, ast.BinOp) and type(node.op) in _BINARY_OPS:
+            visit(node.left)
+            visit(node.right)
+            code.append((_BINARY_OPS[type(node.op)], 0.0))
+        elif isinstance(node, ast.UnaryOp) and isinstance(node.op, (ast.USub, ast.UAdd)):
+            visit(node.operand)
+            if isinstance(node.op, ast.USub):
+                code.append((_OP_NEG, 0.0))
+        elif (isinstance(node, ast.Call) and isinstance(node.func, ast.Name)
+              and node.func.id in _FUNCTIONS and len(node.args) == 1):
+            visit(node.args[0])
+            code.append((_FUNCTIONS[node.func.id], 0.0))
+        else:
+            raise ValueError(f"Unsupported expression: {ast.dump(node)}")
+
+    visit(ast.parse(expression, mode="eval"))
+    return code
+
+
+class Parametric(Structure):
+    """
+    Curve (x(t), y(t)) evaluated by the renderer, only the expressions are
+    sent, not the points. Morphing between two curves with the same
+    expressions animates their parameters.
+    """
+    _fields_ = [
+        ("x_code", POINTER(Instruction)),
+        ("x_length", c_int),
+        ("y_code", POINTER(Instruction)),
+        ("y_length", c_int),
+        ("params", POINTER(c_float)),
+        ("param_count", c_int),
+        ("t_min", c_float),
+        ("t_max", c_float),
+        ("properties", POINTER(Properties))
+    ]
+
+    def __init__(
+        self,
+        x: str,
+        y: str,
+        t_range: tuple = (0.0, 1.0),
+        params: dict = None,
+        properties: Properties = None,
+        variable: str = "t"
+    ):
+        self.shape_id = PARAMETRIC
+        params = params or {}
+        names = list(params.keys())
+
+        x_code = compile_expression(x, variable, names)
+        y_code = compile_expression(y, variable, names)
+        self.x_code = (Instruction * len(x_code))(*x_code)
+        self.x_length = len(x_code)
+        self.y_code = (Instruction * len(y_code))(*y_code)
+        self.y_length = len(y_code)
+
+        values = [float(params[name]) for name in names]
+        self.params = (c_float * max(len(values), 1))(*values)
+        self.param_count = len(values)
+
+        self.t_min, self.t_max = t_range
+        if properties is not None:
+            self.properties = pointer(properties)
+
+
+def FunctionPlot(f: str, x_range: tuple = (-1.0, 1.0), params: dict = None,
+                 properties: Properties = None):
+    """Graph of y = f(x)"""
+    return Parametric("x", f, x_range, params, properties, variable="x")
+
+
+class Text(Structure):
+    """
+    Text in a TrueType font (.ttf, .ttc), centered on the properties'
+    position. size is the em size, in the same units as the other shapes.
+    The glyphs are filled with properties.fill when it is set and outlined
+    with the stroke. Fonts are parsed and glyphs flattened once per render.
+    """
+    _fields_ = [
+        ("font_path", c_char_p),
+        ("text", c_char_p),
+        ("size", c_float),
+        ("properties", POINTER(Properties))
+    ]
+
+    def __init__(
+        self,
+        text: str,
+        font: str,
+        size: float = 0.2,
+        properties: Properties = None
+    ):
+        self.shape_id = TEXT
+        self.font_path = str(font).encode()
+        self.text = text.encode("utf-8")
+        self.size = size
+        if properties is not None:
+            self.properties = pointer(properties)
 
 
 def Polygon(x: list, y: list, properties: Properties = None):
@@ -94,6 +297,35 @@ def Star(radius: float, spikes: int, properties: Properties = None):
         y_points.append(r * math.sin(angle))
     return Polygon(x_points, y_points, properties)
 
+def Polyline3D(points: list, properties: Properties = None):
+    """Polyline through (x, y, z) points, only seen in 3D through a Camera"""
+    x, y, z = zip(*points)
+    return Polylines(list(x), list(y), properties, list(z))
+
+
+def SurfaceWireframe(f, x_range: tuple = (-1.0, 1.0),
+                     z_range: tuple = (-1.0, 1.0), lines: int = 20,
+                     samples: int = 100, properties: Properties = None) -> list:
+    """
+    Grid lines of the surface y = f(x, z), the height being y as seen by the
+    default camera. Returns the 3D polylines, 2 * (lines + 1) of them.
+    """
+    def lerp(r, k, n):
+        return r[0] + (r[1] - r[0]) * k / n
+
+    polylines = []
+    for i in range(lines + 1):
+        x = lerp(x_range, i, lines)
+        z = lerp(z_range, i, lines)
+        along_z = [(x, f(x, w), w)
+                   for w in (lerp(z_range, k, samples) for k in range(samples + 1))]
+        along_x = [(u, f(u, z), z)
+                   for u in (lerp(x_range, k, samples) for k in range(samples + 1))]
+        polylines.append(Polyline3D(along_z, properties))
+        polylines.append(Polyline3D(along_x, properties))
+    return polylines
+
+
 def Cross(radius: float, properties: Properties = None):
     x_points = [radius, -radius, radius, -radius]
     y_points = [radius, -radius, -radius, radius]
@@ -0,0 +1,79 @@
+#include "arena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+#include "memory.h"
+
+namespace utils
+{
+    frame_arena::frame_arena(std::size_t block_size)
+        : block_size(block_size)
+    { }
+
+    frame_arena::~frame_arena()
+    {
+        for (auto &b : blocks)
+        {
+            ::operator delete(b.data);
+            memory::released(memory::geometry, b.size);
+        }
+    }
+
+    void frame_arena::reset()
+    {
+        current = 0;
+        offset = 0;
+    }
+
+    std::size_t frame_arena::bytes_used() const
+    {
+        std::size_t used = offset;
+        for (std::size_t i = 0; i < current && i < blocks.size(); i++)
+            used += blocks[i].size;
+        return used;
+    }
+
+    std::size_t frame_arena::bytes_reserved() const
+    {
+        std::size_t reserved = 0;
+        for (auto &b : blocks)
+            reserved += b.size;
+        return reserved;
+    }
+
+    static std::size_t align_up(std::byte *base, std::size_t offset,
+                                std::size_t alignment)
+    {
+        auto address = reinterpret_cast<std::uintptr_t>(base) + offset;
+        auto aligned = (address + alignment - 1) & ~(alignment - 1);
+        return offset + (aligned - address);
+    }
+
+    void *frame_arena::do_allocate(std::size_t bytes, std::size_t alignment)
+    {
+        // Try the current block, then the blocks kept from previous frames
+        for (; current < blocks.size(); current++, offset = 0)
+        {
+            auto &b = blocks[current];
+            std::size_t start = align_up(b.data, offset, alignment);
+            if (start + bytes <= b.size)
+            {
+                offset = start + bytes;
+                return b.data + start;
+            }
+        }
+
+        // Only reached while warming up, or for a larger frame than before
+        std::size_t size = std::max(block_size, bytes + alignment);
+        auto data = static_cast<std::byte *>(::operator new(size));
+        blocks.push_back({ data, size });
+        memory::allocated(memory::geometry, size);
+
+        current = blocks.size() - 1;
+        offset = align_up(data, 0, alignment) + bytes;
+        return data + (offset - bytes);
+    }
+
+} // namespace utils
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+namespace utils
+{
+    /*
+    ======================================
+    Bump allocator for transient geometry, scoped to a frame or an element
+
+    Allocations only move a pointer forward and deallocation does nothing.
+    reset() rewinds to the first block but keeps every block, so once a
+    frame has been rendered, the following ones allocate nothing from the
+    heap. Containers use it through std::pmr, objects allocated from it must
+    not outlive the next reset().
+    ======================================
+    */
+    class frame_arena : public std::pmr::memory_resource
+    {
+    public:
+        explicit frame_arena(std::size_t block_size = 1 << 20);
+        ~frame_arena() override;
+
+        frame_arena(const frame_arena &) = delete;
+        frame_arena &operator=(const frame_arena &) = delete;
+
+        void reset();
+
+        std::size_t bytes_used() const;
+        std::size_t bytes_reserved() const;
+        std::size_t block_count() const
+        {
+            return blocks.size();
+        }
+
+    private:
+        void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+        void do_deallocate(void *, std::size_t, std::size_t) override
+        { }
+        bool do_is_equal(
+            const std::pmr::memory_resource &other) const noexcept override
+        {
+            return this == &other;
+        }
+
+        struct block
+        {
+            std::byte *data;
+            std::size_t size;
+        };
+
+        std::vector<block> blocks;
+        std::size_t block_size;
+        std::size_t current = 0;
+        std::size_t offset = 0;
+    };
+
+} // namespace utils
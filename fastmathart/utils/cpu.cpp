@@ -0,0 +1,77 @@
+#include "cpu.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <string_view>
+
+namespace cpu
+{
+    static const char *level_names[] = { "generic", "sse4.2", "avx2",
+                                         "avx512" };
+
+    const char *level_name(level l)
+    {
+        return level_names[static_cast<int>(l)];
+    }
+
+    level detected()
+    {
+#if (defined(__GNUC__) || defined(__clang__))                                  \
+    && (defined(__x86_64__) || defined(__i386__))
+        static const level found = [] {
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512f")
+                && __builtin_cpu_supports("avx512bw")
+                && __builtin_cpu_supports("avx512vl"))
+                return level::avx512;
+            if (__builtin_cpu_supports("avx2"))
+                return level::avx2;
+            if (__builtin_cpu_supports("sse4.2"))
+                return level::sse42;
+            return level::generic;
+        }();
+        return found;
+#else
+        // Only x86 with GCC or Clang has variants
+        return level::generic;
+#endif
+    }
+
+    // The detected level, or FMA_CPU if it is lower
+    static level requested()
+    {
+        const level best = detected();
+        const char *env = std::getenv("FMA_CPU");
+        if (env == nullptr || *env == '\0')
+            return best;
+
+        for (int l = 0; l <= static_cast<int>(level::avx512); l++)
+        {
+            if (std::string_view(env) != level_names[l])
+                continue;
+            if (l > static_cast<int>(best))
+            {
+                std::cout << "FMA_CPU=" << env << " is not supported, using "
+                          << level_name(best) << "\n";
+                return best;
+            }
+            return static_cast<level>(l);
+        }
+
+        std::cout << "Unknown FMA_CPU " << env << ", using "
+                  << level_name(best) << "\n";
+        return best;
+    }
+
+    level selected()
+    {
+        // Printed once, the first render or kernel call picks it
+        static const level chosen = [] {
+            const level l = requested();
+            std::cout << "Using " << level_name(l) << " kernels\n";
+            return l;
+        }();
+        return chosen;
+    }
+
+} // namespace cpu
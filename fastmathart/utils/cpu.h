@@ -0,0 +1,31 @@
+#pragma once
+
+/*
+======================================
+CPU features, for the kernels built in several instruction set variants
+
+The level is detected once, with cpuid. FMA_CPU=generic|sse4.2|avx2|avx512
+lowers it, to test the other variants on one machine.
+======================================
+*/
+
+namespace cpu
+{
+    enum class level
+    {
+        generic = 0,
+        sse42,
+        avx2,
+        avx512 // F, BW and VL
+    };
+
+    // What this CPU supports
+    level detected();
+
+    // What the kernels use: the detected level, or FMA_CPU if lower.
+    // Printed when first picked.
+    level selected();
+
+    const char *level_name(level l);
+
+} // namespace cpu
@@ -0,0 +1,441 @@
+#include "elementCache.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fmt/core.h>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <system_error>
+#include <vector>
+
+#include "hash.h"
+
+// Bump whenever the rasterizer output changes, to invalidate old entries
+static constexpr std::uint32_t cache_version = 13;
+
+/*
+======================================
+Hashing of the python scene description
+======================================
+*/
+
+static void hash_color(utils::hasher &h, const PyAPI::Color *color)
+{
+    h.add(color != nullptr);
+    if (color == nullptr)
+        return;
+    h.add(color->r);
+    h.add(color->g);
+    h.add(color->b);
+}
+
+static void hash_properties(utils::hasher &h, const PyAPI::Properties *props)
+{
+    h.add(props != nullptr);
+    if (props == nullptr)
+        return;
+    h.add(props->x);
+    h.add(props->y);
+    h.add(props->z);
+    hash_color(h, props->color);
+    h.add(props->thickness);
+    hash_color(h, props->fill);
+    h.add(props->opacity);
+}
+
+static void hash_shape(utils::hasher &h, const PyAPI::Circle &circle)
+{
+    h.add(circle.radius);
+    hash_properties(h, circle.properties);
+}
+
+static void hash_shape(utils::hasher &h, const PyAPI::Polyline &polyline)
+{
+    h.add_array(polyline.x, static_cast<std::size_t>(polyline.point_count));
+    h.add_array(polyline.y, static_cast<std::size_t>(polyline.point_count));
+    h.add(polyline.z != nullptr);
+    if (polyline.z != nullptr)
+        h.add_array(polyline.z,
+                    static_cast<std::size_t>(polyline.point_count));
+    hash_properties(h, polyline.properties);
+}
+
+static void hash_shape(utils::hasher &h, void *shape, PyAPI::ShapeType type);
+
+static void hash_code(utils::hasher &h, const PyAPI::Instruction *code,
+                      int length)
+{
+    h.add(length);
+    for (int i = 0; i < length; i++)
+    {
+        h.add(code[i].op);
+        h.add(code[i].operand);
+    }
+}
+
+static void hash_shape(utils::hasher &h, const PyAPI::Parametric &curve)
+{
+    hash_code(h, curve.x_code, curve.x_length);
+    hash_code(h, curve.y_code, curve.y_length);
+    h.add_array(curve.params, static_cast<std::size_t>(curve.param_count));
+    h.add(curve.t_min);
+    h.add(curve.t_max);
+    hash_properties(h, curve.properties);
+}
+
+static void hash_string(utils::hasher &h, const char *text)
+{
+    const std::size_t length = text ? std::strlen(text) : 0;
+    h.add<std::uint64_t>(length);
+    h.add_bytes(text, length);
+}
+
+// The font file is part of the key, editing it invalidates the entries
+static void hash_shape(utils::hasher &h, const PyAPI::Text &text)
+{
+    hash_string(h, text.font_path);
+    hash_string(h, text.text);
+    h.add(text.size);
+    hash_properties(h, text.properties);
+
+    std::error_code error;
+    const std::filesystem::path font_path(text.font_path ? text.font_path : "");
+    const auto size = std::filesystem::file_size(font_path, error);
+    h.add<std::uint64_t>(error ? 0 : size);
+    const auto modified = std::filesystem::last_write_time(font_path, error);
+    h.add<std::int64_t>(error ? 0 : modified.time_since_epoch().count());
+}
+
+static void hash_shape(utils::hasher &h, const PyAPI::Instanced &instanced)
+{
+    const auto count = static_cast<std::size_t>(instanced.instance_count);
+    h.add_array(instanced.transforms, instanced.transforms ? 6 * count : 0);
+    h.add(instanced.colors != nullptr);
+    for (std::size_t i = 0; instanced.colors && i < count; i++)
+        hash_color(h, &instanced.colors[i]);
+    h.add_array(instanced.opacities, instanced.opacities ? count : 0);
+    hash_properties(h, instanced.properties);
+
+    if (instanced.shape_type != PyAPI::INSTANCED)
+        hash_shape(h, instanced.shape, instanced.shape_type);
+}
+
+static void hash_shape(utils::hasher &h, void *shape, PyAPI::ShapeType type)
+{
+    h.add(type);
+    PyAPI::shape_visitor([&](auto *s) { hash_shape(h, *s); }, shape, type);
+}
+
+int shape_ids::index(const void *shape)
+{
+    return first_seen.try_emplace(shape, static_cast<int>(first_seen.size()))
+        .first->second;
+}
+
+// A shape an element references, which the scene may share
+static void hash_reference(utils::hasher &h, shape_ids &ids, void *shape,
+                           PyAPI::ShapeType type)
+{
+    h.add(ids.index(shape));
+    hash_shape(h, shape, type);
+}
+
+static void hash_shape_list(utils::hasher &h, shape_ids &ids, void **obj_list,
+                            PyAPI::ShapeType *obj_types, int obj_count)
+{
+    h.add(obj_count);
+    for (int i = 0; i < obj_count; i++)
+        hash_reference(h, ids, obj_list[i], obj_types[i]);
+}
+
+static utils::hasher chained(std::uint64_t previous, PyAPI::ElementType type)
+{
+    utils::hasher h;
+    h.add(previous);
+    h.add(type);
+    return h;
+}
+
+std::uint64_t hash_element(std::uint64_t previous, const PyAPI::Wait &elem,
+                           shape_ids &)
+{
+    auto h = chained(previous, PyAPI::WAIT);
+    h.add(elem.seconds);
+    return h.digest();
+}
+
+std::uint64_t hash_element(std::uint64_t previous, const PyAPI::Place &elem,
+                           shape_ids &ids)
+{
+    auto h = chained(previous, PyAPI::PLACE);
+    hash_shape_list(h, ids, elem.obj_list, elem.obj_types, elem.obj_count);
+    return h.digest();
+}
+
+std::uint64_t hash_element(std::uint64_t previous, const PyAPI::Draw &elem,
+                           shape_ids &ids)
+{
+    auto h = chained(previous, PyAPI::DRAW);
+    hash_shape_list(h, ids, elem.obj_list, elem.obj_types, elem.obj_count);
+    h.add(elem.seconds);
+    return h.digest();
+}
+
+std::uint64_t hash_element(std::uint64_t previous, const PyAPI::Morph &elem,
+                           shape_ids &ids)
+{
+    auto h = chained(previous, PyAPI::MORPH);
+    hash_reference(h, ids, elem.src, elem.src_type);
+    hash_reference(h, ids, elem.dest, elem.dest_type);
+    h.add(elem.seconds);
+    return h.digest();
+}
+
+std::uint64_t hash_element(std::uint64_t previous,
+                           const PyAPI::Particles &elem, shape_ids &)
+{
+    auto h = chained(previous, PyAPI::PARTICLES);
+    h.add(elem.count);
+    h.add(elem.seconds);
+    h.add(elem.seed);
+    h.add(elem.lifetime);
+    h.add(elem.radius);
+    h.add(elem.direction);
+    h.add(elem.spread);
+    h.add(elem.speed_min);
+    h.add(elem.speed_max);
+    h.add(elem.gravity_x);
+    h.add(elem.gravity_y);
+    h.add(elem.drag);
+    hash_color(h, elem.end_color);
+    hash_properties(h, elem.properties);
+    return h.digest();
+}
+
+std::uint64_t hash_element(std::uint64_t previous,
+                           const PyAPI::CameraMove &elem, shape_ids &)
+{
+    auto h = chained(previous, PyAPI::CAMERA_MOVE);
+    h.add(elem.view_count);
+    h.add_array(elem.views, 16 * static_cast<std::size_t>(elem.view_count));
+    h.add(elem.seconds);
+    return h.digest();
+}
+
+std::uint64_t hash_element(std::uint64_t previous,
+                           const PyAPI::Simultaneous &elem, shape_ids &ids)
+{
+    auto h = chained(previous, PyAPI::SIMULTANEOUS);
+    h.add(elem.obj_count);
+    for (int i = 0; i < elem.obj_count; i++)
+    {
+        PyAPI::element_visitor(
+            [&](auto *child) { h.add(hash_element(0, *child, ids)); },
+            elem.obj_list[i], elem.obj_types[i]);
+    }
+    return h.digest();
+}
+
+/*
+======================================
+Disk storage
+======================================
+*/
+
+element_cache::element_cache(const PyAPI::Config &config)
+{
+    // Only where asked for, nothing is written to the working directory
+    const char *dir = std::getenv("FMA_CACHE_DIR");
+    const char *disabled = std::getenv("FMA_NO_CACHE");
+    is_enabled = dir != nullptr && *dir != '\0'
+        && (disabled == nullptr || std::string(disabled) == "0");
+    if (is_enabled)
+        directory = dir;
+
+    max_bytes = std::uintmax_t(2048) << 20;
+    if (const char *size = std::getenv("FMA_CACHE_SIZE");
+        size != nullptr && *size != '\0')
+    {
+        char *end = nullptr;
+        const long long megabytes = std::strtoll(size, &end, 10);
+        if (*end != '\0' || megabytes < 0)
+            std::cout << "Invalid FMA_CACHE_SIZE " << size
+                      << ", using 2048 megabytes\n";
+        else
+            max_bytes = static_cast<std::uintmax_t>(megabytes) << 20;
+    }
+
+    utils::hasher h;
+    h.add(cache_version);
+    h.add(config.width);
+    h.add(config.height);
+    h.add(config.fps);
+    h.add(config.camera != nullptr);
+    if (config.camera != nullptr)
+    {
+        h.add_array(config.camera->view, 16);
+        h.add_array(config.camera->projection, 16);
+    }
+    config_key = h.digest();
+
+    if (!is_enabled)
+        return;
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error)
+    {
+        std::cerr << "Cannot create cache directory " << directory << ": "
+                  << error.message() << "\n";
+        is_enabled = false;
+    }
+}
+
+std::filesystem::path element_cache::canvas_path(std::uint64_t key) const
+{
+    return directory / fmt::format("{:016x}.rgb", key);
+}
+
+std::string element_cache::video_path(std::uint64_t key) const
+{
+    return (directory / fmt::format("{:016x}.mp4", key)).generic_string();
+}
+
+bool element_cache::contains(std::uint64_t key) const
+{
+    if (!is_enabled)
+        return false;
+
+    // The byte after the pixels tells if a video goes with the canvas
+    std::ifstream in(canvas_path(key), std::ios::binary | std::ios::ate);
+    if (!in || in.tellg() <= 0)
+        return false;
+    in.seekg(-1, std::ios::end);
+    char has_frames = 0;
+    if (!in.get(has_frames))
+        return false;
+    return has_frames == 0 || has_video(key);
+}
+
+bool element_cache::has_video(std::uint64_t key) const
+{
+    std::error_code error;
+    return std::filesystem::exists(video_path(key), error);
+}
+
+// Canvases are stored as packed 24 bits RGB, whatever the frame layout
+bool element_cache::load_canvas(std::uint64_t key, pixel_buffer_t &canvas) const
+{
+    basic_pixel_buffer<RGB_8> packed(canvas.width, canvas.height);
+    const auto size = static_cast<std::streamsize>(packed.size());
+
+    std::ifstream in(canvas_path(key), std::ios::binary);
+    in.read(reinterpret_cast<char *>(packed.buffer), size);
+    if (in.gcount() != size)
+        return false;
+
+    convert_pixels(packed, canvas);
+    return true;
+}
+
+void element_cache::store_canvas(std::uint64_t key,
+                                 const pixel_buffer_t &canvas,
+                                 bool has_frames) const
+{
+    if (!is_enabled)
+        return;
+
+    // The canvas file marks a complete entry, so write it last and
+    // atomically: a crash mid-write must not leave a valid looking entry
+    const auto path = canvas_path(key);
+    auto temp = path;
+    temp += ".tmp";
+
+    {
+        basic_pixel_buffer<RGB_8> packed(canvas.width, canvas.height);
+        convert_pixels(canvas, packed);
+
+        std::ofstream out(temp, std::ios::binary);
+        out.write(reinterpret_cast<const char *>(packed.buffer),
+                  static_cast<std::streamsize>(packed.size()));
+        out.put(has_frames ? 1 : 0);
+        if (!out)
+            return;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temp, path, error);
+}
+
+void element_cache::touch(std::uint64_t key) const
+{
+    if (!is_enabled)
+        return;
+
+    std::error_code error;
+    const auto now = std::filesystem::file_time_type::clock::now();
+    std::filesystem::last_write_time(canvas_path(key), now, error);
+    if (has_video(key))
+        std::filesystem::last_write_time(video_path(key), now, error);
+}
+
+void element_cache::trim() const
+{
+    if (!is_enabled)
+        return;
+
+    // The files of an entry, leftovers of interrupted writes included,
+    // share the key their names start with
+    struct entry
+    {
+        std::vector<std::filesystem::path> files;
+        std::uintmax_t bytes = 0;
+        std::filesystem::file_time_type used =
+            std::filesystem::file_time_type::min();
+    };
+    std::map<std::string, entry> entries;
+    std::uintmax_t total = 0;
+
+    std::error_code error;
+    for (const auto &file :
+         std::filesystem::directory_iterator(directory, error))
+    {
+        if (!file.is_regular_file(error))
+            continue;
+        const std::string name = file.path().filename().string();
+        auto &e = entries[name.substr(0, name.find('.'))];
+        const auto bytes = file.file_size(error);
+        const auto modified = file.last_write_time(error);
+        if (error)
+            continue;
+
+        e.files.push_back(file.path());
+        e.bytes += bytes;
+        e.used = std::max(e.used, modified);
+        total += bytes;
+    }
+    if (total <= max_bytes)
+        return;
+
+    std::vector<const entry *> by_age;
+    for (auto &[key, e] : entries)
+        by_age.push_back(&e);
+    std::sort(by_age.begin(), by_age.end(),
+              [](const entry *a, const entry *b) { return a->used < b->used; });
+
+    for (const entry *e : by_age)
+    {
+        if (total <= max_bytes)
+            break;
+        // The canvas goes first, an entry without it is not reused
+        auto files = e->files;
+        std::sort(files.begin(), files.end(), [](auto &a, auto &b) {
+            return (a.extension() == ".rgb") > (b.extension() == ".rgb");
+        });
+        for (auto &path : files)
+            std::filesystem::remove(path, error);
+        total -= e->bytes;
+    }
+}
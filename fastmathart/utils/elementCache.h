@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+
+#include "../api_bindings.h"
+#include "pixelUtils.h"
+
+/*
+======================================
+On-disk cache of rendered scene elements
+
+Every element is keyed by a chained hash: the key of the previous element
+(which stands for the canvas and segment cache state it left behind), the
+element parameters, and the shapes and properties it references. The chain
+is seeded with the Config, so a scene whose first N elements are unchanged
+reuses their encoded videos and only renders the changed tail. Shapes are
+hashed by value and by which of them are the same object, which the
+renderer goes by.
+
+The cache is off unless $FMA_CACHE_DIR names its directory, FMA_NO_CACHE=1
+turns it off again. An entry is <key>.rgb, the canvas after the element and a
+byte telling whether the element produced frames, plus <key>.mp4 when it
+did; an entry whose video is missing is not reused. The directory is kept under
+$FMA_CACHE_SIZE megabytes (default 2048) by removing the entries used
+least recently, going by the modification time of their files.
+======================================
+*/
+
+class element_cache
+{
+public:
+    explicit element_cache(const PyAPI::Config &config);
+
+    bool enabled() const
+    {
+        return is_enabled;
+    }
+
+    // Key of the empty canvas every scene starts from
+    std::uint64_t seed() const
+    {
+        return config_key;
+    }
+
+    // A complete entry: its canvas, and its video if it has frames
+    bool contains(std::uint64_t key) const;
+    bool has_video(std::uint64_t key) const;
+    std::string video_path(std::uint64_t key) const;
+
+    bool load_canvas(std::uint64_t key, pixel_buffer_t &canvas) const;
+    void store_canvas(std::uint64_t key, const pixel_buffer_t &canvas,
+                      bool has_frames) const;
+
+    // Marks an entry reused, the last to be evicted
+    void touch(std::uint64_t key) const;
+
+    // Evicts the least recently used entries over the size limit
+    void trim() const;
+
+private:
+    std::filesystem::path canvas_path(std::uint64_t key) const;
+
+    std::filesystem::path directory;
+    std::uint64_t config_key;
+    std::uintmax_t max_bytes;
+    bool is_enabled;
+};
+
+// Index of each shape in the order the scene first references it. The
+// renderer tells shapes apart by address: the same shape placed twice is
+// one shape of the scene, two equal ones are two, and a Morph only takes
+// its own source out.
+class shape_ids
+{
+public:
+    int index(const void *shape);
+
+private:
+    std::unordered_map<const void *, int> first_seen;
+};
+
+// `ids` carries over from one element of the scene to the next
+std::uint64_t hash_element(std::uint64_t previous, const PyAPI::Wait &elem,
+                           shape_ids &ids);
+std::uint64_t hash_element(std::uint64_t previous, const PyAPI::Place &elem,
+                           shape_ids &ids);
+std::uint64_t hash_element(std::uint64_t previous, const PyAPI::Draw &elem,
+                           shape_ids &ids);
+std::uint64_t hash_element(std::uint64_t previous, const PyAPI::Morph &elem,
+                           shape_ids &ids);
+std::uint64_t hash_element(std::uint64_t previous,
+                           const PyAPI::Simultaneous &elem, shape_ids &ids);
+std::uint64_t hash_element(std::uint64_t previous,
+                           const PyAPI::CameraMove &elem, shape_ids &ids);
+std::uint64_t hash_element(std::uint64_t previous,
+                           const PyAPI::Particles &elem, shape_ids &ids);
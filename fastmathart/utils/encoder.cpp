@@ -0,0 +1,238 @@
+#include "encoder.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include "memory.h"
+#include "trace.h"
+#include "wait.h"
+
+using utils::wait_until;
+
+async_encoder::async_encoder(std::size_t depth)
+    : depth(depth)
+    , staging(memory::resource(memory::encoder))
+{
+    if (depth > 0)
+        writer = std::thread([this] { writer_loop(); });
+}
+
+async_encoder::~async_encoder()
+{
+    finish();
+    if (writer.joinable())
+    {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        submitted++;
+        submitted.notify_one();
+        writer.join();
+    }
+    close_current();
+}
+
+std::size_t async_encoder::default_depth()
+{
+    const char *value = std::getenv("FMA_ENCODER_QUEUE");
+    if (value == nullptr || *value == '\0')
+        return 8;
+
+    char *end = nullptr;
+    const long frames = std::strtol(value, &end, 10);
+    if (*end != '\0' || frames < 0)
+    {
+        std::cout << "Invalid FMA_ENCODER_QUEUE " << value
+                  << ", using 8 frames\n";
+        return 8;
+    }
+    return static_cast<std::size_t>(frames);
+}
+
+void async_encoder::open(std::function<output()> open)
+{
+    enqueue({ job::open_output, std::move(open), nullptr, nullptr, 0, 0, 0 });
+}
+
+void async_encoder::push(const pixel_buffer_t &frame)
+{
+    enqueue({ job::frame, nullptr, nullptr, frame.buffer, frame.stride,
+              frame.width, frame.height });
+}
+
+void async_encoder::close(std::function<void(bool ok)> closed)
+{
+    enqueue({ job::close_output, nullptr, std::move(closed), nullptr, 0, 0,
+              0 });
+}
+
+void async_encoder::enqueue(job &&next)
+{
+    if (depth == 0)
+    {
+        run(next);
+        return;
+    }
+
+    // Backpressure, the writer is `depth` frames behind
+    if (next.kind == job::frame)
+    {
+        if (queued_frames >= depth)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            wait_until(queued_frames, [&](std::size_t n) { return n < depth; });
+            std::lock_guard lock(mutex);
+            waiting += std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+        }
+        queued_frames++;
+    }
+
+    pending++;
+    {
+        std::lock_guard lock(mutex);
+        jobs.push_back(std::move(next));
+    }
+    submitted++;
+    submitted.notify_one();
+}
+
+void async_encoder::drain()
+{
+    const auto start = std::chrono::steady_clock::now();
+    wait_until(queued_frames, [](std::size_t n) { return n == 0; });
+    std::lock_guard lock(mutex);
+    waiting += std::chrono::duration<double>(
+                   std::chrono::steady_clock::now() - start)
+                   .count();
+}
+
+void async_encoder::finish()
+{
+    wait_until(pending, [](std::size_t n) { return n == 0; });
+}
+
+void async_encoder::writer_loop()
+{
+    std::uint64_t taken = 0;
+    while (true)
+    {
+        wait_until(submitted, [&](std::uint64_t n) { return n != taken; });
+        taken++;
+
+        job next;
+        {
+            std::lock_guard lock(mutex);
+            if (jobs.empty())
+            {
+                if (stopping)
+                    return;
+                continue;
+            }
+            next = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        run(next);
+
+        if (next.kind == job::frame)
+        {
+            queued_frames--;
+            queued_frames.notify_all();
+        }
+        pending--;
+        pending.notify_all();
+    }
+}
+
+void async_encoder::run(job &next)
+{
+    const auto start = std::chrono::steady_clock::now();
+    switch (next.kind)
+    {
+    case job::open_output:
+        close_current();
+        current = next.open();
+        write_failed = false;
+        break;
+    case job::frame:
+        write_frame(next);
+        break;
+    case job::close_output: {
+        // Waits for the encoder to finish the file
+        FMA_TRACE_SCOPE("encoder_close", stage);
+        const bool ok = close_current();
+        if (next.closed)
+            next.closed(ok);
+        break;
+    }
+    }
+
+    std::lock_guard lock(mutex);
+    writing += std::chrono::duration<double>(
+                   std::chrono::steady_clock::now() - start)
+                   .count();
+}
+
+// True when the output took every frame and closed cleanly
+bool async_encoder::close_current()
+{
+    bool ok = current && !write_failed;
+    if (current && current.close != nullptr)
+        ok = current.close(current.file) == 0 && ok;
+    current = output{};
+    return ok;
+}
+
+// As packed 24 bits RGB, the encoder's input
+void async_encoder::write_frame(const job &frame)
+{
+    if (!current)
+        return;
+
+    FMA_TRACE_SCOPE("encode", stage);
+    auto *pixels = const_cast<pixel_buffer_t::channel_type *>(frame.pixels);
+    const pixel_buffer_t view(pixels, frame.width, frame.height, frame.stride);
+
+    std::size_t bytes = 0;
+    if (frame_format == RGB_8 && view.packed())
+    {
+        bytes = std::fwrite(view.buffer, 1, view.size(), current.file);
+        write_failed |= bytes != view.size();
+    }
+    else
+    {
+        staging.resize(static_cast<std::size_t>(frame.width)
+                       * static_cast<std::size_t>(frame.height) * 3);
+        basic_pixel_buffer<RGB_8> packed(staging.data(), frame.width,
+                                         frame.height);
+        convert_pixels(view, packed);
+        bytes = std::fwrite(packed.buffer, 1, packed.size(), current.file);
+        write_failed |= bytes != packed.size();
+    }
+    FMA_TRACE_COUNT(bytes_piped, bytes);
+
+    std::lock_guard lock(mutex);
+    written += bytes;
+}
+
+std::uint64_t async_encoder::bytes_written() const
+{
+    std::lock_guard lock(mutex);
+    return written;
+}
+
+double async_encoder::write_seconds() const
+{
+    std::lock_guard lock(mutex);
+    return writing;
+}
+
+double async_encoder::wait_seconds() const
+{
+    std::lock_guard lock(mutex);
+    return waiting;
+}
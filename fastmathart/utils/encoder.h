@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "pixelUtils.h"
+
+/*
+======================================
+Encoder writer thread
+
+Finished frames are piped to the encoder by a thread of its own while the
+next ones render. They go through a queue of at most `depth` frames
+(FMA_ENCODER_QUEUE, default 8): push() waits while it is full, so the
+renderer never runs further ahead than that. FMA_ENCODER_QUEUE=0 writes
+every frame on the rendering thread instead.
+
+Frames are borrowed, not copied: their pixels must stay alive until
+drain() returns. Outputs are opened and closed on the writer thread too,
+the encoder flushing one video overlaps the rendering of the next. close()
+tells through a callback whether the video was written completely.
+======================================
+*/
+
+class async_encoder
+{
+public:
+    // A stream and what closes it, returning 0 once everything it was
+    // given is written, as fclose() and pclose() do
+    struct output
+    {
+        std::FILE *file = nullptr;
+        int (*close)(std::FILE *) = nullptr;
+
+        explicit operator bool() const
+        {
+            return file != nullptr;
+        }
+    };
+
+    explicit async_encoder(std::size_t depth);
+    async_encoder(const async_encoder &) = delete;
+    async_encoder &operator=(const async_encoder &) = delete;
+    ~async_encoder();
+
+    // From FMA_ENCODER_QUEUE
+    static std::size_t default_depth();
+
+    // The frames pushed next go to what `open` returns, a null output
+    // drops them
+    void open(std::function<output()> open);
+
+    // Queues a finished frame, waiting while the queue is full
+    void push(const pixel_buffer_t &frame);
+
+    // Closes the output once its frames are written. `closed` then runs on
+    // the writer thread, told whether the output took every frame and
+    // closed cleanly
+    void close(std::function<void(bool ok)> closed = nullptr);
+
+    // Waits for the queued frames, outputs may still be closing
+    void drain();
+
+    // Waits for everything, closes included
+    void finish();
+
+    std::uint64_t bytes_written() const;
+    double write_seconds() const; // spent by the writer
+    double wait_seconds() const;  // spent by the renderer on a full queue
+
+private:
+    struct job
+    {
+        enum
+        {
+            open_output,
+            frame,
+            close_output
+        } kind = frame;
+        std::function<output()> open;
+        std::function<void(bool ok)> closed;
+        const pixel_buffer_t::channel_type *pixels;
+        std::size_t stride;
+        int width;
+        int height;
+    };
+
+    void enqueue(job &&next);
+    void run(job &next);
+    bool close_current();
+    void write_frame(const job &frame);
+    void writer_loop();
+
+    std::size_t depth;
+    output current;
+    bool write_failed = false;
+    std::pmr::vector<std::uint8_t> staging;
+
+    // The threads wait on the counters, the jobs and totals are under the
+    // mutex
+    mutable std::mutex mutex;
+    std::deque<job> jobs;
+    std::atomic<std::uint64_t> submitted = 0; // jobs, and the stop request
+    std::atomic<std::size_t> queued_frames = 0;
+    std::atomic<std::size_t> pending = 0; // queued or running jobs
+    bool stopping = false;
+    std::uint64_t written = 0;
+    double writing = 0.0;
+    double waiting = 0.0;
+    std::thread writer;
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#include <fmt/core.h>
+
+namespace utils
+{
+    // 64 bits FNV-1a, stable across runs and platforms
+    struct hasher
+    {
+        std::uint64_t state = 14695981039346656037ull;
+
+        void add_bytes(const void *data, std::size_t size)
+        {
+            auto bytes = static_cast<const unsigned char *>(data);
+            for (std::size_t i = 0; i < size; i++)
+            {
+                state ^= bytes[i];
+                state *= 1099511628211ull;
+            }
+        }
+
+        template <class T>
+        requires std::is_arithmetic_v<T> || std::is_enum_v<T>
+        void add(T value)
+        {
+            // Normalize -0.0f so equal floats always hash the same
+            if constexpr (std::is_floating_point_v<T>)
+            {
+                if (value == T(0))
+                    value = T(0);
+            }
+            add_bytes(&value, sizeof(T));
+        }
+
+        template <class T>
+        requires std::is_arithmetic_v<T>
+        void add_array(const T *values, std::size_t count)
+        {
+            add<std::uint64_t>(count);
+            for (std::size_t i = 0; i < count; i++)
+                add(values[i]);
+        }
+
+        std::uint64_t digest() const
+        {
+            return state;
+        }
+
+        std::string hex() const
+        {
+            return fmt::format("{:016x}", state);
+        }
+    };
+
+} // namespace utils
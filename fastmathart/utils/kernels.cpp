@@ -0,0 +1,225 @@
+#include "kernels.h"
+
+#include <algorithm>
+#include <cstring>
+
+// Contracting a * b + c to one fma instruction rounds once instead of
+// twice: the avx2 and avx512 variants would not return the same floats as
+// the generic one
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__))                                  \
+    && (defined(__x86_64__) || defined(__i386__))
+#define FMA_KERNEL_VARIANTS 1
+#define FMA_INLINE inline __attribute__((always_inline))
+#else
+#define FMA_KERNEL_VARIANTS 0
+#define FMA_INLINE inline
+#endif
+
+namespace kernels
+{
+    /* ===== Bodies, compiled once per level ===== */
+
+    // math::lerp on plain floats, so that the variants inline it
+    static FMA_INLINE float lerp1(float a, float b, float t)
+    {
+        return a * (1.0f - t) + b * t;
+    }
+
+    static FMA_INLINE void lerp_points_body(const math::fvec3 *a,
+                                            const math::fvec3 *b, float t,
+                                            math::fvec3 *out,
+                                            std::size_t count)
+    {
+        for (std::size_t k = 0; k < count; k++)
+        {
+            out[k].x = lerp1(a[k].x, b[k].x, t);
+            out[k].y = lerp1(a[k].y, b[k].y, t);
+            out[k].z = lerp1(a[k].z, b[k].z, t);
+        }
+    }
+
+    // CubicBezier::valueAt, one coordinate
+    static FMA_INLINE float cubic1(float p1, float p2, float p3, float p4,
+                                   float t)
+    {
+        const float p2_p3 = lerp1(p2, p3, t);
+        return lerp1(lerp1(lerp1(p1, p2, t), p2_p3, t),
+                     lerp1(p2_p3, lerp1(p3, p4, t), t), t);
+    }
+
+    static FMA_INLINE void eval_cubic_body(const math::CubicBezier &curve,
+                                           const float *t, math::fvec3 *out,
+                                           std::size_t count)
+    {
+        const math::fvec3 p1 = curve.p1, p2 = curve.p2, p3 = curve.p3,
+                          p4 = curve.p4;
+        for (std::size_t k = 0; k < count; k++)
+        {
+            out[k].x = cubic1(p1.x, p2.x, p3.x, p4.x, t[k]);
+            out[k].y = cubic1(p1.y, p2.y, p3.y, p4.y, t[k]);
+            out[k].z = cubic1(p1.z, p2.z, p3.z, p4.z, t[k]);
+        }
+    }
+
+    // x / 255 for x <= 255 * 256, exact
+    static FMA_INLINE std::uint16_t div255(std::uint16_t x)
+    {
+        return static_cast<std::uint16_t>((x + (x >> 8) + 1) >> 8);
+    }
+
+    static FMA_INLINE void blend_over_body(std::uint8_t *dst,
+                                           std::size_t count,
+                                           const std::uint16_t *weighted,
+                                           std::size_t period, int a8)
+    {
+        const auto keep = static_cast<std::uint16_t>(255 - a8);
+        std::size_t i = 0;
+        for (; i + period <= count; i += period)
+            for (std::size_t j = 0; j < period; j++)
+                dst[i + j] = static_cast<std::uint8_t>(div255(
+                    static_cast<std::uint16_t>(dst[i + j] * keep
+                                               + weighted[j])));
+        for (std::size_t j = 0; i + j < count; j++)
+            dst[i + j] = static_cast<std::uint8_t>(div255(
+                static_cast<std::uint16_t>(dst[i + j] * keep + weighted[j])));
+    }
+
+    static FMA_INLINE void blend_add_body(std::uint8_t *dst, std::size_t count,
+                                          const std::uint16_t *weighted,
+                                          std::size_t period, int)
+    {
+        std::size_t i = 0;
+        for (; i + period <= count; i += period)
+            for (std::size_t j = 0; j < period; j++)
+                dst[i + j] = static_cast<std::uint8_t>(
+                    std::min(255, dst[i + j] + div255(weighted[j])));
+        for (std::size_t j = 0; i + j < count; j++)
+            dst[i + j] = static_cast<std::uint8_t>(
+                std::min(255, dst[i + j] + div255(weighted[j])));
+    }
+
+    static FMA_INLINE void rgbx_to_rgb_body(const std::uint8_t *src,
+                                            std::uint8_t *dst,
+                                            std::size_t pixels)
+    {
+        // 4 pixels per step through local blocks, which the compiler turns
+        // into a single shuffle
+        std::size_t p = 0;
+        for (; p + 4 <= pixels; p += 4)
+        {
+            std::uint8_t block_in[16], block_out[12];
+            std::memcpy(block_in, src + 4 * p, sizeof(block_in));
+            for (int k = 0; k < 4; k++)
+                for (int c = 0; c < 3; c++)
+                    block_out[3 * k + c] = block_in[4 * k + c];
+            std::memcpy(dst + 3 * p, block_out, sizeof(block_out));
+        }
+        for (; p < pixels; p++)
+        {
+            dst[3 * p] = src[4 * p];
+            dst[3 * p + 1] = src[4 * p + 1];
+            dst[3 * p + 2] = src[4 * p + 2];
+        }
+    }
+
+    static FMA_INLINE void rgb_to_rgbx_body(const std::uint8_t *src,
+                                            std::uint8_t *dst,
+                                            std::size_t pixels)
+    {
+        for (std::size_t p = 0; p < pixels; p++)
+        {
+            dst[4 * p] = src[3 * p];
+            dst[4 * p + 1] = src[3 * p + 1];
+            dst[4 * p + 2] = src[3 * p + 2];
+            dst[4 * p + 3] = 0;
+        }
+    }
+
+    /* ===== Variants ===== */
+
+    // One table of the bodies above, compiled with the `attributes` of a
+    // level
+#define FMA_KERNEL_TABLE(name, attributes)                                     \
+    namespace name                                                             \
+    {                                                                          \
+        attributes static void lerp_points(const math::fvec3 *a,               \
+                                           const math::fvec3 *b, float t,      \
+                                           math::fvec3 *out, std::size_t n)    \
+        {                                                                      \
+            lerp_points_body(a, b, t, out, n);                                 \
+        }                                                                      \
+        attributes static void eval_cubic(const math::CubicBezier &curve,      \
+                                          const float *t, math::fvec3 *out,    \
+                                          std::size_t n)                       \
+        {                                                                      \
+            eval_cubic_body(curve, t, out, n);                                 \
+        }                                                                      \
+        attributes static void blend_over(std::uint8_t *dst, std::size_t n,    \
+                                          const std::uint16_t *weighted,       \
+                                          std::size_t period, int a8)          \
+        {                                                                      \
+            blend_over_body(dst, n, weighted, period, a8);                     \
+        }                                                                      \
+        attributes static void blend_add(std::uint8_t *dst, std::size_t n,     \
+                                         const std::uint16_t *weighted,        \
+                                         std::size_t period, int a8)           \
+        {                                                                      \
+            blend_add_body(dst, n, weighted, period, a8);                      \
+        }                                                                      \
+        attributes static void rgbx_to_rgb(const std::uint8_t *src,            \
+                                           std::uint8_t *dst, std::size_t n)   \
+        {                                                                      \
+            rgbx_to_rgb_body(src, dst, n);                                     \
+        }                                                                      \
+        attributes static void rgb_to_rgbx(const std::uint8_t *src,            \
+                                           std::uint8_t *dst, std::size_t n)   \
+        {                                                                      \
+            rgb_to_rgbx_body(src, dst, n);                                     \
+        }                                                                      \
+        static const table functions{ lerp_points, eval_cubic, blend_over,     \
+                                      blend_add,   rgbx_to_rgb, rgb_to_rgbx }; \
+    }
+
+    FMA_KERNEL_TABLE(generic, )
+#if FMA_KERNEL_VARIANTS
+    FMA_KERNEL_TABLE(sse42, __attribute__((target("sse4.2"))))
+    FMA_KERNEL_TABLE(avx2, __attribute__((target("avx2"))))
+    FMA_KERNEL_TABLE(avx512,
+                     __attribute__((target("avx512f,avx512bw,avx512vl"))))
+#endif
+
+#undef FMA_KERNEL_TABLE
+
+    const table &for_level(cpu::level l)
+    {
+#if FMA_KERNEL_VARIANTS
+        switch (l)
+        {
+        case cpu::level::avx512:
+            return avx512::functions;
+        case cpu::level::avx2:
+            return avx2::functions;
+        case cpu::level::sse42:
+            return sse42::functions;
+        case cpu::level::generic:
+            break;
+        }
+#else
+        (void)l;
+#endif
+        return generic::functions;
+    }
+
+    const table &active()
+    {
+        static const table &chosen = for_level(cpu::selected());
+        return chosen;
+    }
+
+} // namespace kernels
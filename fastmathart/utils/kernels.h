@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "../math/bezier.h"
+#include "../math/vec.h"
+#include "cpu.h"
+
+/*
+======================================
+Hot array kernels, built for every cpu::level and picked once at load
+
+Every variant returns bit for bit what the generic one does, so frames
+(and the render cache) do not depend on the machine that rendered them.
+======================================
+*/
+
+namespace kernels
+{
+    struct table
+    {
+        // out[k] = lerp(a[k], b[k], t)
+        void (*lerp_points)(const math::fvec3 *a, const math::fvec3 *b,
+                            float t, math::fvec3 *out, std::size_t count);
+
+        // out[k] = curve.valueAt(t[k])
+        void (*eval_cubic)(const math::CubicBezier &curve, const float *t,
+                           math::fvec3 *out, std::size_t count);
+
+        // Over and add blending of `count` 8 bits channels, weighted[j] is
+        // the source channel times a8 plus 127, repeating every `period`
+        // channels
+        void (*blend_over)(std::uint8_t *dst, std::size_t count,
+                           const std::uint16_t *weighted, std::size_t period,
+                           int a8);
+        void (*blend_add)(std::uint8_t *dst, std::size_t count,
+                          const std::uint16_t *weighted, std::size_t period,
+                          int a8);
+
+        // 4 channels pixels to packed RGB and back, the fourth byte is
+        // dropped or set to 0
+        void (*rgbx_to_rgb)(const std::uint8_t *src, std::uint8_t *dst,
+                            std::size_t pixels);
+        void (*rgb_to_rgbx)(const std::uint8_t *src, std::uint8_t *dst,
+                            std::size_t pixels);
+    };
+
+    // The variant of a level, which the CPU must support
+    const table &for_level(cpu::level l);
+
+    // The variant of cpu::selected()
+    const table &active();
+
+} // namespace kernels
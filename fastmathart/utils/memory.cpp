@@ -0,0 +1,145 @@
+#include "memory.h"
+
+#include <atomic>
+#include <fmt/core.h>
+#include <utility>
+
+namespace memory
+{
+    static std::atomic<std::size_t> current_bytes[TAG_COUNT];
+    static std::atomic<std::size_t> peak_bytes[TAG_COUNT];
+
+    static const char *tag_names[] = { "frames", "geometry", "caches",
+                                       "encoder" };
+
+    void allocated(tag t, std::size_t bytes)
+    {
+        std::size_t now =
+            current_bytes[t].fetch_add(bytes, std::memory_order_relaxed)
+            + bytes;
+        std::size_t peak = peak_bytes[t].load(std::memory_order_relaxed);
+        while (now > peak
+               && !peak_bytes[t].compare_exchange_weak(
+                   peak, now, std::memory_order_relaxed))
+        { }
+    }
+
+    void released(tag t, std::size_t bytes)
+    {
+        current_bytes[t].fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    usage query(tag t)
+    {
+        return { current_bytes[t].load(std::memory_order_relaxed),
+                 peak_bytes[t].load(std::memory_order_relaxed) };
+    }
+
+    const char *tag_name(tag t)
+    {
+        return tag_names[t];
+    }
+
+    void reset_peaks()
+    {
+        for (int t = 0; t < TAG_COUNT; t++)
+        {
+            auto now = current_bytes[t].load(std::memory_order_relaxed);
+            peak_bytes[t].store(now, std::memory_order_relaxed);
+        }
+    }
+
+    void dump(std::ostream &out)
+    {
+        constexpr double mb = 1024.0 * 1024.0;
+        out << "Memory by subsystem (current / peak MB)\n";
+        for (int t = 0; t < TAG_COUNT; t++)
+        {
+            auto u = query(static_cast<tag>(t));
+            out << fmt::format("  {:<10} {:>10.2f} / {:>10.2f}\n",
+                               tag_names[t], double(u.current) / mb,
+                               double(u.peak) / mb);
+        }
+    }
+
+    /* ===== Counted heap ===== */
+
+    class counted_resource : public std::pmr::memory_resource
+    {
+    public:
+        explicit counted_resource(tag t)
+            : t(t)
+        { }
+
+    private:
+        void *do_allocate(std::size_t bytes, std::size_t alignment) override
+        {
+            void *p = std::pmr::new_delete_resource()->allocate(bytes,
+                                                                alignment);
+            allocated(t, bytes);
+            return p;
+        }
+
+        void do_deallocate(void *p, std::size_t bytes,
+                           std::size_t alignment) override
+        {
+            std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+            released(t, bytes);
+        }
+
+        bool do_is_equal(
+            const std::pmr::memory_resource &other) const noexcept override
+        {
+            return this == &other;
+        }
+
+        tag t;
+    };
+
+    std::pmr::memory_resource *resource(tag t)
+    {
+        static counted_resource resources[TAG_COUNT] = {
+            counted_resource(frames), counted_resource(geometry),
+            counted_resource(caches), counted_resource(encoder)
+        };
+        return &resources[t];
+    }
+
+    /* ===== Charges ===== */
+
+    charge::charge(tag t, std::size_t bytes)
+        : t(t)
+        , held(bytes)
+    {
+        allocated(t, held);
+    }
+
+    charge::charge(const charge &other)
+        : charge(other.t, other.held)
+    { }
+
+    charge::charge(charge &&other) noexcept
+        : t(other.t)
+        , held(std::exchange(other.held, 0))
+    { }
+
+    charge &charge::operator=(charge other) noexcept
+    {
+        std::swap(t, other.t);
+        std::swap(held, other.held);
+        return *this;
+    }
+
+    charge::~charge()
+    {
+        if (held > 0)
+            released(t, held);
+    }
+
+    void charge::add(std::size_t more)
+    {
+        held += more;
+        allocated(t, more);
+    }
+
+} // namespace memory
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <ostream>
+
+/*
+======================================
+Memory accounting by subsystem
+
+Every tag keeps its current and peak bytes, updated atomically from any
+thread. Frame storage is counted as allocated: a zeroed video buffer
+whose frames are never drawn counts in full while the system has not
+committed its pages yet.
+    - frames:   pixel and video buffers
+    - geometry: Bezier paths and the blocks of the frame arenas
+    - caches:   shapes kept by the scene, font files and glyph caches
+    - encoder:  frames converted for the encoder
+======================================
+*/
+
+namespace memory
+{
+    enum tag
+    {
+        frames = 0,
+        geometry,
+        caches,
+        encoder,
+        TAG_COUNT
+    };
+
+    struct usage
+    {
+        std::size_t current;
+        std::size_t peak;
+    };
+
+    void allocated(tag t, std::size_t bytes);
+    void released(tag t, std::size_t bytes);
+
+    usage query(tag t);
+    const char *tag_name(tag t);
+
+    // Every peak restarts from the current bytes
+    void reset_peaks();
+
+    // One line per tag
+    void dump(std::ostream &out);
+
+    // Heap allocations through std::pmr, counted under the tag
+    std::pmr::memory_resource *resource(tag t);
+
+    // Bytes held by one object, released with it. Copies hold the same
+    // bytes again, moves hand them over.
+    class charge
+    {
+    public:
+        charge() = default;
+        charge(tag t, std::size_t bytes);
+        charge(const charge &other);
+        charge(charge &&other) noexcept;
+        charge &operator=(charge other) noexcept;
+        ~charge();
+
+        void add(std::size_t more);
+
+        std::size_t bytes() const
+        {
+            return held;
+        }
+
+    private:
+        tag t = frames;
+        std::size_t held = 0;
+    };
+
+} // namespace memory
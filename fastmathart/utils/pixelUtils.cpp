@@ -1,7 +1,12 @@
 #include "pixelUtils.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <cstring>
+#include <vector>
+
+#include "kernels.h"
+#include "trace.h"
 
 /*
 ======================================
@@ -232,107 +237,382 @@ Buffer utils
 ======================================
 */
 
-pixel_buffer_t::pixel_buffer_t(int width, int height)
+template <pixel_format F>
+basic_pixel_buffer<F>::basic_pixel_buffer(int width, int height)
+    : basic_pixel_buffer(width, height, default_stride(width))
+{ }
+
+template <pixel_format F>
+basic_pixel_buffer<F>::basic_pixel_buffer(int width, int height,
+                                          std::size_t stride)
     : width(width)
     , height(height)
+    , stride(stride)
     , owns_buffer(true)
-    , buffer(new uint8_t[width * height * 3])
+    , buffer(allocate_aligned<channel_type>(stride
+                                            * static_cast<std::size_t>(height)))
+{
+    memory::allocated(memory::frames, size() * sizeof(channel_type));
+}
+
+template <pixel_format F>
+basic_pixel_buffer<F>::basic_pixel_buffer(basic_pixel_buffer &&other)
+    : width(other.width)
+    , height(other.height)
+    , stride(other.stride)
+    , owns_buffer(other.owns_buffer)
+    , buffer(other.buffer)
+{
+    other.owns_buffer = false;
+    other.buffer = nullptr;
+}
+
+template <pixel_format F>
+basic_pixel_buffer<F>::basic_pixel_buffer(channel_type *buffer, int width,
+                                          int height)
+    : basic_pixel_buffer(buffer, width, height, default_stride(width))
 { }
 
-pixel_buffer_t::pixel_buffer_t(uint8_t *buffer, int width, int height)
+template <pixel_format F>
+basic_pixel_buffer<F>::basic_pixel_buffer(channel_type *buffer, int width,
+                                          int height, std::size_t stride)
     : width(width)
     , height(height)
+    , stride(stride)
     , owns_buffer(false)
     , buffer(buffer)
 { }
 
-pixel_buffer_t::~pixel_buffer_t()
+template <pixel_format F>
+basic_pixel_buffer<F>::~basic_pixel_buffer()
 {
     if (owns_buffer)
-        delete[] buffer;
+    {
+        aligned_delete{}(buffer);
+        memory::released(memory::frames, size() * sizeof(channel_type));
+    }
 }
 
-void pixel_buffer_t::copy_from(pixel_buffer_t &other)
+template <pixel_format F>
+void basic_pixel_buffer<F>::copy_from(const basic_pixel_buffer &other)
 {
     if (other.width != width || other.height != height)
         return;
 
-    std::memcpy(buffer, other.buffer, width * height * 3);
+    if (stride == other.stride)
+    {
+        std::memcpy(buffer, other.buffer, size() * sizeof(channel_type));
+        return;
+    }
+
+    const std::size_t row_size =
+        static_cast<std::size_t>(width) * traits::channels;
+    for (int y = 0; y < height; y++)
+        std::memcpy(row(y), other.row(y), row_size * sizeof(channel_type));
 }
 
-void pixel_buffer_t::copy_from(pixel_buffer_t &&other)
+template <pixel_format F>
+void basic_pixel_buffer<F>::set_pixel(int x, int y, const color_type &color)
 {
-    if (other.width != width || other.height != height)
+    if (x < 0 || x >= width || y < 0 || y >= height)
         return;
 
-    std::memcpy(buffer, other.buffer, width * height * 3);
+    FMA_TRACE_COUNT(pixels_written, 1);
+
+    traits::store(row(y) + x * traits::channels, color);
 }
 
-void pixel_buffer_t::set_pixel(int x, int y, const color_t<RGB_8> &color)
+template <pixel_format F>
+typename basic_pixel_buffer<F>::color_type
+basic_pixel_buffer<F>::get_pixel(int x, int y)
 {
     if (x < 0 || x >= width || y < 0 || y >= height)
+        return color_type(0, 0, 0);
+
+    return traits::load(row(y) + x * traits::channels);
+}
+
+// `count` copies of one pixel, whole words at once for 32 bits pixels
+template <class Traits>
+static void fill_pixels(typename Traits::channel_type *dst, int count,
+                        const typename Traits::channel_type *pixel)
+{
+    constexpr int channels = Traits::channels;
+    if constexpr (channels == 4 && sizeof(typename Traits::channel_type) == 1)
+    {
+        std::uint32_t word;
+        std::memcpy(&word, pixel, sizeof(word));
+        for (int x = 0; x < count; x++)
+            std::memcpy(dst + 4 * x, &word, sizeof(word));
+    }
+    else
+    {
+        for (int x = 0; x < count; x++)
+        {
+            for (int c = 0; c < channels; c++)
+                dst[x * channels + c] = pixel[c];
+        }
+    }
+}
+
+// One row is filled pixel by pixel, the others are copies of it
+template <pixel_format F>
+void basic_pixel_buffer<F>::clear(const color_type color)
+{
+    constexpr int channels = traits::channels;
+    if (height <= 0)
         return;
 
-    int index = (y * width + x) * 3;
-    buffer[index] = color.x;
-    buffer[index + 1] = color.y;
-    buffer[index + 2] = color.z;
+    channel_type pixel[channels];
+    traits::store(pixel, color);
+    if constexpr (traits::has_alpha)
+        pixel[channels - 1] = 0;
+
+    channel_type *first = row(0);
+    fill_pixels<traits>(first, width, pixel);
+
+    const std::size_t row_size =
+        static_cast<std::size_t>(width) * channels * sizeof(channel_type);
+    for (int y = 1; y < height; y++)
+        std::memcpy(row(y), first, row_size);
 }
 
-color_t<RGB_8> pixel_buffer_t::get_pixel(int x, int y)
+template <pixel_format F>
+void basic_pixel_buffer<F>::fill_span(int y, int x0, int x1,
+                                      const color_type &color)
 {
-    if (x < 0 || x >= width || y < 0 || y >= height)
-        return color_t<RGB_8>(0, 0, 0);
+    fill_rect(x0, y, x1, y, color);
+}
+
+// Same as clear, on the clipped part of the rows
+template <pixel_format F>
+void basic_pixel_buffer<F>::fill_rect(int x0, int y0, int x1, int y1,
+                                      const color_type &color)
+{
+    x0 = std::max(x0, 0);
+    x1 = std::min(x1, width - 1);
+    y0 = std::max(y0, 0);
+    y1 = std::min(y1, height - 1);
+    if (x0 > x1 || y0 > y1)
+        return;
+
+    constexpr int channels = traits::channels;
+    channel_type pixel[channels];
+    traits::store(pixel, color);
+
+    const int count = x1 - x0 + 1;
+    channel_type *first = row(y0) + x0 * channels;
+    fill_pixels<traits>(first, count, pixel);
+
+    const std::size_t run_size =
+        static_cast<std::size_t>(count) * channels * sizeof(channel_type);
+    for (int y = y0 + 1; y <= y1; y++)
+        std::memcpy(row(y) + x0 * channels, first, run_size);
+
+    FMA_TRACE_COUNT(pixels_written, count * (y1 - y0 + 1));
+}
+
+template struct basic_pixel_buffer<RGB_8>;
+template struct basic_pixel_buffer<LinearRGB_f32>;
+template struct basic_pixel_buffer<RGBA_8>;
+template struct basic_pixel_buffer<RGBX_8>;
+
+template <pixel_format F, pixel_format G>
+void convert_pixels(const basic_pixel_buffer<F> &src,
+                    basic_pixel_buffer<G> &dst)
+{
+    if (src.width != dst.width || src.height != dst.height)
+        return;
+
+    using traits = pixel_traits<F>;
+    constexpr int in = traits::channels;
+    constexpr int out = pixel_traits<G>::channels;
 
-    int index = (y * width + x) * 3;
-    return color_t<RGB_8>(buffer[index], buffer[index + 1], buffer[index + 2]);
+    for (int y = 0; y < src.height; y++)
+    {
+        const auto *p = src.row(y);
+        uint8_t *q = dst.row(y);
+
+        if constexpr (F == LinearRGB_f32)
+        {
+            for (int x = 0; x < src.width; x++, p += in, q += out)
+                pixel_traits<G>::store(
+                    q, color_t<LinearRGB_f32>(std::clamp(p[0], 0.0f, 1.0f),
+                                              std::clamp(p[1], 0.0f, 1.0f),
+                                              std::clamp(p[2], 0.0f, 1.0f))
+                           .toRGB_8());
+        }
+        else
+        {
+            int x = 0;
+            if constexpr (in == 4 && out == 3)
+            {
+                kernels::active().rgbx_to_rgb(
+                    p, q, static_cast<std::size_t>(src.width));
+                x = src.width;
+            }
+            else if constexpr (in == 3 && out == 4)
+            {
+                kernels::active().rgb_to_rgbx(
+                    p, q, static_cast<std::size_t>(src.width));
+                x = src.width;
+            }
+
+            for (; x < src.width; x++, p += in, q += out)
+            {
+                q[0] = p[0];
+                q[1] = p[1];
+                q[2] = p[2];
+                if constexpr (out == 4)
+                    q[3] = 0;
+            }
+        }
+    }
 }
 
-void pixel_buffer_t::clear(const color_t<RGB_8> color)
+template void convert_pixels(const basic_pixel_buffer<RGB_8> &,
+                             basic_pixel_buffer<RGB_8> &);
+template void convert_pixels(const basic_pixel_buffer<LinearRGB_f32> &,
+                             basic_pixel_buffer<RGB_8> &);
+template void convert_pixels(const basic_pixel_buffer<RGBA_8> &,
+                             basic_pixel_buffer<RGB_8> &);
+template void convert_pixels(const basic_pixel_buffer<RGBX_8> &,
+                             basic_pixel_buffer<RGB_8> &);
+template void convert_pixels(const basic_pixel_buffer<RGB_8> &,
+                             basic_pixel_buffer<RGBX_8> &);
+template void convert_pixels(const basic_pixel_buffer<LinearRGB_f32> &,
+                             basic_pixel_buffer<RGBX_8> &);
+template void convert_pixels(const basic_pixel_buffer<RGBA_8> &,
+                             basic_pixel_buffer<RGBX_8> &);
+template void convert_pixels(const basic_pixel_buffer<RGBX_8> &,
+                             basic_pixel_buffer<RGBX_8> &);
+
+// Whole pixels are compared, so a layer's color never mixes with another's.
+// Runs of 16 pixels the layer left as they were are skipped with one
+// memcmp, and dst is only written where something changed.
+template <pixel_format F>
+void overlay_changes(basic_pixel_buffer<F> &dst,
+                     const basic_pixel_buffer<F> &layer,
+                     const basic_pixel_buffer<F> &base)
 {
-    for (int i = 0; i < width * height; i++)
+    if (dst.width != layer.width || dst.height != layer.height
+        || dst.width != base.width || dst.height != base.height)
+        return;
+
+    using traits = pixel_traits<F>;
+    using channel_type = typename traits::channel_type;
+    constexpr int channels = traits::channels;
+    constexpr int run = 16;
+
+    for (int y = 0; y < dst.height; y++)
     {
-        buffer[i * 3] = color.x;
-        buffer[i * 3 + 1] = color.y;
-        buffer[i * 3 + 2] = color.z;
+        for (int x0 = 0; x0 < dst.width; x0 += run)
+        {
+            const int count = std::min(run, dst.width - x0);
+            auto *d = dst.row(y) + x0 * channels;
+            const auto *l = layer.row(y) + x0 * channels;
+            const auto *b = base.row(y) + x0 * channels;
+            if (std::memcmp(l, b, count * channels * sizeof(channel_type))
+                == 0)
+                continue;
+
+            for (int x = 0; x < count;
+                 x++, d += channels, l += channels, b += channels)
+            {
+                if (std::memcmp(l, b, channels * sizeof(channel_type)) != 0)
+                    std::memcpy(d, l, channels * sizeof(channel_type));
+            }
+        }
     }
 }
 
+template void overlay_changes(basic_pixel_buffer<RGB_8> &,
+                              const basic_pixel_buffer<RGB_8> &,
+                              const basic_pixel_buffer<RGB_8> &);
+template void overlay_changes(basic_pixel_buffer<RGBX_8> &,
+                              const basic_pixel_buffer<RGBX_8> &,
+                              const basic_pixel_buffer<RGBX_8> &);
+
 video_buffer_t::video_buffer_t(int width, int height, int frames)
+    : video_buffer_t(width, height, frames, {})
+{ }
+
+video_buffer_t::video_buffer_t(int width, int height, int frames,
+                               std::vector<int> kept, std::size_t slots)
     : width(width)
     , height(height)
     , frames(frames)
+    , stride(pixel_buffer_t::default_stride(width))
+    , kept(std::move(kept))
+    , slots(std::max(this->kept.empty()
+                         ? static_cast<std::size_t>(std::max(frames, 0))
+                         : this->kept.size(),
+                     slots))
 {
-    buffer = std::make_unique<uint8_t[]>(width * height * frames * 3);
+    const std::size_t count = frame_size() * this->slots;
+    buffer = std::unique_ptr<channel_type[], zeroed_delete>(
+        allocate_zeroed<channel_type>(count),
+        zeroed_delete{ count * sizeof(channel_type) });
 }
 
+video_buffer_t::video_buffer_t(video_buffer_t &&other) = default;
+
 void video_buffer_t::set_all_frames(const pixel_buffer_t &framebuffer)
 {
-    if (framebuffer.width != width || framebuffer.height != height)
-        return;
-
     for (int i = 0; i < frames; i++)
-    {
-        std::memcpy(buffer.get() + i * width * height * 3, framebuffer.buffer,
-                    width * height * 3);
-    }
+        set_frame(framebuffer, i);
 }
 
 void video_buffer_t::set_frame(const pixel_buffer_t &framebuffer,
                                int frame_index)
 {
-    if (frame_index < 0 || frame_index >= frames)
+    if (!contains(frame_index))
         return;
 
-    std::memcpy(buffer.get() + frame_index * width * height * 3,
-                framebuffer.buffer, width * height * 3);
+    get_frame(frame_index).copy_from(framebuffer);
 }
 
-pixel_buffer_t video_buffer_t::get_frame(int frame_index)
+void video_buffer_t::slide(std::vector<int> next)
+{
+    // A frame kept in both windows only moves to an earlier slot, so the
+    // slots are read before they are overwritten. The new frames start
+    // zeroed, as in a new buffer.
+    for (std::size_t to = 0; to < next.size(); to++)
+    {
+        channel_type *slot = buffer.get() + to * frame_size();
+        const auto found = std::lower_bound(kept.begin(), kept.end(), next[to]);
+        if (found == kept.end() || *found != next[to])
+        {
+            std::memset(slot, 0, frame_size() * sizeof(channel_type));
+            continue;
+        }
+        const auto from = static_cast<std::size_t>(found - kept.begin());
+        if (from != to)
+            std::memcpy(slot, buffer.get() + from * frame_size(),
+                        frame_size() * sizeof(channel_type));
+    }
+    kept = std::move(next);
+}
+
+bool video_buffer_t::contains(int frame_index) const
 {
     if (frame_index < 0 || frame_index >= frames)
-        return pixel_buffer_t(0, 0);
+        return false;
+    return kept.empty()
+        || std::binary_search(kept.begin(), kept.end(), frame_index);
+}
 
-    return pixel_buffer_t(buffer.get() + frame_index * width * height * 3,
-                          width, height);
-}
\ No newline at end of file
+pixel_buffer_t video_buffer_t::get_frame(int frame_index)
+{
+    // Empty view, no allocation
+    if (!contains(frame_index))
+        return pixel_buffer_t(nullptr, 0, 0);
+
+    const std::size_t slot = kept.empty()
+        ? static_cast<std::size_t>(frame_index)
+        : static_cast<std::size_t>(
+            std::lower_bound(kept.begin(), kept.end(), frame_index)
+            - kept.begin());
+    return pixel_buffer_t(buffer.get() + slot * frame_size(), width, height,
+                          stride);
+}
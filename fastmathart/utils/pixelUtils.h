@@ -1,7 +1,16 @@
+#pragma once
+
+#include <cstddef>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <vector>
 
 #include "../math/vec.h"
-#include "../render.h"
+#include "../api_bindings.h"
+#include "memory.h"
 
 enum pixel_format
 {
@@ -9,7 +18,9 @@ enum pixel_format
     RGB_f32,
     LinearRGB_8,
     LinearRGB_f32,
-    Oklab
+    Oklab,
+    RGBA_8,
+    RGBX_8
 };
 
 template <pixel_format F>
@@ -134,34 +145,294 @@ struct _color_implem<LinearRGB_f32>
 color_t<RGB_f32> cast_to_color_t_RGB_f32(const PyAPI::Color &color);
 color_t<RGB_8> cast_to_color_t_RGB_8(const PyAPI::Color &color);
 
-struct pixel_buffer_t
+/*
+======================================
+Storage layout of the formats a pixel buffer can hold
+======================================
+*/
+
+template <pixel_format F>
+struct pixel_traits;
+
+template <>
+struct pixel_traits<RGB_8>
+{
+    using channel_type = uint8_t;
+    using color_type = color_t<RGB_8>;
+    static constexpr int channels = 3;
+    static constexpr int color_channels = 3;
+    static constexpr bool has_alpha = false;
+
+    static color_type load(const channel_type *p)
+    {
+        return color_type(p[0], p[1], p[2]);
+    }
+
+    static void store(channel_type *p, const color_type &color)
+    {
+        p[0] = color.x;
+        p[1] = color.y;
+        p[2] = color.z;
+    }
+};
+
+// Linear light accumulation buffer, for high quality output
+template <>
+struct pixel_traits<LinearRGB_f32>
 {
+    using channel_type = float;
+    using color_type = color_t<LinearRGB_f32>;
+    static constexpr int channels = 3;
+    static constexpr int color_channels = 3;
+    static constexpr bool has_alpha = false;
+
+    static color_type load(const channel_type *p)
+    {
+        return color_type(p[0], p[1], p[2]);
+    }
+
+    static void store(channel_type *p, const color_type &color)
+    {
+        p[0] = color.x;
+        p[1] = color.y;
+        p[2] = color.z;
+    }
+};
+
+// 8 bits RGB plus a coverage channel, the color part behaves as RGB_8
+template <>
+struct pixel_traits<RGBA_8>
+{
+    using channel_type = uint8_t;
+    using color_type = color_t<RGB_8>;
+    static constexpr int channels = 4;
+    static constexpr int color_channels = 3;
+    static constexpr bool has_alpha = true;
+
+    static color_type load(const channel_type *p)
+    {
+        return color_type(p[0], p[1], p[2]);
+    }
+
+    static void store(channel_type *p, const color_type &color)
+    {
+        p[0] = color.x;
+        p[1] = color.y;
+        p[2] = color.z;
+        p[3] = 255;
+    }
+};
+
+// 8 bits RGB in 32 bits pixels, the fourth byte is padding and always 0,
+// so zeroed memory is black. Every pixel is aligned, so a fill or a copy is
+// a run of whole word stores.
+template <>
+struct pixel_traits<RGBX_8>
+{
+    using channel_type = uint8_t;
+    using color_type = color_t<RGB_8>;
+    static constexpr int channels = 4;
+    static constexpr int color_channels = 3;
+    static constexpr bool has_alpha = false;
+
+    static color_type load(const channel_type *p)
+    {
+        return color_type(p[0], p[1], p[2]);
+    }
+
+    static void store(channel_type *p, const color_type &color)
+    {
+        p[0] = color.x;
+        p[1] = color.y;
+        p[2] = color.z;
+        p[3] = 0;
+    }
+};
+
+// Owned pixel storage starts on a cache line. Rows of 4 channels formats
+// are padded to a multiple of it, so every row is aligned too.
+inline constexpr std::size_t row_alignment = 64;
+
+struct aligned_delete
+{
+    template <class T>
+    void operator()(T *p) const
+    {
+        ::operator delete[](p, std::align_val_t{ row_alignment });
+    }
+};
+
+template <class T>
+T *allocate_aligned(std::size_t count)
+{
+    return new (std::align_val_t{ row_alignment }) T[count];
+}
+
+// Zeroed and aligned the same way. calloc leaves large blocks to the
+// system's zero pages, so frames that are never drawn into cost nothing.
+// The block calloc returned is kept right before the aligned address.
+// Both count as frame storage.
+struct zeroed_delete
+{
+    std::size_t bytes = 0;
+
+    template <class T>
+    void operator()(T *p) const
+    {
+        std::free(reinterpret_cast<void **>(p)[-1]);
+        memory::released(memory::frames, bytes);
+    }
+};
+
+template <class T>
+T *allocate_zeroed(std::size_t count)
+{
+    void *block =
+        std::calloc(count * sizeof(T) + sizeof(void *) + row_alignment, 1);
+    if (block == nullptr)
+        throw std::bad_alloc();
+    memory::allocated(memory::frames, count * sizeof(T));
+
+    std::uintptr_t address =
+        reinterpret_cast<std::uintptr_t>(block) + sizeof(void *);
+    address = (address + row_alignment - 1) / row_alignment * row_alignment;
+    reinterpret_cast<void **>(address)[-1] = block;
+    return reinterpret_cast<T *>(address);
+}
+
+/*
+Pixels of a frame, row after row. `stride` is the distance between two
+rows in channel_type elements: 3 channels formats are packed, the others
+have rows padded to row_alignment bytes unless told otherwise.
+*/
+template <pixel_format F>
+struct basic_pixel_buffer
+{
+    using traits = pixel_traits<F>;
+    using channel_type = typename traits::channel_type;
+    using color_type = typename traits::color_type;
+
     int width;
     int height;
+    std::size_t stride;
     bool owns_buffer;
-    uint8_t *buffer;
-
-    pixel_buffer_t(int width, int height);
-    pixel_buffer_t(pixel_buffer_t &&other);
-    pixel_buffer_t(uint8_t *buffer, int width, int height);
-    ~pixel_buffer_t();
-    void copy_from(pixel_buffer_t &other);
-    void copy_from(pixel_buffer_t &&other);
-    void set_pixel(int x, int y, const color_t<RGB_8> &color);
-    color_t<RGB_8> get_pixel(int x, int y);
-    void clear(const color_t<RGB_8> color = { 0, 0, 0 });
+    channel_type *buffer;
+
+    basic_pixel_buffer(int width, int height);
+    basic_pixel_buffer(int width, int height, std::size_t stride);
+    basic_pixel_buffer(basic_pixel_buffer &&other);
+    basic_pixel_buffer(channel_type *buffer, int width, int height);
+    basic_pixel_buffer(channel_type *buffer, int width, int height,
+                       std::size_t stride);
+    ~basic_pixel_buffer();
+    void copy_from(const basic_pixel_buffer &other);
+    void set_pixel(int x, int y, const color_type &color);
+    color_type get_pixel(int x, int y);
+    void clear(const color_type color = { 0, 0, 0 });
+
+    // Solid runs, clipped to the buffer once. Bounds are inclusive.
+    void fill_span(int y, int x0, int x1, const color_type &color);
+    void fill_rect(int x0, int y0, int x1, int y1, const color_type &color);
+
+    static constexpr std::size_t default_stride(int width)
+    {
+        const std::size_t packed =
+            static_cast<std::size_t>(width) * traits::channels;
+        if constexpr (traits::channels == 3)
+            return packed;
+
+        constexpr std::size_t step = row_alignment / sizeof(channel_type);
+        return (packed + step - 1) / step * step;
+    }
+
+    channel_type *row(int y)
+    {
+        return buffer + static_cast<std::size_t>(y) * stride;
+    }
+
+    const channel_type *row(int y) const
+    {
+        return buffer + static_cast<std::size_t>(y) * stride;
+    }
+
+    // Rows are contiguous, without padding
+    bool packed() const
+    {
+        return stride == static_cast<std::size_t>(width) * traits::channels;
+    }
+
+    // Elements from the first row to the end of the last one
+    std::size_t size() const
+    {
+        return static_cast<std::size_t>(height) * stride;
+    }
 };
 
+/*
+Format of the frames the scene is rendered into. Packed 24 bits RGB, the
+encoder's own format, unless built with FMA_FRAME_RGBX: then pixels are
+32 bits with 64 bytes aligned rows, and frames are converted to RGB once,
+when they are written out.
+*/
+#ifdef FMA_FRAME_RGBX
+inline constexpr pixel_format frame_format = RGBX_8;
+#else
+inline constexpr pixel_format frame_format = RGB_8;
+#endif
+
+using pixel_buffer_t = basic_pixel_buffer<frame_format>;
+
+extern template struct basic_pixel_buffer<RGB_8>;
+extern template struct basic_pixel_buffer<LinearRGB_f32>;
+extern template struct basic_pixel_buffer<RGBA_8>;
+extern template struct basic_pixel_buffer<RGBX_8>;
+
+// Resolve any buffer to one of the 8 bits RGB layouts, RGB_8 being what
+// the encoder takes
+template <pixel_format F, pixel_format G>
+void convert_pixels(const basic_pixel_buffer<F> &src,
+                    basic_pixel_buffer<G> &dst);
+
+// Pixels of `layer` that differ from `base` are copied into `dst`. Layers
+// rendered from the same base merge this way, in order, into one frame.
+template <pixel_format F>
+void overlay_changes(basic_pixel_buffer<F> &dst,
+                     const basic_pixel_buffer<F> &layer,
+                     const basic_pixel_buffer<F> &base);
+
+// Frames of one element, each laid out as a pixel_buffer_t. They start
+// black.
 struct video_buffer_t
 {
-    std::unique_ptr<uint8_t[]> buffer;
+    using channel_type = pixel_buffer_t::channel_type;
+
+    std::unique_ptr<channel_type[], zeroed_delete> buffer;
     int width;
     int height;
     int frames;
+    std::size_t stride;
+    std::vector<int> kept; // sorted, empty when every frame is stored
+    std::size_t slots;     // frames the buffer has room for
 
     video_buffer_t(int width, int height, int frames);
+    // Only the `kept` frames are stored, the others are empty views that
+    // elements skip. Room is made for `slots` frames if that is more.
+    video_buffer_t(int width, int height, int frames, std::vector<int> kept,
+                   std::size_t slots = 0);
     video_buffer_t(video_buffer_t &&other);
     void set_frame(const pixel_buffer_t &framebuffer, int frame_index);
     void set_all_frames(const pixel_buffer_t &framebuffer);
     pixel_buffer_t get_frame(int frame_index);
-};
\ No newline at end of file
+    bool contains(int frame_index) const;
+
+    // Stores the `next` frames instead, keeping the pixels of those stored
+    // already. Only moves forward, within the frames the buffer has room
+    // for.
+    void slide(std::vector<int> next);
+
+    // Elements per frame
+    std::size_t frame_size() const
+    {
+        return stride * static_cast<std::size_t>(height);
+    }
+};
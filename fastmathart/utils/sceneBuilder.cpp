@@ -0,0 +1,306 @@
+#include "sceneBuilder.h"
+
+#include <algorithm>
+#include <iostream>
+
+PyAPI::Color *scene_builder::keep(const PyAPI::Color *color)
+{
+    if (color == nullptr)
+        return nullptr;
+    return &colors.emplace_back(*color);
+}
+
+PyAPI::Properties *scene_builder::keep(const PyAPI::Properties &source)
+{
+    auto &copy = properties.emplace_back(source);
+    copy.color = keep(source.color);
+    copy.fill = keep(source.fill);
+    return &copy;
+}
+
+int scene_builder::add_shape(void *shape, PyAPI::ShapeType type)
+{
+    shapes.emplace_back(shape, type);
+    return static_cast<int>(shapes.size() - 1);
+}
+
+int scene_builder::add_element(void *element, PyAPI::ElementType type)
+{
+    elements.push_back({ type, element });
+    in_sequence.push_back(true);
+    return static_cast<int>(elements.size() - 1);
+}
+
+std::pair<void **, PyAPI::ShapeType *>
+scene_builder::keep_shapes(const int *handles, int count)
+{
+    auto &objects = object_lists.emplace_back();
+    auto &types = shape_type_lists.emplace_back();
+    for (int i = 0; i < count; i++)
+    {
+        objects.push_back(shapes[std::size_t(handles[i])].first);
+        types.push_back(shapes[std::size_t(handles[i])].second);
+    }
+    return { objects.data(), types.data() };
+}
+
+bool scene_builder::valid_shapes(const int *handles, int count) const
+{
+    if (count < 0 || (count > 0 && handles == nullptr))
+    {
+        std::cout << "Invalid list of " << count << " shapes\n";
+        return false;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        if (handles[i] < 0 || std::size_t(handles[i]) >= shapes.size())
+        {
+            std::cout << "Invalid shape handle " << handles[i] << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+int scene_builder::add_circle(float radius,
+                              const PyAPI::Properties *properties)
+{
+    if (properties == nullptr)
+    {
+        std::cout << "A circle needs properties\n";
+        return -1;
+    }
+    auto &circle =
+        circles.emplace_back(PyAPI::Circle{ radius, keep(*properties) });
+    return add_shape(&circle, PyAPI::CIRCLE);
+}
+
+int scene_builder::add_polyline(float *x, float *y, float *z, int count,
+                                const PyAPI::Properties *properties)
+{
+    if (x == nullptr || y == nullptr || count < 1 || properties == nullptr)
+    {
+        std::cout << "A polyline needs points and properties\n";
+        return -1;
+    }
+    auto &polyline = polylines.emplace_back(
+        PyAPI::Polyline{ x, y, count, keep(*properties), z });
+    return add_shape(&polyline, PyAPI::POLYLINES);
+}
+
+int scene_builder::add_polylines(float *x, float *y, float *z,
+                                 const int *starts, int count,
+                                 const PyAPI::Properties *properties)
+{
+    if (x == nullptr || y == nullptr || starts == nullptr || count < 1
+        || properties == nullptr)
+    {
+        std::cout << "Polylines need points, their starts and properties\n";
+        return -1;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        if (starts[i] < 0 || starts[i + 1] <= starts[i])
+        {
+            std::cout << "Polyline " << i << " has no points\n";
+            return -1;
+        }
+    }
+
+    // One copy of the properties for all of them
+    auto *shared = keep(*properties);
+    const int first = static_cast<int>(shapes.size());
+    for (int i = 0; i < count; i++)
+    {
+        const int start = starts[i];
+        auto &polyline = polylines.emplace_back(PyAPI::Polyline{
+            x + start, y + start, starts[i + 1] - start, shared,
+            z != nullptr ? z + start : nullptr });
+        add_shape(&polyline, PyAPI::POLYLINES);
+    }
+    return first;
+}
+
+int scene_builder::add_instanced(int shape, float *transforms,
+                                 PyAPI::Color *instance_colors,
+                                 float *opacities, int count,
+                                 const PyAPI::Properties *properties)
+{
+    if (!valid_shapes(&shape, 1))
+        return -1;
+    if (transforms == nullptr || count < 1)
+    {
+        std::cout << "Instances need transforms\n";
+        return -1;
+    }
+
+    auto [base, type] = shapes[std::size_t(shape)];
+    PyAPI::Properties *kept = nullptr;
+    if (properties != nullptr)
+        kept = keep(*properties);
+    else
+        PyAPI::shape_visitor([&](auto *s) { kept = s->properties; }, base,
+                             type);
+
+    auto &shape_instances = instanced.emplace_back(PyAPI::Instanced{
+        base, type, transforms, instance_colors, opacities, count, kept });
+    return add_shape(&shape_instances, PyAPI::INSTANCED);
+}
+
+int scene_builder::add_parametric(const PyAPI::Instruction *x_code,
+                                  int x_length,
+                                  const PyAPI::Instruction *y_code,
+                                  int y_length, const float *values,
+                                  int param_count, float t_min, float t_max,
+                                  const PyAPI::Properties *properties)
+{
+    if (x_code == nullptr || y_code == nullptr || x_length < 1
+        || y_length < 1 || param_count < 0
+        || (param_count > 0 && values == nullptr) || properties == nullptr)
+    {
+        std::cout << "A curve needs its two expressions and properties\n";
+        return -1;
+    }
+
+    auto &x = code.emplace_back(x_code, x_code + x_length);
+    auto &y = code.emplace_back(y_code, y_code + y_length);
+    // Never empty, a curve without parameters still has an array
+    auto &kept_params = params.emplace_back(values, values + param_count);
+    kept_params.resize(std::size_t(std::max(param_count, 1)));
+
+    auto &curve = parametrics.emplace_back(PyAPI::Parametric{
+        x.data(), x_length, y.data(), y_length, kept_params.data(),
+        param_count, t_min, t_max, keep(*properties) });
+    return add_shape(&curve, PyAPI::PARAMETRIC);
+}
+
+int scene_builder::add_text(const char *font_path, const char *text,
+                            float size, const PyAPI::Properties *properties)
+{
+    if (font_path == nullptr || text == nullptr || properties == nullptr)
+    {
+        std::cout << "Text needs a font, a string and properties\n";
+        return -1;
+    }
+    const char *font = strings.emplace_back(font_path).c_str();
+    const char *utf8 = strings.emplace_back(text).c_str();
+    auto &shape =
+        texts.emplace_back(PyAPI::Text{ font, utf8, size, keep(*properties) });
+    return add_shape(&shape, PyAPI::TEXT);
+}
+
+int scene_builder::add_wait(float seconds)
+{
+    return add_element(&waits.emplace_back(PyAPI::Wait{ seconds }),
+                       PyAPI::WAIT);
+}
+
+int scene_builder::add_place(const int *handles, int count)
+{
+    if (!valid_shapes(handles, count))
+        return -1;
+
+    auto [objects, types] = keep_shapes(handles, count);
+    auto &place = places.emplace_back(PyAPI::Place{ objects, types, count });
+    return add_element(&place, PyAPI::PLACE);
+}
+
+int scene_builder::add_draw(const int *handles, int count, float seconds)
+{
+    if (!valid_shapes(handles, count))
+        return -1;
+
+    auto [objects, types] = keep_shapes(handles, count);
+    auto &draw =
+        draws.emplace_back(PyAPI::Draw{ objects, types, count, seconds });
+    return add_element(&draw, PyAPI::DRAW);
+}
+
+int scene_builder::add_morph(int src, int dest, float seconds)
+{
+    const int handles[] = { src, dest };
+    if (!valid_shapes(handles, 2))
+        return -1;
+
+    auto &morph = morphs.emplace_back(
+        PyAPI::Morph{ shapes[std::size_t(src)].first,
+                      shapes[std::size_t(dest)].first,
+                      shapes[std::size_t(src)].second,
+                      shapes[std::size_t(dest)].second, seconds });
+    return add_element(&morph, PyAPI::MORPH);
+}
+
+int scene_builder::add_camera_move(float *views, int view_count,
+                                   float seconds)
+{
+    if (views == nullptr || view_count < 1)
+    {
+        std::cout << "A camera move needs views\n";
+        return -1;
+    }
+    auto &move = camera_moves.emplace_back(
+        PyAPI::CameraMove{ views, view_count, seconds });
+    return add_element(&move, PyAPI::CAMERA_MOVE);
+}
+
+int scene_builder::add_particles(const PyAPI::Particles &emitter)
+{
+    if (emitter.properties == nullptr)
+    {
+        std::cout << "Particles need properties\n";
+        return -1;
+    }
+    auto &copy = particles.emplace_back(emitter);
+    copy.end_color = keep(emitter.end_color);
+    copy.properties = keep(*emitter.properties);
+    return add_element(&copy, PyAPI::PARTICLES);
+}
+
+int scene_builder::add_simultaneous(const int *handles, int count)
+{
+    if (count < 1 || handles == nullptr)
+    {
+        std::cout << "Simultaneous needs elements\n";
+        return -1;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        if (handles[i] < 0 || std::size_t(handles[i]) >= elements.size()
+            || !in_sequence[std::size_t(handles[i])])
+        {
+            std::cout << "Invalid or already grouped element " << handles[i]
+                      << "\n";
+            return -1;
+        }
+        // An element plays once, it can't be two children
+        if (std::find(handles, handles + i, handles[i]) != handles + i)
+        {
+            std::cout << "Element " << handles[i] << " is grouped twice\n";
+            return -1;
+        }
+    }
+
+    auto &objects = object_lists.emplace_back();
+    auto &types = element_type_lists.emplace_back();
+    for (int i = 0; i < count; i++)
+    {
+        const auto element = std::size_t(handles[i]);
+        objects.push_back(elements[element].elem);
+        types.push_back(elements[element].type);
+        in_sequence[element] = false;
+    }
+    auto &together = simultaneous.emplace_back(
+        PyAPI::Simultaneous{ objects.data(), types.data(), count });
+    return add_element(&together, PyAPI::SIMULTANEOUS);
+}
+
+PyAPI::Scene &scene_builder::scene()
+{
+    sequence.clear();
+    for (std::size_t i = 0; i < elements.size(); i++)
+        if (in_sequence[i])
+            sequence.push_back(elements[i]);
+
+    built = { sequence.data(), static_cast<int>(sequence.size()) };
+    return built;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../api_bindings.h"
+
+/*
+======================================
+Scenes built one call at a time
+
+A scene_builder owns the PyAPI structs of a scene and hands out integer
+handles for its shapes and elements, so a scene of many objects is built
+without nested arrays on the caller's side. Coordinates, transforms,
+instance colors and camera views are borrowed, not copied: those buffers
+must stay alive and unchanged as long as the builder. Properties, colors,
+strings and expression bytecode are small and copied.
+
+Elements are appended to the scene as they are added, the children of a
+Simultaneous leave it to play inside their parent. Adding returns -1 (with
+a message) for an invalid handle or argument.
+======================================
+*/
+
+class scene_builder
+{
+public:
+    scene_builder() = default;
+    scene_builder(const scene_builder &) = delete;
+    scene_builder &operator=(const scene_builder &) = delete;
+
+    // Shapes, their handles index the shapes of the builder
+    int add_circle(float radius, const PyAPI::Properties *properties);
+    int add_polyline(float *x, float *y, float *z, int count,
+                     const PyAPI::Properties *properties);
+    // `count` polylines in the same buffers, polyline i going through the
+    // points starts[i] to starts[i + 1] excluded: `starts` holds count + 1
+    // entries, the last one past the end of the last polyline. Their
+    // handles follow the one returned.
+    int add_polylines(float *x, float *y, float *z, const int *starts,
+                      int count, const PyAPI::Properties *properties);
+    // Without properties, those of `shape` are used
+    int add_instanced(int shape, float *transforms, PyAPI::Color *colors,
+                      float *opacities, int count,
+                      const PyAPI::Properties *properties);
+    int add_parametric(const PyAPI::Instruction *x_code, int x_length,
+                       const PyAPI::Instruction *y_code, int y_length,
+                       const float *params, int param_count, float t_min,
+                       float t_max, const PyAPI::Properties *properties);
+    int add_text(const char *font_path, const char *text, float size,
+                 const PyAPI::Properties *properties);
+
+    // Elements, their handles index the elements of the builder
+    int add_wait(float seconds);
+    int add_place(const int *shapes, int count);
+    int add_draw(const int *shapes, int count, float seconds);
+    int add_morph(int src, int dest, float seconds);
+    int add_camera_move(float *views, int view_count, float seconds);
+    int add_particles(const PyAPI::Particles &particles);
+    // Each element once, not already part of another Simultaneous
+    int add_simultaneous(const int *elements, int count);
+
+    // The elements in order, valid until the next call
+    PyAPI::Scene &scene();
+
+    std::size_t shape_count() const
+    {
+        return shapes.size();
+    }
+
+private:
+    PyAPI::Properties *keep(const PyAPI::Properties &properties);
+    PyAPI::Color *keep(const PyAPI::Color *color);
+    int add_shape(void *shape, PyAPI::ShapeType type);
+    int add_element(void *element, PyAPI::ElementType type);
+    bool valid_shapes(const int *handles, int count) const;
+    std::pair<void **, PyAPI::ShapeType *> keep_shapes(const int *handles,
+                                                       int count);
+
+    // Deques, the renderer holds pointers to their items
+    std::deque<PyAPI::Circle> circles;
+    std::deque<PyAPI::Polyline> polylines;
+    std::deque<PyAPI::Instanced> instanced;
+    std::deque<PyAPI::Parametric> parametrics;
+    std::deque<PyAPI::Text> texts;
+    std::deque<PyAPI::Properties> properties;
+    std::deque<PyAPI::Color> colors;
+    std::deque<std::string> strings;
+    std::deque<std::vector<PyAPI::Instruction>> code;
+    std::deque<std::vector<float>> params;
+
+    std::deque<PyAPI::Wait> waits;
+    std::deque<PyAPI::Place> places;
+    std::deque<PyAPI::Draw> draws;
+    std::deque<PyAPI::Morph> morphs;
+    std::deque<PyAPI::CameraMove> camera_moves;
+    std::deque<PyAPI::Particles> particles;
+    std::deque<PyAPI::Simultaneous> simultaneous;
+    std::deque<std::vector<void *>> object_lists;
+    std::deque<std::vector<PyAPI::ShapeType>> shape_type_lists;
+    std::deque<std::vector<PyAPI::ElementType>> element_type_lists;
+
+    std::vector<std::pair<void *, PyAPI::ShapeType>> shapes;
+    std::vector<PyAPI::SceneElement> elements;
+    std::vector<bool> in_sequence; // not the child of a Simultaneous
+    std::vector<PyAPI::SceneElement> sequence;
+    PyAPI::Scene built{ nullptr, 0 };
+};
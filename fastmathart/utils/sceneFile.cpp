@@ -0,0 +1,590 @@
+#include "sceneFile.h"
+
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <tuple>
+#include <type_traits>
+#include <typeinfo>
+#include <vector>
+
+#if defined(_WIN32) || defined(_WIN64)
+#define FMA_SCENE_MMAP 0
+#else
+#define FMA_SCENE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "hash.h"
+
+namespace scene_file
+{
+    static constexpr char file_magic[8] = { 'F', 'M', 'A', 'S',
+                                            'C', 'E', 'N', 'E' };
+    static constexpr std::uint32_t file_version = 1;
+    static constexpr std::uint32_t byte_order_mark = 0x01020304;
+    static constexpr std::size_t alignment = alignof(std::max_align_t);
+
+    // Anything that changes how the structs are laid out
+    static std::uint64_t layout_hash()
+    {
+        utils::hasher h;
+        h.add(sizeof(void *));
+        h.add(sizeof(PyAPI::Config));
+        h.add(sizeof(PyAPI::Camera));
+        h.add(sizeof(PyAPI::SceneElement));
+        h.add(sizeof(PyAPI::Scene));
+        h.add(sizeof(PyAPI::Wait));
+        h.add(sizeof(PyAPI::Place));
+        h.add(sizeof(PyAPI::Draw));
+        h.add(sizeof(PyAPI::Morph));
+        h.add(sizeof(PyAPI::Simultaneous));
+        h.add(sizeof(PyAPI::CameraMove));
+        h.add(sizeof(PyAPI::Particles));
+        h.add(sizeof(PyAPI::Color));
+        h.add(sizeof(PyAPI::Properties));
+        h.add(sizeof(PyAPI::Circle));
+        h.add(sizeof(PyAPI::Polyline));
+        h.add(sizeof(PyAPI::Instanced));
+        h.add(sizeof(PyAPI::Instruction));
+        h.add(sizeof(PyAPI::Parametric));
+        h.add(sizeof(PyAPI::Text));
+        h.add(sizeof(PyAPI::ElementType));
+        h.add(sizeof(PyAPI::ShapeType));
+        return h.digest();
+    }
+
+    /*
+    ======================================
+    Writing
+    ======================================
+    */
+
+    class writer
+    {
+    public:
+        writer()
+            : bytes(sizeof(header), 0)
+        { }
+
+        // Appends a copy of `count` objects, or finds the one already made
+        // of the same objects. Offset 0 (the header) stands for null.
+        template <class T>
+        std::pair<std::uint64_t, bool> put(const T *items, std::size_t count)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            if (items == nullptr || count == 0)
+                return { 0, false };
+
+            const auto key = std::make_tuple(
+                static_cast<const void *>(items), typeid(T).hash_code(), count);
+            if (auto found = written.find(key); found != written.end())
+                return { found->second, false };
+
+            const std::uint64_t at = pad();
+            bytes.resize(at + sizeof(T) * count);
+            std::memcpy(&bytes[at], items, sizeof(T) * count);
+            written.emplace(key, at);
+            return { at, true };
+        }
+
+        // Points the pointer stored at `slot` to the object at `target`
+        void link(std::uint64_t slot, std::uint64_t target)
+        {
+            const std::uintptr_t value(target);
+            std::memcpy(&bytes[slot], &value, sizeof(value));
+            if (target != 0)
+                relocations.push_back(slot);
+        }
+
+        std::uint64_t pad()
+        {
+            bytes.resize((bytes.size() + alignment - 1) / alignment
+                         * alignment);
+            return bytes.size();
+        }
+
+        std::vector<unsigned char> bytes;
+        std::vector<std::uint64_t> relocations;
+
+    private:
+        std::map<std::tuple<const void *, std::size_t, std::size_t>,
+                 std::uint64_t>
+            written;
+    };
+
+    static std::size_t count_of(int count)
+    {
+        return count > 0 ? static_cast<std::size_t>(count) : 0;
+    }
+
+    template <class T>
+    static std::uint64_t put_array(writer &w, const T *items, int count)
+    {
+        return w.put(items, count_of(count)).first;
+    }
+
+    static std::uint64_t put_string(writer &w, const char *text)
+    {
+        return text ? w.put(text, std::strlen(text) + 1).first : 0;
+    }
+
+    static std::uint64_t store(writer &w, const PyAPI::Color *color)
+    {
+        return w.put(color, 1).first;
+    }
+
+    static std::uint64_t store(writer &w, const PyAPI::Properties *props)
+    {
+        using PyAPI::Properties;
+        auto [at, fresh] = w.put(props, 1);
+        if (fresh)
+        {
+            w.link(at + offsetof(Properties, color), store(w, props->color));
+            w.link(at + offsetof(Properties, fill), store(w, props->fill));
+        }
+        return at;
+    }
+
+    static std::uint64_t store_shape(writer &w, void *shape,
+                                     PyAPI::ShapeType type);
+
+    static std::uint64_t store(writer &w, const PyAPI::Circle *circle)
+    {
+        using PyAPI::Circle;
+        auto [at, fresh] = w.put(circle, 1);
+        if (fresh)
+            w.link(at + offsetof(Circle, properties),
+                   store(w, circle->properties));
+        return at;
+    }
+
+    static std::uint64_t store(writer &w, const PyAPI::Polyline *polyline)
+    {
+        using PyAPI::Polyline;
+        auto [at, fresh] = w.put(polyline, 1);
+        if (fresh)
+        {
+            const int count = polyline->point_count;
+            w.link(at + offsetof(Polyline, x),
+                   put_array(w, polyline->x, count));
+            w.link(at + offsetof(Polyline, y),
+                   put_array(w, polyline->y, count));
+            w.link(at + offsetof(Polyline, z),
+                   put_array(w, polyline->z, count));
+            w.link(at + offsetof(Polyline, properties),
+                   store(w, polyline->properties));
+        }
+        return at;
+    }
+
+    static std::uint64_t store(writer &w, const PyAPI::Instanced *instanced)
+    {
+        using PyAPI::Instanced;
+        auto [at, fresh] = w.put(instanced, 1);
+        if (fresh)
+        {
+            const int count = instanced->instance_count;
+            w.link(at + offsetof(Instanced, shape),
+                   store_shape(w, instanced->shape, instanced->shape_type));
+            w.link(at + offsetof(Instanced, transforms),
+                   put_array(w, instanced->transforms, 6 * count));
+            w.link(at + offsetof(Instanced, colors),
+                   put_array(w, instanced->colors, count));
+            w.link(at + offsetof(Instanced, opacities),
+                   put_array(w, instanced->opacities, count));
+            w.link(at + offsetof(Instanced, properties),
+                   store(w, instanced->properties));
+        }
+        return at;
+    }
+
+    static std::uint64_t store(writer &w, const PyAPI::Parametric *curve)
+    {
+        using PyAPI::Parametric;
+        auto [at, fresh] = w.put(curve, 1);
+        if (fresh)
+        {
+            w.link(at + offsetof(Parametric, x_code),
+                   put_array(w, curve->x_code, curve->x_length));
+            w.link(at + offsetof(Parametric, y_code),
+                   put_array(w, curve->y_code, curve->y_length));
+            w.link(at + offsetof(Parametric, params),
+                   put_array(w, curve->params, curve->param_count));
+            w.link(at + offsetof(Parametric, properties),
+                   store(w, curve->properties));
+        }
+        return at;
+    }
+
+    static std::uint64_t store(writer &w, const PyAPI::Text *text)
+    {
+        using PyAPI::Text;
+        auto [at, fresh] = w.put(text, 1);
+        if (fresh)
+        {
+            w.link(at + offsetof(Text, font_path),
+                   put_string(w, text->font_path));
+            w.link(at + offsetof(Text, text), put_string(w, text->text));
+            w.link(at + offsetof(Text, properties),
+                   store(w, text->properties));
+        }
+        return at;
+    }
+
+    static std::uint64_t store_shape(writer &w, void *shape,
+                                     PyAPI::ShapeType type)
+    {
+        std::uint64_t at = 0;
+        if (shape != nullptr)
+            PyAPI::shape_visitor([&](auto *s) { at = store(w, s); }, shape,
+                                 type);
+        return at;
+    }
+
+    // obj_list and obj_types of Place and Draw
+    template <class T>
+    static void store_shape_list(writer &w, std::uint64_t at, const T &elem)
+    {
+        const auto [list, fresh] = w.put(elem.obj_list,
+                                         count_of(elem.obj_count));
+        if (fresh)
+        {
+            for (int i = 0; i < elem.obj_count; i++)
+                w.link(list + sizeof(void *) * static_cast<std::size_t>(i),
+                       store_shape(w, elem.obj_list[i], elem.obj_types[i]));
+        }
+        w.link(at + offsetof(T, obj_list), list);
+        w.link(at + offsetof(T, obj_types),
+               put_array(w, elem.obj_types, elem.obj_count));
+    }
+
+    static std::uint64_t store(writer &w, const PyAPI::Wait *wait)
+    {
+        return w.put(wait, 1).first;
+    }
+
+    static std::uint64_t store(writer &w, const PyAPI::Place *place)
+    {
+        auto [at, fresh] = w.put(place, 1);
+        if (fresh)
+            store_shape_list(w, at, *place);
+        return at;
+    }
+
+    static std::uint64_t store(writer &w, const PyAPI::Draw *draw)
+    {
+        auto [at, fresh] = w.put(draw, 1);
+        if (fresh)
+            store_shape_list(w, at, *draw);
+        return at;
+    }
+
+    static std::uint64_t store(writer &w, const PyAPI::Morph *morph)
+    {
+        using PyAPI::Morph;
+        auto [at, fresh] = w.put(morph, 1);
+        if (fresh)
+        {
+            w.link(at + offsetof(Morph, src),
+                   store_shape(w, morph->src, morph->src_type));
+            w.link(at + offsetof(Morph, dest),
+                   store_shape(w, morph->dest, morph->dest_type));
+        }
+        return at;
+    }
+
+    static std::uint64_t store(writer &w, const PyAPI::CameraMove *move)
+    {
+        using PyAPI::CameraMove;
+        auto [at, fresh] = w.put(move, 1);
+        if (fresh)
+            w.link(at + offsetof(CameraMove, views),
+                   put_array(w, move->views, 16 * move->view_count));
+        return at;
+    }
+
+    static std::uint64_t store(writer &w, const PyAPI::Particles *particles)
+    {
+        using PyAPI::Particles;
+        auto [at, fresh] = w.put(particles, 1);
+        if (fresh)
+        {
+            w.link(at + offsetof(Particles, end_color),
+                   store(w, particles->end_color));
+            w.link(at + offsetof(Particles, properties),
+                   store(w, particles->properties));
+        }
+        return at;
+    }
+
+    static std::uint64_t store_element(writer &w, void *elem,
+                                       PyAPI::ElementType type);
+
+    static std::uint64_t store(writer &w, const PyAPI::Simultaneous *group)
+    {
+        using PyAPI::Simultaneous;
+        auto [at, fresh] = w.put(group, 1);
+        if (!fresh)
+            return at;
+
+        const auto [list, fresh_list] = w.put(group->obj_list,
+                                              count_of(group->obj_count));
+        if (fresh_list)
+        {
+            for (int i = 0; i < group->obj_count; i++)
+                w.link(list + sizeof(void *) * static_cast<std::size_t>(i),
+                       store_element(w, group->obj_list[i],
+                                     group->obj_types[i]));
+        }
+        w.link(at + offsetof(Simultaneous, obj_list), list);
+        w.link(at + offsetof(Simultaneous, obj_types),
+               put_array(w, group->obj_types, group->obj_count));
+        return at;
+    }
+
+    static std::uint64_t store_element(writer &w, void *elem,
+                                       PyAPI::ElementType type)
+    {
+        std::uint64_t at = 0;
+        if (elem != nullptr)
+            PyAPI::element_visitor([&](auto *e) { at = store(w, e); }, elem,
+                                   type);
+        return at;
+    }
+
+    static std::uint64_t store(writer &w, const PyAPI::Scene *scene)
+    {
+        using PyAPI::Scene;
+        using PyAPI::SceneElement;
+        auto [at, fresh] = w.put(scene, 1);
+        if (!fresh)
+            return at;
+
+        const auto [elements, fresh_elements] = w.put(
+            scene->elements, count_of(scene->element_count));
+        if (fresh_elements)
+        {
+            for (int i = 0; i < scene->element_count; i++)
+            {
+                const auto &element = scene->elements[i];
+                w.link(elements
+                           + sizeof(SceneElement) * static_cast<std::size_t>(i)
+                           + offsetof(SceneElement, elem),
+                       store_element(w, element.elem, element.type));
+            }
+        }
+        w.link(at + offsetof(Scene, elements), elements);
+        return at;
+    }
+
+    static std::uint64_t store(writer &w, const PyAPI::Config *config)
+    {
+        using PyAPI::Config;
+        auto [at, fresh] = w.put(config, 1);
+        if (fresh)
+            w.link(at + offsetof(Config, camera), w.put(config->camera, 1).first);
+        return at;
+    }
+
+    bool save(const PyAPI::Scene &scene, const PyAPI::Config &config,
+              const std::string &path)
+    {
+        writer w;
+        header head{};
+        std::memcpy(head.magic, file_magic, sizeof(file_magic));
+        head.version = file_version;
+        head.byte_order = byte_order_mark;
+        head.layout = layout_hash();
+        head.config = store(w, &config);
+        head.scene = store(w, &scene);
+
+        head.relocations = w.pad();
+        head.relocation_count = w.relocations.size();
+        const std::size_t table_bytes =
+            w.relocations.size() * sizeof(std::uint64_t);
+        w.bytes.resize(head.relocations + table_bytes);
+        if (table_bytes > 0)
+            std::memcpy(&w.bytes[head.relocations], w.relocations.data(),
+                        table_bytes);
+        head.size = w.bytes.size();
+        std::memcpy(w.bytes.data(), &head, sizeof(head));
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(w.bytes.data()),
+                   static_cast<std::streamsize>(w.bytes.size()));
+        if (!file)
+        {
+            std::cout << "Cannot write the scene to " << path << "\n";
+            return false;
+        }
+        return true;
+    }
+
+    /*
+    ======================================
+    Loading
+    ======================================
+    */
+
+    mapped::~mapped()
+    {
+        close();
+    }
+
+    void mapped::close()
+    {
+#if FMA_SCENE_MMAP
+        if (is_mapped)
+            munmap(base, length);
+        else
+            delete[] base;
+#else
+        delete[] base;
+#endif
+        base = nullptr;
+        length = 0;
+        is_mapped = false;
+        scene_root = nullptr;
+        config_root = nullptr;
+    }
+
+    // Copy on write mapping of the file, or a copy of it where there is no
+    // mmap
+    static unsigned char *load_bytes(const std::string &path,
+                                     std::size_t &length, bool &is_mapped)
+    {
+#if FMA_SCENE_MMAP
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return nullptr;
+        struct stat info;
+        void *data = MAP_FAILED;
+        if (fstat(fd, &info) == 0 && info.st_size > 0)
+        {
+            length = static_cast<std::size_t>(info.st_size);
+            data = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                        fd, 0);
+        }
+        ::close(fd);
+        if (data == MAP_FAILED)
+            return nullptr;
+        is_mapped = true;
+        return static_cast<unsigned char *>(data);
+#else
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file)
+            return nullptr;
+        length = static_cast<std::size_t>(file.tellg());
+        auto *data = new unsigned char[length];
+        file.seekg(0);
+        if (!file.read(reinterpret_cast<char *>(data),
+                       static_cast<std::streamsize>(length)))
+        {
+            delete[] data;
+            return nullptr;
+        }
+        is_mapped = false;
+        return data;
+#endif
+    }
+
+    // What is wrong with the structure of the file, null if nothing
+    static const char *check(const unsigned char *data, std::size_t length)
+    {
+        if (length < sizeof(header))
+            return "truncated";
+        header head;
+        std::memcpy(&head, data, sizeof(head));
+
+        auto object_fits = [&](std::uint64_t at, std::size_t size) {
+            return at >= sizeof(header) && at % alignment == 0
+                && at <= length && size <= length - at;
+        };
+
+        if (std::memcmp(head.magic, file_magic, sizeof(file_magic)) != 0)
+            return "not a scene file";
+        if (head.version != file_version)
+            return "written by another version";
+        if (head.byte_order != byte_order_mark
+            || head.layout != layout_hash())
+            return "written for another architecture";
+        if (head.size != length)
+            return "truncated";
+        if (!object_fits(head.config, sizeof(PyAPI::Config))
+            || !object_fits(head.scene, sizeof(PyAPI::Scene)))
+            return "corrupted";
+        if (head.relocation_count
+                > (length - std::min<std::uint64_t>(head.relocations, length))
+                    / sizeof(std::uint64_t)
+            || !object_fits(head.relocations, 0))
+            return "corrupted";
+
+        for (std::uint64_t i = 0; i < head.relocation_count; i++)
+        {
+            std::uint64_t slot;
+            std::memcpy(&slot, data + head.relocations + i * sizeof(slot),
+                        sizeof(slot));
+            std::uintptr_t target;
+            if (slot % alignof(void *) != 0 || slot > length - sizeof(target))
+                return "corrupted";
+            std::memcpy(&target, data + slot, sizeof(target));
+            if (target == 0 || target >= length)
+                return "corrupted";
+        }
+        return nullptr;
+    }
+
+    bool mapped::open(const std::string &path)
+    {
+        close();
+        base = load_bytes(path, length, is_mapped);
+        if (base == nullptr)
+        {
+            std::cout << "Cannot read the scene file " << path << "\n";
+            return false;
+        }
+
+        if (const char *error = check(base, length))
+        {
+            std::cout << "Invalid scene file " << path << ": " << error
+                      << "\n";
+            close();
+            return false;
+        }
+
+        // Offsets to addresses, the pages of the pointers only are copied
+        header head;
+        std::memcpy(&head, base, sizeof(head));
+        for (std::uint64_t i = 0; i < head.relocation_count; i++)
+        {
+            std::uint64_t slot;
+            std::memcpy(&slot, base + head.relocations + i * sizeof(slot),
+                        sizeof(slot));
+            std::uintptr_t target;
+            std::memcpy(&target, base + slot, sizeof(target));
+            void *pointer = base + target;
+            std::memcpy(base + slot, &pointer, sizeof(pointer));
+        }
+
+        scene_root = reinterpret_cast<PyAPI::Scene *>(base + head.scene);
+        config_root = reinterpret_cast<PyAPI::Config *>(base + head.config);
+        return true;
+    }
+
+    PyAPI::Scene &mapped::scene() const
+    {
+        return *scene_root;
+    }
+
+    PyAPI::Config &mapped::config() const
+    {
+        return *config_root;
+    }
+
+} // namespace scene_file
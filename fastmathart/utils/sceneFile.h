@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "../api_bindings.h"
+
+/*
+======================================
+Binary scene files, rendered without Python by fma_render
+
+The file is the scene itself: every PyAPI struct and array is stored as it
+is laid out in memory, its pointers replaced by offsets from the start of
+the file. A relocation table lists where these pointers are, so loading is
+mapping the file copy on write and adding the base address to each of
+them. The points, transforms and other arrays are never read before the
+renderer needs them.
+
+It is tied to the ABI it was written with (pointer size, endianness and
+struct layouts), a file from another one is rejected. Objects shared by
+several elements are stored once and stay shared. Fonts are referenced by
+their path, not embedded. The structure of a file is checked on load, the
+counts in it are trusted: only render files written by save().
+======================================
+*/
+
+namespace scene_file
+{
+    struct header
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t byte_order; // 0x01020304 as written
+        std::uint64_t layout;     // hash of the pointer and struct sizes
+        std::uint64_t size;       // of the whole file
+        std::uint64_t config;     // offsets of the two roots
+        std::uint64_t scene;
+        std::uint64_t relocations; // offset of the table
+        std::uint64_t relocation_count;
+    };
+
+    // Writes `scene` and `config` to `path`, false (with a message) if it
+    // could not
+    bool save(const PyAPI::Scene &scene, const PyAPI::Config &config,
+              const std::string &path);
+
+    // A loaded file, the scene lives as long as it does
+    class mapped
+    {
+    public:
+        mapped() = default;
+        mapped(const mapped &) = delete;
+        mapped &operator=(const mapped &) = delete;
+        ~mapped();
+
+        // False (with a message) for a missing, truncated or foreign file
+        bool open(const std::string &path);
+
+        PyAPI::Scene &scene() const;
+        PyAPI::Config &config() const;
+
+    private:
+        void close();
+
+        unsigned char *base = nullptr;
+        std::size_t length = 0;
+        bool is_mapped = false; // else read into a heap buffer
+        PyAPI::Scene *scene_root = nullptr;
+        PyAPI::Config *config_root = nullptr;
+    };
+
+} // namespace scene_file
@@ -0,0 +1,190 @@
+#include "trace.h"
+
+#ifdef FMA_ENABLE_TRACING
+
+#    include <array>
+#    include <atomic>
+#    include <chrono>
+#    include <cstdlib>
+#    include <fmt/core.h>
+#    include <fstream>
+#    include <iostream>
+#    include <memory>
+#    include <mutex>
+#    include <string>
+#    include <vector>
+
+namespace trace
+{
+    struct event
+    {
+        const char *name;
+        const char *arg_name;
+        std::int64_t arg;
+        std::int64_t start_ns;
+        std::int64_t duration_ns;
+        category cat;
+    };
+
+    struct thread_buffer
+    {
+        int tid;
+        std::vector<event> events;
+        std::vector<std::pair<std::int64_t, std::array<std::int64_t,
+                                                       COUNTER_COUNT>>>
+            counter_samples;
+    };
+
+    static const char *category_names[] = { "scene", "element", "frame",
+                                            "stage" };
+    static const char *counter_names[] = { "segments_rasterized",
+                                           "pixels_written", "bytes_piped",
+                                           "shapes_culled" };
+
+    static std::mutex registry_mutex;
+    static std::vector<std::shared_ptr<thread_buffer>> registry;
+    static int next_tid = 1;
+    static std::atomic<std::int64_t> totals[COUNTER_COUNT];
+
+    static std::int64_t now_ns()
+    {
+        static const auto epoch = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now() - epoch)
+            .count();
+    }
+
+    static thread_buffer &local_buffer()
+    {
+        thread_local std::shared_ptr<thread_buffer> buffer = [] {
+            auto buf = std::make_shared<thread_buffer>();
+            std::lock_guard lock(registry_mutex);
+            buf->tid = next_tid++;
+            registry.push_back(buf);
+            return buf;
+        }();
+        return *buffer;
+    }
+
+    thread_counters &local_counters()
+    {
+        thread_local thread_counters counters;
+        return counters;
+    }
+
+    void flush_counters()
+    {
+        auto &pending = local_counters().pending;
+        std::array<std::int64_t, COUNTER_COUNT> snapshot;
+
+        for (int i = 0; i < COUNTER_COUNT; i++)
+        {
+            snapshot[i] = totals[i].fetch_add(pending[i],
+                                              std::memory_order_relaxed)
+                + pending[i];
+            pending[i] = 0;
+        }
+
+        local_buffer().counter_samples.emplace_back(now_ns(), snapshot);
+    }
+
+    scope::scope(const char *name, category cat, const char *arg_name,
+                 std::int64_t arg)
+        : name(name)
+        , arg_name(arg_name)
+        , arg(arg)
+        , start_ns(now_ns())
+        , cat(cat)
+    { }
+
+    scope::~scope()
+    {
+        local_buffer().events.push_back(
+            { name, arg_name, arg, start_ns, now_ns() - start_ns, cat });
+
+        if (cat == category::frame || cat == category::element
+            || cat == category::scene)
+            flush_counters();
+    }
+
+    // Forgets what was written, so that the next render of the process
+    // starts an empty trace. Buffers only the registry holds belong to
+    // threads that have exited, e.g. the children of a Simultaneous.
+    static void reset_trace()
+    {
+        std::erase_if(registry, [](const std::shared_ptr<thread_buffer> &b) {
+            return b.use_count() == 1;
+        });
+        for (auto &buffer : registry)
+        {
+            buffer->events.clear();
+            buffer->counter_samples.clear();
+        }
+        for (auto &total : totals)
+            total = 0;
+    }
+
+    void write_chrome_trace(std::string_view path)
+    {
+        std::string filename(path);
+        if (filename.empty())
+        {
+            const char *env = std::getenv("FMA_TRACE_FILE");
+            filename = env ? env : "fma_trace.json";
+        }
+
+        std::lock_guard lock(registry_mutex);
+        std::ofstream out(filename);
+        if (!out)
+        {
+            fmt::print(stderr, "Cannot write trace file {}\n", filename);
+            reset_trace();
+            return;
+        }
+
+        // Timestamps are in microseconds in the trace event format
+        out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+        bool first = true;
+        auto separator = [&] {
+            if (!first)
+                out << ",\n";
+            first = false;
+        };
+
+        for (auto &buffer : registry)
+        {
+            for (auto &ev : buffer->events)
+            {
+                separator();
+                out << fmt::format(
+                    "{{\"name\": \"{}\", \"cat\": \"{}\", \"ph\": \"X\", "
+                    "\"pid\": 1, \"tid\": {}, \"ts\": {:.3f}, \"dur\": {:.3f}",
+                    ev.name, category_names[static_cast<int>(ev.cat)],
+                    buffer->tid, ev.start_ns / 1e3, ev.duration_ns / 1e3);
+                if (ev.arg_name)
+                    out << fmt::format(", \"args\": {{\"{}\": {}}}",
+                                       ev.arg_name, ev.arg);
+                out << "}";
+            }
+
+            for (auto &[ts, values] : buffer->counter_samples)
+            {
+                for (int i = 0; i < COUNTER_COUNT; i++)
+                {
+                    separator();
+                    out << fmt::format(
+                        "{{\"name\": \"{}\", \"ph\": \"C\", \"pid\": 1, "
+                        "\"ts\": {:.3f}, \"args\": {{\"value\": {}}}}}",
+                        counter_names[i], ts / 1e3, values[i]);
+                }
+            }
+        }
+        out << "\n]}\n";
+        reset_trace();
+
+        std::cout << "Trace written to " << filename << "\n";
+    }
+
+} // namespace trace
+
+#endif
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+/*
+======================================
+Scoped tracing, exported as Chrome trace JSON (chrome://tracing, Perfetto)
+
+Only compiled in with -DFMA_ENABLE_TRACING (cmake -DENABLE_TRACING=ON),
+otherwise every macro below expands to nothing.
+======================================
+*/
+
+namespace trace
+{
+    enum class category
+    {
+        scene = 0,
+        element,
+        frame,
+        stage
+    };
+
+    enum counter
+    {
+        segments_rasterized = 0,
+        pixels_written,
+        bytes_piped,
+        shapes_culled, // placements skipped or drawn as a dot
+        COUNTER_COUNT
+    };
+
+#ifdef FMA_ENABLE_TRACING
+    struct thread_counters
+    {
+        std::int64_t pending[COUNTER_COUNT] = {};
+    };
+
+    thread_counters &local_counters();
+
+    inline void count(counter c, std::int64_t delta)
+    {
+        local_counters().pending[c] += delta;
+    }
+
+    // Publish this thread's pending counts and record the global totals
+    void flush_counters();
+
+    class scope
+    {
+    public:
+        scope(const char *name, category cat, const char *arg_name = nullptr,
+              std::int64_t arg = 0);
+        ~scope();
+
+        scope(const scope &) = delete;
+        scope &operator=(const scope &) = delete;
+
+    private:
+        const char *name;
+        const char *arg_name;
+        std::int64_t arg;
+        std::int64_t start_ns;
+        category cat;
+    };
+
+    // Write every event recorded since the last call, the output file
+    // defaults to $FMA_TRACE_FILE or "fma_trace.json"
+    void write_chrome_trace(std::string_view path = {});
+#endif
+
+} // namespace trace
+
+#ifdef FMA_ENABLE_TRACING
+#    define FMA_TRACE_CONCAT_IMPL(a, b) a##b
+#    define FMA_TRACE_CONCAT(a, b) FMA_TRACE_CONCAT_IMPL(a, b)
+#    define FMA_TRACE_SCOPE(name, cat)                                         \
+        trace::scope FMA_TRACE_CONCAT(trace_scope_, __LINE__)(                 \
+            name, trace::category::cat)
+#    define FMA_TRACE_SCOPE_ARG(name, cat, arg_name, arg)                      \
+        trace::scope FMA_TRACE_CONCAT(trace_scope_, __LINE__)(                 \
+            name, trace::category::cat, arg_name,                              \
+            static_cast<std::int64_t>(arg))
+#    define FMA_TRACE_COUNT(counter, delta)                                    \
+        trace::count(trace::counter, static_cast<std::int64_t>(delta))
+#    define FMA_TRACE_WRITE() trace::write_chrome_trace()
+#else
+#    define FMA_TRACE_SCOPE(name, cat) ((void)0)
+#    define FMA_TRACE_SCOPE_ARG(name, cat, arg_name, arg) ((void)0)
+#    define FMA_TRACE_COUNT(counter, delta) ((void)0)
+#    define FMA_TRACE_WRITE() ((void)0)
+#endif
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <atomic>
+
+namespace utils
+{
+    // Blocks until the counter satisfies `done`
+    template <class T, class Predicate>
+    void wait_until(const std::atomic<T> &counter, Predicate done)
+    {
+        for (T value = counter.load(); !done(value); value = counter.load())
+            counter.wait(value);
+    }
+} // namespace utils
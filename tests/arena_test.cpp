@@ -0,0 +1,209 @@
+#include <doctest/doctest.h>
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "../fastmathart/math/bezier.h"
+#include "../fastmathart/math/simplify.h"
+#include "../fastmathart/morph.h"
+#include "../fastmathart/raster.h"
+#include "../fastmathart/render.h"
+#include "../fastmathart/utils/arena.h"
+
+// Every heap allocation of the test binary goes through here, the tests
+// only compare it before and after their steady state
+static std::atomic<long> heap_allocations{ 0 };
+
+void *operator new(std::size_t size)
+{
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+// Counts what goes through it, the memory itself comes from the heap
+class counting_resource : public std::pmr::memory_resource
+{
+public:
+    long allocations = 0;
+
+private:
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        allocations++;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void *p, std::size_t bytes,
+                       std::size_t alignment) override
+    {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(
+        const std::pmr::memory_resource &other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+static math::BezierPath make_square(std::pmr::memory_resource *resource,
+                                    float size)
+{
+    math::BezierPath path(resource);
+    path.addCurve(math::CubicBezier::straightLine({ -size, -size, 0 },
+                                                  { size, -size, 0 }));
+    path.addCurve(math::CubicBezier::straightLine({ size, -size, 0 },
+                                                  { size, size, 0 }));
+    path.addCurve(math::CubicBezier::straightLine({ size, size, 0 },
+                                                  { -size, size, 0 }));
+    path.addCurve(math::CubicBezier::straightLine({ -size, size, 0 },
+                                                  { -size, -size, 0 }));
+    return path;
+}
+
+TEST_CASE("Arena reuses its blocks after reset")
+{
+    utils::frame_arena arena(256);
+
+    for (int frame = 0; frame < 3; frame++)
+    {
+        for (int i = 0; i < 20; i++)
+        {
+            void *p = arena.allocate(48, 16);
+            CHECK(reinterpret_cast<std::uintptr_t>(p) % 16 == 0);
+        }
+        CHECK(arena.bytes_used() >= 20 * 48);
+        CHECK(arena.block_count() == 4);
+        arena.reset();
+        CHECK(arena.bytes_used() == 0);
+    }
+
+    // Larger than a block, gets a block of its own
+    CHECK(arena.allocate(1000, 8) != nullptr);
+    CHECK(arena.block_count() == 5);
+}
+
+TEST_CASE("Steady state morph frames allocate nothing")
+{
+    counting_resource resource;
+    pixel_buffer_t frame(64, 64);
+    const pixel_writer<frame_format, blend_mode::replace> writer(
+        color_t<RGB_8>(255, 128, 0));
+
+    // The outlines of the Morph element, flattened once
+    auto src = make_square(&resource, 0.5f);
+    auto dest = make_square(&resource, 0.8f);
+    math::alignPaths(src, dest);
+    const morph_outline outline =
+        flatten_aligned(src, dest, 0.005f, &resource);
+    std::pmr::vector<math::fvec3> points(&resource);
+
+    auto render_frame = [&](float t) {
+        interpolate_outline(outline, t, points);
+        frame.clear();
+        render_polyline(points.data(), points.size(),
+                        math::affine2::identity(), 3, frame, writer);
+    };
+
+    // Warms up the point storage and the rasterizer scratch space
+    render_frame(0.0f);
+    const long before = resource.allocations;
+    const long heap_before = heap_allocations;
+    for (int i = 1; i <= 10; i++)
+        render_frame(i / 10.0f);
+
+    CHECK(resource.allocations == before);
+    CHECK(heap_allocations == heap_before);
+    CHECK(frame.get_pixel(32, 32 - 26).r == 255);
+}
+
+TEST_CASE("Simplifying again allocates nothing")
+{
+    std::vector<math::fvec3> wave, out;
+    for (int i = 0; i < 1000; i++)
+        wave.emplace_back(float(i) / 500.0f - 1.0f,
+                          0.5f * std::sin(float(i) / 50.0f), 0.0f);
+
+    math::simplify_polyline(wave.data(), wave.size(), 0.001f, out);
+    const std::size_t kept = out.size();
+    const long before = heap_allocations;
+    for (int i = 0; i < 10; i++)
+    {
+        out.clear();
+        math::simplify_polyline(wave.data(), wave.size(), 0.001f, out);
+    }
+
+    CHECK(heap_allocations == before);
+    CHECK(out.size() == kept);
+    CHECK(kept < wave.size());
+}
+
+TEST_CASE("Morph frames over a scene allocate nothing")
+{
+    // Frames written from the rendering thread, without ffmpeg or the cache
+    const char *names[] = { "FMA_ENCODER", "FMA_NO_CACHE", "FMA_ENCODER_QUEUE" };
+    const char *values[] = { "null", "1", "0" };
+    std::string saved[3];
+    bool was_set[3];
+    for (int i = 0; i < 3; i++)
+    {
+        const char *value = std::getenv(names[i]);
+        was_set[i] = value != nullptr;
+        saved[i] = value ? value : "";
+        setenv(names[i], values[i], 1);
+    }
+
+    PyAPI::Color white{ 1.0f, 1.0f, 1.0f };
+    PyAPI::Properties props{ 0.0f, 0.0f, 0.0f, &white, 0.02f, nullptr, 1.0f };
+    PyAPI::Circle placed{ 0.3f, &props }, circle{ 0.5f, &props };
+    float xs[] = { -0.5f, 0.5f, 0.5f, -0.5f, -0.5f };
+    float ys[] = { -0.5f, -0.5f, 0.5f, 0.5f, -0.5f };
+    PyAPI::Polyline square{ xs, ys, 5, &props, nullptr };
+    void *objects[] = { &placed };
+    PyAPI::ShapeType types[] = { PyAPI::CIRCLE };
+    PyAPI::Place place{ objects, types, 1 };
+    PyAPI::Config config{ 64, 48, 24, nullptr };
+
+    // Each frame redraws the placed circle under the morph, a longer Morph
+    // only has more of them
+    auto render_allocations = [&](float seconds) {
+        PyAPI::Morph morph{ &circle, &square, PyAPI::CIRCLE, PyAPI::POLYLINES,
+                            seconds };
+        PyAPI::SceneElement elements[] = {
+            { PyAPI::PLACE, &place },
+            { PyAPI::MORPH, &morph },
+        };
+        PyAPI::Scene scene{ elements, 2 };
+        const long before = heap_allocations;
+        render_scene(scene, config, "morph.mp4");
+        return heap_allocations - before;
+    };
+
+    render_allocations(1.0f);
+    const long short_morph = render_allocations(1.0f);
+    CHECK(render_allocations(3.0f) == short_morph);
+
+    for (int i = 0; i < 3; i++)
+    {
+        if (was_set[i])
+            setenv(names[i], saved[i].c_str(), 1);
+        else
+            unsetenv(names[i]);
+    }
+}
@@ -28,4 +28,33 @@ TEST_CASE("Bezier curve")
 
     alignPaths(path, path2);
     CHECK(path.size() == path2.size());
-}
\ No newline at end of file
+}
+TEST_CASE("Flattening steps follow the tolerance")
+{
+    using namespace math;
+
+    CubicBezier line{ { 0.0f, 0.0f, 0.0f },
+                      { 1.0f, 0.0f, 0.0f },
+                      { 2.0f, 0.0f, 0.0f },
+                      { 3.0f, 0.0f, 0.0f } };
+    CHECK(flatten_steps(line, 0.01f, 64) == 1);
+
+    CubicBezier curve{ { 0.0f, 0.0f, 0.0f },
+                       { 1.0f, 1.0f, 0.0f },
+                       { 2.0f, 1.0f, 0.0f },
+                       { 3.0f, 0.0f, 0.0f } };
+    const int coarse = flatten_steps(curve, 0.01f, 256);
+    const int fine = flatten_steps(curve, 0.0001f, 256);
+    CHECK(coarse > 1);
+    CHECK(fine >= 9 * coarse); // n grows as 1 / sqrt(tolerance)
+    CHECK(flatten_steps(curve, 0.0f, 64) == 64);
+
+    // Every step midpoint is within the tolerance of the chord
+    for (int i = 0; i < coarse; i++)
+    {
+        const float t0 = float(i) / coarse, t1 = float(i + 1) / coarse;
+        CHECK(segment_distance2(curve.valueAt(0.5f * (t0 + t1)),
+                                curve.valueAt(t0), curve.valueAt(t1))
+              <= 0.01f * 0.01f);
+    }
+}
@@ -0,0 +1,197 @@
+#include <doctest/doctest.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fmt/core.h>
+#include <fstream>
+#include <string>
+
+#include "../fastmathart/utils/elementCache.h"
+
+// Key of an element on its own, after `previous`
+static std::uint64_t key_of(std::uint64_t previous, const auto &elem)
+{
+    shape_ids ids;
+    return hash_element(previous, elem, ids);
+}
+
+// Chained keys of the elements
+static std::uint64_t scene_key(PyAPI::SceneElement *elements, int count)
+{
+    std::uint64_t key = 0;
+    shape_ids ids;
+    for (int i = 0; i < count; i++)
+        PyAPI::element_visitor(
+            [&](auto *elem) { key = hash_element(key, *elem, ids); },
+            elements[i].elem, elements[i].type);
+    return key;
+}
+
+TEST_CASE("Element cache keys")
+{
+    PyAPI::Color color{ 0.3f, 0.6f, 0.8f };
+    PyAPI::Properties props{ 0.0f, 0.0f, 0.0f, &color, 0.01f, nullptr, 1.0f };
+    PyAPI::Circle circle{ 0.5f, &props };
+
+    void *objects[] = { &circle };
+    PyAPI::ShapeType types[] = { PyAPI::CIRCLE };
+    PyAPI::Draw draw{ objects, types, 1, 2.0f };
+
+    const auto key = key_of(1, draw);
+
+    // Stable for the same content, whatever the addresses
+    PyAPI::Color color_copy = color;
+    PyAPI::Properties props_copy{ 0.0f, 0.0f, 0.0f, &color_copy, 0.01f,
+                                  nullptr, 1.0f };
+    PyAPI::Circle circle_copy{ 0.5f, &props_copy };
+    void *objects_copy[] = { &circle_copy };
+    PyAPI::Draw draw_copy{ objects_copy, types, 1, 2.0f };
+    CHECK(key_of(1, draw_copy) == key);
+
+    // Depends on the incoming state, the shapes and their properties
+    CHECK(key_of(2, draw) != key);
+
+    circle_copy.radius = 0.6f;
+    CHECK(key_of(1, draw_copy) != key);
+    circle_copy.radius = 0.5f;
+
+    color_copy.g = 0.7f;
+    CHECK(key_of(1, draw_copy) != key);
+    color_copy.g = 0.6f;
+
+    draw_copy.seconds = 3.0f;
+    CHECK(key_of(1, draw_copy) != key);
+
+    PyAPI::Wait wait{ 2.0f };
+    CHECK(key_of(1, wait) != key_of(1, PyAPI::Wait{ 1.0f }));
+}
+
+TEST_CASE("Element cache keys tell shared shapes from equal ones")
+{
+    PyAPI::Color color{ 0.3f, 0.6f, 0.8f };
+    PyAPI::Properties props{ 0.0f, 0.0f, 0.0f, &color, 0.01f, nullptr, 1.0f };
+    PyAPI::Circle a{ 0.5f, &props }, b{ 0.5f, &props }, c{ 0.5f, &props };
+    float xs[] = { -0.5f, 0.5f }, ys[] = { 0.0f, 0.0f };
+    PyAPI::Polyline line{ xs, ys, 2, &props, nullptr };
+    PyAPI::ShapeType types[] = { PyAPI::CIRCLE, PyAPI::CIRCLE };
+
+    // The same circle placed twice is one shape of the scene
+    void *twice[] = { &a, &a }, *both[] = { &a, &b }, *other[] = { &b, &c };
+    PyAPI::Place place_twice{ twice, types, 2 }, place_both{ both, types, 2 },
+        place_other{ other, types, 2 };
+    PyAPI::SceneElement twice_scene[] = { { PyAPI::PLACE, &place_twice } };
+    PyAPI::SceneElement both_scene[] = { { PyAPI::PLACE, &place_both } };
+    PyAPI::SceneElement other_scene[] = { { PyAPI::PLACE, &place_other } };
+    CHECK(scene_key(twice_scene, 1) != scene_key(both_scene, 1));
+    CHECK(scene_key(both_scene, 1) == scene_key(other_scene, 1));
+
+    // A Morph takes out its own source, not the equal circle next to it
+    PyAPI::Morph first{ &a, &line, PyAPI::CIRCLE, PyAPI::POLYLINES, 1.0f };
+    PyAPI::Morph second{ &b, &line, PyAPI::CIRCLE, PyAPI::POLYLINES, 1.0f };
+    PyAPI::Morph moved{ &c, &line, PyAPI::CIRCLE, PyAPI::POLYLINES, 1.0f };
+    PyAPI::SceneElement morph_first[] = { { PyAPI::PLACE, &place_both },
+                                          { PyAPI::MORPH, &first } };
+    PyAPI::SceneElement morph_second[] = { { PyAPI::PLACE, &place_both },
+                                           { PyAPI::MORPH, &second } };
+    PyAPI::SceneElement morph_moved[] = { { PyAPI::PLACE, &place_other },
+                                          { PyAPI::MORPH, &moved } };
+    CHECK(scene_key(morph_first, 2) != scene_key(morph_second, 2));
+    CHECK(scene_key(morph_second, 2) == scene_key(morph_moved, 2));
+}
+
+TEST_CASE("The element cache is off unless given a directory")
+{
+    const char *dir = std::getenv("FMA_CACHE_DIR");
+    const std::string saved_dir = dir ? dir : "";
+    const char *no_cache = std::getenv("FMA_NO_CACHE");
+    const std::string saved_no_cache = no_cache ? no_cache : "";
+    unsetenv("FMA_CACHE_DIR");
+    unsetenv("FMA_NO_CACHE");
+
+    PyAPI::Config config{ 64, 48, 24, nullptr };
+    CHECK_FALSE(element_cache(config).enabled());
+
+    if (dir != nullptr)
+        setenv("FMA_CACHE_DIR", saved_dir.c_str(), 1);
+    if (no_cache != nullptr)
+        setenv("FMA_NO_CACHE", saved_no_cache.c_str(), 1);
+}
+
+TEST_CASE("The element cache evicts the least recently used entries")
+{
+    const auto directory =
+        std::filesystem::temp_directory_path() / "fma_cache_trim_test";
+    std::filesystem::remove_all(directory);
+    setenv("FMA_CACHE_DIR", directory.string().c_str(), 1);
+    setenv("FMA_CACHE_SIZE", "1", 1);
+    const char *no_cache = std::getenv("FMA_NO_CACHE");
+    const std::string saved_no_cache = no_cache ? no_cache : "";
+    unsetenv("FMA_NO_CACHE");
+
+    PyAPI::Config config{ 64, 48, 24, nullptr };
+    element_cache cache(config);
+    REQUIRE(cache.enabled());
+
+    // Three entries of 600 KB, the first one reused last
+    pixel_buffer_t canvas(64, 48);
+    canvas.clear();
+    const auto now = std::filesystem::file_time_type::clock::now();
+    for (std::uint64_t key = 1; key <= 3; key++)
+    {
+        cache.store_canvas(key, canvas, true);
+        std::ofstream(cache.video_path(key), std::ios::binary)
+            << std::string(600 << 10, 'v');
+        for (auto path : { directory / fmt::format("{:016x}.rgb", key),
+                           std::filesystem::path(cache.video_path(key)) })
+            std::filesystem::last_write_time(
+                path, now - std::chrono::hours(4 - key));
+    }
+    cache.touch(1);
+
+    cache.trim();
+    CHECK(cache.contains(1));
+    CHECK(cache.has_video(1));
+    CHECK_FALSE(cache.contains(2));
+    CHECK_FALSE(cache.has_video(2));
+    CHECK_FALSE(cache.contains(3));
+
+    unsetenv("FMA_CACHE_DIR");
+    unsetenv("FMA_CACHE_SIZE");
+    if (no_cache != nullptr)
+        setenv("FMA_NO_CACHE", saved_no_cache.c_str(), 1);
+    std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("Element cache entries are only reused with their video")
+{
+    const auto directory =
+        std::filesystem::temp_directory_path() / "fma_cache_video_test";
+    std::filesystem::remove_all(directory);
+    setenv("FMA_CACHE_DIR", directory.string().c_str(), 1);
+    const char *no_cache = std::getenv("FMA_NO_CACHE");
+    const std::string saved_no_cache = no_cache ? no_cache : "";
+    unsetenv("FMA_NO_CACHE");
+
+    PyAPI::Config config{ 64, 48, 24, nullptr };
+    element_cache cache(config);
+    REQUIRE(cache.enabled());
+
+    pixel_buffer_t canvas(64, 48);
+    canvas.clear();
+    cache.store_canvas(1, canvas, false);
+    cache.store_canvas(2, canvas, true);
+    CHECK(cache.contains(1));
+    CHECK_FALSE(cache.contains(2));
+
+    std::ofstream(cache.video_path(2), std::ios::binary) << "video";
+    CHECK(cache.contains(2));
+
+    pixel_buffer_t loaded(64, 48);
+    CHECK(cache.load_canvas(2, loaded));
+
+    unsetenv("FMA_CACHE_DIR");
+    if (no_cache != nullptr)
+        setenv("FMA_NO_CACHE", saved_no_cache.c_str(), 1);
+    std::filesystem::remove_all(directory);
+}
@@ -0,0 +1,85 @@
+#include <doctest/doctest.h>
+
+#include <cstdio>
+#include <vector>
+
+#include "../fastmathart/utils/encoder.h"
+
+TEST_CASE("Encoder writes the frames in order, whatever the queue depth")
+{
+    video_buffer_t video(5, 3, 12);
+    for (int f = 0; f < video.frames; f++)
+        video.get_frame(f).clear({ static_cast<std::uint8_t>(f * 20), 7,
+                                   static_cast<std::uint8_t>(255 - f) });
+
+    for (std::size_t depth : { 0, 1, 4 })
+    {
+        // Left open for the checks
+        std::FILE *file = std::tmpfile();
+        REQUIRE(file != nullptr);
+
+        async_encoder encoder(depth);
+        encoder.open([file] {
+            return async_encoder::output{ file,
+                                          [](std::FILE *) { return 0; } };
+        });
+        for (int f = 0; f < video.frames; f++)
+            encoder.push(video.get_frame(f));
+        bool closed = false;
+        encoder.close([&](bool ok) { closed = ok; });
+        encoder.drain();
+        encoder.finish();
+        CHECK(closed);
+
+        const std::size_t frame_bytes = 5 * 3 * 3;
+        CHECK(encoder.bytes_written() == frame_bytes * 12);
+
+        std::vector<std::uint8_t> bytes(frame_bytes * 12);
+        std::rewind(file);
+        REQUIRE(std::fread(bytes.data(), 1, bytes.size(), file)
+                == bytes.size());
+        for (int f = 0; f < video.frames; f++)
+        {
+            const auto *pixel = &bytes[frame_bytes * std::size_t(f) + 9];
+            CHECK(pixel[0] == f * 20);
+            CHECK(pixel[1] == 7);
+            CHECK(pixel[2] == 255 - f);
+        }
+        std::fclose(file);
+    }
+
+    // No output, the frames are dropped
+    async_encoder dropping(2);
+    dropping.open([] { return async_encoder::output(); });
+    dropping.push(video.get_frame(0));
+    bool dropped = false;
+    dropping.close([&](bool ok) { dropped = !ok; });
+    dropping.finish();
+    CHECK(dropping.bytes_written() == 0);
+    CHECK(dropped);
+}
+
+TEST_CASE("Encoder reports outputs that fail to close")
+{
+    video_buffer_t video(4, 4, 2);
+    video.get_frame(0).clear();
+    video.get_frame(1).clear();
+
+    for (std::size_t depth : { 0, 2 })
+    {
+        // As a pipe to an encoder exiting with an error
+        async_encoder encoder(depth);
+        encoder.open([] {
+            return async_encoder::output{ std::tmpfile(), [](std::FILE *file) {
+                                             std::fclose(file);
+                                             return 1;
+                                         } };
+        });
+        encoder.push(video.get_frame(0));
+        encoder.push(video.get_frame(1));
+        bool closed = true;
+        encoder.close([&](bool ok) { closed = ok; });
+        encoder.finish();
+        CHECK_FALSE(closed);
+    }
+}
@@ -0,0 +1,171 @@
+#include <doctest/doctest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "../fastmathart/math/expression.h"
+
+using namespace math;
+
+TEST_CASE("Bytecode evaluates like the expression it encodes")
+{
+    // a * sin(t) + exp(-t) / sqrt(abs(t) + 1)
+    const instruction code[] = {
+        { opcode::parameter, 0 }, { opcode::variable, 0 }, { opcode::sin, 0 },
+        { opcode::mul, 0 },       { opcode::variable, 0 }, { opcode::neg, 0 },
+        { opcode::exp, 0 },       { opcode::variable, 0 }, { opcode::abs, 0 },
+        { opcode::constant, 1 },  { opcode::add, 0 },      { opcode::sqrt, 0 },
+        { opcode::div, 0 },       { opcode::add, 0 },
+    };
+    const expression f(code, std::size(code), 1);
+    REQUIRE(f.valid());
+
+    const float params[] = { 0.75f };
+
+    // More values than one batch
+    std::vector<float> t(1000), out(t.size());
+    for (std::size_t i = 0; i < t.size(); i++)
+        t[i] = -5.0f + 10.0f * i / float(t.size());
+    f.evaluate(t.data(), t.size(), params, out.data());
+
+    for (std::size_t i = 0; i < t.size(); i++)
+    {
+        const float x = t[i];
+        const float expected = 0.75f * std::sin(x)
+            + std::exp(-x) / std::sqrt(std::abs(x) + 1.0f);
+        CHECK(out[i] == doctest::Approx(expected).epsilon(1e-5));
+    }
+}
+
+TEST_CASE("Malformed bytecode is rejected")
+{
+    const instruction underflow[] = { { opcode::variable, 0 },
+                                      { opcode::add, 0 } };
+    CHECK_FALSE(expression(underflow, 2, 0).valid());
+
+    const instruction leftover[] = { { opcode::variable, 0 },
+                                     { opcode::variable, 0 } };
+    CHECK_FALSE(expression(leftover, 2, 0).valid());
+
+    const instruction bad_param[] = { { opcode::parameter, 3 } };
+    CHECK_FALSE(expression(bad_param, 1, 2).valid());
+    CHECK(std::isnan(expression(bad_param, 1, 2).evaluate(0.0f, nullptr)));
+
+    // Parameter indices are whole numbers
+    const instruction nan_param[] = { { opcode::parameter, NAN } };
+    CHECK_FALSE(expression(nan_param, 1, 2).valid());
+    const instruction half_param[] = { { opcode::parameter, 0.5f } };
+    CHECK_FALSE(expression(half_param, 1, 2).valid());
+}
+
+TEST_CASE("Adaptive sampling follows the curvature")
+{
+    // Circle of radius 0.5: (0.5 cos t, 0.5 sin t)
+    const instruction x_code[] = { { opcode::constant, 0.5f },
+                                   { opcode::variable, 0 },
+                                   { opcode::cos, 0 },
+                                   { opcode::mul, 0 } };
+    const instruction y_code[] = { { opcode::constant, 0.5f },
+                                   { opcode::variable, 0 },
+                                   { opcode::sin, 0 },
+                                   { opcode::mul, 0 } };
+    const expression x(x_code, 4, 0), y(y_code, 4, 0);
+
+    const float two_pi = 6.2831853f;
+    const float tolerance = 1e-5f;
+    std::vector<fvec3> points;
+    sample_parametric(x, y, nullptr, 0.0f, two_pi, tolerance, points);
+
+    // Chords of a circle stay within tolerance of it
+    REQUIRE(points.size() > 65);
+    for (std::size_t i = 1; i < points.size(); i++)
+    {
+        fvec3 mid = 0.5f * (points[i - 1] + points[i]);
+        CHECK(0.5f - mid.length() <= 2 * tolerance);
+    }
+
+    // A straight line needs no refinement at all
+    const instruction line[] = { { opcode::variable, 0 } };
+    const expression id(line, 1, 0);
+    std::vector<fvec3> straight;
+    sample_parametric(id, id, nullptr, 0.0f, 1.0f, tolerance, straight);
+    CHECK(straight.size() == 65);
+
+    // log(t) is undefined below 0, those samples are dropped
+    const instruction log_code[] = { { opcode::variable, 0 },
+                                     { opcode::log, 0 } };
+    const expression log_t(log_code, 2, 0);
+    std::vector<fvec3> half;
+    sample_parametric(id, log_t, nullptr, -1.0f, 1.0f, 1e-3f, half);
+    REQUIRE_FALSE(half.empty());
+    for (auto &p : half)
+        CHECK(p.x > 0.0f);
+}
+
+TEST_CASE("Sampling lifts the pen at poles and undefined parts")
+{
+    const instruction line[] = { { opcode::variable, 0 } };
+    const expression id(line, 1, 0);
+    auto separators = [](const std::vector<fvec3> &points) {
+        return std::count_if(points.begin(), points.end(),
+                             [](fvec3 p) { return std::isnan(p.x); });
+    };
+
+    // tan(t) jumps from +inf to -inf at pi / 2, no sample is infinite
+    const instruction tan_code[] = { { opcode::variable, 0 },
+                                     { opcode::tan, 0 } };
+    const expression tan_t(tan_code, 2, 0);
+    std::vector<fvec3> tangent;
+    sample_parametric(id, tan_t, nullptr, -1.4f, 1.8f, 1e-3f, tangent);
+    REQUIRE(separators(tangent) == 1);
+    const auto gap = std::find_if(tangent.begin(), tangent.end(),
+                                  [](fvec3 p) { return std::isnan(p.x); });
+    CHECK((gap - 1)->x < 1.5708f);
+    CHECK((gap - 1)->y > 100.0f);
+    CHECK((gap + 1)->x > 1.5707f);
+    CHECK((gap + 1)->y < -100.0f);
+
+    // 1 / t is infinite at 0, a sample of the grid
+    const instruction inverse_code[] = { { opcode::constant, 1 },
+                                         { opcode::variable, 0 },
+                                         { opcode::div, 0 } };
+    const expression inverse(inverse_code, 3, 0);
+    std::vector<fvec3> hyperbola;
+    sample_parametric(id, inverse, nullptr, -1.0f, 1.0f, 1e-3f, hyperbola);
+    CHECK(separators(hyperbola) == 1);
+    CHECK(std::isfinite(hyperbola.front().x));
+    CHECK(std::isfinite(hyperbola.back().x));
+}
+
+TEST_CASE("Continuous curves have no pen lifts, even sampled exactly")
+{
+    auto separators = [](const std::vector<fvec3> &points) {
+        return std::count_if(points.begin(), points.end(),
+                             [](fvec3 p) { return std::isnan(p.x); });
+    };
+
+    // (t, 10 sin(5 t)) and a unit circle, with no tolerance every interval
+    // reaches the last level without being flat
+    const instruction line[] = { { opcode::variable, 0 } };
+    const instruction wave_code[] = { { opcode::constant, 10 },
+                                      { opcode::constant, 5 },
+                                      { opcode::variable, 0 },
+                                      { opcode::mul, 0 },
+                                      { opcode::sin, 0 },
+                                      { opcode::mul, 0 } };
+    const instruction cos_code[] = { { opcode::variable, 0 },
+                                     { opcode::cos, 0 } };
+    const instruction sin_code[] = { { opcode::variable, 0 },
+                                     { opcode::sin, 0 } };
+    const expression id(line, 1, 0), wave(wave_code, 6, 0),
+        cos_t(cos_code, 2, 0), sin_t(sin_code, 2, 0);
+
+    std::vector<fvec3> points;
+    sample_parametric(id, wave, nullptr, 0.0f, 6.2831853f, 0.0f, points);
+    CHECK(separators(points) == 0);
+
+    points.clear();
+    sample_parametric(cos_t, sin_t, nullptr, 0.0f, 6.2831853f, 0.0f, points);
+    CHECK(separators(points) == 0);
+}
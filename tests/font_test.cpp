@@ -0,0 +1,185 @@
+#include <doctest/doctest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "../fastmathart/font.h"
+
+// Big endian writer for the font tables
+struct table_writer
+{
+    std::vector<std::uint8_t> bytes;
+
+    table_writer &u16(int value)
+    {
+        bytes.push_back(static_cast<std::uint8_t>(value >> 8));
+        bytes.push_back(static_cast<std::uint8_t>(value));
+        return *this;
+    }
+
+    table_writer &u32(std::uint32_t value)
+    {
+        u16(static_cast<int>(value >> 16));
+        return u16(static_cast<int>(value & 0xFFFF));
+    }
+
+    table_writer &zeros(std::size_t count)
+    {
+        bytes.insert(bytes.end(), count, 0);
+        return *this;
+    }
+};
+
+/*
+Smallest usable TrueType font, 1000 units per em:
+    glyph 0, the missing glyph, has no outline
+    glyph 1 ('A') is the square [0, 500] x [0, 500]
+    glyph 2 ('B') is glyph 1 moved 500 units right, as a composite
+*/
+static std::vector<std::uint8_t> make_test_font()
+{
+    table_writer head;
+    head.u32(0x00010000).zeros(14).u16(1000).zeros(30).u16(1).u16(0);
+
+    table_writer hhea;
+    hhea.u32(0x00010000).u16(800).u16(0x10000 - 200).u16(0).zeros(24).u16(3);
+
+    table_writer maxp;
+    maxp.u32(0x00005000).u16(3);
+
+    table_writer hmtx;
+    hmtx.u16(500).u16(0).u16(600).u16(0).u16(1100).u16(0);
+
+    table_writer cmap;
+    cmap.u16(0).u16(1).u16(3).u16(1).u32(12);
+    cmap.u16(4).u16(32).u16(0).u16(4).zeros(6);
+    cmap.u16('B').u16(0xFFFF).u16(0);
+    cmap.u16('A').u16(0xFFFF);
+    cmap.u16(0x10000 - ('A' - 1)).u16(1);
+    cmap.u16(0).u16(0);
+
+    table_writer glyf;
+    glyf.u16(1).u16(0).u16(0).u16(500).u16(500);
+    glyf.u16(3).u16(0);
+    glyf.bytes.insert(glyf.bytes.end(), 4, 0x01);
+    glyf.u16(0).u16(0).u16(500).u16(0);
+    glyf.u16(0).u16(500).u16(0).u16(0x10000 - 500);
+    const auto square_end = static_cast<std::uint32_t>(glyf.bytes.size());
+    glyf.u16(0xFFFF).u16(500).u16(0).u16(1000).u16(500);
+    glyf.u16(0x0003).u16(1).u16(500).u16(0);
+    const auto composite_end = static_cast<std::uint32_t>(glyf.bytes.size());
+
+    table_writer loca;
+    loca.u32(0).u32(0).u32(square_end).u32(composite_end);
+
+    const std::vector<std::pair<std::string, table_writer *>> tables = {
+        { "cmap", &cmap }, { "glyf", &glyf }, { "head", &head },
+        { "hhea", &hhea }, { "hmtx", &hmtx }, { "loca", &loca },
+        { "maxp", &maxp }
+    };
+
+    table_writer file;
+    file.u32(0x00010000).u16(static_cast<int>(tables.size())).zeros(6);
+    auto offset = static_cast<std::uint32_t>(12 + 16 * tables.size());
+    for (auto &[tag, table] : tables)
+    {
+        file.bytes.insert(file.bytes.end(), tag.begin(), tag.end());
+        const auto length = static_cast<std::uint32_t>(table->bytes.size());
+        file.u32(0).u32(offset).u32(length);
+        offset += (length + 3) & ~3u;
+    }
+    for (auto &[tag, table] : tables)
+    {
+        file.bytes.insert(file.bytes.end(), table->bytes.begin(),
+                          table->bytes.end());
+        file.zeros((4 - table->bytes.size() % 4) % 4);
+    }
+    return file.bytes;
+}
+
+TEST_CASE("Font metrics and character map")
+{
+    font face(make_test_font());
+    REQUIRE(face.valid());
+
+    CHECK(face.glyph_count() == 3);
+    CHECK(face.glyph_index('A') == 1);
+    CHECK(face.glyph_index('B') == 2);
+    CHECK(face.glyph_index('Z') == 0);
+    CHECK(face.glyph_index(0x1F600) == 0);
+
+    CHECK(face.advance(1) == doctest::Approx(0.6f));
+    CHECK(face.ascender() == doctest::Approx(0.8f));
+    CHECK(face.descender() == doctest::Approx(-0.2f));
+    CHECK(face.line_height() == doctest::Approx(1.0f));
+
+    CHECK_FALSE(font(std::vector<std::uint8_t>(64, 0)).valid());
+}
+
+TEST_CASE("Glyph outlines are cached in em units")
+{
+    font face(make_test_font());
+
+    const auto &square = face.outline(1);
+    REQUIRE(square.curves.size() == 4);
+    CHECK(square.contour_ends == std::vector<std::size_t>{ 4 });
+    CHECK(square.curves[1].p4.x == doctest::Approx(0.5f));
+    CHECK(square.curves[1].p4.y == doctest::Approx(0.5f));
+    CHECK(&face.outline(1) == &square);
+
+    // The composite is the square, moved
+    const auto &moved = face.outline(2);
+    REQUIRE(moved.curves.size() == 4);
+    CHECK(moved.curves[1].p4.x == doctest::Approx(1.0f));
+    CHECK(moved.curves[1].p4.y == doctest::Approx(0.5f));
+
+    CHECK(face.outline(0).curves.size() == 0);
+}
+
+TEST_CASE("Flattened contours end with a NaN point")
+{
+    font face(make_test_font());
+
+    const auto &points = face.flattened(1, 40);
+    REQUIRE(points.size() == 6);
+    CHECK(points[0].x == points[4].x);
+    CHECK(points[0].y == points[4].y);
+    CHECK(std::isnan(points[5].x));
+    CHECK(&face.flattened(1, 40) == &points);
+}
+
+TEST_CASE("Coverage masks")
+{
+    font face(make_test_font());
+
+    // Half an em at 40 pixels per em: a 20 x 20 pixels square above the
+    // baseline
+    const auto &mask = face.mask(1, 40);
+    CHECK(mask.left == 0);
+    CHECK(mask.top == -20);
+    REQUIRE(mask.width >= 20);
+    REQUIRE(mask.height >= 20);
+    CHECK(mask.coverage[0] == 255);
+    CHECK(std::accumulate(mask.coverage.begin(), mask.coverage.end(), 0)
+          == 400 * 255);
+    CHECK(&face.mask(1, 40) == &mask);
+
+    // Exact coverage along the rows, nonzero winding for overlaps
+    const float n = std::numeric_limits<float>::quiet_NaN();
+    const auto half = rasterize_coverage({ { 0.5f, 0.0f, 0.0f },
+                                           { 0.5f, 1.0f, 0.0f },
+                                           { 1.0f, 1.0f, 0.0f },
+                                           { 1.0f, 0.0f, 0.0f },
+                                           { n, n, n },
+                                           { 0.5f, 0.0f, 0.0f },
+                                           { 0.5f, 1.0f, 0.0f },
+                                           { 1.0f, 1.0f, 0.0f },
+                                           { 1.0f, 0.0f, 0.0f },
+                                           { n, n, n } });
+    CHECK(half.left == 0);
+    CHECK(half.coverage[0] == 128);
+}
@@ -0,0 +1,79 @@
+#include <doctest/doctest.h>
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "../fastmathart/utils/kernels.h"
+
+TEST_CASE("Every kernel variant returns the generic results")
+{
+    std::mt19937 rng(45);
+    std::uniform_real_distribution<float> coord(-2.0f, 2.0f);
+    std::uniform_int_distribution<int> byte(0, 255);
+
+    // Odd sizes, for the tails after the vector loops
+    const std::size_t count = 1037;
+    std::vector<math::fvec3> a(count), b(count);
+    std::vector<float> ts(count);
+    for (std::size_t k = 0; k < count; k++)
+    {
+        a[k] = { coord(rng), coord(rng), coord(rng) };
+        b[k] = { coord(rng), coord(rng), coord(rng) };
+        ts[k] = float(k) / float(count - 1);
+    }
+    const math::CubicBezier curve(a[0], a[1], b[2], b[3]);
+
+    std::vector<std::uint8_t> pixels(count * 4);
+    for (auto &c : pixels)
+        c = static_cast<std::uint8_t>(byte(rng));
+    std::uint16_t weighted[48];
+    const int a8 = 77;
+    for (int j = 0; j < 48; j++)
+        weighted[j] = static_cast<std::uint16_t>((j * 5 % 256) * a8 + 127);
+
+    const auto &reference = kernels::for_level(cpu::level::generic);
+    for (int l = 0; l <= static_cast<int>(cpu::detected()); l++)
+    {
+        const auto level = static_cast<cpu::level>(l);
+        const auto &variant = kernels::for_level(level);
+
+        std::vector<math::fvec3> expected(count), actual(count);
+        reference.lerp_points(a.data(), b.data(), 0.3f, expected.data(),
+                              count);
+        variant.lerp_points(a.data(), b.data(), 0.3f, actual.data(), count);
+        CHECK(std::memcmp(expected.data(), actual.data(),
+                          count * sizeof(math::fvec3))
+              == 0);
+
+        reference.eval_cubic(curve, ts.data(), expected.data(), count);
+        variant.eval_cubic(curve, ts.data(), actual.data(), count);
+        CHECK(std::memcmp(expected.data(), actual.data(),
+                          count * sizeof(math::fvec3))
+              == 0);
+        CHECK(expected[count / 2] == curve.valueAt(ts[count / 2]));
+
+        auto over = pixels, over_ref = pixels;
+        reference.blend_over(over_ref.data(), over_ref.size(), weighted, 48,
+                             a8);
+        variant.blend_over(over.data(), over.size(), weighted, 48, a8);
+        CHECK(over == over_ref);
+
+        auto add = pixels, add_ref = pixels;
+        reference.blend_add(add_ref.data(), add_ref.size(), weighted, 48, a8);
+        variant.blend_add(add.data(), add.size(), weighted, 48, a8);
+        CHECK(add == add_ref);
+
+        std::vector<std::uint8_t> rgb(count * 3), rgbx(count * 4);
+        variant.rgbx_to_rgb(pixels.data(), rgb.data(), count);
+        variant.rgb_to_rgbx(rgb.data(), rgbx.data(), count);
+        for (std::size_t p = 0; p < count; p++)
+        {
+            CHECK(std::memcmp(&rgbx[4 * p], &pixels[4 * p], 3) == 0);
+            CHECK(rgbx[4 * p + 3] == 0);
+        }
+    }
+
+    // The override can only lower the level
+    CHECK(cpu::selected() <= cpu::detected());
+}
@@ -0,0 +1,69 @@
+#include <doctest/doctest.h>
+
+#include <utility>
+
+#include "../fastmathart/math/bezier.h"
+#include "../fastmathart/utils/arena.h"
+#include "../fastmathart/utils/memory.h"
+#include "../fastmathart/utils/pixelUtils.h"
+
+TEST_CASE("Memory is counted by subsystem")
+{
+    const auto frames = memory::query(memory::frames).current;
+    const std::size_t frame_bytes =
+        pixel_buffer_t(16, 8).size() * sizeof(pixel_buffer_t::channel_type);
+    {
+        pixel_buffer_t frame(16, 8);
+        video_buffer_t video(16, 8, 3);
+        CHECK(memory::query(memory::frames).current
+              == frames + 4 * frame_bytes);
+
+        // Moves hand the storage over
+        video_buffer_t moved(std::move(video));
+        pixel_buffer_t moved_frame(std::move(frame));
+        CHECK(moved_frame.buffer != nullptr);
+        CHECK(memory::query(memory::frames).current
+              == frames + 4 * frame_bytes);
+    }
+    CHECK(memory::query(memory::frames).current == frames);
+
+    const auto geometry = memory::query(memory::geometry).current;
+    {
+        math::BezierPath path;
+        path.reserve(10);
+        CHECK(memory::query(memory::geometry).current
+              == geometry + 10 * sizeof(math::CubicBezier));
+
+        // The arena's blocks count, not what is allocated from them
+        utils::frame_arena arena(4096);
+        math::BezierPath transient(&arena);
+        transient.reserve(10);
+        transient.reserve(20);
+        CHECK(memory::query(memory::geometry).current
+              == geometry + 10 * sizeof(math::CubicBezier) + 4096);
+    }
+    CHECK(memory::query(memory::geometry).current == geometry);
+}
+
+TEST_CASE("Charges follow their object")
+{
+    const auto caches = memory::query(memory::caches);
+    memory::reset_peaks();
+    {
+        memory::charge a(memory::caches, 100);
+        memory::charge copy = a;
+        copy.add(50);
+        CHECK(memory::query(memory::caches).current == caches.current + 250);
+        CHECK(memory::query(memory::caches).peak == caches.current + 250);
+
+        memory::charge moved = std::move(a);
+        CHECK(a.bytes() == 0);
+        CHECK(moved.bytes() == 100);
+        CHECK(memory::query(memory::caches).current == caches.current + 250);
+
+        copy = memory::charge(memory::caches, 10);
+        CHECK(memory::query(memory::caches).current == caches.current + 110);
+    }
+    CHECK(memory::query(memory::caches).current == caches.current);
+    CHECK(memory::query(memory::caches).peak >= caches.current + 250);
+}
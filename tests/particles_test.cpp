@@ -0,0 +1,133 @@
+#include <doctest/doctest.h>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "../fastmathart/math/random.h"
+#include "../fastmathart/math/vec.h"
+#include "../fastmathart/particles.h"
+#include "../fastmathart/raster.h"
+
+TEST_CASE("Philox matches the Random123 known answers")
+{
+    CHECK(math::philox4x32({ 0, 0, 0, 0 }, { 0, 0 })
+          == math::philox_counter{ 0x6627e8d5, 0xe169c58d, 0xbc57ac4c,
+                                   0x9b00dbd8 });
+    CHECK(math::philox4x32({ 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff },
+                           { 0xffffffff, 0xffffffff })
+          == math::philox_counter{ 0x408f276d, 0x41c83b0e, 0xa20bc7c6,
+                                   0x6d5451fd });
+    CHECK(math::philox4x32({ 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344 },
+                           { 0xa4093822, 0x299f31d0 })
+          == math::philox_counter{ 0xd16cfe09, 0x94fdcceb, 0x5001e420,
+                                   0x24126ea1 });
+}
+
+TEST_CASE("random_float gives every thread the same stream")
+{
+    auto draw = [] {
+        std::vector<float> values(100);
+        for (auto &v : values)
+            v = math::random_float();
+        return values;
+    };
+
+    std::vector<float> first, second;
+    std::thread a([&] { first = draw(); });
+    std::thread b([&] { second = draw(); });
+    a.join();
+    b.join();
+
+    CHECK(first == second);
+    CHECK(std::all_of(first.begin(), first.end(),
+                      [](float v) { return v >= 0.0f && v < 1.0f; }));
+    CHECK(std::adjacent_find(first.begin(), first.end()) == first.end());
+}
+
+static PyAPI::Particles make_emitter(PyAPI::Properties &props,
+                                     unsigned int seed)
+{
+    PyAPI::Particles emitter{};
+    emitter.count = 1000;
+    emitter.seconds = 1.0f;
+    emitter.seed = seed;
+    emitter.lifetime = 0.5f;
+    emitter.radius = 0.1f;
+    emitter.spread = 3.14159f;
+    emitter.speed_min = 0.2f;
+    emitter.speed_max = 0.8f;
+    emitter.gravity_y = -1.0f;
+    emitter.drag = 0.5f;
+    emitter.properties = &props;
+    return emitter;
+}
+
+TEST_CASE("Particle runs are reproducible")
+{
+    PyAPI::Color color{ 1.0f, 0.5f, 0.0f };
+    PyAPI::Properties props{ 0.2f, -0.1f, 0.0f, &color, 0.0f, nullptr, 1.0f };
+
+    particle_system a(make_emitter(props, 7), 30), b(make_emitter(props, 7), 30),
+        c(make_emitter(props, 8), 30);
+    for (int i = 0; i < 40; i++)
+    {
+        a.step();
+        b.step();
+        c.step();
+    }
+
+    CHECK(a.frame() == 40);
+    CHECK(a.x == b.x);
+    CHECK(a.vy == b.vy);
+    CHECK(a.opacity == b.opacity);
+    CHECK(a.x != c.x);
+
+    // Every particle has been born and reborn by now
+    CHECK(std::all_of(a.age.begin(), a.age.end(), [](float age) {
+        return age >= 0.0f && age < 0.5f;
+    }));
+}
+
+TEST_CASE("Particles move in a straight line without forces")
+{
+    PyAPI::Color color{ 1.0f, 1.0f, 1.0f };
+    PyAPI::Properties props{ 0.0f, 0.0f, 0.0f, &color, 0.0f, nullptr, 1.0f };
+
+    PyAPI::Particles emitter{};
+    emitter.count = 1;
+    emitter.lifetime = 10.0f;
+    emitter.speed_min = emitter.speed_max = 0.5f;
+    emitter.properties = &props;
+
+    particle_system particles(emitter, 10);
+    for (int i = 0; i < 5; i++)
+        particles.step();
+
+    CHECK(particles.x[0] == doctest::Approx(0.25f));
+    CHECK(particles.y[0] == doctest::Approx(0.0f));
+    CHECK(particles.opacity[0] == doctest::Approx(0.95f));
+}
+
+TEST_CASE("Point batches are rasterized with their own colors")
+{
+    basic_pixel_buffer<RGB_8> frame(8, 8);
+    frame.clear();
+
+    // Centers of pixels (1, 1) and (6, 2), and one off screen
+    const float x[] = { -0.625f, 0.625f, 3.0f };
+    const float y[] = { 0.625f, 0.375f, 0.0f };
+    const float r[] = { 1.0f, 0.0f, 1.0f };
+    const float g[] = { 0.0f, 1.0f, 1.0f };
+    const float b[] = { 0.0f, 0.0f, 1.0f };
+    const float opacity[] = { 1.0f, 0.5f, 1.0f };
+    render_points<blend_mode::over>(x, y, r, g, b, opacity, 3, 0, frame);
+
+    CHECK(frame.get_pixel(1, 1).r == 255);
+    CHECK(frame.get_pixel(6, 2).g == 128);
+
+    int lit = 0;
+    for (std::size_t i = 0; i < frame.size(); i++)
+        lit += frame.buffer[i] != 0;
+    CHECK(lit == 2);
+}
@@ -0,0 +1,90 @@
+#include <doctest/doctest.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+#include "../fastmathart/math/projection.h"
+#include "../fastmathart/raster.h"
+
+static math::fvec3 reference_projection(const math::mat4 &m, math::fvec3 p)
+{
+    float v[4];
+    for (int r = 0; r < 4; r++)
+        v[r] = m(r, 0) * p.x + m(r, 1) * p.y + m(r, 2) * p.z + m(r, 3);
+    return { v[0] / v[3], v[1] / v[3], v[2] / v[3] };
+}
+
+TEST_CASE("Batched projection matches the matrix product")
+{
+    const auto camera =
+        math::mat4::perspective(1.0f, 0.1f, 100.0f)
+        * math::mat4::look_at({ 1.0f, 2.0f, 4.0f }, { 0, 0, 0 }, { 0, 1, 0 })
+        * math::mat4::rotation({ 0.0f, 1.0f, 0.0f }, 0.7f);
+
+    // More than one batch, and a partial one
+    std::vector<math::fvec3> points;
+    for (int i = 0; i < 1000; i++)
+        points.emplace_back(std::sin(0.1f * i), std::cos(0.37f * i),
+                            0.001f * i - 0.5f);
+
+    std::vector<math::fvec3> projected(points.size());
+    math::project_points(camera, points.data(), points.size(),
+                         projected.data());
+
+    for (std::size_t i = 0; i < points.size(); i++)
+    {
+        const auto expected = reference_projection(camera, points[i]);
+        CHECK(projected[i].x == doctest::Approx(expected.x).epsilon(1e-4));
+        CHECK(projected[i].y == doctest::Approx(expected.y).epsilon(1e-4));
+        CHECK(projected[i].z == doctest::Approx(expected.z).epsilon(1e-4));
+    }
+}
+
+TEST_CASE("Camera looks at its target")
+{
+    const auto camera = math::mat4::perspective(1.0f, 0.1f, 100.0f)
+        * math::mat4::look_at({ 0.0f, 0.0f, 3.0f }, { 0, 0, 0 }, { 0, 1, 0 });
+
+    const auto center = math::project_point(camera, { 0, 0, 0 });
+    CHECK(center.x == doctest::Approx(0.0f));
+    CHECK(center.y == doctest::Approx(0.0f));
+
+    // Further is deeper, and above stays above
+    const auto far = math::project_point(camera, { 0.0f, 0.5f, -2.0f });
+    const auto near = math::project_point(camera, { 0.0f, 0.5f, 1.0f });
+    CHECK(far.z > near.z);
+    CHECK(near.y > far.y);
+    CHECK(far.y > 0.0f);
+
+    // Behind the camera and past the far plane
+    CHECK_FALSE(math::is_projected(math::project_point(camera, { 0, 0, 5 })));
+    CHECK_FALSE(
+        math::is_projected(math::project_point(camera, { 0, 0, -200 })));
+}
+
+TEST_CASE("Polylines through an identity camera match the 2D path")
+{
+    const std::array<math::fvec3, 4> points{ math::fvec3{ -0.6f, -0.4f, 0.0f },
+                                             math::fvec3{ 0.1f, 0.5f, 0.0f },
+                                             math::fvec3{ 0.5f, -0.2f, 0.0f },
+                                             math::fvec3{ 0.7f, 0.6f, 0.0f } };
+    const auto transform = math::affine2::from_array(
+        std::array{ 0.8f, -0.2f, 0.1f, 0.3f, 0.9f, -0.05f }.data());
+    const pixel_writer<frame_format, blend_mode::replace> writer(
+        color_t<RGB_8>(255, 255, 255));
+
+    pixel_buffer_t flat(96, 64), projected(96, 64);
+    flat.clear();
+    projected.clear();
+
+    render_polyline(points.data(), points.size(), transform, 2, flat, writer);
+    render_polyline(points.data(), points.size(), transform,
+                    math::mat4::identity(), 2, projected, writer);
+
+    CHECK(std::any_of(flat.buffer, flat.buffer + flat.size(),
+                      [](std::uint8_t c) { return c != 0; }));
+    CHECK(std::equal(flat.buffer, flat.buffer + flat.size(),
+                     projected.buffer));
+}
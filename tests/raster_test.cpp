@@ -0,0 +1,297 @@
+#include <doctest/doctest.h>
+
+#include <array>
+
+#include "../fastmathart/raster.h"
+
+TEST_CASE("Disk kernel covers the pixels inside the radius")
+{
+    pixel_buffer_t frame(32, 32);
+    frame.clear();
+
+    const math::vec3<int> center(10, 12, 0);
+    render_disk(center, 5, frame, color_t<RGB_8>(255, 0, 0));
+
+    for (int y = 0; y < frame.height; y++)
+    {
+        for (int x = 0; x < frame.width; x++)
+        {
+            int dx = x - center.x;
+            int dy = y - center.y;
+            bool inside = dx * dx + dy * dy < 25;
+            CHECK((frame.get_pixel(x, y).r == 255) == inside);
+        }
+    }
+
+    // Clipped against the borders instead of writing out of bounds
+    render_disk({ 0, 0, 0 }, 8, frame, color_t<RGB_8>(0, 255, 0));
+    CHECK(frame.get_pixel(0, 0).g == 255);
+    CHECK(frame.get_pixel(7, 0).g == 255);
+    CHECK(frame.get_pixel(8, 0).g == 0);
+}
+
+// A disk at every Bresenham step from a to b
+static void stamp_segment(math::vec3<int> a, math::vec3<int> b, int radius,
+                          pixel_buffer_t &frame, color_t<RGB_8> color)
+{
+    math::vec3<int> p = a;
+    int dx = std::abs(b.x - a.x), dy = std::abs(b.y - a.y);
+    int sx = a.x < b.x ? 1 : -1, sy = a.y < b.y ? 1 : -1;
+    int err = dx - dy;
+    while (true)
+    {
+        render_disk(p, radius, frame, color);
+        if (p.x == b.x && p.y == b.y)
+            break;
+        int e2 = 2 * err;
+        if (e2 > -dy)
+        {
+            err -= dy;
+            p.x += sx;
+        }
+        if (e2 < dx)
+        {
+            err += dx;
+            p.y += sy;
+        }
+    }
+}
+
+TEST_CASE("Segment kernel matches stamped disks")
+{
+    pixel_buffer_t stamped(64, 48);
+    pixel_buffer_t spans(64, 48);
+    stamped.clear();
+    spans.clear();
+
+    const math::vec3<int> a(3, 40, 0), b(58, 5, 0);
+    const int radius = 4;
+    const color_t<RGB_8> white(255, 255, 255);
+
+    stamp_segment(a, b, radius, stamped, white);
+    render_segment(a, b, radius, spans,
+                   pixel_writer<frame_format, blend_mode::replace>(white));
+
+    CHECK(std::equal(stamped.buffer, stamped.buffer + stamped.size(),
+                     spans.buffer));
+}
+
+TEST_CASE("Segments crossing the frame walk only its steps, same pixels")
+{
+    const color_t<RGB_8> white(255, 255, 255);
+    const std::array<std::array<math::vec3<int>, 2>, 8> segments = { {
+        { { { -900, 30, 0 }, { 1000, 10, 0 } } },   // x major, both sides
+        { { { 2000, -700, 0 }, { -1500, 900, 0 } } }, // both axes
+        { { { 20, -3000, 0 }, { 41, 2500, 0 } } },  // y major
+        { { { -50, -41, 0 }, { 30, 24, 0 } } },     // ends inside
+        { { { 30, 24, 0 }, { -400, 300, 0 } } },    // starts inside
+        { { { -300, -300, 0 }, { 300, 300, 0 } } }, // diagonal
+        { { { -300, 60, 0 }, { 300, 70, 0 } } },    // below the frame
+        { { { 100, 10, 0 }, { 900, 40, 0 } } },     // right of it
+    } };
+
+    for (const auto &[a, b] : segments)
+    {
+        for (int radius : { 1, 3, 6 })
+        {
+            pixel_buffer_t stamped(64, 48);
+            pixel_buffer_t spans(64, 48);
+            stamped.clear();
+            spans.clear();
+
+            stamp_segment(a, b, radius, stamped, white);
+            render_segment(
+                a, b, radius, spans,
+                pixel_writer<frame_format, blend_mode::replace>(white));
+            CHECK(std::equal(stamped.buffer, stamped.buffer + stamped.size(),
+                             spans.buffer));
+        }
+    }
+}
+
+TEST_CASE("Segments are clipped to the guard band before truncation")
+{
+    PyAPI::Color color{ 1.0f, 1.0f, 1.0f };
+    PyAPI::Properties props{};
+    props.color = &color;
+    props.thickness = 0.05f;
+    props.opacity = 1.0f;
+
+    auto lit = [](const pixel_buffer_t &frame) {
+        return std::any_of(frame.buffer, frame.buffer + frame.size(),
+                           [](std::uint8_t c) { return c != 0; });
+    };
+
+    // Far past the right edge, the same pixels as just past it
+    pixel_buffer_t expected(64, 48), actual(64, 48);
+    expected.clear();
+    actual.clear();
+    render_line({ 0.0f, 0.0f, 0.0f }, { 1.5f, 0.0f, 0.0f }, expected, props);
+    render_line({ 0.0f, 0.0f, 0.0f }, { 1e12f, 0.0f, 0.0f }, actual, props);
+    CHECK(lit(actual));
+    CHECK(std::equal(actual.buffer, actual.buffer + actual.size(),
+                     expected.buffer));
+
+    // Across the frame from both sides, and zoomed in
+    actual.clear();
+    render_line({ -1e9f, -1e9f, 0.0f }, { 1e9f, 1e9f, 0.0f }, actual, props);
+    CHECK(lit(actual));
+
+    actual.clear();
+    const auto zoom = math::affine2::from_array(
+        std::array{ 1e10f, 0.0f, 0.0f, 0.0f, 1e10f, 0.0f }.data());
+    const auto line = math::CubicBezier::straightLine({ -1.0f, 0.0f, 0.0f },
+                                                      { 1.0f, 0.0f, 0.0f });
+    render_cubic_bezier(line, zoom, 2, actual,
+                        pixel_writer<frame_format, blend_mode::replace>(
+                            color_t<RGB_8>(255, 255, 255)));
+    CHECK(lit(actual));
+
+    // Entirely off screen, or too far to be finite in raster space
+    actual.clear();
+    render_line({ 1e12f, 1e12f, 0.0f }, { 2e12f, 1e12f, 0.0f }, actual, props);
+    render_line({ 0.0f, 0.0f, 0.0f }, { 3e38f, 0.0f, 0.0f }, actual, props);
+    CHECK_FALSE(lit(actual));
+}
+
+TEST_CASE("Blend modes per format")
+{
+    const color_t<RGB_8> red(255, 0, 0);
+
+    pixel_buffer_t rgb(4, 4);
+    rgb.clear({ 0, 0, 200 });
+    render_disk<blend_mode::over>({ 1, 1, 0 }, 1, rgb, red, 0.5f);
+    CHECK(rgb.get_pixel(1, 1).r == 128);
+    CHECK(rgb.get_pixel(1, 1).b == 100);
+
+    render_disk<blend_mode::add>({ 1, 1, 0 }, 1, rgb, red, 1.0f);
+    CHECK(rgb.get_pixel(1, 1).r == 255); // saturates
+
+    basic_pixel_buffer<LinearRGB_f32> linear(4, 4);
+    linear.clear();
+    render_disk<blend_mode::add>({ 2, 2, 0 }, 1, linear, red, 0.25f);
+    render_disk<blend_mode::add>({ 2, 2, 0 }, 1, linear, red, 0.25f);
+    CHECK(linear.get_pixel(2, 2).r == doctest::Approx(0.5f));
+    CHECK(linear.get_pixel(2, 2).g == 0.0f);
+
+    basic_pixel_buffer<RGBA_8> rgba(4, 4);
+    rgba.clear();
+    render_disk<blend_mode::over>({ 0, 0, 0 }, 1, rgba, red, 0.5f);
+    CHECK(rgba.row(0)[0] == 128);
+    CHECK(rgba.row(0)[3] == 128); // coverage
+    render_disk({ 3, 3, 0 }, 1, rgba, red);
+    CHECK(rgba.row(3)[3 * 4 + 3] == 255);
+
+    pixel_buffer_t resolved(4, 4);
+    convert_pixels(linear, resolved);
+    CHECK(resolved.get_pixel(2, 2).r > 128); // back to sRGB
+    CHECK(resolved.get_pixel(0, 0).r == 0);
+}
+
+TEST_CASE("Span primitives clip once")
+{
+    pixel_buffer_t frame(8, 4);
+    frame.clear();
+    frame.fill_rect(-3, 2, 2, 9, { 10, 20, 30 });
+    CHECK(frame.get_pixel(0, 2).g == 20);
+    CHECK(frame.get_pixel(2, 3).b == 30);
+    CHECK(frame.get_pixel(3, 3).r == 0);
+    CHECK(frame.get_pixel(0, 1).r == 0);
+    frame.fill_span(0, 6, 20, { 1, 2, 3 });
+    CHECK(frame.get_pixel(7, 0).r == 1);
+    CHECK(frame.get_pixel(5, 0).r == 0);
+
+    // Runs blend exactly like single pixels
+    basic_pixel_buffer<RGBX_8> runs(6, 2), pixels(6, 2);
+    runs.clear({ 50, 100, 150 });
+    pixels.clear({ 50, 100, 150 });
+    const pixel_writer<RGBX_8, blend_mode::over> over(
+        color_t<RGB_8>(255, 0, 10), 0.3f);
+    render_rect(-1, 0, 3, 5, runs, over);
+    for (int y = 0; y < 2; y++)
+        for (int x = 0; x <= 3; x++)
+            over.write(pixels.row(y) + 4 * x);
+    for (int y = 0; y < 2; y++)
+        CHECK(std::equal(runs.row(y), runs.row(y) + 4 * 6, pixels.row(y)));
+    CHECK(runs.row(1)[3] == 0);
+
+    // Coverage scales the opacity, zero leaves the pixel alone
+    const std::array<std::uint8_t, 4> coverage{ 0, 255, 128, 255 };
+    pixel_buffer_t covered(4, 1);
+    covered.clear();
+    render_span(0, -1, coverage.data(), 4, covered,
+                pixel_writer<frame_format, blend_mode::over>(
+                    color_t<RGB_8>(200, 0, 0)));
+    CHECK(covered.get_pixel(0, 0).r == 200);
+    CHECK(covered.get_pixel(1, 0).r == 100);
+    CHECK(covered.get_pixel(2, 0).r == 200);
+    CHECK(covered.get_pixel(3, 0).r == 0);
+}
+
+TEST_CASE("Object position is applied at rasterization time")
+{
+    PyAPI::Color color{ 1.0f, 1.0f, 1.0f };
+    PyAPI::Properties props{};
+    props.color = &color;
+    props.thickness = 0.05f;
+    props.opacity = 1.0f;
+
+    const auto line = math::CubicBezier::straightLine({ -0.25f, 0.0f, 0.0f },
+                                                      { 0.25f, 0.0f, 0.0f });
+    const auto moved = math::CubicBezier::straightLine({ 0.25f, 0.5f, 0.0f },
+                                                       { 0.75f, 0.5f, 0.0f });
+
+    pixel_buffer_t expected(64, 64), actual(64, 64);
+    expected.clear();
+    actual.clear();
+
+    render_cubic_bezier(moved, expected, props);
+
+    props.x = 0.5f;
+    props.y = 0.5f;
+    render_cubic_bezier(line, actual, props);
+
+    CHECK(std::any_of(actual.buffer, actual.buffer + actual.size(),
+                      [](std::uint8_t c) { return c != 0; }));
+    CHECK(std::equal(actual.buffer, actual.buffer + actual.size(),
+                     expected.buffer));
+}
+
+TEST_CASE("Instance transforms compose with the object transform")
+{
+    const auto scale = math::affine2::from_array(
+        std::array{ 2.0f, 0.0f, 0.1f, 0.0f, 3.0f, -0.2f }.data());
+    const auto placement = math::affine2::translation(0.5f, 0.25f);
+    const auto p = (placement * scale).apply({ 1.0f, 1.0f, 0.5f });
+
+    CHECK(p.x == doctest::Approx(2.6f));
+    CHECK(p.y == doctest::Approx(3.05f));
+    CHECK(p.z == 0.5f);
+
+    CHECK(math::affine2::identity().is_identity());
+    CHECK(math::lerp(placement, placement, 0.3f).apply({ 0, 0, 0 })
+          == math::fvec3(0.5f, 0.25f, 0.0f));
+}
+
+TEST_CASE("Layers merge the pixels they changed, in order")
+{
+    pixel_buffer_t base(4, 1);
+    base.clear({ 10, 10, 10 });
+
+    pixel_buffer_t first(4, 1), second(4, 1), merged(4, 1);
+    first.copy_from(base);
+    second.copy_from(base);
+    first.fill_span(0, 0, 1, { 255, 255, 255 });
+    second.fill_span(0, 1, 2, { 255, 0, 0 });
+    second.fill_span(0, 3, 3, { 10, 10, 0 }); // one channel as the base
+
+    merged.copy_from(base);
+    overlay_changes(merged, first, base);
+    overlay_changes(merged, second, base);
+
+    CHECK(merged.get_pixel(0, 0).g == 255);
+    CHECK(merged.get_pixel(1, 0).r == 255);
+    CHECK(merged.get_pixel(1, 0).g == 0); // whole pixels, the later layer
+    CHECK(merged.get_pixel(2, 0).g == 0);
+    CHECK(merged.get_pixel(3, 0).b == 0);
+}
@@ -0,0 +1,234 @@
+#include <doctest/doctest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "../fastmathart/render.h"
+
+// Lit pixels of a packed RGB frame
+static int lit_pixels(const std::vector<std::uint8_t> &rgb, int width,
+                      int height, std::size_t stride)
+{
+    int lit = 0;
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+        {
+            const std::uint8_t *p = &rgb[y * stride + x * 3];
+            lit += (p[0] | p[1] | p[2]) != 0;
+        }
+    return lit;
+}
+
+TEST_CASE("Single frames are rendered from the state of the scene")
+{
+    PyAPI::Color white{ 1.0f, 1.0f, 1.0f }, red{ 1.0f, 0.0f, 0.0f };
+    PyAPI::Properties white_props{ 0.0f, 0.0f, 0.0f, &white, 0.2f,
+                                   nullptr, 1.0f };
+    PyAPI::Properties red_props{ 0.0f, 0.0f, 0.0f, &red, 0.2f, nullptr, 1.0f };
+
+    PyAPI::Circle circle{ 0.5f, &white_props };
+    float xs[] = { -0.8f, 0.8f, 0.8f }, ys[] = { -0.8f, -0.8f, 0.8f };
+    PyAPI::Polyline polyline{ xs, ys, 3, &red_props, nullptr };
+
+    void *drawn[] = { &polyline };
+    PyAPI::ShapeType drawn_types[] = { PyAPI::POLYLINES };
+    PyAPI::Wait start{ 0.25f }, end{ 0.25f };
+    PyAPI::Draw draw{ drawn, drawn_types, 1, 0.5f };
+    void *placed[] = { &circle };
+    PyAPI::ShapeType placed_types[] = { PyAPI::CIRCLE };
+    PyAPI::Place place{ placed, placed_types, 1 };
+
+    // 6 black frames, then the polyline over 12 frames on top of the
+    // circle, which stays for 6 more
+    PyAPI::SceneElement elements[] = {
+        { PyAPI::WAIT, &start },
+        { PyAPI::PLACE, &place },
+        { PyAPI::DRAW, &draw },
+        { PyAPI::WAIT, &end },
+    };
+    PyAPI::Scene scene{ elements, 4 };
+    PyAPI::Config config{ 64, 48, 24, nullptr };
+
+    // Rows padded, as in a larger image
+    const std::size_t stride = 64 * 3 + 16;
+    auto render = [&](int frame) {
+        std::vector<std::uint8_t> rgb(stride * 48, 0xAB);
+        REQUIRE(render_scene_frame(scene, config, frame, rgb.data(), stride));
+        return rgb;
+    };
+
+    const auto first = render(0);
+    CHECK(lit_pixels(first, 64, 48, stride) == 0);
+    CHECK(first[64 * 3] == 0xAB); // the padding is left alone
+
+    // The outline is revealed frame after frame, over the circle
+    int previous = lit_pixels(render(6), 64, 48, stride);
+    CHECK(previous > 0);
+    for (int frame = 7; frame < 18; frame++)
+    {
+        const int lit = lit_pixels(render(frame), 64, 48, stride);
+        CHECK(lit >= previous);
+        previous = lit;
+    }
+
+    // The last Wait shows the canvas the Draw left
+    const auto drawn_frame = render(17);
+    CHECK(render(18) == drawn_frame);
+    CHECK(render(23) == drawn_frame);
+
+    std::vector<std::uint8_t> rgb(stride * 48);
+    CHECK_FALSE(render_scene_frame(scene, config, 24, rgb.data(), stride));
+    CHECK_FALSE(render_scene_frame(scene, config, -1, rgb.data(), stride));
+    CHECK_FALSE(render_scene_frame(scene, config, 0, rgb.data(), 64));
+}
+
+TEST_CASE("Off-screen placements are skipped and tiny ones are a dot")
+{
+    PyAPI::Color white{ 1.0f, 1.0f, 1.0f };
+    PyAPI::Properties props{ 0.0f, 0.0f, 0.0f, &white, 0.2f, nullptr, 1.0f };
+
+    // A dense spiral, then copies of it far to the right and shrunk to a
+    // hundredth of a pixel
+    std::vector<float> xs, ys;
+    for (int i = 0; i < 5000; i++)
+    {
+        const float r = 0.9f * i / 5000.0f, a = i * 0.01f;
+        xs.push_back(r * std::cos(a));
+        ys.push_back(r * std::sin(a));
+    }
+    PyAPI::Polyline spiral{ xs.data(), ys.data(), 5000, &props, nullptr };
+    float away[] = { 1, 0, 5.0f, 0, 1, 0 };
+    float tiny[] = { 1e-4f, 0, 0.1f, 0, 1e-4f, 0.1f };
+
+    float point_x[] = { 0.1f, 0.1f }, point_y[] = { 0.1f, 0.1f };
+    PyAPI::Polyline point{ point_x, point_y, 2, &props, nullptr };
+    float identity[] = { 1, 0, 0, 0, 1, 0 };
+
+    auto place_frame = [&](PyAPI::Polyline &shape, float *transforms) {
+        PyAPI::Instanced copies{ &shape, PyAPI::POLYLINES, transforms,
+                                 nullptr, nullptr, 1, &props };
+        void *placed[] = { &copies };
+        PyAPI::ShapeType placed_types[] = { PyAPI::INSTANCED };
+        PyAPI::Place place{ placed, placed_types, 1 };
+        PyAPI::Wait wait{ 0.25f };
+        PyAPI::SceneElement elements[] = {
+            { PyAPI::PLACE, &place },
+            { PyAPI::WAIT, &wait },
+        };
+        PyAPI::Scene scene{ elements, 2 };
+        PyAPI::Config config{ 64, 48, 24, nullptr };
+
+        std::vector<std::uint8_t> rgb(64 * 48 * 3);
+        REQUIRE(render_scene_frame(scene, config, 0, rgb.data(), 64 * 3));
+        return rgb;
+    };
+
+    CHECK(lit_pixels(place_frame(spiral, away), 64, 48, 64 * 3) == 0);
+
+    // The 5000 points are one disk of the stroke, where a single point is
+    const auto dot = place_frame(spiral, tiny);
+    CHECK(lit_pixels(dot, 64, 48, 64 * 3) > 0);
+    CHECK(dot == place_frame(point, identity));
+}
+
+TEST_CASE("Translucent strokes blend over what is under them")
+{
+    PyAPI::Color white{ 1.0f, 1.0f, 1.0f }, red{ 1.0f, 0.0f, 0.0f };
+    PyAPI::Properties white_props{ 0.0f, 0.0f, 0.0f, &white, 0.2f,
+                                   nullptr, 1.0f };
+    PyAPI::Properties red_props{ 0.0f, 0.0f, 0.0f, &red, 0.2f, nullptr, 1.0f };
+
+    // An opaque red line across, then a white one down at half opacity
+    float across_x[] = { -0.9f, 0.9f }, across_y[] = { 0.0f, 0.0f };
+    float down_x[] = { 0.0f, 0.0f }, down_y[] = { -0.9f, 0.9f };
+    PyAPI::Polyline across{ across_x, across_y, 2, &red_props, nullptr };
+    PyAPI::Polyline down{ down_x, down_y, 2, &white_props, nullptr };
+    float identity[] = { 1, 0, 0, 0, 1, 0 };
+    float half = 0.5f;
+    PyAPI::Instanced translucent{ &down, PyAPI::POLYLINES, identity, nullptr,
+                                  &half, 1, &white_props };
+
+    void *placed[] = { &across, &translucent };
+    PyAPI::ShapeType placed_types[] = { PyAPI::POLYLINES, PyAPI::INSTANCED };
+    PyAPI::Place place{ placed, placed_types, 2 };
+    PyAPI::Wait wait{ 0.25f };
+    PyAPI::SceneElement elements[] = {
+        { PyAPI::PLACE, &place },
+        { PyAPI::WAIT, &wait },
+    };
+    PyAPI::Scene scene{ elements, 2 };
+    PyAPI::Config config{ 64, 48, 24, nullptr };
+
+    std::vector<std::uint8_t> rgb(64 * 48 * 3);
+    REQUIRE(render_scene_frame(scene, config, 0, rgb.data(), 64 * 3));
+    auto pixel = [&](int x, int y) { return &rgb[(y * 64 + x) * 3]; };
+
+    // Half white over the black background
+    const std::uint8_t *over_black = pixel(32, 8);
+    CHECK(over_black[0] == 128);
+    CHECK(over_black[1] == 128);
+    CHECK(over_black[2] == 128);
+
+    // Half white over the red line
+    const std::uint8_t *over_red = pixel(32, 24);
+    CHECK(over_red[0] == 255);
+    CHECK(over_red[1] == 128);
+    CHECK(over_red[2] == 128);
+
+    // The red line alone
+    CHECK(pixel(10, 24)[0] == 255);
+    CHECK(pixel(10, 24)[1] == 0);
+}
+
+TEST_CASE("Simultaneous children render each of their frames once")
+{
+    // Every chunk of a single frame, without ffmpeg or the cache
+    const char *names[] = { "FMA_ENCODER", "FMA_NO_CACHE", "FMA_LAYER_MEMORY" };
+    const char *values[] = { "null", "1", "0" };
+    std::string saved[3];
+    bool was_set[3];
+    for (int i = 0; i < 3; i++)
+    {
+        const char *value = std::getenv(names[i]);
+        was_set[i] = value != nullptr;
+        saved[i] = value ? value : "";
+        setenv(names[i], values[i], 1);
+    }
+
+    PyAPI::Color white{ 1.0f, 1.0f, 1.0f };
+    PyAPI::Properties props{ 0.0f, 0.0f, 0.0f, &white, 0.05f, nullptr, 1.0f };
+    PyAPI::Circle circle{ 0.5f, &props };
+    void *drawn[] = { &circle };
+    PyAPI::ShapeType drawn_types[] = { PyAPI::CIRCLE };
+    PyAPI::Config config{ 64, 48, 24, nullptr };
+
+    // The longer child sets the length, the frames rendered grow with it
+    for (float seconds : { 1.0f, 2.0f, 4.0f })
+    {
+        PyAPI::Wait wait{ 2.0f * seconds };
+        PyAPI::Draw draw{ drawn, drawn_types, 1, seconds };
+        void *children[] = { &wait, &draw };
+        PyAPI::ElementType child_types[] = { PyAPI::WAIT, PyAPI::DRAW };
+        PyAPI::Simultaneous simultaneous{ children, child_types, 2 };
+        PyAPI::SceneElement elements[] = {
+            { PyAPI::SIMULTANEOUS, &simultaneous },
+        };
+        PyAPI::Scene scene{ elements, 1 };
+
+        render_scene(scene, config, "simultaneous.mp4");
+        const int frames = static_cast<int>(24.0f * seconds);
+        CHECK(last_render_stats().frames == 2 * frames);
+        CHECK(last_render_stats().layer_frames == 3 * frames);
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        if (was_set[i])
+            setenv(names[i], saved[i].c_str(), 1);
+        else
+            unsetenv(names[i]);
+    }
+}
@@ -0,0 +1,98 @@
+#include <doctest/doctest.h>
+
+#include "../fastmathart/utils/elementCache.h"
+#include "../fastmathart/utils/sceneBuilder.h"
+
+// Chained keys of the elements, they cover every field of the scene
+static std::uint64_t builder_scene_key(const PyAPI::Scene &scene)
+{
+    std::uint64_t key = 0;
+    shape_ids ids;
+    for (int i = 0; i < scene.element_count; i++)
+        PyAPI::element_visitor(
+            [&](auto *elem) { key = hash_element(key, *elem, ids); },
+            scene.elements[i].elem, scene.elements[i].type);
+    return key;
+}
+
+TEST_CASE("Scenes built by handles match the same scene built by hand")
+{
+    PyAPI::Color white{ 1.0f, 1.0f, 1.0f }, red{ 1.0f, 0.0f, 0.0f };
+    PyAPI::Properties props{ 0.1f, -0.2f, 0.0f, &white, 0.01f, &red, 0.8f };
+    float xs[] = { 0.0f, 0.5f, 0.25f, 0.0f, -0.5f };
+    float ys[] = { 0.0f, 0.1f, 0.6f, 0.0f, -0.3f };
+    float transforms[] = { 1, 0, 0.2f, 0, 1, 0, 1, 0, -0.2f, 0, 1, 0 };
+
+    // By hand
+    PyAPI::Circle circle{ 0.5f, &props };
+    PyAPI::Polyline first{ xs, ys, 3, &props, nullptr };
+    PyAPI::Polyline second{ xs + 3, ys + 3, 2, &props, nullptr };
+    PyAPI::Instanced copies{ &circle, PyAPI::CIRCLE, transforms, nullptr,
+                             nullptr, 2, &props };
+    void *placed[] = { &circle };
+    PyAPI::ShapeType placed_types[] = { PyAPI::CIRCLE };
+    PyAPI::Place place{ placed, placed_types, 1 };
+    void *drawn[] = { &first, &second, &copies };
+    PyAPI::ShapeType drawn_types[] = { PyAPI::POLYLINES, PyAPI::POLYLINES,
+                                       PyAPI::INSTANCED };
+    PyAPI::Draw draw{ drawn, drawn_types, 3, 1.5f };
+    PyAPI::Wait wait{ 0.5f };
+    PyAPI::Morph morph{ &first, &circle, PyAPI::POLYLINES, PyAPI::CIRCLE,
+                        1.0f };
+    void *children[] = { &wait, &morph };
+    PyAPI::ElementType child_types[] = { PyAPI::WAIT, PyAPI::MORPH };
+    PyAPI::Simultaneous together{ children, child_types, 2 };
+    PyAPI::SceneElement elements[] = {
+        { PyAPI::PLACE, &place },
+        { PyAPI::DRAW, &draw },
+        { PyAPI::SIMULTANEOUS, &together },
+    };
+    PyAPI::Scene by_hand{ elements, 3 };
+
+    // By handles, from a temporary copy of the properties
+    scene_builder builder;
+    int shape_circle = 0, shape_first = 0;
+    {
+        PyAPI::Color white_copy = white, red_copy = red;
+        PyAPI::Properties copy{ 0.1f, -0.2f, 0.0f, &white_copy, 0.01f,
+                                &red_copy, 0.8f };
+        shape_circle = builder.add_circle(0.5f, &copy);
+        const int starts[] = { 0, 3, 5 };
+        shape_first = builder.add_polylines(xs, ys, nullptr, starts, 2, &copy);
+    }
+    const int shape_copies = builder.add_instanced(
+        shape_circle, transforms, nullptr, nullptr, 2, nullptr);
+    CHECK(shape_first == 1);
+    CHECK(shape_copies == 3);
+    CHECK(builder.shape_count() == 4);
+
+    builder.add_place(&shape_circle, 1);
+    const int drawn_handles[] = { shape_first, shape_first + 1, shape_copies };
+    builder.add_draw(drawn_handles, 3, 1.5f);
+    const int grouped[] = { builder.add_wait(0.5f),
+                            builder.add_morph(shape_first, shape_circle,
+                                              1.0f) };
+    builder.add_simultaneous(grouped, 2);
+
+    auto &built = builder.scene();
+    REQUIRE(built.element_count == 3);
+    CHECK(builder_scene_key(built) == builder_scene_key(by_hand));
+
+    // The points are borrowed
+    auto *draw_built = static_cast<PyAPI::Draw *>(built.elements[1].elem);
+    auto *polyline = static_cast<PyAPI::Polyline *>(draw_built->obj_list[1]);
+    CHECK(polyline->x == xs + 3);
+    CHECK(polyline->point_count == 2);
+
+    // Invalid handles are refused and change nothing
+    const int unknown = 42;
+    CHECK(builder.add_place(&unknown, 1) == -1);
+    CHECK(builder.add_morph(shape_circle, -1, 1.0f) == -1);
+    CHECK(builder.add_simultaneous(grouped, 2) == -1);
+    const int pause = builder.add_wait(1.0f);
+    const int twice[] = { pause, pause };
+    CHECK(builder.add_simultaneous(twice, 2) == -1);
+    CHECK(builder.add_polyline(xs, ys, nullptr, 0, &props) == -1);
+    // Only the pause was added, it is not grouped
+    CHECK(builder.scene().element_count == 4);
+}
@@ -0,0 +1,117 @@
+#include <doctest/doctest.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "../fastmathart/utils/elementCache.h"
+#include "../fastmathart/utils/sceneFile.h"
+
+// Chained keys of the elements, they cover every field of the scene
+static std::uint64_t scene_key(const PyAPI::Scene &scene)
+{
+    std::uint64_t key = 0;
+    shape_ids ids;
+    for (int i = 0; i < scene.element_count; i++)
+        PyAPI::element_visitor(
+            [&](auto *elem) { key = hash_element(key, *elem, ids); },
+            scene.elements[i].elem, scene.elements[i].type);
+    return key;
+}
+
+TEST_CASE("Scene files round trip every element and shape")
+{
+    PyAPI::Color white{ 1.0f, 1.0f, 1.0f }, red{ 1.0f, 0.0f, 0.0f };
+    PyAPI::Properties props{ 0.1f, -0.2f, 0.0f, &white, 0.01f, &red, 0.8f };
+
+    PyAPI::Circle circle{ 0.5f, &props };
+    float xs[] = { 0.0f, 0.5f, 0.25f }, ys[] = { 0.0f, 0.1f, 0.6f },
+          zs[] = { 0.0f, 0.2f, 0.4f };
+    PyAPI::Polyline polyline{ xs, ys, 3, &props, zs };
+    PyAPI::Instruction x_code[] = { { 1, 0.0f }, { 0, 2.0f } };
+    float params[] = { 0.5f };
+    PyAPI::Parametric curve{ x_code, 2, x_code, 1, params, 1,
+                             0.0f, 6.28f, &props };
+    PyAPI::Text text{ "missing.ttf", "Hello\nworld", 0.2f, &props };
+    float transforms[] = { 1, 0, 0, 0, 1, 0, 2, 0, 0.5f, 0, 2, -0.5f };
+    PyAPI::Color colors[] = { red, white };
+    PyAPI::Instanced instanced{ &circle, PyAPI::CIRCLE, transforms, colors,
+                                nullptr, 2, &props };
+
+    void *placed[] = { &circle, &polyline, &curve };
+    PyAPI::ShapeType placed_types[] = { PyAPI::CIRCLE, PyAPI::POLYLINES,
+                                        PyAPI::PARAMETRIC };
+    PyAPI::Place place{ placed, placed_types, 3 };
+    void *drawn[] = { &text, &instanced };
+    PyAPI::ShapeType drawn_types[] = { PyAPI::TEXT, PyAPI::INSTANCED };
+    PyAPI::Draw draw{ drawn, drawn_types, 2, 1.5f };
+    PyAPI::Morph morph{ &circle, &polyline, PyAPI::CIRCLE, PyAPI::POLYLINES,
+                        2.0f };
+    PyAPI::Wait wait{ 0.5f };
+    void *children[] = { &wait, &draw };
+    PyAPI::ElementType child_types[] = { PyAPI::WAIT, PyAPI::DRAW };
+    PyAPI::Simultaneous together{ children, child_types, 2 };
+    float views[32] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+    PyAPI::CameraMove move{ views, 2, 1.0f };
+    PyAPI::Particles particles{ 100,  2.0f, 7u,   1.0f, 0.1f, 1.5f,  0.3f,
+                                0.2f, 0.4f, 0.0f, -1.0f, 0.5f, &red, &props };
+
+    PyAPI::SceneElement elements[] = {
+        { PyAPI::PLACE, &place },         { PyAPI::DRAW, &draw },
+        { PyAPI::MORPH, &morph },         { PyAPI::SIMULTANEOUS, &together },
+        { PyAPI::CAMERA_MOVE, &move },    { PyAPI::PARTICLES, &particles },
+    };
+    PyAPI::Scene scene{ elements, 6 };
+    PyAPI::Camera camera{};
+    camera.view[0] = 2.0f;
+    camera.projection[15] = 3.0f;
+    PyAPI::Config config{ 320, 240, 24, &camera };
+
+    const std::string path =
+        (std::filesystem::temp_directory_path() / "fma_scene_test.fmas")
+            .string();
+    REQUIRE(scene_file::save(scene, config, path));
+
+    {
+        scene_file::mapped file;
+        REQUIRE(file.open(path));
+        const auto &loaded = file.scene();
+        CHECK(loaded.element_count == 6);
+        CHECK(scene_key(loaded) == scene_key(scene));
+
+        CHECK(file.config().width == 320);
+        CHECK(file.config().fps == 24);
+        REQUIRE(file.config().camera != nullptr);
+        CHECK(file.config().camera->view[0] == 2.0f);
+        CHECK(file.config().camera->projection[15] == 3.0f);
+
+        // The same objects are still the same, Morph finds what Place put
+        const auto &loaded_place =
+            *static_cast<PyAPI::Place *>(loaded.elements[0].elem);
+        const auto &loaded_morph =
+            *static_cast<PyAPI::Morph *>(loaded.elements[2].elem);
+        CHECK(loaded_morph.src == loaded_place.obj_list[0]);
+        CHECK(loaded_morph.src != &circle);
+        const auto &loaded_instanced = *static_cast<PyAPI::Instanced *>(
+            static_cast<PyAPI::Draw *>(loaded.elements[1].elem)->obj_list[1]);
+        CHECK(loaded_instanced.opacities == nullptr);
+        CHECK(loaded_instanced.shape == loaded_morph.src);
+    }
+
+    // Truncated and foreign files are refused
+    const auto size = std::filesystem::file_size(path);
+    std::filesystem::resize_file(path, size - 8);
+    scene_file::mapped truncated;
+    CHECK_FALSE(truncated.open(path));
+
+    {
+        std::ofstream foreign(path, std::ios::binary | std::ios::trunc);
+        foreign << std::string(size, 'x');
+    }
+    scene_file::mapped garbage;
+    CHECK_FALSE(garbage.open(path));
+    CHECK_FALSE(garbage.open(path + ".missing"));
+
+    std::filesystem::remove(path);
+}
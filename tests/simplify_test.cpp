@@ -0,0 +1,76 @@
+#include <doctest/doctest.h>
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "../fastmathart/math/simplify.h"
+
+using namespace math;
+
+TEST_CASE("Collinear points are dropped")
+{
+    std::vector<fvec3> line;
+    for (int i = 0; i <= 100; i++)
+        line.emplace_back(i / 100.0f, 0.5f * i / 100.0f, 0.0f);
+
+    std::vector<fvec3> kept;
+    simplify_polyline(line.data(), line.size(), 1e-4f, kept);
+
+    REQUIRE(kept.size() == 2);
+    CHECK(kept.front() == line.front());
+    CHECK(kept.back() == line.back());
+}
+
+TEST_CASE("Simplified polyline stays within the tolerance")
+{
+    std::vector<fvec3> plot;
+    for (int i = 0; i < 10000; i++)
+    {
+        float x = -1.0f + 2.0f * i / 9999.0f;
+        plot.emplace_back(x, 0.5f * std::sin(12.0f * x), 0.0f);
+    }
+
+    const float tolerance = 0.002f;
+    std::vector<fvec3> kept;
+    simplify_polyline(plot.data(), plot.size(), tolerance, kept);
+
+    CHECK(kept.size() < plot.size() / 10);
+
+    // Every original point is close to the segment spanning its x
+    std::size_t segment = 0;
+    for (auto &p : plot)
+    {
+        while (kept[segment + 1].x < p.x)
+            segment++;
+        CHECK(segment_distance2(p, kept[segment], kept[segment + 1])
+              <= tolerance * tolerance * 1.0001f);
+    }
+
+    std::vector<fvec3> all;
+    simplify_polyline(plot.data(), plot.size(), 0.0f, all);
+    CHECK(all.size() == plot.size());
+}
+
+TEST_CASE("Pen lifts survive the simplification")
+{
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    std::vector<fvec3> pieces;
+    for (int i = 0; i <= 50; i++)
+        pieces.emplace_back(i / 50.0f, 0.0f, 0.0f);
+    pieces.emplace_back(nan, nan, nan);
+    pieces.emplace_back(nan, nan, nan);
+    for (int i = 0; i <= 50; i++)
+        pieces.emplace_back(i / 50.0f, 1.0f, 0.0f);
+
+    std::vector<fvec3> kept;
+    simplify_polyline(pieces.data(), pieces.size(), 1e-3f, kept);
+
+    // Both lines down to their ends, one gap between them
+    REQUIRE(kept.size() == 5);
+    CHECK(kept[0] == pieces.front());
+    CHECK(kept[1] == fvec3(1.0f, 0.0f, 0.0f));
+    CHECK(std::isnan(kept[2].x));
+    CHECK(kept[3] == fvec3(0.0f, 1.0f, 0.0f));
+    CHECK(kept[4] == pieces.back());
+}
@@ -0,0 +1,96 @@
+#include <chrono>
+#include <cstdlib>
+#include <fmt/core.h>
+#include <string>
+
+#include "../../fastmathart/render.h"
+
+/*
+======================================
+fma_render: renders a binary scene file, no Python needed
+
+The file is written by save_scene() (fastmathart.save_scene in Python) and
+holds the config too, --width, --height and --fps replace its values.
+======================================
+*/
+
+extern "C" int render_scene_file(const char *path, const char *filename,
+                                 int width, int height, int fps);
+extern "C" void render_statistics(render_stats *stats);
+
+static void usage()
+{
+    fmt::print(
+        "Usage: fma_render <scene file> [-o <output>] [--width <n>]\n"
+        "                  [--height <n>] [--fps <n>] [--stats]\n");
+}
+
+int main(int argc, char **argv)
+{
+    std::string scene_path, output = "out.mp4";
+    int width = 0, height = 0, fps = 0;
+    bool print_stats = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc)
+            {
+                usage();
+                std::exit(1);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "-o" || arg == "--output")
+            output = next();
+        else if (arg == "--width")
+            width = std::max(0, std::atoi(next().c_str()));
+        else if (arg == "--height")
+            height = std::max(0, std::atoi(next().c_str()));
+        else if (arg == "--fps")
+            fps = std::max(0, std::atoi(next().c_str()));
+        else if (arg == "--stats")
+            print_stats = true;
+        else if (arg == "--help" || arg == "-h")
+        {
+            usage();
+            return 0;
+        }
+        else if (scene_path.empty() && !arg.starts_with("-"))
+            scene_path = arg;
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    if (scene_path.empty())
+    {
+        usage();
+        return 1;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    if (render_scene_file(scene_path.c_str(), output.c_str(), width, height,
+                          fps)
+        != 0)
+        return 1;
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    if (print_stats)
+    {
+        render_stats stats{};
+        render_statistics(&stats);
+        fmt::print("{} frames in {:.3f} s (render {:.3f} s, encode {:.3f} s, "
+                   "waiting on the encoder {:.3f} s, cache {:.3f} s, "
+                   "concat {:.3f} s)\n",
+                   stats.frames, elapsed.count(), stats.render_seconds,
+                   stats.encode_seconds, stats.encode_wait_seconds,
+                   stats.cache_seconds, stats.concat_seconds);
+    }
+    return 0;
+}